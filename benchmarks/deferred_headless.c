@@ -0,0 +1,396 @@
+/**********************************************************************************************
+*
+*   raylib-3D - Headless deferred rendering benchmark
+*
+*   Renders the cubicmap scene of models_deferred_advanced.c through the deferred pipeline in an
+*   offscreen EGL context (no window, no GPU needed: works on Mesa llvmpipe) and prints the timings as JSON.
+*
+*   Options:
+*       --width 1280 --height 720   Render resolution
+*       --lights 64                 Number of point lights (up to LIGHT_SET_MAX_LIGHTS)
+*       --frames 300                Frames measured, after --warmup 30 frames
+*       --compact                   Use the compact GBuffer layout
+*       --lighting full|half|quarter  Lighting pass resolution
+*       --ssao                      Run the half resolution SSAO pass
+*       --output file.json          Write the JSON to a file instead of stdout
+*
+*   Compile (raylib built with GRAPHICS_API_OPENGL_33), run from the benchmarks directory:
+*   gcc -o deferred_headless deferred_headless.c -lraylib -lEGL -lm -lpthread -ldl -std=c99
+*
+*   NOTE: Without a window raylib time and screen size are not available, the benchmark keeps
+*   its own clock and sets the viewport after every pass that resets it to the screen
+*
+**********************************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L   // clock_gettime() with -std=c99
+
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define ASSETS_PATH "../examples/assets/"
+
+typedef struct BenchmarkOptions {
+    int width;
+    int height;
+    int lights;
+    int frames;
+    int warmup;
+    bool compact;
+    bool ssao;
+    int lighting;           // LightingResolution
+    const char* output;
+} BenchmarkOptions;
+
+static double GetBenchmarkTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec*1e-9;
+}
+
+// Offscreen context, a pbuffer surface of the render size gives the lighting pass a default framebuffer
+static bool InitOffscreenContext(int width, int height)
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    // Mesa surfaceless platform first, it needs no display server
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != NULL) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if ((display == EGL_NO_DISPLAY) || !eglInitialize(display, NULL, NULL))
+    {
+        TraceLog(LOG_WARNING, "BENCHMARK: Failed to initialize EGL display");
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || (configCount == 0))
+    {
+        TraceLog(LOG_WARNING, "BENCHMARK: No EGL pbuffer config available");
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+
+    if ((surface == EGL_NO_SURFACE) || (context == EGL_NO_CONTEXT) || !eglMakeCurrent(display, surface, surface, context))
+    {
+        TraceLog(LOG_WARNING, "BENCHMARK: Failed to create a GL 3.3 core offscreen context");
+        return false;
+    }
+
+    // Same setup InitWindow() does once the context exists
+    rlLoadExtensions((void*)eglGetProcAddress);
+    rlglInit(width, height);
+
+    return true;
+}
+
+// BeginMode3D() without a window, the aspect comes from the render size
+static void BeginHeadlessMode3D(Camera camera, int width, int height)
+{
+    rlDrawRenderBatchActive();
+
+    rlMatrixMode(RL_PROJECTION);
+    rlPushMatrix();
+    rlLoadIdentity();
+
+    double top = RL_CULL_DISTANCE_NEAR*tan(camera.fovy*0.5*DEG2RAD);
+    double right = top*(double)width/(double)height;
+    rlFrustum(-right, right, -top, top, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    rlMultMatrixf(MatrixToFloat(view));
+
+    rlEnableDepthTest();
+}
+
+static void EndHeadlessMode3D(void)
+{
+    rlDrawRenderBatchActive();
+
+    rlMatrixMode(RL_PROJECTION);
+    rlPopMatrix();
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+
+    rlDisableDepthTest();
+}
+
+// Screen space 2D drawing on the whole render size, EndDeferredMode() resets it to the (missing) window size
+static void SetHeadlessViewport(int width, int height)
+{
+    rlViewport(0, 0, width, height);
+
+    rlMatrixMode(RL_PROJECTION);
+    rlLoadIdentity();
+    rlOrtho(0, width, height, 0, 0, 1);
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+}
+
+// Deterministic light placement, so runs are comparable
+static float GetBenchmarkRandom(unsigned int* seed)
+{
+    *seed = *seed*1664525u + 1013904223u;
+    return (float)(*seed >> 8)/(float)(1 << 24);
+}
+
+static int CompareFloat(const void* a, const void* b)
+{
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static void WriteTimingJson(FILE* file, const char* name, float* samples, int count, bool last)
+{
+    qsort(samples, count, sizeof(float), CompareFloat);
+
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += samples[i];
+
+    fprintf(file, "    \"%s\": { \"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n", name,
+        samples[0], sum/count, samples[(int)ceilf(0.99f*(float)count) - 1], samples[count - 1], last? "" : ",");
+}
+
+static bool ParseOptions(int argc, char** argv, BenchmarkOptions* options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc)? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--compact") == 0) { options->compact = true; continue; }
+        if (strcmp(arg, "--ssao") == 0) { options->ssao = true; continue; }
+        if (value == NULL) return false;
+
+        if (strcmp(arg, "--width") == 0) options->width = atoi(value);
+        else if (strcmp(arg, "--height") == 0) options->height = atoi(value);
+        else if (strcmp(arg, "--lights") == 0) options->lights = atoi(value);
+        else if (strcmp(arg, "--frames") == 0) options->frames = atoi(value);
+        else if (strcmp(arg, "--warmup") == 0) options->warmup = atoi(value);
+        else if (strcmp(arg, "--output") == 0) options->output = value;
+        else if (strcmp(arg, "--lighting") == 0)
+        {
+            if (strcmp(value, "full") == 0) options->lighting = LIGHTING_RESOLUTION_FULL;
+            else if (strcmp(value, "half") == 0) options->lighting = LIGHTING_RESOLUTION_HALF;
+            else if (strcmp(value, "quarter") == 0) options->lighting = LIGHTING_RESOLUTION_QUARTER;
+            else return false;
+        }
+        else return false;
+        i++;
+    }
+
+    if (options->lights > LIGHT_SET_MAX_LIGHTS) options->lights = LIGHT_SET_MAX_LIGHTS;
+    return (options->width > 0) && (options->height > 0) && (options->frames > 0) && (options->lights >= 0) && (options->warmup >= 0);
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options = { 1280, 720, 64, 300, 30, false, false, LIGHTING_RESOLUTION_FULL, NULL };
+    if (!ParseOptions(argc, argv, &options))
+    {
+        printf("usage: %s [--width w] [--height h] [--lights n] [--frames n] [--warmup n] [--compact] [--ssao] [--lighting full|half|quarter] [--output file]\n", argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    if (!InitOffscreenContext(options.width, options.height)) return 1;
+
+    const int width = options.width;
+    const int height = options.height;
+
+    // Same scene as models_deferred_advanced.c
+    R3DShaderVariants gBufferVariants = LoadShaderVariants(ASSETS_PATH "shaders/gbuffer.vs", ASSETS_PATH "shaders/gbuffer.fs");
+    R3DShaderVariants lightingVariants = LoadShaderVariants(0, ASSETS_PATH "shaders/deferredLighting.fs");
+    Shader lightingShader = GetShaderVariant(&lightingVariants, SHADER_FEATURE_SPECULAR | (options.ssao? SHADER_FEATURE_SSAO : 0));
+
+    const char* samplers[] = { "colorbuffer", "normalbuffer", "positionbuffer", "ssaobuffer", "depthbuffer", "emissionbuffer" };
+    for (int i = 0; i < 6; i++)
+    {
+        int unit = i + 1;
+        SetShaderValue(lightingShader, GetShaderLocation(lightingShader, samplers[i]), &unit, SHADER_UNIFORM_INT);
+    }
+
+    unsigned int seed = 1;
+    R3DLightSet lightSet = LoadLightSet();
+    for (int i = 0; i < options.lights; i++)
+    {
+        R3DLight light = { 0 };
+        light.position = (Vector3){ -14.0f + 28.0f*GetBenchmarkRandom(&seed), 1.0f, -5.0f + 10.0f*GetBenchmarkRandom(&seed) };
+        light.color = (Vector3){ GetBenchmarkRandom(&seed), GetBenchmarkRandom(&seed), GetBenchmarkRandom(&seed) };
+        light.linear = 0.7f;
+        light.quadratic = 1.8f;
+        AddLight(&lightSet, light);
+    }
+
+    Image imMap = LoadImage(ASSETS_PATH "textures/cubicmap.png");
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);
+
+    Texture2D texture = LoadTexture(ASSETS_PATH "textures/cubicmap_atlas_packed.png");
+    Texture2D normalTexture = LoadTexture(ASSETS_PATH "textures/cubicmap_atlas_normal.png");
+    Texture2D metallicTexture = LoadTexture(ASSETS_PATH "textures/cubicmap_atlas_metallic.png");
+    model.materials[0].maps[MATERIAL_MAP_ALBEDO].texture = texture;
+    model.materials[0].maps[MATERIAL_MAP_NORMAL].texture = normalTexture;
+    model.materials[0].maps[MATERIAL_MAP_METALNESS].texture = metallicTexture;
+
+    Shader gBufferShader = GetShaderVariant(&gBufferVariants, GetMaterialShaderFeatures(model.materials[0]));
+    gBufferShader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+    model.materials[0].shader = gBufferShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };
+    Texture2D whiteTexture = { rlGetTextureIdDefault(), 1, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+
+    GBuffer gBuffer = options.compact? LoadGBufferCompact(width, height) : LoadGBuffer(width, height);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+    SetDeferredModeShaderLayout(lightingShader, gBuffer);
+    R3DLightingBuffer lightingBuffer = LoadLightingBuffer(width, height, options.lighting);
+    R3DSSAO ssao = { 0 };
+    if (options.ssao) ssao = LoadSSAO(width, height);
+
+    float* frameTimes = (float*)R3D_MALLOC(options.frames*sizeof(float));
+
+    for (int frame = -options.warmup; frame < options.frames; frame++)
+    {
+        if (frame == 0) ResetFrameStats();
+        double frameStart = GetBenchmarkTime();
+
+        // Fixed camera path around the maze and bobbing lights, every run draws the same frames
+        float t = (float)(frame + options.warmup)/60.0f;
+        Camera camera = { 0 };
+        camera.position = (Vector3){ 0.2f + sinf(t*0.5f)*6.0f, 0.4f, 0.2f + cosf(t*0.5f)*2.0f };
+        camera.target = (Vector3){ camera.position.x + cosf(t), 0.4f, camera.position.z + sinf(t) };
+        camera.up = (Vector3){ 0.0f, 1.0f, 0.0f };
+        camera.fovy = 45.0f;
+        camera.projection = CAMERA_PERSPECTIVE;
+
+        for (int i = 0; i < options.lights && i < 8; i++)
+        {
+            R3DLight light = lightSet.lights[i];
+            light.position.y = 1.0f + sinf(t + i)*0.5f;
+            SetLight(&lightSet, i, light);
+        }
+        UpdateLightSet(&lightSet);
+
+        SetHeadlessViewport(width, height);
+        rlClearColor(245, 245, 245, 255);
+        rlClearScreenBuffers();
+
+        BeginDeferredMode(gBuffer);
+            BeginHeadlessMode3D(camera, width, height);
+                DrawModel(model, mapPosition, 1.0f, WHITE);
+            EndHeadlessMode3D();
+        EndDeferredMode();
+        SetHeadlessViewport(width, height);
+
+        if (options.ssao) UpdateSSAO(&ssao, gBuffer, camera);
+
+        SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+        BeginLightingMode(lightingBuffer, gBuffer, lightingShader);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(options.ssao? ssao.occlusion : whiteTexture, 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){ 0, 0, width, -height }, (Rectangle){ 0, 0, width, height }, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+        EndLightingMode(lightingBuffer, gBuffer);
+
+        // Waiting for the GPU makes the frame time the full cost of the frame
+        rlDrawRenderBatchActive();
+        glFinish();
+
+        if (frame >= 0) frameTimes[frame] = (float)((GetBenchmarkTime() - frameStart)*1000.0);
+    }
+
+    R3DFrameStats stats = GetFrameStats();
+
+    FILE* file = (options.output != NULL)? fopen(options.output, "w") : stdout;
+    if (file == NULL)
+    {
+        TraceLog(LOG_WARNING, "BENCHMARK: Failed to open %s", options.output);
+        file = stdout;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"benchmark\": \"deferred_headless\",\n");
+    fprintf(file, "  \"renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+    fprintf(file, "  \"version\": \"%s\",\n", (const char*)glGetString(GL_VERSION));
+    fprintf(file, "  \"width\": %i,\n  \"height\": %i,\n", width, height);
+    fprintf(file, "  \"lights\": %i,\n  \"frames\": %i,\n  \"warmup\": %i,\n", options.lights, options.frames, options.warmup);
+    fprintf(file, "  \"layout\": \"%s\",\n", options.compact? "compact" : "standard");
+    fprintf(file, "  \"lighting_resolution\": %i,\n", options.lighting);
+    fprintf(file, "  \"ssao\": %s,\n", options.ssao? "true" : "false");
+    fprintf(file, "  \"frame_ms\": {\n");
+    WriteTimingJson(file, "wall", frameTimes, options.frames, true);
+    fprintf(file, "  },\n");
+
+    // Pass statistics cover the last PROFILER_HISTORY frames
+    fprintf(file, "  \"pass_gpu_ms\": {\n");
+    int passCount = 0;
+    for (int i = 0; i < PROFILER_PASS_COUNT; i++) if (stats.passes[i].samples > 0) passCount++;
+    for (int i = 0; i < PROFILER_PASS_COUNT; i++)
+    {
+        R3DPassStats pass = stats.passes[i];
+        if (pass.samples == 0) continue;
+
+        fprintf(file, "    \"%s\": { \"samples\": %i, \"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f }%s\n", GetProfilerPassName(i),
+            pass.samples, pass.gpuMin, pass.gpuAvg, pass.gpuP99, (--passCount > 0)? "," : "");
+    }
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"dropped_samples\": %i\n", stats.dropped);
+    fprintf(file, "}\n");
+
+    if (file != stdout) fclose(file);
+
+    R3D_FREE(frameTimes);
+
+    // The shader belongs to the variants, UnloadModel() would unload it too (and the map textures)
+    model.materials[0].shader.id = rlGetShaderIdDefault();
+    UnloadModel(model);
+    UnloadLightSet(lightSet);
+    UnloadLightingBuffer(lightingBuffer);
+    UnloadSSAO(ssao);
+    UnloadGBuffer(gBuffer);
+    UnloadShaderVariants(gBufferVariants);
+    UnloadShaderVariants(lightingVariants);
+    rlglClose();
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+/**********************************************************************************************
+*
+*   raylib-3D - Mesh optimization benchmark
+*
+*   Imports examples/assets/models/wall.fbx through Assimp and generates larger synthetic meshes, then runs the
+*   OptimizeMesh() steps on them one after the other and prints, as JSON, the vertex cache miss ratios (ACMR, ATVR)
+*   and overdraw of each mesh as loaded and after each step, with the time the steps took.
+*
+*   Options:
+*       --runs 5                    Times each step is run, on a freshly loaded mesh, the fastest is kept
+*       --output file.json          Write the JSON to a file instead of stdout
+*
+*   Compile (raylib built with GRAPHICS_API_OPENGL_33, Assimp installed), run from the benchmarks directory:
+*   gcc -o mesh_optimize mesh_optimize.c -lraylib -lassimp -lEGL -lm -lpthread -ldl -std=c99
+*
+*   NOTE: Loading uploads the meshes, so an offscreen EGL context is created first. The figures are measured
+*   on the CPU, they do not depend on the GPU
+*
+**********************************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L   // clock_gettime() with -std=c99
+
+#define R3D_ASSIMP_SUPPORT
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ASSETS_PATH "../examples/assets/"
+#define BENCHMARK_MODELS 5
+#define BENCHMARK_STEPS 4
+
+typedef struct BenchmarkOptions {
+    int runs;
+    const char* output;
+} BenchmarkOptions;
+
+// Steps applied on top of each other, the first one only welds the vertices
+static const char* stepNames[BENCHMARK_STEPS] = { "welded", "vertexCache", "overdraw", "vertexFetch" };
+static const unsigned int stepFlags[BENCHMARK_STEPS] = {
+    0,
+    MESH_OPTIMIZE_VERTEX_CACHE,
+    MESH_OPTIMIZE_VERTEX_CACHE | MESH_OPTIMIZE_OVERDRAW,
+    MESH_OPTIMIZE_ALL
+};
+
+static const char* modelNames[BENCHMARK_MODELS] = { "wall.fbx", "sphere", "knot", "plane", "cubicmap" };
+
+static double GetBenchmarkTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec*1e-9;
+}
+
+// Offscreen context, only needed for the mesh uploads
+static bool InitOffscreenContext(void)
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    // Mesa surfaceless platform first, it needs no display server
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != NULL) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if ((display == EGL_NO_DISPLAY) || !eglInitialize(display, NULL, NULL))
+    {
+        TraceLog(LOG_WARNING, "BENCHMARK: Failed to initialize EGL display");
+        return false;
+    }
+
+    const EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || (configCount == 0))
+    {
+        TraceLog(LOG_WARNING, "BENCHMARK: No EGL pbuffer config available");
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+
+    if ((surface == EGL_NO_SURFACE) || (context == EGL_NO_CONTEXT) || !eglMakeCurrent(display, surface, surface, context))
+    {
+        TraceLog(LOG_WARNING, "BENCHMARK: Failed to create a GL 3.3 core offscreen context");
+        return false;
+    }
+
+    rlLoadExtensions((void*)eglGetProcAddress);
+    rlglInit(16, 16);
+
+    return true;
+}
+
+// The meshes come out of the GenMesh*() functions and the import as they always do, each triangle with its own vertices
+static Model LoadBenchmarkModel(int index)
+{
+    Model model = { 0 };
+    switch (index)
+    {
+        case 0: model = LoadModelAdvanced(ASSETS_PATH "models/wall.fbx"); break;
+        case 1: model = LoadModelFromMesh(GenMeshSphere(1.0f, 128, 128)); break;        // About 32k triangles
+        case 2: model = LoadModelFromMesh(GenMeshKnot(1.0f, 2.0f, 512, 64)); break;     // About 65k triangles, folded over itself
+        case 3: model = LoadModelFromMesh(GenMeshPlane(10.0f, 10.0f, 180, 180)); break; // About 65k triangles
+        case 4:
+        {
+            Image image = LoadImage(ASSETS_PATH "textures/cubicmap.png");
+            model = LoadModelFromMesh(GenMeshCubicmap(image, (Vector3){ 1.0f, 1.0f, 1.0f }));
+            UnloadImage(image);
+        } break;
+        default: break;
+    }
+    return model;
+}
+
+static void WriteStatsJson(FILE* file, const char* name, R3DMeshStats stats, int vertexCount, double time, bool last)
+{
+    fprintf(file, "        \"%s\": { \"acmr\": %.4f, \"atvr\": %.4f, \"overdraw\": %.4f, \"vertices\": %i", name, stats.acmr, stats.atvr, stats.overdraw, vertexCount);
+    if (time >= 0.0) fprintf(file, ", \"ms\": %.3f", time*1000.0);
+    fprintf(file, " }%s\n", last? "" : ",");
+}
+
+static bool ParseOptions(int argc, char** argv, BenchmarkOptions* options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc)? argv[i + 1] : NULL;
+        if (value == NULL) return false;
+
+        if (strcmp(arg, "--runs") == 0) options->runs = atoi(value);
+        else if (strcmp(arg, "--output") == 0) options->output = value;
+        else return false;
+        i++;
+    }
+
+    return (options->runs > 0);
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options = { 5, NULL };
+    if (!ParseOptions(argc, argv, &options))
+    {
+        printf("usage: %s [--runs n] [--output file]\n", argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    if (!InitOffscreenContext()) return 1;
+
+    FILE* file = (options.output != NULL)? fopen(options.output, "w") : stdout;
+    if (file == NULL)
+    {
+        TraceLog(LOG_WARNING, "BENCHMARK: Failed to open %s", options.output);
+        return 1;
+    }
+
+    fprintf(file, "{\n  \"cacheSize\": %i,\n  \"meshes\": [\n", MESH_OPTIMIZE_CACHE_SIZE);
+
+    bool firstMesh = true;
+    for (int m = 0; m < BENCHMARK_MODELS; m++)
+    {
+        Model model = LoadBenchmarkModel(m);
+        if (model.meshCount == 0)
+        {
+            TraceLog(LOG_WARNING, "BENCHMARK: Failed to load %s, skipped", modelNames[m]);
+            continue;
+        }
+
+        int meshCount = model.meshCount;
+        R3DMeshStats* loaded = (R3DMeshStats*)malloc(meshCount*sizeof(R3DMeshStats));
+        int* triangles = (int*)malloc(meshCount*sizeof(int));
+        int* vertices = (int*)malloc(meshCount*sizeof(int));
+        for (int i = 0; i < meshCount; i++)
+        {
+            loaded[i] = GetMeshStats(model.meshes[i]);
+            triangles[i] = model.meshes[i].triangleCount;
+            vertices[i] = model.meshes[i].vertexCount;
+        }
+        UnloadModelAdvanced(model);
+
+        R3DMeshStats* results = (R3DMeshStats*)calloc(meshCount*BENCHMARK_STEPS, sizeof(R3DMeshStats));
+        int* resultVertices = (int*)calloc(meshCount*BENCHMARK_STEPS, sizeof(int));
+        double* times = (double*)malloc(meshCount*BENCHMARK_STEPS*sizeof(double));
+        bool* optimized = (bool*)calloc(meshCount, sizeof(bool));
+        for (int i = 0; i < meshCount*BENCHMARK_STEPS; i++) times[i] = -1.0;
+
+        // Every run starts again from the loaded mesh, the steps reorder it in place
+        for (int s = 0; s < BENCHMARK_STEPS; s++)
+        {
+            for (int run = 0; run < options.runs; run++)
+            {
+                model = LoadBenchmarkModel(m);
+                for (int i = 0; (i < meshCount) && (i < model.meshCount); i++)
+                {
+                    double start = GetBenchmarkTime();
+                    bool done = OptimizeMesh(&model.meshes[i], stepFlags[s]);
+                    double time = GetBenchmarkTime() - start;
+                    if (!done) continue;
+
+                    int r = i*BENCHMARK_STEPS + s;
+                    if ((times[r] < 0.0) || (time < times[r])) times[r] = time;
+                    if (run == 0)
+                    {
+                        results[r] = GetMeshStats(model.meshes[i]);
+                        resultVertices[r] = model.meshes[i].vertexCount;
+                        optimized[i] = true;
+                    }
+                }
+                UnloadModelAdvanced(model);
+            }
+        }
+
+        for (int i = 0; i < meshCount; i++)
+        {
+            fprintf(file, "%s    {\n", firstMesh? "" : ",\n");
+            fprintf(file, "      \"name\": \"%s\",\n      \"mesh\": %i,\n      \"triangles\": %i,\n", modelNames[m], i, triangles[i]);
+            fprintf(file, "      \"stats\": {\n");
+            WriteStatsJson(file, "loaded", loaded[i], vertices[i], -1.0, !optimized[i]);
+            for (int s = 0; optimized[i] && (s < BENCHMARK_STEPS); s++)
+            {
+                int r = i*BENCHMARK_STEPS + s;
+                WriteStatsJson(file, stepNames[s], results[r], resultVertices[r], times[r], s == BENCHMARK_STEPS - 1);
+            }
+            fprintf(file, "      }\n    }");
+            firstMesh = false;
+        }
+
+        free(optimized);
+        free(times);
+        free(resultVertices);
+        free(results);
+        free(vertices);
+        free(triangles);
+        free(loaded);
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+    if (file != stdout) fclose(file);
+
+    return 0;
+}
@@ -1,7 +1,14 @@
 #version 330
 
+// Shader variant features (see GetShaderVariant), everything is on when loaded without variants
+#ifndef R3D_VARIANT
+#define R3D_SSAO
+#define R3D_SPECULAR
+#endif
+
+
 in vec2 fragTexCoord;
-in vec3 fragColor;
+in vec4 fragColor;
 
 out vec4 finalColor;
 
@@ -10,48 +17,194 @@ uniform sampler2D colorbuffer;
 uniform sampler2D normalbuffer;
 uniform sampler2D positionbuffer;
 uniform sampler2D ssaobuffer;
+uniform sampler2D depthbuffer;
+uniform sampler2D emissionbuffer; // GBuffer emission attachment, black when it has none
 
 struct light {
     vec3 position;
-    vec3 color;
-    
     float linear;
+    vec3 color;
     float quadratic;
+    vec3 direction;
+    int type; // 0: point, 1: directional, 2: spot
+    float spotCutoff; // Cosine of the spot cone half angle
+    int shadow; // Shadow atlas entry, -1: none
+};
+
+// Light set, see R3DLightSet (std140, LIGHT_SET_MAX_LIGHTS lights)
+const int max_lights = 255;
+layout (std140) uniform LightBlock {
+    int lightCount;
+    light lights[max_lights];
 };
-const int num_lights = 32;
-uniform light lights[num_lights];
 uniform vec3 viewpos;
+uniform mat4 invViewProj;
+uniform int gbufferLayout; // 0: standard, 1: compact (octahedral normals, position from depth)
+uniform vec2 gbufferScale;  // Part of the GBuffer covered by its viewport (dynamic resolution)
+uniform int lightingDemodulate; // 1: reduced resolution lighting (see R3DLightingBuffer), writes diffuse lighting (rgb) and specular luminance (a) without albedo
+
+#ifdef R3D_SHADOWS
+// Cascaded shadows of directional lights, see R3DShadowCascades
+#define R3D_SHADOW_CASCADES 4   // SHADOW_MAX_CASCADES
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 shadowMatrices[R3D_SHADOW_CASCADES];
+uniform float shadowSplits[R3D_SHADOW_CASCADES];      // View depth where each cascade ends
+uniform float shadowTexelSizes[R3D_SHADOW_CASCADES];  // World size of a shadow map texel
+uniform int shadowCascadeCount;
+uniform vec3 shadowViewDir;  // Camera forward, cascades are picked by view depth
+uniform float shadowBias;    // Normal offset, in texels
+
+// Point and spot light shadows, see R3DShadowAtlas (std140, SHADOW_ATLAS_MAX_LIGHTS lights)
+#define R3D_SHADOW_ATLAS_LIGHTS 32
+struct shadow_light {
+    mat4 matrices[6]; // View projection of each view, cube faces +x -x +y -y +z -z of point lights
+    vec4 rects[6];    // Atlas tile of each view (offset, size), empty until drawn
+    vec4 params;      // x: tangent of the view half angle
+};
+layout (std140) uniform ShadowBlock {
+    shadow_light shadowLights[R3D_SHADOW_ATLAS_LIGHTS];
+};
+uniform sampler2DShadow shadowAtlas;
+uniform float shadowAtlasBias; // Normal offset, in texels
+#endif
+
+vec3 decode_normal(vec2 f)
+{
+    f = f*2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+vec3 reconstruct_position(vec2 uv)
+{
+    float depth = texture(depthbuffer, uv).r;
+    vec4 world = invViewProj*vec4(vec3(uv/gbufferScale, depth)*2.0 - 1.0, 1.0);
+    return world.xyz/world.w;
+}
+
+#ifdef R3D_SHADOWS
+float calc_shadow(vec3 fragPos, vec3 normal, vec3 lightdir)
+{
+    float depth = dot(fragPos - viewpos, shadowViewDir);
+    int cascade = 0;
+    while (cascade < shadowCascadeCount && depth > shadowSplits[cascade]) cascade++;
+    if (cascade >= shadowCascadeCount) return 1.0;
+
+    // Normal offset, larger at grazing angles where acne shows
+    float slope = 1.0 - max(dot(normal, lightdir), 0.0);
+    vec3 position = fragPos + normal*shadowTexelSizes[cascade]*shadowBias*(0.5 + slope);
+    vec4 coord = shadowMatrices[cascade]*vec4(position, 1.0);
+    coord.xyz = coord.xyz/coord.w*0.5 + 0.5;
+
+    // 4 bilinear compared taps, a 3x3 texel footprint
+    vec2 texel = 1.0/vec2(textureSize(shadowMap, 0).xy);
+    float shadow = 0.0;
+    shadow += texture(shadowMap, vec4(coord.xy + vec2(-0.5, -0.5)*texel, float(cascade), coord.z));
+    shadow += texture(shadowMap, vec4(coord.xy + vec2(0.5, -0.5)*texel, float(cascade), coord.z));
+    shadow += texture(shadowMap, vec4(coord.xy + vec2(-0.5, 0.5)*texel, float(cascade), coord.z));
+    shadow += texture(shadowMap, vec4(coord.xy + vec2(0.5, 0.5)*texel, float(cascade), coord.z));
+    return shadow*0.25;
+}
+
+float calc_atlas_shadow(int entry, int type, vec3 fragPos, vec3 normal, vec3 lightpos, vec3 lightdir)
+{
+    // Point lights pick the cube face of the major axis
+    vec3 v = fragPos - lightpos;
+    vec3 a = abs(v);
+    int view = 0;
+    if (type == 0) {
+        if (a.x >= a.y && a.x >= a.z) view = (v.x < 0.0) ? 1 : 0;
+        else if (a.y >= a.z) view = (v.y < 0.0) ? 3 : 2;
+        else view = (v.z < 0.0) ? 5 : 4;
+    }
+    vec4 rect = shadowLights[entry].rects[view];
+    if (rect.z <= 0.0) return 1.0;
+
+    // Normal offset scaled by the texel size at the fragment distance
+    vec2 texel = 1.0/vec2(textureSize(shadowAtlas, 0));
+    float texelSize = 2.0*length(v)*shadowLights[entry].params.x*texel.x/rect.z;
+    float slope = 1.0 - max(dot(normal, lightdir), 0.0);
+    vec3 position = fragPos + normal*texelSize*shadowAtlasBias*(0.5 + slope);
+    vec4 coord = shadowLights[entry].matrices[view]*vec4(position, 1.0);
+    if (coord.w <= 0.0) return 1.0;
+    coord.xyz = coord.xyz/coord.w*0.5 + 0.5;
+
+    // 4 bilinear compared taps, kept inside the tile
+    vec2 uv = rect.xy + coord.xy*rect.zw;
+    vec2 lo = rect.xy + texel*0.5;
+    vec2 hi = rect.xy + rect.zw - texel*0.5;
+    float shadow = 0.0;
+    shadow += texture(shadowAtlas, vec3(clamp(uv + vec2(-0.5, -0.5)*texel, lo, hi), coord.z));
+    shadow += texture(shadowAtlas, vec3(clamp(uv + vec2(0.5, -0.5)*texel, lo, hi), coord.z));
+    shadow += texture(shadowAtlas, vec3(clamp(uv + vec2(-0.5, 0.5)*texel, lo, hi), coord.z));
+    shadow += texture(shadowAtlas, vec3(clamp(uv + vec2(0.5, 0.5)*texel, lo, hi), coord.z));
+    return shadow*0.25;
+}
+#endif
 
-vec3 calc_lighting()
+vec4 calc_lighting()
 {
-    vec3 Normal = texture(normalbuffer, fragTexCoord).rgb;
-    vec3 FragPos = texture(positionbuffer, fragTexCoord).rgb;
+    vec3 Normal;
+    vec3 FragPos;
+    if (gbufferLayout == 1) {
+        Normal = decode_normal(texture(normalbuffer, fragTexCoord).rg);
+        FragPos = reconstruct_position(fragTexCoord);
+    } else {
+        Normal = texture(normalbuffer, fragTexCoord).rgb;
+        FragPos = texture(positionbuffer, fragTexCoord).rgb;
+    }
     vec3 Diffuse = texture(colorbuffer, fragTexCoord).rgb;
     float Specular = texture(colorbuffer, fragTexCoord).a;
     
-    vec3 lighting = Diffuse * 0.1;
+    vec3 diffuseLighting = vec3(0.1);
+    vec3 specularLighting = vec3(0.0);
     vec3 viewdir = normalize(viewpos - FragPos);
-    for (int i = 0; i < num_lights; i++) {
+    for (int i = 0; i < lightCount; i++) {
         vec3 lightdir = normalize(lights[i].position - FragPos);
-        vec3 diffuse = max(dot(Normal, lightdir), 0.0) * Diffuse * lights[i].color;
+        if (lights[i].type == 1) lightdir = -normalize(lights[i].direction);
+        vec3 diffuse = max(dot(Normal, lightdir), 0.0) * lights[i].color;
         
+#ifdef R3D_SPECULAR
         vec3 halfwaydir = normalize(lightdir + viewdir);
         float spec = pow(max(dot(Normal, halfwaydir), 0.0), 16.0);
         vec3 specular = lights[i].color * spec * Specular;
+#else
+        vec3 specular = vec3(0.0);
+#endif
         
         float distance = length(lights[i].position - FragPos);
         float attenuation = 1.0 / (1.0 + lights[i].linear * distance + lights[i].quadratic * distance * distance);
+        if (lights[i].type == 1) attenuation = 1.0;
+        if (lights[i].type == 2) {
+            // Spot cone, softened over the outer part of the cone
+            float cosAngle = dot(-lightdir, normalize(lights[i].direction));
+            attenuation *= clamp((cosAngle - lights[i].spotCutoff)/max(1.0 - lights[i].spotCutoff, 1e-4)*4.0, 0.0, 1.0);
+        }
+#ifdef R3D_SHADOWS
+        if (lights[i].type == 1) attenuation *= calc_shadow(FragPos, Normal, lightdir);
+        else if (lights[i].shadow >= 0 && attenuation > 0.0) attenuation *= calc_atlas_shadow(lights[i].shadow, lights[i].type, FragPos, Normal, lights[i].position, lightdir);
+#endif
         diffuse *= attenuation;
         specular *= attenuation;
-        lighting += diffuse + specular;
+        diffuseLighting += diffuse;
+        specularLighting += specular;
     }
-    lighting *= texture(ssaobuffer, fragTexCoord).rgb;
-    
-    return lighting;
-    
+#ifdef R3D_SSAO
+    vec3 occlusion = texture(ssaobuffer, fragTexCoord).rgb;
+    diffuseLighting *= occlusion;
+    specularLighting *= occlusion;
+#endif
+
+    // Albedo and emission are applied at full resolution by the upsample
+    if (lightingDemodulate == 1) return vec4(diffuseLighting, dot(specularLighting, vec3(0.2126, 0.7152, 0.0722)));
+    vec3 Emission = texture(emissionbuffer, fragTexCoord).rgb;
+    return vec4(Diffuse*diffuseLighting + specularLighting + Emission, 1.0);
 }
 
 void main()
 {
-    finalColor = vec4(calc_lighting(), 1);
+    finalColor = calc_lighting();
 }
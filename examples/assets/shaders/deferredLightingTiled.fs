@@ -0,0 +1,103 @@
+#version 330
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+out vec4 finalColor;
+
+uniform sampler2D texture0;
+uniform sampler2D colorbuffer;
+uniform sampler2D normalbuffer;
+uniform sampler2D positionbuffer;
+uniform sampler2D ssaobuffer;
+uniform sampler2D depthbuffer;
+uniform sampler2D emissionbuffer; // GBuffer emission attachment, black when it has none
+
+struct light {
+    vec3 position;
+    vec3 color;
+    
+    float linear;
+    float quadratic;
+};
+
+// Tiled lighting buffers, see R3DLightTiles
+uniform samplerBuffer lightData;         // 2 texels per light: (position, linear), (color, quadratic)
+uniform usamplerBuffer lightTileGrid;    // (offset, count) into lightTileIndices per tile
+uniform usamplerBuffer lightTileIndices; // light indices
+uniform int lightTilesX;
+uniform int lightTileSize;               // LIGHT_TILE_SIZE
+
+light fetch_light(int index)
+{
+    vec4 positionLinear = texelFetch(lightData, index*2);
+    vec4 colorQuadratic = texelFetch(lightData, index*2 + 1);
+    return light(positionLinear.xyz, colorQuadratic.rgb, positionLinear.w, colorQuadratic.w);
+}
+uniform vec3 viewpos;
+uniform mat4 invViewProj;
+uniform int gbufferLayout; // 0: standard, 1: compact (octahedral normals, position from depth)
+
+vec3 decode_normal(vec2 f)
+{
+    f = f*2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+vec3 reconstruct_position(vec2 uv)
+{
+    float depth = texture(depthbuffer, uv).r;
+    vec4 world = invViewProj*vec4(vec3(uv, depth)*2.0 - 1.0, 1.0);
+    return world.xyz/world.w;
+}
+
+vec3 calc_lighting()
+{
+    vec3 Normal;
+    vec3 FragPos;
+    if (gbufferLayout == 1) {
+        Normal = decode_normal(texture(normalbuffer, fragTexCoord).rg);
+        FragPos = reconstruct_position(fragTexCoord);
+    } else {
+        Normal = texture(normalbuffer, fragTexCoord).rgb;
+        FragPos = texture(positionbuffer, fragTexCoord).rgb;
+    }
+    vec3 Diffuse = texture(colorbuffer, fragTexCoord).rgb;
+    float Specular = texture(colorbuffer, fragTexCoord).a;
+    
+    vec3 lighting = Diffuse * 0.1;
+    vec3 viewdir = normalize(viewpos - FragPos);
+
+    // Only walk the lights touching this pixel tile
+    ivec2 tile = ivec2(fragTexCoord*vec2(textureSize(depthbuffer, 0)))/lightTileSize;
+    uvec2 list = texelFetch(lightTileGrid, tile.y*lightTilesX + tile.x).xy;
+    for (uint t = 0u; t < list.y; t++) {
+        light l = fetch_light(int(texelFetch(lightTileIndices, int(list.x + t)).r));
+        vec3 lightdir = normalize(l.position - FragPos);
+        vec3 diffuse = max(dot(Normal, lightdir), 0.0) * Diffuse * l.color;
+        
+        vec3 halfwaydir = normalize(lightdir + viewdir);
+        float spec = pow(max(dot(Normal, halfwaydir), 0.0), 16.0);
+        vec3 specular = l.color * spec * Specular;
+        
+        float distance = length(l.position - FragPos);
+        float attenuation = 1.0 / (1.0 + l.linear * distance + l.quadratic * distance * distance);
+        diffuse *= attenuation;
+        specular *= attenuation;
+        lighting += diffuse + specular;
+    }
+    lighting *= texture(ssaobuffer, fragTexCoord).rgb;
+    lighting += texture(emissionbuffer, fragTexCoord).rgb;
+    
+    return lighting;
+    
+}
+
+void main()
+{
+    finalColor = vec4(calc_lighting(), 1);
+}
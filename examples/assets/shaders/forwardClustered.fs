@@ -0,0 +1,78 @@
+#version 330
+
+// Forward lighting for objects drawn after the deferred pass (transparent objects), reads the same light clusters
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+in vec3 fragNormal;
+in vec3 fragPos;
+
+out vec4 finalColor;
+
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+uniform sampler2D depthbuffer; // GBuffer depth, fragments behind the deferred scene are discarded
+
+struct light {
+    vec3 position;
+    vec3 color;
+    
+    float linear;
+    float quadratic;
+};
+
+// Clustered lighting buffers, see R3DLightClusters
+uniform samplerBuffer lightData;            // 2 texels per light: (position, linear), (color, quadratic)
+uniform usamplerBuffer lightClusterGrid;    // (offset, count) into lightClusterIndices per cluster
+uniform usamplerBuffer lightClusterIndices; // light indices
+uniform ivec3 lightClusterSize;             // clusters along x, y and depth slices
+uniform vec2 lightClusterScreen;            // screen size covered by the clusters
+uniform vec2 lightClusterDepth;             // slice = log(depth)*x + y
+uniform mat4 lightClusterView;
+
+light fetch_light(int index)
+{
+    vec4 positionLinear = texelFetch(lightData, index*2);
+    vec4 colorQuadratic = texelFetch(lightData, index*2 + 1);
+    return light(positionLinear.xyz, colorQuadratic.rgb, positionLinear.w, colorQuadratic.w);
+}
+
+// (offset, count) of the light list of the cluster holding a fragment
+uvec2 cluster_lights(vec2 fragcoord, vec3 worldpos)
+{
+    float depth = max(-(lightClusterView*vec4(worldpos, 1.0)).z, 1e-4);
+    ivec3 cluster = ivec3(ivec2(fragcoord*vec2(lightClusterSize.xy)/lightClusterScreen), int(log(depth)*lightClusterDepth.x + lightClusterDepth.y));
+    cluster = clamp(cluster, ivec3(0), lightClusterSize - 1);
+    return texelFetch(lightClusterGrid, (cluster.z*lightClusterSize.y + cluster.y)*lightClusterSize.x + cluster.x).xy;
+}
+
+uniform vec3 viewpos;
+
+void main()
+{
+    if (gl_FragCoord.z > texelFetch(depthbuffer, ivec2(gl_FragCoord.xy), 0).r) discard;
+
+    vec4 albedo = texture(texture0, fragTexCoord)*colDiffuse*fragColor;
+    vec3 Normal = normalize(fragNormal);
+    vec3 viewdir = normalize(viewpos - fragPos);
+    if (!gl_FrontFacing) Normal = -Normal;
+
+    vec3 lighting = albedo.rgb * 0.1;
+
+    uvec2 list = cluster_lights(gl_FragCoord.xy, fragPos);
+    for (uint t = 0u; t < list.y; t++) {
+        light l = fetch_light(int(texelFetch(lightClusterIndices, int(list.x + t)).r));
+        vec3 lightdir = normalize(l.position - fragPos);
+        vec3 diffuse = max(dot(Normal, lightdir), 0.0) * albedo.rgb * l.color;
+
+        vec3 halfwaydir = normalize(lightdir + viewdir);
+        float spec = pow(max(dot(Normal, halfwaydir), 0.0), 16.0);
+        vec3 specular = l.color * spec * 0.5;
+
+        float distance = length(l.position - fragPos);
+        float attenuation = 1.0 / (1.0 + l.linear * distance + l.quadratic * distance * distance);
+        lighting += (diffuse + specular) * attenuation;
+    }
+
+    finalColor = vec4(lighting, albedo.a);
+}
@@ -1,26 +1,84 @@
 #version 330
+
+// Shader variant features (see GetShaderVariant), everything is on when loaded without variants
+#ifndef R3D_VARIANT
+#define R3D_NORMAL_MAP
+#define R3D_EMISSION
+#endif
+
 layout (location = 0) out vec3 gposition;
 layout (location = 1) out vec3 gnormal;
 layout (location = 2) out vec4 galbedospec;
 layout (location = 3) out vec4 gemission;
+layout (location = 4) out float gmaterialid;
+layout (location = 5) out vec2 gvelocity;
 
 in vec2 fragTexCoord;
 in vec3 fragPos;
 in vec3 fragNormal;
+in vec4 fragClipPos;
+in vec4 fragPrevClipPos;
+#ifdef R3D_LIGHTMAP
+in vec2 fragTexCoord2;
+#endif
 
 uniform sampler2D texture0; // diffuse
 uniform sampler2D texture1; // specular
 uniform sampler2D texture2; // normals
+uniform sampler2D texture5; // emission
+#ifdef R3D_LIGHTMAP
+uniform sampler2D texture4; // baked lighting (see BakeLightmaps), second texcoords
+#endif
+
+uniform vec4 colEmission = vec4(1.0); // emission map tint, untinted by default
+uniform float materialId;  // 0 to 255, set by the caller before each draw, stored as id/255 in the material id attachment
+
+uniform int gbufferLayout; // 0: standard, 1: compact (octahedral normals, no position target)
 
 out vec4 finalColor;
 
+// Octahedral normal encoding, maps the unit sphere onto the [0, 1] square
+vec2 oct_wrap(vec2 v)
+{
+    return (1.0 - abs(v.yx))*vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encode_normal(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    n.xy = (n.z >= 0.0) ? n.xy : oct_wrap(n.xy);
+    return n.xy*0.5 + 0.5;
+}
+
 void main()
 {
+#ifdef R3D_NORMAL_MAP
     gnormal = texture(texture2, fragTexCoord).rgb;
+#ifndef R3D_VARIANT
     if (gnormal.r == 1 && gnormal.g == 1 && gnormal.b == 1)
         gnormal = fragNormal;
+#endif
+#else
+    gnormal = fragNormal;
+#endif
+    if (gbufferLayout == 1)
+        gnormal = vec3(encode_normal(normalize(gnormal)), 0.0);
     
     gposition = fragPos;
     galbedospec.rgb = texture(texture0, fragTexCoord).rgb;
     galbedospec.a = texture(texture1, fragTexCoord).r;
+#ifdef R3D_EMISSION
+    gemission = vec4(texture(texture5, fragTexCoord).rgb*colEmission.rgb, 1.0);
+#else
+    gemission = vec4(0.0, 0.0, 0.0, 1.0);
+#endif
+#ifdef R3D_LIGHTMAP
+    gemission.rgb += galbedospec.rgb*texture(texture4, fragTexCoord2).rgb;
+#endif
+    gmaterialid = materialId/255.0;
+
+    // Motion vector in texture space, from the previous frame position to this one
+    gvelocity = vec2(0.0);
+    if (fragPrevClipPos.w > 0.0)
+        gvelocity = (fragClipPos.xy/fragClipPos.w - fragPrevClipPos.xy/fragPrevClipPos.w)*0.5;
 }
@@ -5,17 +5,38 @@ in vec3 vertexPosition;
 in vec2 vertexTexCoord;
 in vec3 vertexNormal;
 in vec4 vertexColor;
+#ifdef R3D_LIGHTMAP
+in vec2 vertexTexCoord2;
+#endif
+#ifdef R3D_SKINNING
+in vec4 vertexBoneIds;
+in vec4 vertexBoneWeights;
+#endif
+#ifdef R3D_INSTANCING
+in mat4 instanceTransform;
+in mat3 instanceNormal;    // transpose(inverse(mat3(instanceTransform))), computed on the CPU (see DrawModelInstancedDeferred)
+#endif
 
 // Input uniform values
 uniform mat4 mvp;
 uniform mat4 modelMatrix;
+uniform mat4 prevViewProj; // previous frame view projection, used for the velocity attachment (camera motion only)
 // uniform vec3 vertexNormal;
+#ifdef R3D_SKINNING
+#define R3D_MAX_BONES 64   // SHADER_VARIANT_MAX_BONES
+uniform mat4 boneMatrices[R3D_MAX_BONES];
+#endif
 
 // Output vertex attributes (to fragment shader)
 out vec2 fragTexCoord;
 out vec4 fragColor;
 out vec3 fragNormal;
 out vec3 fragPos;
+out vec4 fragClipPos;
+out vec4 fragPrevClipPos;
+#ifdef R3D_LIGHTMAP
+out vec2 fragTexCoord2;
+#endif
 
 // NOTE: Add here your custom variables 
 
@@ -23,11 +44,35 @@ void main()
 {
     fragTexCoord = vertexTexCoord;
     fragColor = vertexColor;
+#ifdef R3D_LIGHTMAP
+    fragTexCoord2 = vertexTexCoord2;
+#endif
     
+    vec4 position = vec4(vertexPosition, 1.0);
+    vec3 normal = vertexNormal;
+#ifdef R3D_SKINNING
+    mat4 skinMatrix = boneMatrices[int(vertexBoneIds.x)]*vertexBoneWeights.x +
+                      boneMatrices[int(vertexBoneIds.y)]*vertexBoneWeights.y +
+                      boneMatrices[int(vertexBoneIds.z)]*vertexBoneWeights.z +
+                      boneMatrices[int(vertexBoneIds.w)]*vertexBoneWeights.w;
+    position = skinMatrix*position;
+    normal = mat3(skinMatrix)*normal;
+#endif
+
+    // Instance transforms apply before the model matrix (and so before mvp)
+#ifdef R3D_INSTANCING
+    position = instanceTransform*position;
+    mat3 normalMatrix = mat3(modelMatrix)*instanceNormal; // Model matrix without non uniform scale, identity when drawn by DrawModelInstancedDeferred
+#else
     mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
-    fragNormal = normalize(normalMatrix*vertexNormal);
+#endif
+    fragNormal = normalize(normalMatrix*normal);
     
-    fragPos = vec3(modelMatrix*vec4(vertexPosition, 1.0));
+    fragPos = vec3(modelMatrix*position);
     
-    gl_Position = mvp*vec4(vertexPosition, 1.0);
+    gl_Position = mvp*position;
+
+    fragClipPos = gl_Position;
+    // Current world position seen by the previous camera, moving and skinned objects get the camera motion only
+    fragPrevClipPos = prevViewProj*vec4(fragPos, 1.0);
 }
\ No newline at end of file
@@ -2,10 +2,14 @@
 #include "../r3d.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
 
-#define MAX_LIGHTS    64
+#define MAX_LIGHTS    64    // Up to LIGHT_SET_MAX_LIGHTS
+#define MOVING_LIGHTS 8
 #define SCREEN_WIDTH  1280
 #define SCREEN_HEIGHT 720
+#define COMPACT_GBUFFER true  // Use the compact GBuffer layout (octahedral normals, position rebuilt from depth)
+#define LIGHTING_RESOLUTION LIGHTING_RESOLUTION_HALF  // Resolution of the lighting pass, upsampled to the screen
 
 int main()
 {
@@ -17,11 +21,18 @@ int main()
     Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
     SetCameraMode(camera, CAMERA_FIRST_PERSON);
 
-    //Load shaders
-    Shader gBufferShader = LoadShader("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
-    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+    //Load shaders, program binaries are cached between runs (needs a GL 4.3 raylib build)
+    SetShaderCacheDirectory("assets/shaders/cache");
+    // Each shader is compiled once per feature set used, the variants listed in the manifest are compiled upfront
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    PrewarmShaderVariants(&gBufferVariants, "assets/shaders/gbuffer.variants");
+    R3DShaderVariants lightingVariants = LoadShaderVariants(0, "assets/shaders/deferredLighting.fs");
+
+    // The ssaobuffer is filled by the half resolution SSAO pass
+    Shader lightingShader = GetShaderVariant(&lightingVariants, SHADER_FEATURE_SPECULAR | SHADER_FEATURE_SSAO);
 
-    Shader lightingShader = LoadShader(0, "assets/shaders/defferedLighting.fs");
+    R3DShaderCacheStats cacheStats = GetShaderCacheStats();
+    TraceLog(LOG_INFO, "Shader cache: %i hits, %i misses, %.2f ms saved", cacheStats.hits, cacheStats.misses, cacheStats.timeSaved);
 
     int shaderValue = 1;
     SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
@@ -29,19 +40,23 @@ int main()
     SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
     shaderValue = 3;
     SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
-
-    for(int i = 0; i < MAX_LIGHTS; i++) {
-        Vector3 position = {GetRandomValue(-14, 14), 1, GetRandomValue(-5, 5)};
-        SetShaderValue(lightingShader, GetShaderLocation(lightingShader, TextFormat("lights[%d].position", i)), (float*)&position, UNIFORM_VEC3);
-
-        Vector3 color = {GetRandomValue(0, 1), GetRandomValue(0, 1), GetRandomValue(0, 1)};
-        SetShaderValue(lightingShader, GetShaderLocation(lightingShader, TextFormat("lights[%d].color", i)), (float*)&color, UNIFORM_VEC3);
-
-        float linear = 0.7;
-        SetShaderValue(lightingShader, GetShaderLocation(lightingShader, TextFormat("lights[%d].linear", i)), &linear, UNIFORM_FLOAT);
-
-        float quadratic = 1.8;
-        SetShaderValue(lightingShader, GetShaderLocation(lightingShader, TextFormat("lights[%d].quadratic", i)), &quadratic, UNIFORM_FLOAT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    // Lights live in a uniform buffer, only the ones changed are uploaded
+    R3DLightSet lightSet = LoadLightSet();
+    for (int i = 0; i < MAX_LIGHTS; i++)
+    {
+        R3DLight light = { 0 };
+        light.position = (Vector3){ GetRandomValue(-14, 14), 1, GetRandomValue(-5, 5) };
+        light.color = (Vector3){ GetRandomValue(0, 1), GetRandomValue(0, 1), GetRandomValue(0, 1) };
+        light.linear = 0.7f;
+        light.quadratic = 1.8f;
+        AddLight(&lightSet, light);
     }
 
     Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
@@ -56,6 +71,10 @@ int main()
     model.materials[0].maps[MAP_ALBEDO].texture = texture;
     model.materials[0].maps[MAP_NORMAL].texture = normalTexture;
     model.materials[0].maps[MAP_METALNESS].texture = metallicTexture;
+
+    // The material maps decide the GBuffer variant
+    Shader gBufferShader = GetShaderVariant(&gBufferVariants, GetMaterialShaderFeatures(model.materials[0]));
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
     model.materials[0].shader = gBufferShader;
 
     // Get map image data to be used for collision detection
@@ -65,7 +84,14 @@ int main()
     Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
     Vector3 playerPosition = camera.position;       // Set player position
 
-    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    GBuffer gBuffer = COMPACT_GBUFFER? LoadGBufferCompact(SCREEN_WIDTH, SCREEN_HEIGHT) : LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+    TraceLog(LOG_INFO, "GBuffer uses %i bytes per pixel", GetGBufferBytesPerPixel(gBuffer));
+
+    R3DLightingBuffer lightingBuffer = LoadLightingBuffer(SCREEN_WIDTH, SCREEN_HEIGHT, LIGHTING_RESOLUTION);
+    R3DSSAO ssao = LoadSSAO(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ssao.budget = 1.0f;     // Milliseconds, the kernel size adapts to it
+
     RenderTexture renderTarget = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
 
     // Main game loop
@@ -105,6 +131,15 @@ int main()
                 }
             }
         }
+
+        // A few lights bob up and down every frame
+        for (int i = 0; i < MOVING_LIGHTS; i++)
+        {
+            R3DLight light = lightSet.lights[i];
+            light.position.y = 1.0f + sinf(GetTime() + i)*0.5f;
+            SetLight(&lightSet, i, light);
+        }
+        UpdateLightSet(&lightSet);
         //----------------------------------------------------------------------------------
 
         // Draw
@@ -121,13 +156,21 @@ int main()
                 EndMode3D();
             EndDeferredMode();
 
-            BeginShaderMode(lightingShader);
-                SetDeferredModeShaderTexture(gBuffer.color, 1);
-                SetDeferredModeShaderTexture(gBuffer.normal, 2);
-                SetDeferredModeShaderTexture(gBuffer.position, 3);
-                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
-                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
-            EndShaderMode();
+            UpdateSSAO(&ssao, gBuffer, camera);
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginLightingMode(lightingBuffer, gBuffer, lightingShader);
+                BeginShaderMode(lightingShader);
+                    SetShaderLightSet(lightingShader, lightSet);
+                    SetDeferredModeShaderTexture(gBuffer.color, 1);
+                    SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                    SetDeferredModeShaderTexture(gBuffer.position, 3);
+                    SetDeferredModeShaderTexture(ssao.occlusion, 4);
+                    SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                    SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                    DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+                EndShaderMode();
+            EndLightingMode(lightingBuffer, gBuffer);
 
             DrawTextureEx(cubicmap, (Vector2){ GetScreenWidth() - cubicmap.width*4 - 20, 20 }, 0.0f, 4.0f, WHITE);
             DrawRectangleLines(GetScreenWidth() - cubicmap.width*4 - 20, 20, cubicmap.width*4, cubicmap.height*4, GREEN);
@@ -135,6 +178,16 @@ int main()
             // Draw player position radar
             DrawRectangle(GetScreenWidth() - cubicmap.width*4 - 20 + playerCellX*4, 20 + playerCellY*4, 4, 4, RED);
 
+            // Rolling pass timings, results arrive a few frames late
+            R3DFrameStats frameStats = GetFrameStats();
+            DrawRectangle(10, 40, 300, 20 + PROFILER_PASS_SSAO*20, Fade(BLACK, 0.6f));
+            for (int i = 0; i <= PROFILER_PASS_SSAO; i++)
+            {
+                R3DPassStats pass = frameStats.passes[i];
+                if (pass.samples == 0) continue;
+                DrawText(TextFormat("%s: GPU %.2f (p99 %.2f) CPU %.2f ms", GetProfilerPassName(i), pass.gpuAvg, pass.gpuP99, pass.cpuAvg), 20, 50 + i*20, 10, WHITE);
+            }
+
             DrawFPS(10, 10);
 
         EndDrawing();
@@ -149,9 +202,14 @@ int main()
     UnloadTexture(texture);     // Unload map texture
     UnloadTexture(normalTexture);     // Unload map texture
     UnloadTexture(metallicTexture);     // Unload map texture
+    model.materials[0].shader.id = rlGetShaderIdDefault();  // The shader belongs to the variants
     UnloadModel(model);         // Unload map model
+    UnloadLightSet(lightSet);
+    UnloadLightingBuffer(lightingBuffer);
+    UnloadSSAO(ssao);
     UnloadGBuffer(gBuffer);
-    UnloadShader(gBufferShader);
+    UnloadShaderVariants(gBufferVariants);
+    UnloadShaderVariants(lightingVariants);
     UnloadRenderTexture(renderTarget);
 
     CloseWindow();              // Close window and OpenGL context
@@ -0,0 +1,176 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <math.h>
+
+#define MAX_LIGHTS    16384
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define FRAME_HISTORY 120
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deferred Clustered");
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders
+    Shader gBufferShader = LoadShader("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+
+    // Both lighting shaders read the same light clusters
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLightingClustered.fs");
+    Shader forwardShader = LoadShader("assets/shaders/forwardClustered.vs", "assets/shaders/forwardClustered.fs");
+    forwardShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(forwardShader, "modelMatrix");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 11;
+    SetShaderValue(forwardShader, GetShaderLocation(forwardShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+
+    // Small lights spread over the whole maze
+    static R3DLight lights[MAX_LIGHTS] = { 0 };
+    static float lightPhase[MAX_LIGHTS] = { 0 };
+    for (int i = 0; i < MAX_LIGHTS; i++)
+    {
+        lights[i].position = (Vector3){ GetRandomValue(-1600, 1600)/100.0f, 0.5f, GetRandomValue(-800, 800)/100.0f };
+        lights[i].color = (Vector3){ GetRandomValue(0, 10)/40.0f, GetRandomValue(0, 10)/40.0f, GetRandomValue(0, 10)/40.0f };
+        lights[i].linear = 0.7f;
+        lights[i].quadratic = 40.0f;
+        lightPhase[i] = GetRandomValue(0, 628)/100.0f;
+    }
+    int lightCount = 4096;
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas_packed.png");    // Load map texture
+    Texture2D normalTexture = LoadTexture("assets/textures/cubicmap_atlas_normal.png");
+    Texture2D metallicTexture =  LoadTexture("assets/textures/cubicmap_atlas_metallic.png");
+    model.materials[0].maps[MAP_ALBEDO].texture = texture;
+    model.materials[0].maps[MAP_NORMAL].texture = normalTexture;
+    model.materials[0].maps[MAP_METALNESS].texture = metallicTexture;
+    model.materials[0].shader = gBufferShader;
+
+    // Transparent spheres, forward lit after the deferred pass
+    Model sphere = LoadModelFromMesh(GenMeshSphere(0.15f, 16, 16));
+    sphere.materials[0].shader = forwardShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+
+    GBuffer gBuffer = LoadGBufferCompact(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+
+    R3DLightClusters lightClusters = LoadLightClusters(SCREEN_WIDTH, SCREEN_HEIGHT, MAX_LIGHTS, LIGHT_CLUSTER_MAX_LIGHTS);
+
+    float frameTimes[FRAME_HISTORY] = { 0 };
+    int frame = 0;
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        if (IsKeyPressed(KEY_UP) && (lightCount < MAX_LIGHTS)) lightCount *= 2;
+        if (IsKeyPressed(KEY_DOWN) && (lightCount > 256)) lightCount /= 2;
+
+        for (int i = 0; i < lightCount; i++)
+        {
+            lights[i].position.y = 0.5f + sinf(GetTime() + lightPhase[i])*0.4f;
+        }
+
+        // Light binning is done once, before any pass reads the clusters
+        double clusterTime = GetTime();
+        UpdateLightClusters(&lightClusters, camera, lights, lightCount);
+        clusterTime = GetTime() - clusterTime;
+
+        frameTimes[frame++%FRAME_HISTORY] = GetFrameTime();
+        float frameAverage = 0.0f, frameWorst = 0.0f;
+        for (int i = 0; i < FRAME_HISTORY; i++)
+        {
+            frameAverage += frameTimes[i]/FRAME_HISTORY;
+            if (frameTimes[i] > frameWorst) frameWorst = frameTimes[i];
+        }
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModel(model, mapPosition, 1.0f, WHITE);                     // Draw maze map
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightClusters(lightingShader, lightClusters);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            // Forward pass, the GBuffer depth hides the spheres behind the maze walls
+            SetDeferredModeShaderCamera(forwardShader, gBuffer, camera);
+            SetShaderLightClusters(forwardShader, lightClusters);
+            SetDeferredModeShaderTexture(gBuffer.depth, 11);
+            BeginMode3D(camera);
+                for (int x = -15; x <= 15; x += 3)
+                {
+                    DrawModel(sphere, (Vector3){ x + 0.5f, 0.5f, 0.5f }, 1.0f, Fade(SKYBLUE, 0.5f));
+                }
+            EndMode3D();
+
+            DrawFPS(10, 10);
+            DrawText(TextFormat("%i lights (UP/DOWN)", lightCount), 10, 40, 20, LIME);
+            DrawText(TextFormat("frame avg %.2f ms, worst %.2f ms", frameAverage*1000.0f, frameWorst*1000.0f), 10, 65, 20, LIME);
+            DrawText(TextFormat("light binning %.2f ms", clusterTime*1000.0), 10, 90, 20, LIME);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    UnloadTexture(texture);     // Unload map texture
+    UnloadTexture(normalTexture);     // Unload map texture
+    UnloadTexture(metallicTexture);     // Unload map texture
+    UnloadModel(model);         // Unload map model
+    UnloadModel(sphere);
+    UnloadLightClusters(lightClusters);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(gBufferShader);
+    UnloadShader(lightingShader);
+    UnloadShader(forwardShader);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define GRID_SIZE     316   // GRID_SIZE*GRID_SIZE props, about 100k
+#define LODS          3
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Culling");
+    SetTargetFPS(60);
+
+    // Setup our camera, inside the field so most props are out of view
+    Camera camera = { { 0.0f, 2.0f, 0.0f }, { 10.0f, 1.5f, 10.0f }, { 0.0f, 1.0f, 0.0f }, 60.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders, the instancing variant reads the transforms from the instance buffer
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLighting.fs");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    R3DLightSet lightSet = LoadLightSet();
+    R3DLight light = { 0 };
+    light.type = LIGHT_DIRECTIONAL;
+    light.direction = (Vector3){ -0.4f, -1.0f, -0.3f };
+    light.color = (Vector3){ 1.0f, 0.95f, 0.9f };
+    AddLight(&lightSet, light);
+    UpdateLightSet(&lightSet);
+
+    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    Shader instancedShader = GetShaderVariant(&gBufferVariants, SHADER_FEATURE_INSTANCING);
+    instancedShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(instancedShader, "modelMatrix");
+    SetDeferredModeShaderLayout(instancedShader, gBuffer);
+
+    // The prop with less and less detail, each level keeping about a third of the triangles of the previous one
+    Model model = LoadModelFromMesh(GenMeshSphere(0.25f, 24, 24));
+    R3DMeshLods lods = GenMeshLods(&model.meshes[0], LODS, 0.35f, 0.0f);
+    model.materials[0].shader = instancedShader;
+
+    // A field of props, the culling set keeps their world bounds
+    R3DBounds bounds = GetModelBounds(model);
+    R3DCullingSet cullingSet = LoadCullingSet(GRID_SIZE*GRID_SIZE);
+    cullingSet.lodSizes[0] = 0.05f;     // Under 5% of the screen height: second level
+    cullingSet.lodSizes[1] = 0.015f;    // Under 1.5%: third level
+    for (int i = 0; i < GRID_SIZE*GRID_SIZE; i++)
+    {
+        float height = GetRandomValue(5, 30)/10.0f;
+        Matrix transform = MatrixMultiply(MatrixScale(1.0f, height, 1.0f), MatrixTranslate((i%GRID_SIZE - GRID_SIZE/2)*0.8f, height*0.25f, (i/GRID_SIZE - GRID_SIZE/2)*0.8f));
+        AddCullingInstance(&cullingSet, bounds, transform);
+    }
+
+    bool culling = true;
+    double cullTime = 0.0;
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        if (IsKeyPressed(KEY_SPACE)) culling = !culling;
+
+        if (culling)
+        {
+            double start = GetTime();
+            CullInstances(&cullingSet, gBuffer, camera);
+            cullTime = GetTime() - start;
+        }
+        else
+        {
+            // Everything visible, at full detail
+            for (int i = 0; i < cullingSet.count; i++)
+            {
+                cullingSet.visible[i] = i;
+                cullingSet.lods[i] = 0;
+            }
+            cullingSet.visibleCount = cullingSet.count;
+            cullTime = 0.0;
+        }
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModelCulledDeferred(model, &cullingSet, -1);     // One instanced draw per level
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            int lodCounts[LODS] = { 0 };
+            for (int i = 0; i < cullingSet.visibleCount; i++) lodCounts[cullingSet.lods[i]]++;
+
+            R3DPassStats gBufferStats = GetFrameStats().passes[PROFILER_PASS_GBUFFER];
+            DrawRectangle(10, 40, 320, 110, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("%i of %i props visible, culling %s (SPACE)", cullingSet.visibleCount, cullingSet.count, culling? "on" : "off"), 20, 50, 10, WHITE);
+            DrawText(TextFormat("Culling: %.3f ms CPU", cullTime*1000.0), 20, 70, 10, WHITE);
+            DrawText(TextFormat("Detail levels: %i / %i / %i", lodCounts[0], lodCounts[1], lodCounts[2]), 20, 90, 10, WHITE);
+            DrawText(TextFormat("Triangles per level: %i / %i / %i", lods.indexCount[0]/3, lods.indexCount[1]/3, lods.indexCount[2]/3), 20, 110, 10, WHITE);
+            DrawText(TextFormat("GBuffer: %.2f ms GPU, %.2f ms CPU", gBufferStats.gpuAvg, gBufferStats.cpuAvg), 20, 130, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    UnloadCullingSet(cullingSet);
+    model.materials[0].shader.id = rlGetShaderIdDefault();  // The shader belongs to the variants
+    UnloadModelAdvanced(model); // Unload the model and the detail levels of its mesh
+    UnloadLightSet(lightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(lightingShader);
+    UnloadShaderVariants(gBufferVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
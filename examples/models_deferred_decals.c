@@ -0,0 +1,166 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define MAX_DECALS    4096
+#define START_DECALS  512
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Decals");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    R3DShaderVariants lightingVariants = LoadShaderVariants(0, "assets/shaders/deferredLighting.fs");
+    Shader lightingShader = GetShaderVariant(&lightingVariants, SHADER_FEATURE_SPECULAR);
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    R3DLightSet lightSet = LoadLightSet();
+    for (int i = 0; i < 6; i++)
+    {
+        R3DLight light = { 0 };
+        light.type = LIGHT_POINT;
+        light.position = (Vector3){ -12.0f + 5.0f*i, 0.6f, GetRandomValue(-4, 4) };
+        light.color = (Vector3){ GetRandomValue(2, 10)/10.0f, GetRandomValue(2, 10)/10.0f, GetRandomValue(2, 10)/10.0f };
+        light.linear = 0.35f;
+        light.quadratic = 0.44f;
+        AddLight(&lightSet, light);
+    }
+    UpdateLightSet(&lightSet);
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas.png");    // Load map texture
+    model.materials[0].maps[MAP_DIFFUSE].texture = texture;             // Set map diffuse texture
+    Shader gBufferShader = GetShaderVariant(&gBufferVariants, GetMaterialShaderFeatures(model.materials[0]));
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+    model.materials[0].shader = gBufferShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+
+    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+
+    // The map atlases double as decal atlases, a decal shows one of their four parts
+    R3DDecals decals = LoadDecals(MAX_DECALS, 0);
+    decals.albedo = texture;
+    decals.normal = LoadTexture("assets/textures/cubicmap_atlas_normal.png");
+
+    // Decals scattered over the maze floor, the ones crossing a wall fade on it
+    R3DDecal decal = { 0 };
+    decal.normalOpacity = 1.0f;
+    for (int i = 0; i < START_DECALS; i++)
+    {
+        int part = GetRandomValue(0, 3);
+        decal.source = (Rectangle){ (part%2)*0.5f, (part/2)*0.5f, 0.5f, 0.5f };
+        decal.tint = (Color){ GetRandomValue(128, 255), GetRandomValue(128, 255), GetRandomValue(128, 255), 200 };
+        Vector3 position = { GetRandomValue(-160, 160)/10.0f, 0.0f, GetRandomValue(-80, 80)/10.0f };
+        decal.transform = GetDecalTransform(position, (Vector3){ 0.0f, 1.0f, 0.0f }, GetRandomValue(0, 360), (Vector3){ 0.6f, 0.5f, 0.6f });
+        AddDecal(&decals, decal);
+    }
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        // Stamp a decal on the floor at the center of the screen
+        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        {
+            RayHitInfo hit = GetCollisionRayGround(GetMouseRay((Vector2){ GetScreenWidth()/2.0f, GetScreenHeight()/2.0f }, camera), 0.0f);
+            if (hit.hit)
+            {
+                decal.source = (Rectangle){ 0.5f, 0.0f, 0.5f, 0.5f };
+                decal.tint = WHITE;
+                decal.transform = GetDecalTransform(hit.position, hit.normal, GetRandomValue(0, 360), (Vector3){ 0.8f, 0.5f, 0.8f });
+                AddDecal(&decals, decal);
+            }
+        }
+        if (IsKeyPressed(KEY_BACKSPACE) && (decals.count > 0)) RemoveDecal(&decals, decals.count - 1);
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModel(model, mapPosition, 1.0f, WHITE);                     // Draw maze map
+
+                EndMode3D();
+            EndDeferredMode();
+
+            DrawDecals(&decals, gBuffer, camera);                                   // Before the lighting pass reads the GBuffer
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            R3DPassStats decalStats = GetFrameStats().passes[PROFILER_PASS_DECALS];
+            DrawRectangle(10, 40, 280, 70, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("Decals: %.2f ms GPU, %.2f ms CPU", decalStats.gpuAvg, decalStats.cpuAvg), 20, 50, 10, WHITE);
+            DrawText(TextFormat("Decals drawn: %i of %i", decals.count, decals.maxDecals), 20, 70, 10, WHITE);
+            DrawText("Click: add a decal, BACKSPACE: remove the last one", 20, 90, 10, WHITE);
+
+            DrawCircle(GetScreenWidth()/2, GetScreenHeight()/2, 2.0f, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    model.materials[0].shader.id = rlGetShaderIdDefault();  // The shader belongs to the variants
+    UnloadModel(model);         // Unload map model (and the albedo atlas)
+    UnloadTexture(decals.normal);
+    UnloadDecals(decals);
+    UnloadLightSet(lightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShaderVariants(gBufferVariants);
+    UnloadShaderVariants(lightingVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define MAX_LIGHTS    LIGHT_SET_MAX_LIGHTS  // Enough lights to make the lighting pass expensive
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+
+int main()
+{
+    // Resizable window, the GBuffer is only reallocated when the size crosses a DYNAMIC_RESOLUTION_BUCKET boundary
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Dynamic Resolution");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders
+    Shader gBufferShader = LoadShader("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLighting.fs");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    R3DLightSet lightSet = LoadLightSet();
+    for (int i = 0; i < MAX_LIGHTS; i++)
+    {
+        R3DLight light = { 0 };
+        light.position = (Vector3){ GetRandomValue(-14, 14), 1, GetRandomValue(-5, 5) };
+        light.color = (Vector3){ GetRandomValue(0, 1), GetRandomValue(0, 1), GetRandomValue(0, 1) };
+        light.linear = 0.7f;
+        light.quadratic = 1.8f;
+        AddLight(&lightSet, light);
+    }
+    UpdateLightSet(&lightSet);
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas.png");    // Load map texture
+    model.materials[0].maps[MAP_DIFFUSE].texture = texture;             // Set map diffuse texture
+    model.materials[0].maps[MAP_METALNESS].texture = GetTextureDefault();
+    model.materials[0].maps[MAP_NORMAL].texture = GetTextureDefault();
+    model.materials[0].shader = gBufferShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+
+    // Standard layout GBuffer, the viewport scale keeps the deferred passes under 1000/60 ms
+    const GBufferAttachmentDesc descs[] = {
+        { GBUFFER_ATTACHMENT_POSITION, GBUFFER_FORMAT_RGB16F },
+        { GBUFFER_ATTACHMENT_NORMAL, GBUFFER_FORMAT_RGB16F },
+        { GBUFFER_ATTACHMENT_ALBEDO_SPEC, GBUFFER_FORMAT_RGBA8 },
+    };
+    R3DDynamicResolution dynamicResolution = LoadDynamicResolution(descs, 3, 14.0f);
+    SetDeferredModeShaderLayout(gBufferShader, dynamicResolution.gbuffer);
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        // Lower the budget to watch the viewport shrink
+        if (IsKeyPressed(KEY_UP)) dynamicResolution.targetTime += 1.0f;
+        if (IsKeyPressed(KEY_DOWN) && (dynamicResolution.targetTime > 1.0f)) dynamicResolution.targetTime -= 1.0f;
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDynamicResolution(&dynamicResolution);
+            GBuffer gBuffer = dynamicResolution.gbuffer;
+
+                BeginDeferredMode(gBuffer);
+                    BeginMode3D(camera);
+
+                        DrawModel(model, mapPosition, 1.0f, WHITE);                     // Draw maze map
+
+                    EndMode3D();
+                EndDeferredMode();
+
+                // The lighting pass runs per screen pixel and upsamples the GBuffer viewport
+                SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+                BeginShaderMode(lightingShader);
+                    SetShaderLightSet(lightingShader, lightSet);
+                    SetDeferredModeShaderTexture(gBuffer.color, 1);
+                    SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                    SetDeferredModeShaderTexture(gBuffer.position, 3);
+                    SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                    SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                    SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                    DrawTexturePro(gBuffer.color, (Rectangle){ 0, 0, gBuffer.viewportWidth, -gBuffer.viewportHeight },
+                        (Rectangle){ 0, 0, GetScreenWidth(), GetScreenHeight() }, Vector2Zero(), 0.0f, WHITE);
+                EndShaderMode();
+
+            EndDynamicResolution(&dynamicResolution);
+
+            DrawRectangle(10, 40, 330, 90, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("GPU: %.2f ms (budget %.0f ms, UP/DOWN)", dynamicResolution.gpuTime, dynamicResolution.targetTime), 20, 50, 10, WHITE);
+            DrawText(TextFormat("Scale: %.2f, viewport %i x %i", dynamicResolution.scale, gBuffer.viewportWidth, gBuffer.viewportHeight), 20, 70, 10, WHITE);
+            DrawText(TextFormat("GBuffer: %i x %i", gBuffer.width, gBuffer.height), 20, 90, 10, WHITE);
+            DrawText(TextFormat("Reallocations: %i", dynamicResolution.reallocations), 20, 110, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    UnloadTexture(texture);     // Unload map texture
+    UnloadModel(model);         // Unload map model
+    UnloadLightSet(lightSet);
+    UnloadDynamicResolution(dynamicResolution);
+    UnloadShader(gBufferShader);
+    UnloadShader(lightingShader);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define GRID_SIZE     100   // GRID_SIZE*GRID_SIZE props
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Instanced");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 30.0f, 20.0f, 30.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_ORBITAL);
+
+    //Load shaders, the instancing variant reads the transforms from the instance buffer
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLighting.fs");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    R3DLightSet lightSet = LoadLightSet();
+    R3DLight light = { 0 };
+    light.type = LIGHT_DIRECTIONAL;
+    light.direction = (Vector3){ -0.4f, -1.0f, -0.3f };
+    light.color = (Vector3){ 1.0f, 0.95f, 0.9f };
+    AddLight(&lightSet, light);
+    UpdateLightSet(&lightSet);
+
+    Model model = LoadModelFromMesh(GenMeshCube(0.4f, 0.4f, 0.4f));
+
+    Shader gBufferShader = GetShaderVariant(&gBufferVariants, 0);
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+    Shader instancedShader = GetShaderVariant(&gBufferVariants, SHADER_FEATURE_INSTANCING);
+    instancedShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(instancedShader, "modelMatrix");
+
+    // A grid of props, each turned and scaled differently
+    int count = GRID_SIZE*GRID_SIZE;
+    Matrix* transforms = (Matrix*)RL_CALLOC(count, sizeof(Matrix));
+    for (int i = 0; i < count; i++)
+    {
+        float height = GetRandomValue(5, 30)/10.0f;
+        Matrix scale = MatrixScale(1.0f, height, 1.0f);
+        Matrix rotation = MatrixRotateY(GetRandomValue(0, 360)*DEG2RAD);
+        Matrix translation = MatrixTranslate((i%GRID_SIZE - GRID_SIZE/2)*0.6f, height*0.2f, (i/GRID_SIZE - GRID_SIZE/2)*0.6f);
+        transforms[i] = MatrixMultiply(MatrixMultiply(scale, rotation), translation);
+    }
+
+    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+    SetDeferredModeShaderLayout(instancedShader, gBuffer);
+
+    bool instanced = true;
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        if (IsKeyPressed(KEY_SPACE)) instanced = !instanced;
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    if (instanced)
+                    {
+                        model.materials[0].shader = instancedShader;
+                        DrawModelInstancedDeferred(model, transforms, count);           // One draw for all the props
+                    }
+                    else
+                    {
+                        model.materials[0].shader = gBufferShader;
+                        for (int i = 0; i < count; i++)
+                        {
+                            model.transform = transforms[i];
+                            DrawModel(model, Vector3Zero(), 1.0f, WHITE);               // One draw per prop
+                        }
+                        model.transform = MatrixIdentity();
+                    }
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            R3DPassStats gBufferStats = GetFrameStats().passes[PROFILER_PASS_GBUFFER];
+            DrawRectangle(10, 40, 280, 70, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("%i props, %s (SPACE)", count, instanced? "instanced" : "one DrawModel() each"), 20, 50, 10, WHITE);
+            DrawText(TextFormat("GBuffer: %.2f ms GPU", gBufferStats.gpuAvg), 20, 70, 10, WHITE);
+            DrawText(TextFormat("GBuffer: %.2f ms CPU", gBufferStats.cpuAvg), 20, 90, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    RL_FREE(transforms);
+    model.materials[0].shader.id = rlGetShaderIdDefault();  // The shader belongs to the variants
+    UnloadModel(model);
+    UnloadLightSet(lightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(lightingShader);
+    UnloadShaderVariants(gBufferVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
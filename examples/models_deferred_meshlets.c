@@ -0,0 +1,131 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Meshlets");
+    SetTargetFPS(60);
+
+    // Setup our camera, close to the knot so part of it is out of view
+    Camera camera = { { 3.0f, 2.0f, 3.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 60.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_ORBITAL);
+
+    //Load shaders
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLighting.fs");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    R3DLightSet lightSet = LoadLightSet();
+    R3DLight light = { 0 };
+    light.type = LIGHT_DIRECTIONAL;
+    light.direction = (Vector3){ -0.4f, -1.0f, -0.3f };
+    light.color = (Vector3){ 1.0f, 0.95f, 0.9f };
+    AddLight(&lightSet, light);
+    UpdateLightSet(&lightSet);
+
+    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    // A dense mesh, about 65k triangles, split into meshlets once
+    Mesh mesh = GenMeshKnot(1.0f, 2.0f, 512, 64);
+    R3DMeshlets meshlets = LoadMeshlets(&mesh);
+
+    Material material = LoadMaterialDefault();
+    material.shader = GetShaderVariant(&gBufferVariants, GetMaterialShaderFeatures(material));
+    material.shader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(material.shader, "modelMatrix");
+    SetDeferredModeShaderLayout(material.shader, gBuffer);
+
+    Matrix transform = MatrixIdentity();
+    bool culling = true;
+    double cullTime = 0.0;
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        if (IsKeyPressed(KEY_SPACE)) culling = !culling;
+
+        if (culling)
+        {
+            double start = GetTime();
+            CullMeshlets(&meshlets, gBuffer, camera, transform);
+            cullTime = GetTime() - start;
+        }
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    if (culling) DrawMeshletsDeferred(mesh, meshlets, material, transform);   // Only the meshlets in view and facing the camera
+                    else DrawMesh(mesh, material, transform);
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            R3DPassStats gBufferStats = GetFrameStats().passes[PROFILER_PASS_GBUFFER];
+            DrawRectangle(10, 40, 320, 110, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("Meshlet culling %s (SPACE): %.3f ms CPU", culling? "on" : "off", cullTime*1000.0), 20, 50, 10, WHITE);
+            DrawText(TextFormat("Meshlets: %i of %i, in %i draw ranges", culling? meshlets.visibleCount : meshlets.count, meshlets.count, culling? meshlets.drawCount : 1), 20, 70, 10, WHITE);
+            DrawText(TextFormat("Triangles: %i of %i", culling? meshlets.visibleTriangles : mesh.triangleCount, mesh.triangleCount), 20, 90, 10, WHITE);
+            DrawText(TextFormat("GBuffer: %.2f ms GPU, %.2f ms CPU", gBufferStats.gpuAvg, gBufferStats.cpuAvg), 20, 110, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    UnloadMeshlets(meshlets);
+    material.shader.id = rlGetShaderIdDefault();   // The shader belongs to the variants
+    UnloadMaterial(material);
+    UnloadMesh(mesh);
+    UnloadLightSet(lightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(lightingShader);
+    UnloadShaderVariants(gBufferVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
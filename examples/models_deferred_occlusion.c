@@ -0,0 +1,180 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define PROPS         20000
+#define OCCLUSION_WIDTH  256
+#define OCCLUSION_HEIGHT 128
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Occlusion Culling");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLighting.fs");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    R3DLightSet lightSet = LoadLightSet();
+    R3DLight light = { 0 };
+    light.type = LIGHT_DIRECTIONAL;
+    light.direction = (Vector3){ -0.4f, -1.0f, -0.3f };
+    light.color = (Vector3){ 1.0f, 0.95f, 0.9f };
+    AddLight(&lightSet, light);
+    UpdateLightSet(&lightSet);
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Color* mapPixels = LoadImageColors(imMap);
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas.png");    // Load map texture
+    model.materials[0].maps[MAP_DIFFUSE].texture = texture;             // Set map diffuse texture
+    Shader gBufferShader = GetShaderVariant(&gBufferVariants, GetMaterialShaderFeatures(model.materials[0]));
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+    model.materials[0].shader = gBufferShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+
+    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+
+    Shader instancedShader = GetShaderVariant(&gBufferVariants, SHADER_FEATURE_INSTANCING);
+    instancedShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(instancedShader, "modelMatrix");
+    SetDeferredModeShaderLayout(instancedShader, gBuffer);
+
+    Model prop = LoadModelFromMesh(GenMeshSphere(0.05f, 12, 12));
+    prop.materials[0].shader = instancedShader;
+
+    // The maze walls are the occluders, the props are scattered over its free cells
+    R3DOcclusionBuffer occlusion = LoadOcclusionBuffer(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+    AddOccluderModel(&occlusion, model, MatrixTranslate(mapPosition.x, mapPosition.y, mapPosition.z));
+
+    R3DBounds propBounds = GetModelBounds(prop);
+    R3DCullingSet cullingSet = LoadCullingSet(PROPS);
+    while (cullingSet.count < PROPS)
+    {
+        int x = GetRandomValue(0, imMap.width - 1);
+        int z = GetRandomValue(0, imMap.height - 1);
+        if (mapPixels[z*imMap.width + x].r == 255) continue;     // Wall
+
+        Vector3 position = { mapPosition.x + x + GetRandomValue(-40, 40)/100.0f, 0.05f, mapPosition.z + z + GetRandomValue(-40, 40)/100.0f };
+        AddCullingInstance(&cullingSet, propBounds, MatrixTranslate(position.x, position.y, position.z));
+    }
+    UnloadImageColors(mapPixels);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // Occlusion buffer shown in a corner
+    Image occlusionImage = GetOcclusionBufferImage(occlusion);
+    Texture2D occlusionTexture = LoadTextureFromImage(occlusionImage);
+    UnloadImage(occlusionImage);
+
+    bool occlusionCulling = true;
+    int frustumVisible = 0;
+    double occlusionTime = 0.0;
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        if (IsKeyPressed(KEY_SPACE)) occlusionCulling = !occlusionCulling;
+
+        frustumVisible = CullInstances(&cullingSet, gBuffer, camera);
+        if (occlusionCulling)
+        {
+            double start = GetTime();
+            UpdateOcclusionBuffer(&occlusion, gBuffer, camera);
+            OccludeInstances(&occlusion, &cullingSet);
+            occlusionTime = GetTime() - start;
+
+            occlusionImage = GetOcclusionBufferImage(occlusion);
+            UpdateTexture(occlusionTexture, occlusionImage.data);
+            UnloadImage(occlusionImage);
+        }
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModel(model, mapPosition, 1.0f, WHITE);                     // Draw maze map
+                    DrawModelCulledDeferred(prop, &cullingSet, -1);                 // Only the props in view and not behind a wall
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            DrawRectangle(10, 40, 320, 90, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("Props: %i in the frustum, %i drawn", frustumVisible, cullingSet.visibleCount), 20, 50, 10, WHITE);
+            DrawText(TextFormat("Occlusion culling %s (SPACE): %.3f ms CPU", occlusionCulling? "on" : "off", occlusionTime*1000.0), 20, 70, 10, WHITE);
+            DrawText(TextFormat("Occluder triangles: %i of %i", occlusion.triangles, occlusion.occluderCount), 20, 90, 10, WHITE);
+            DrawText(TextFormat("Occluded props: %i", occlusionCulling? occlusion.occluded : 0), 20, 110, 10, WHITE);
+
+            DrawTexture(occlusionTexture, GetScreenWidth() - occlusionTexture.width - 10, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    UnloadTexture(occlusionTexture);
+    UnloadOcclusionBuffer(occlusion);
+    UnloadCullingSet(cullingSet);
+    prop.materials[0].shader.id = rlGetShaderIdDefault();   // The shaders belong to the variants
+    model.materials[0].shader.id = rlGetShaderIdDefault();
+    UnloadModel(prop);
+    UnloadModel(model);         // Unload map model (and its textures)
+    UnloadLightSet(lightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(lightingShader);
+    UnloadShaderVariants(gBufferVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define GRID_SIZE     48    // GRID_SIZE*GRID_SIZE props
+#define MATERIALS     4
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Render Queue");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 20.0f, 12.0f, 20.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_ORBITAL);
+
+    //Load shaders
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLighting.fs");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    R3DLightSet lightSet = LoadLightSet();
+    R3DLight light = { 0 };
+    light.type = LIGHT_DIRECTIONAL;
+    light.direction = (Vector3){ -0.4f, -1.0f, -0.3f };
+    light.color = (Vector3){ 1.0f, 0.95f, 0.9f };
+    AddLight(&lightSet, light);
+    UpdateLightSet(&lightSet);
+
+    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    // Two meshes and a few materials, some of them with a normal map and so another shader variant
+    Mesh meshes[2] = { GenMeshCube(0.4f, 0.4f, 0.4f), GenMeshSphere(0.25f, 12, 12) };
+    const char* textures[MATERIALS] = {
+        "assets/textures/cubicmap_atlas.png", "assets/textures/cubicmap_atlas_metallic.png",
+        "assets/textures/cubicmap_atlas_packed.png", "assets/textures/cubicmap_atlas.png"
+    };
+    Material materials[MATERIALS] = { 0 };
+    for (int i = 0; i < MATERIALS; i++)
+    {
+        materials[i] = LoadMaterialDefault();
+        materials[i].maps[MAP_DIFFUSE].texture = LoadTexture(textures[i]);
+        if (i%2 == 1) materials[i].maps[MATERIAL_MAP_NORMAL].texture = LoadTexture("assets/textures/cubicmap_atlas_normal.png");
+
+        materials[i].shader = GetShaderVariant(&gBufferVariants, GetMaterialShaderFeatures(materials[i]));
+        materials[i].shader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(materials[i].shader, "modelMatrix");
+        SetDeferredModeShaderLayout(materials[i].shader, gBuffer);
+    }
+
+    // The same draws recorded once in a draw list, as a static level would be
+    R3DDrawList drawList = LoadDrawList();
+    for (int i = 0; i < GRID_SIZE*GRID_SIZE; i++)
+    {
+        Matrix transform = MatrixTranslate((i%GRID_SIZE - GRID_SIZE/2)*0.6f, 0.2f, (i/GRID_SIZE - GRID_SIZE/2)*0.6f);
+        AddDrawListMesh(&drawList, meshes[i%2], materials[i%MATERIALS], transform);
+    }
+
+    const char* modes[3] = { "immediate", "sorted render queue", "draw list" };
+    int mode = 1;
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        if (IsKeyPressed(KEY_SPACE)) mode = (mode + 1)%3;
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    if (mode == 2) ReplayDrawList(&drawList);                            // Sorted and resolved once
+                    else
+                    {
+                        // Submitted with the materials and meshes interleaved, the worst order for immediate drawing
+                        for (int i = 0; i < GRID_SIZE*GRID_SIZE; i++)
+                        {
+                            Matrix transform = MatrixTranslate((i%GRID_SIZE - GRID_SIZE/2)*0.6f, 0.2f, (i/GRID_SIZE - GRID_SIZE/2)*0.6f);
+                            if (mode == 1) DrawMeshQueued(meshes[i%2], materials[i%MATERIALS], transform);
+                            else DrawMesh(meshes[i%2], materials[i%MATERIALS], transform);
+                        }
+                    }
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            R3DPassStats gBufferStats = GetFrameStats().passes[PROFILER_PASS_GBUFFER];
+            R3DRenderQueueStats queueStats = GetRenderQueueStats();
+            DrawRectangle(10, 40, 320, 110, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("%i draws, %s (SPACE)", GRID_SIZE*GRID_SIZE, modes[mode]), 20, 50, 10, WHITE);
+            DrawText(TextFormat("GBuffer: %.2f ms GPU, %.2f ms CPU", gBufferStats.gpuAvg, gBufferStats.cpuAvg), 20, 70, 10, WHITE);
+            DrawText(TextFormat("Shader binds: %i (%i avoided)", queueStats.shaderBinds, queueStats.shaderBindsAvoided), 20, 90, 10, WHITE);
+            DrawText(TextFormat("Texture binds: %i (%i avoided)", queueStats.textureBinds, queueStats.textureBindsAvoided), 20, 110, 10, WHITE);
+            DrawText(TextFormat("Vertex array binds: %i (%i avoided)", queueStats.vaoBinds, queueStats.vaoBindsAvoided), 20, 130, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    for (int i = 0; i < MATERIALS; i++)
+    {
+        materials[i].shader.id = rlGetShaderIdDefault();  // The shaders belong to the variants
+        UnloadMaterial(materials[i]);
+    }
+    UnloadDrawList(drawList);
+    UnloadMesh(meshes[0]);
+    UnloadMesh(meshes[1]);
+    UnloadLightSet(lightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(lightingShader);
+    UnloadShaderVariants(gBufferVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define ATLAS_SIZE    4096
+#define POINT_LIGHTS  6
+#define SPOT_LIGHTS   2
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Shadow Atlas");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders, the lighting shader is the variant sampling the atlas
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    R3DShaderVariants lightingVariants = LoadShaderVariants(0, "assets/shaders/deferredLighting.fs");
+    Shader lightingShader = GetShaderVariant(&lightingVariants, SHADER_FEATURE_SPECULAR | SHADER_FEATURE_SHADOWS);
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    R3DShadowAtlas atlas = LoadShadowAtlas(ATLAS_SIZE);
+
+    // Static point lights along the maze and spot lights sweeping it, all shadowed through the atlas
+    R3DLightSet lightSet = LoadLightSet();
+    for (int i = 0; i < POINT_LIGHTS; i++)
+    {
+        R3DLight light = { 0 };
+        light.type = LIGHT_POINT;
+        light.position = (Vector3){ -12.0f + 5.0f*i, 0.6f, GetRandomValue(-4, 4) };
+        light.color = (Vector3){ GetRandomValue(2, 10)/10.0f, GetRandomValue(2, 10)/10.0f, GetRandomValue(2, 10)/10.0f };
+        light.linear = 0.35f;
+        light.quadratic = 0.44f;
+        AddShadowLight(&atlas, &lightSet, AddLight(&lightSet, light));
+    }
+
+    int spotLights[SPOT_LIGHTS] = { 0 };
+    for (int i = 0; i < SPOT_LIGHTS; i++)
+    {
+        R3DLight light = { 0 };
+        light.type = LIGHT_SPOT;
+        light.position = (Vector3){ -6.0f + 12.0f*i, 3.0f, 0.0f };
+        light.direction = (Vector3){ 0.0f, -1.0f, 0.0f };
+        light.spotAngle = 35.0f;
+        light.color = (Vector3){ 1.0f, 0.95f, 0.8f };
+        light.linear = 0.09f;
+        light.quadratic = 0.032f;
+        spotLights[i] = AddLight(&lightSet, light);
+        AddShadowLight(&atlas, &lightSet, spotLights[i]);
+    }
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas.png");    // Load map texture
+    model.materials[0].maps[MAP_DIFFUSE].texture = texture;             // Set map diffuse texture
+    Shader gBufferShader = GetShaderVariant(&gBufferVariants, GetMaterialShaderFeatures(model.materials[0]));
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+    model.materials[0].shader = gBufferShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+
+    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        if (IsKeyPressed(KEY_UP)) atlas.updateBudget++;
+        if (IsKeyPressed(KEY_DOWN) && (atlas.updateBudget > 1)) atlas.updateBudget--;
+
+        // Only the spot lights move, the point light views stay cached
+        for (int i = 0; i < SPOT_LIGHTS; i++)
+        {
+            R3DLight light = lightSet.lights[spotLights[i]];
+            float angle = GetTime()*0.5f + i*PI;
+            light.direction = (Vector3){ cosf(angle)*0.6f, -1.0f, sinf(angle)*0.6f };
+            SetLight(&lightSet, spotLights[i], light);
+        }
+
+        UpdateShadowAtlas(&atlas, &lightSet, camera, (float)GetScreenWidth()/(float)GetScreenHeight());
+        UpdateLightSet(&lightSet);
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginProfilerPass(PROFILER_PASS_SHADOWS);
+            for (int i = 0; i < atlas.updateCount; i++)
+            {
+                BeginShadowAtlasView(&atlas, i);
+                    DrawModel(model, mapPosition, 1.0f, WHITE);
+                EndShadowAtlasView(&atlas);
+            }
+            EndProfilerPass(PROFILER_PASS_SHADOWS);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModel(model, mapPosition, 1.0f, WHITE);                     // Draw maze map
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetShaderShadowAtlas(lightingShader, atlas);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            R3DPassStats shadowStats = GetFrameStats().passes[PROFILER_PASS_SHADOWS];
+            DrawRectangle(10, 40, 280, 70, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("Shadows: %.2f ms GPU", shadowStats.gpuAvg), 20, 50, 10, WHITE);
+            DrawText(TextFormat("Views drawn: %i of %i per frame (UP/DOWN)", atlas.updateCount, atlas.updateBudget), 20, 70, 10, WHITE);
+            DrawText(TextFormat("Views drawn since loaded: %i", atlas.viewUpdates), 20, 90, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    model.materials[0].shader.id = rlGetShaderIdDefault();  // The shader belongs to the variants
+    UnloadModel(model);         // Unload map model
+    UnloadShadowAtlas(atlas);
+    UnloadLightSet(lightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShaderVariants(gBufferVariants);
+    UnloadShaderVariants(lightingVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define SHADOW_SIZE   2048
+#define CASCADES      4
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deffered Shadows");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders, the lighting shader is the variant sampling the cascades
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    R3DShaderVariants lightingVariants = LoadShaderVariants(0, "assets/shaders/deferredLighting.fs");
+    Shader lightingShader = GetShaderVariant(&lightingVariants, SHADER_FEATURE_SPECULAR | SHADER_FEATURE_SHADOWS);
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    // A single sun, the cascades follow its direction
+    Vector3 sunDirection = { -0.4f, -1.0f, -0.3f };
+    R3DLightSet lightSet = LoadLightSet();
+    R3DLight sun = { 0 };
+    sun.type = LIGHT_DIRECTIONAL;
+    sun.direction = sunDirection;
+    sun.color = (Vector3){ 1.0f, 0.95f, 0.85f };
+    AddLight(&lightSet, sun);
+    UpdateLightSet(&lightSet);
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas.png");    // Load map texture
+    model.materials[0].maps[MAP_DIFFUSE].texture = texture;             // Set map diffuse texture
+    Shader gBufferShader = GetShaderVariant(&gBufferVariants, GetMaterialShaderFeatures(model.materials[0]));
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+    model.materials[0].shader = gBufferShader;
+
+    // A cube circling the maze, drawn in the dynamic shadow layer every frame
+    Model cube = LoadModelFromMesh(GenMeshCube(0.3f, 0.3f, 0.3f));
+    cube.materials[0].shader = gBufferShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+
+    GBuffer gBuffer = LoadGBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+
+    R3DShadowCascades shadows = LoadShadowCascades(SHADOW_SIZE, CASCADES);
+    shadows.maxDistance = 30.0f;
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        Vector3 cubePosition = { cosf(GetTime()*0.5f)*6.0f, 1.3f, sinf(GetTime()*0.5f)*3.0f };
+
+        // The static layer is only drawn again when a cascade moves
+        UpdateShadowCascades(&shadows, camera, (float)GetScreenWidth()/(float)GetScreenHeight(), sunDirection);
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginProfilerPass(PROFILER_PASS_SHADOWS);
+            for (int i = 0; i < shadows.cascadeCount; i++)
+            {
+                if (BeginShadowCascade(&shadows, i, SHADOW_LAYER_STATIC))
+                {
+                    DrawModel(model, mapPosition, 1.0f, WHITE);
+                    EndShadowCascade(&shadows);
+                }
+
+                BeginShadowCascade(&shadows, i, SHADOW_LAYER_DYNAMIC);
+                    DrawModel(cube, cubePosition, 1.0f, WHITE);
+                EndShadowCascade(&shadows);
+            }
+            EndProfilerPass(PROFILER_PASS_SHADOWS);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModel(model, mapPosition, 1.0f, WHITE);                     // Draw maze map
+                    DrawModel(cube, cubePosition, 1.0f, WHITE);
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, lightSet);
+                SetShaderShadowCascades(lightingShader, shadows);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            R3DPassStats shadowStats = GetFrameStats().passes[PROFILER_PASS_SHADOWS];
+            DrawRectangle(10, 40, 260, 50, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("Shadows: %.2f ms GPU", shadowStats.gpuAvg), 20, 50, 10, WHITE);
+            DrawText(TextFormat("Static layer updates: %i", shadows.staticUpdates), 20, 70, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    model.materials[0].shader.id = rlGetShaderIdDefault();  // The shader belongs to the variants
+    cube.materials[0].shader.id = rlGetShaderIdDefault();
+    UnloadModel(model);         // Unload map model
+    UnloadModel(cube);
+    UnloadShadowCascades(shadows);
+    UnloadLightSet(lightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShaderVariants(gBufferVariants);
+    UnloadShaderVariants(lightingVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
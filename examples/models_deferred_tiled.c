@@ -0,0 +1,137 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define MAX_LIGHTS    1024
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deferred Tiled");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders
+    Shader gBufferShader = LoadShader("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+
+    // Tiled lighting shader, only walks the lights of each screen tile
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLightingTiled.fs");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    // Lights are kept on the CPU, tiles are rebuilt every frame
+    R3DLight lights[MAX_LIGHTS] = { 0 };
+    float lightPhase[MAX_LIGHTS] = { 0 };
+    for (int i = 0; i < MAX_LIGHTS; i++)
+    {
+        lights[i].position = (Vector3){ GetRandomValue(-14, 14), 0.5f, GetRandomValue(-6, 6) };
+        lights[i].color = (Vector3){ GetRandomValue(0, 1), GetRandomValue(0, 1), GetRandomValue(0, 1) };
+        lights[i].linear = 0.7f;
+        lights[i].quadratic = 8.0f;
+        lightPhase[i] = GetRandomValue(0, 628)/100.0f;
+    }
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas_packed.png");    // Load map texture
+    Texture2D normalTexture = LoadTexture("assets/textures/cubicmap_atlas_normal.png");
+    Texture2D metallicTexture =  LoadTexture("assets/textures/cubicmap_atlas_metallic.png");
+    model.materials[0].maps[MAP_ALBEDO].texture = texture;
+    model.materials[0].maps[MAP_NORMAL].texture = normalTexture;
+    model.materials[0].maps[MAP_METALNESS].texture = metallicTexture;
+    model.materials[0].shader = gBufferShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+
+    GBuffer gBuffer = LoadGBufferCompact(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+
+    R3DLightTiles lightTiles = LoadLightTiles(SCREEN_WIDTH, SCREEN_HEIGHT, MAX_LIGHTS, LIGHT_TILE_MAX_LIGHTS);
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        for (int i = 0; i < MAX_LIGHTS; i++)
+        {
+            lights[i].position.y = 0.5f + sinf(GetTime() + lightPhase[i])*0.4f;
+        }
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModel(model, mapPosition, 1.0f, WHITE);                     // Draw maze map
+
+                EndMode3D();
+            EndDeferredMode();
+
+            // Bin the lights into screen tiles using the GBuffer depth
+            UpdateLightTiles(&lightTiles, gBuffer, camera, lights, MAX_LIGHTS);
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetDeferredModeShaderTiles(lightingShader, lightTiles);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            DrawFPS(10, 10);
+            DrawText(TextFormat("%i lights, %s culling", MAX_LIGHTS, lightTiles.compute? "compute" : "CPU"), 10, 40, 20, LIME);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    UnloadTexture(texture);     // Unload map texture
+    UnloadTexture(normalTexture);     // Unload map texture
+    UnloadTexture(metallicTexture);     // Unload map texture
+    UnloadModel(model);         // Unload map model
+    UnloadLightTiles(lightTiles);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(gBufferShader);
+    UnloadShader(lightingShader);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
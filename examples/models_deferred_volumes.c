@@ -0,0 +1,115 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define MAX_LIGHTS    512
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Deferred Light Volumes");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders
+    Shader gBufferShader = LoadShader("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    gBufferShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(gBufferShader, "modelMatrix");
+
+    // Point lights only shade the pixels inside their volume, so there is no light count limit
+    R3DLight lights[MAX_LIGHTS] = { 0 };
+    float lightPhase[MAX_LIGHTS] = { 0 };
+    for (int i = 0; i < MAX_LIGHTS; i++)
+    {
+        lights[i].position = (Vector3){ GetRandomValue(-14, 14), 0.5f, GetRandomValue(-6, 6) };
+        lights[i].color = (Vector3){ GetRandomValue(0, 1), GetRandomValue(0, 1), GetRandomValue(0, 1) };
+        lights[i].linear = 0.7f;
+        lights[i].quadratic = 8.0f;
+        lightPhase[i] = GetRandomValue(0, 628)/100.0f;
+    }
+
+    // Dim moon light, drawn full screen
+    lights[0].type = LIGHT_DIRECTIONAL;
+    lights[0].direction = (Vector3){ -0.3f, -1.0f, -0.5f };
+    lights[0].color = (Vector3){ 0.15f, 0.15f, 0.25f };
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas_packed.png");    // Load map texture
+    Texture2D normalTexture = LoadTexture("assets/textures/cubicmap_atlas_normal.png");
+    Texture2D metallicTexture =  LoadTexture("assets/textures/cubicmap_atlas_metallic.png");
+    model.materials[0].maps[MAP_ALBEDO].texture = texture;
+    model.materials[0].maps[MAP_NORMAL].texture = normalTexture;
+    model.materials[0].maps[MAP_METALNESS].texture = metallicTexture;
+    model.materials[0].shader = gBufferShader;
+
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+
+    GBuffer gBuffer = LoadGBufferCompact(SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetDeferredModeShaderLayout(gBufferShader, gBuffer);
+
+    R3DLightVolumes lightVolumes = LoadLightVolumes(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        for (int i = 1; i < MAX_LIGHTS; i++)
+        {
+            lights[i].position.y = 0.5f + sinf(GetTime() + lightPhase[i])*0.4f;
+        }
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(RAYWHITE);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModel(model, mapPosition, 1.0f, WHITE);                     // Draw maze map
+
+                EndMode3D();
+            EndDeferredMode();
+
+            // Accumulate every light into the HDR lighting target
+            DrawLightVolumes(lightVolumes, gBuffer, camera, lights, MAX_LIGHTS);
+
+            DrawTexturePro(lightVolumes.lighting, (Rectangle){0, 0, lightVolumes.width, -lightVolumes.height}, (Rectangle){0, 0, lightVolumes.width, lightVolumes.height}, Vector2Zero(), 0.0f, WHITE);
+
+            DrawFPS(10, 10);
+            DrawText(TextFormat("%i lights", MAX_LIGHTS), 10, 40, 20, LIME);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    UnloadTexture(texture);     // Unload map texture
+    UnloadTexture(normalTexture);     // Unload map texture
+    UnloadTexture(metallicTexture);     // Unload map texture
+    UnloadModel(model);         // Unload map model
+    UnloadLightVolumes(lightVolumes);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(gBufferShader);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+#define R3D_IMPLEMENTATION
+#include "../r3d.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SCREEN_WIDTH  1280
+#define SCREEN_HEIGHT 720
+#define LIGHTMAP_SIZE 1024
+#define LIGHTS        6
+
+int main()
+{
+    // Basic raylib window creation
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Example - Models Lightmap Bake");
+    SetTargetFPS(60);
+
+    // Setup our camera
+    Camera camera = { { 0.2f, 0.4f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f, CAMERA_PERSPECTIVE};
+    SetCameraMode(camera, CAMERA_FIRST_PERSON);
+
+    //Load shaders, the gbuffer variant is picked from the material once it has its lightmap
+    R3DShaderVariants gBufferVariants = LoadShaderVariants("assets/shaders/gbuffer.vs", "assets/shaders/gbuffer.fs");
+    Shader lightingShader = LoadShader(0, "assets/shaders/deferredLighting.fs");
+
+    int shaderValue = 1;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "colorbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 2;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "normalbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 3;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "positionbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 4;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "ssaobuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 5;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "depthbuffer"), &shaderValue, UNIFORM_INT);
+    shaderValue = 6;
+    SetShaderValue(lightingShader, GetShaderLocation(lightingShader, "emissionbuffer"), &shaderValue, UNIFORM_INT);
+
+    // The same lights are baked and shaded in real time, to compare both, the baked lighting is shaded with no lights
+    R3DLightSet bakedLightSet = LoadLightSet();
+    UpdateLightSet(&bakedLightSet);
+    R3DLightSet lightSet = LoadLightSet();
+    R3DLight lights[LIGHTS] = { 0 };
+    for (int i = 0; i < LIGHTS; i++)
+    {
+        lights[i].type = LIGHT_POINT;
+        lights[i].position = (Vector3){ -12.0f + 5.0f*i, 0.6f, GetRandomValue(-4, 4) };
+        lights[i].color = (Vector3){ GetRandomValue(2, 10)/10.0f, GetRandomValue(2, 10)/10.0f, GetRandomValue(2, 10)/10.0f };
+        lights[i].linear = 0.35f;
+        lights[i].quadratic = 0.44f;
+        AddLight(&lightSet, lights[i]);
+    }
+    UpdateLightSet(&lightSet);
+
+    Image imMap = LoadImage("assets/textures/cubicmap.png");      // Load cubicmap image (RAM)
+    Mesh mesh = GenMeshCubicmap(imMap, (Vector3){ 1.0f, 1.0f, 1.0f });
+    Model model = LoadModelFromMesh(mesh);
+    UnloadImage(imMap);             // Unload image from RAM
+
+    // Bake in the space the model is drawn in
+    Vector3 mapPosition = { -16.0f, 0.0f, -8.0f };  // Set model position
+    model.transform = MatrixTranslate(mapPosition.x, mapPosition.y, mapPosition.z);
+
+    R3DBakeSettings settings = { 0 };
+    settings.size = LIGHTMAP_SIZE;
+    settings.ambient = (Vector3){ 0.05f, 0.05f, 0.08f };
+    double bakeStart = GetTime();
+    Image lightmap = BakeLightmaps(&model, lights, LIGHTS, settings);
+    double bakeTime = GetTime() - bakeStart;
+
+    // NOTE: By default each cube is mapped to one part of texture atlas
+    Texture2D texture = LoadTexture("assets/textures/cubicmap_atlas.png");    // Load map texture
+    model.materials[0].maps[MAP_DIFFUSE].texture = texture;             // Set map diffuse texture
+    model.materials[0].maps[MATERIAL_MAP_LIGHTMAP].texture = LoadTextureFromImage(lightmap);
+    SetTextureFilter(model.materials[0].maps[MATERIAL_MAP_LIGHTMAP].texture, FILTER_BILINEAR);
+    UnloadImage(lightmap);
+
+    // The lightmap variant adds the baked lighting to the emission attachment, the other one ignores the lightmap
+    unsigned int features = GetMaterialShaderFeatures(model.materials[0]);
+    Shader bakedShader = GetShaderVariant(&gBufferVariants, features);
+    bakedShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(bakedShader, "modelMatrix");
+    Shader realTimeShader = GetShaderVariant(&gBufferVariants, features & ~SHADER_FEATURE_LIGHTMAP);
+    realTimeShader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(realTimeShader, "modelMatrix");
+
+    // The lighting pass adds the emission attachment to the lit image
+    GBufferAttachmentDesc descs[] = {
+        { GBUFFER_ATTACHMENT_POSITION, GBUFFER_FORMAT_RGB16F },
+        { GBUFFER_ATTACHMENT_NORMAL, GBUFFER_FORMAT_RGB16F },
+        { GBUFFER_ATTACHMENT_ALBEDO_SPEC, GBUFFER_FORMAT_RGBA8 },
+        { GBUFFER_ATTACHMENT_EMISSION, GBUFFER_FORMAT_RGB16F },
+    };
+    GBuffer gBuffer = LoadGBufferEx(SCREEN_WIDTH, SCREEN_HEIGHT, descs, 4);
+    SetDeferredModeShaderLayout(bakedShader, gBuffer);
+    SetDeferredModeShaderLayout(realTimeShader, gBuffer);
+
+    bool baked = true;
+
+    // Main game loop
+    while (!WindowShouldClose())    // Detect window close button or ESC key
+    {
+        // Update
+        //----------------------------------------------------------------------------------
+        UpdateCamera(&camera);      // Update camera
+
+        if (IsKeyPressed(KEY_SPACE)) baked = !baked;
+        model.materials[0].shader = baked? bakedShader : realTimeShader;
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginDrawing();
+
+            ClearBackground(BLACK);
+
+            BeginDeferredMode(gBuffer);
+                BeginMode3D(camera);
+
+                    DrawModel(model, Vector3Zero(), 1.0f, WHITE);           // Draw maze map, already placed by its transform
+
+                EndMode3D();
+            EndDeferredMode();
+
+            SetDeferredModeShaderCamera(lightingShader, gBuffer, camera);
+            BeginShaderMode(lightingShader);
+                SetShaderLightSet(lightingShader, baked? bakedLightSet : lightSet);
+                SetDeferredModeShaderTexture(gBuffer.color, 1);
+                SetDeferredModeShaderTexture(gBuffer.normal, 2);
+                SetDeferredModeShaderTexture(gBuffer.position, 3);
+                SetDeferredModeShaderTexture(GetTextureDefault(), 4);
+                SetDeferredModeShaderTexture(gBuffer.depth, 5);
+                SetDeferredModeShaderTexture(GetGBufferAttachment(gBuffer, GBUFFER_ATTACHMENT_EMISSION), 6);
+                DrawTexturePro(gBuffer.color, (Rectangle){0, 0, gBuffer.width, -gBuffer.height}, (Rectangle){0, 0, gBuffer.width, gBuffer.height}, Vector2Zero(), 0.0f, WHITE);
+            EndShaderMode();
+
+            DrawRectangle(10, 40, 260, 50, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("Lighting: %s (SPACE)", baked? "baked" : "real time"), 20, 50, 10, WHITE);
+            DrawText(TextFormat("Baked in %.2f s on the CPU", bakeTime), 20, 70, 10, WHITE);
+
+            DrawFPS(10, 10);
+
+        EndDrawing();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    model.materials[0].shader.id = rlGetShaderIdDefault();  // The shader belongs to the variants
+    UnloadModel(model);         // Unload map model (and its textures)
+    UnloadLightSet(lightSet);
+    UnloadLightSet(bakedLightSet);
+    UnloadGBuffer(gBuffer);
+    UnloadShader(lightingShader);
+    UnloadShaderVariants(gBufferVariants);
+
+    CloseWindow();              // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
@@ -29,6 +29,17 @@
 *       Define this flag if you wish to include your own GLAD OpenGL profile.
 *       NOTE: Currently this flag is unsupported
 *
+*   #define R3D_NO_THREADS
+*       Defining this before R3D_IMPLEMENTATION runs the CPU side passes (e.g. light culling) on the calling thread only.
+*       By default a pool of worker threads (up to R3D_MAX_THREADS) is started on first use.
+*       NOTE: On Linux, threads need to link with -lpthread
+*
+*   #define R3D_NO_SIMD
+*       Defining this before R3D_IMPLEMENTATION disables the SSE paths of the CPU side passes.
+*
+*   #define R3D_NO_PROFILER
+*       Defining this before R3D_IMPLEMENTATION removes the GPU/CPU timing of the passes (see GetFrameStats()).
+*
 *   #define R3D_CUSTOM_ALLOCATORS
 *   #define R3D_MALLOC()
 *   #define R3D_CALLOC()
@@ -64,245 +75,9682 @@
 *
 **********************************************************************************************/
 
-#if !defined(R3D_H)
-#define R3D_H
+#if !defined(R3D_H)
+#define R3D_H
+
+#if defined(__cplusplus)
+#define R3DDEF extern "C"
+#else
+#define R3DDEF extern
+#endif
+
+#include <raylib.h>
+
+#ifndef R3D_CUSTOM_ALLOCATORS
+#include <stdlib.h>
+#ifndef R3D_MALLOC
+#define R3D_MALLOC malloc
+#endif
+#ifndef R3D_CALLOC
+#define R3D_CALLOC calloc
+#endif
+#ifndef R3D_FREE
+#define R3D_FREE free
+#endif
+#endif
+
+#define PROFILER_QUERIES 3        // Timer query pairs in flight per pass, results are read back frames later without stalling
+#define PROFILER_HISTORY 128      // Samples per pass the frame statistics are computed over
+
+// Passes timed by the frame profiler
+typedef enum {
+    PROFILER_PASS_GBUFFER = 0,       // BeginDeferredMode() .. EndDeferredMode()
+    PROFILER_PASS_LIGHT_CULLING,     // UpdateLightTiles(), UpdateLightClusters()
+    PROFILER_PASS_LIGHT_VOLUMES,     // DrawLightVolumes()
+    PROFILER_PASS_LIGHTING,          // BeginLightingMode() .. EndLightingMode(), without the upsample
+    PROFILER_PASS_UPSAMPLE,          // Reduced resolution lighting upsample, in EndLightingMode()
+    PROFILER_PASS_SSAO,              // UpdateSSAO()
+    PROFILER_PASS_DECALS,            // DrawDecals()
+    PROFILER_PASS_SHADOWS,           // Not timed by the library (casters are drawn by the application), scope it with BeginProfilerPass()
+    PROFILER_PASS_COMPOSITE,         // Not timed by the library, scope it with BeginProfilerPass()
+    PROFILER_PASS_CUSTOM             // Not timed by the library, scope it with BeginProfilerPass()
+} ProfilerPass;
+
+#define PROFILER_PASS_COUNT 10
+
+// Rolling statistics of a pass over the last PROFILER_HISTORY samples, times in milliseconds
+typedef struct R3DPassStats {
+    int samples;                     // Samples in the window (0 when the pass did not run yet)
+    float gpuMin;
+    float gpuAvg;
+    float gpuP99;                    // 99th percentile
+    float cpuMin;                    // CPU time between the begin and the end of the pass (command submission)
+    float cpuAvg;
+    float cpuP99;
+} R3DPassStats;
+
+typedef struct R3DFrameStats {
+    R3DPassStats passes[PROFILER_PASS_COUNT]; // Indexed by ProfilerPass
+    int dropped;                     // Samples skipped since the program started, every query of the pass was still in flight
+} R3DFrameStats;
+
+R3DDEF void BeginProfilerPass(int pass);              // Begin timing a ProfilerPass (GPU and CPU), the passes of the library are timed already
+R3DDEF void EndProfilerPass(int pass);                // End timing a ProfilerPass
+R3DDEF R3DFrameStats GetFrameStats(void);             // Get the min/avg/p99 times of every pass, from the results available so far
+R3DDEF const char* GetProfilerPassName(int pass);     // Get the name of a ProfilerPass (e.g. "gbuffer")
+R3DDEF void ResetFrameStats(void);                    // Clear the samples of every pass
+
+#define GBUFFER_MAX_ATTACHMENTS 6 // One color attachment per GBufferAttachmentType
+
+// GBuffer layouts, selects how normals/positions are encoded
+typedef enum {
+    GBUFFER_LAYOUT_STANDARD = 0, // position (RGB16F), normal (RGB16F), color (RGBA8), depth (24 bit)
+    GBUFFER_LAYOUT_COMPACT       // normal (RG16, octahedral encoded), color (RGBA8), depth (24 bit).. position is rebuilt from depth
+} GBufferLayout;
+
+// GBuffer attachment types, the type is also the gbuffer fragment shader output location it receives
+typedef enum {
+    GBUFFER_ATTACHMENT_POSITION = 0, // World position (location 0)
+    GBUFFER_ATTACHMENT_NORMAL,       // World normal (location 1), octahedral encoded when there is no position attachment
+    GBUFFER_ATTACHMENT_ALBEDO_SPEC,  // Albedo (rgb) and specular (a) (location 2)
+    GBUFFER_ATTACHMENT_EMISSION,     // Emission color (location 3)
+    GBUFFER_ATTACHMENT_MATERIAL_ID,  // Material id (location 4) from the materialId uniform (0 to 255), stored as id/255
+    GBUFFER_ATTACHMENT_VELOCITY      // Screen space motion vector (location 5), from the camera motion only
+} GBufferAttachmentType;
+
+// GBuffer attachment formats
+typedef enum {
+    GBUFFER_FORMAT_R8 = 0,           // 8 bit normalized, 1 channel
+    GBUFFER_FORMAT_RGBA8,            // 8 bit normalized, 4 channels
+    GBUFFER_FORMAT_RG16,             // 16 bit normalized, 2 channels
+    GBUFFER_FORMAT_RG16F,            // 16 bit float, 2 channels
+    GBUFFER_FORMAT_RGB16F,           // 16 bit float, 3 channels
+    GBUFFER_FORMAT_RGBA16F           // 16 bit float, 4 channels
+} GBufferAttachmentFormat;
+
+// GBuffer attachment descriptor, used to select the targets allocated by LoadGBufferEx()
+typedef struct GBufferAttachmentDesc {
+    int type;   // GBufferAttachmentType
+    int format; // GBufferAttachmentFormat
+} GBufferAttachmentDesc;
+
+// GBuffer implementation based on @TheLumaio
+// GBuffer stores multiple render targets for a single render pass
+typedef struct GBuffer {
+    unsigned int id;
+    int width;
+    int height;
+    int viewportWidth;  // Size of the region drawn by BeginDeferredMode(), the whole GBuffer unless scaled (see R3DDynamicResolution)
+    int viewportHeight;
+    int layout;       // GBufferLayout, compact when there is no position attachment
+    Texture color;    // Albedo/spec attachment (id = 0 when not allocated)
+    Texture normal;   // Normal attachment (id = 0 when not allocated)
+    Texture position; // Position attachment (id = 0 when not allocated, e.g. GBUFFER_LAYOUT_COMPACT)
+    Texture depth;
+    int attachmentCount;                                 // Number of color attachments
+    Texture attachments[GBUFFER_MAX_ATTACHMENTS];        // Color attachments, in GL_COLOR_ATTACHMENT order
+    GBufferAttachmentDesc descs[GBUFFER_MAX_ATTACHMENTS]; // Descriptors of the color attachments
+} GBuffer;
+
+R3DDEF GBuffer LoadGBuffer(int width, int height);                // Loads a new GBuffer with given screen constraints
+R3DDEF GBuffer LoadGBufferCompact(int width, int height);         // Loads a new GBuffer using the compact layout (octahedral normals, position from depth)
+R3DDEF GBuffer LoadGBufferEx(int width, int height, const GBufferAttachmentDesc* descs, int count); // Loads a new GBuffer with the given color attachments
+R3DDEF void UnloadGBuffer(GBuffer gbuffer);                       // Unload an existing GBuffer
+R3DDEF Texture GetGBufferAttachment(GBuffer gbuffer, int type);   // Get the attachment of a GBufferAttachmentType (id = 0 when not allocated)
+R3DDEF int GetGBufferBytesPerPixel(GBuffer gbuffer);              // Get the memory used by a single pixel over all the GBuffer targets
+R3DDEF void BeginDeferredMode(GBuffer gbuffer);                   // Begin drawing in Deferred mode (using GBuffer) NOTE: Should be called after BeginDrawing, before BeginMode3D
+R3DDEF void EndDeferredMode();                                    // End drawing of Deferred mode
+R3DDEF void SetDeferredModeShaderTexture(Texture texture, int i); // Sets and binds a texture to active in GL context
+R3DDEF void SetGBufferViewport(GBuffer* gbuffer, int width, int height); // Sets the region drawn by BeginDeferredMode(), clamped to the GBuffer size
+R3DDEF void SetDeferredModeShaderLayout(Shader shader, GBuffer gbuffer);                // Sets the GBuffer layout uniforms (gbufferLayout, gbufferScale) on a gbuffer or lighting shader
+R3DDEF void SetDeferredModeShaderCamera(Shader shader, GBuffer gbuffer, Camera camera); // Sets the camera uniforms (viewpos, invViewProj) on a lighting shader
+R3DDEF void SetDeferredModeShaderMotion(Shader shader, GBuffer gbuffer, Camera previousCamera); // Sets the previous frame camera uniform (prevViewProj) on a gbuffer shader, for the velocity attachment (camera motion only, objects are taken as static)
+R3DDEF void DrawModelInstancedDeferred(Model model, const Matrix* transforms, int count); // Draw a model once per transform, one draw per mesh, inside BeginMode3D() (SHADER_FEATURE_INSTANCING variant)
+
+// Render queue statistics of the last deferred pass, binds avoided are the ones a DrawMesh() per draw would have done on top
+typedef struct R3DRenderQueueStats {
+    int draws;                       // Queued draws executed
+    int shaderBinds;
+    int textureBinds;
+    int vaoBinds;
+    int shaderBindsAvoided;
+    int textureBindsAvoided;
+    int vaoBindsAvoided;
+} R3DRenderQueueStats;
+
+R3DDEF void DrawModelQueued(Model model, Vector3 position, float scale, Color tint);   // Queue a model draw, executed sorted by state and depth at EndDeferredMode(), inside BeginMode3D()
+R3DDEF void DrawMeshQueued(Mesh mesh, Material material, Matrix transform);           // Queue a mesh draw, executed sorted by state and depth at EndDeferredMode(), inside BeginMode3D()
+R3DDEF R3DRenderQueueStats GetRenderQueueStats(void);                                // Get the render queue statistics of the last deferred pass
+
+// Retained draw list, static draws recorded once and replayed every frame with their GL state resolved when built
+// NOTE: Draws keep copies of the meshes and materials, add them again after changing a material shader or a mesh
+typedef struct R3DDrawList {
+    int count;                       // Draws recorded
+    int batchCount;                  // Shader and material changes of the built list
+    bool dirty;                      // Draws changed since the last build, the next ReplayDrawList() builds the list again
+    void* data;                      // Recorded draws and resolved state
+} R3DDrawList;
+
+R3DDEF R3DDrawList LoadDrawList(void);                                                    // Load an empty draw list
+R3DDEF void UnloadDrawList(R3DDrawList list);                                             // Unload a draw list (not its meshes and materials)
+R3DDEF void AddDrawListMesh(R3DDrawList* list, Mesh mesh, Material material, Matrix transform); // Record a mesh draw
+R3DDEF void AddDrawListModel(R3DDrawList* list, Model model, Matrix transform);           // Record the draws of a model, its transform applies before the given one
+R3DDEF void ClearDrawList(R3DDrawList* list);                                             // Remove all the recorded draws
+R3DDEF void InvalidateDrawList(R3DDrawList* list);                                        // Build the list again on the next replay, after changing the textures or colors of its materials
+R3DDEF void ReplayDrawList(R3DDrawList* list);                                            // Draw the recorded draws, in deferred mode inside BeginMode3D()
+
+// Bounding volumes of a mesh, in mesh space
+typedef struct R3DBounds {
+    BoundingBox box;                 // Axis aligned box
+    Vector3 center;                  // Bounding sphere, around the box center
+    float radius;
+} R3DBounds;
+
+#define CULLING_MAX_LODS 4           // Detail levels told apart by CullInstances()
+
+// Instances culled against the camera frustum, their world bounds are kept as structure of arrays for SIMD tests
+typedef struct R3DCullingSet {
+    int count;                       // Instances added
+    int capacity;
+    int visibleCount;                // Instances inside the frustum at the last CullInstances()
+    int* visible;                    // Indices of the visible instances, in increasing order
+    unsigned char* lods;             // Detail level of each visible instance
+    float lodSizes[CULLING_MAX_LODS - 1]; // Projected size (bounding sphere diameter over the view height) under which an instance drops to the next level, decreasing (0: level unused)
+    void* data;                      // Instance transforms and world bounds
+} R3DCullingSet;
+
+R3DDEF R3DBounds GetMeshBounds(Mesh mesh);                                                 // Get the bounds of a mesh, the ones stored at import by LoadModelAdvanced() or computed from its vertices
+R3DDEF R3DBounds GetModelBounds(Model model);                                              // Get the bounds of all the meshes of a model, its transform applied
+R3DDEF R3DCullingSet LoadCullingSet(int capacity);                                         // Load an empty culling set, it grows past the given capacity
+R3DDEF void UnloadCullingSet(R3DCullingSet set);                                           // Unload a culling set
+R3DDEF int AddCullingInstance(R3DCullingSet* set, R3DBounds bounds, Matrix transform);     // Add an instance of the given mesh space bounds, returns its index
+R3DDEF void SetCullingInstance(R3DCullingSet* set, int index, R3DBounds bounds, Matrix transform); // Move an instance or change its bounds
+R3DDEF void ClearCullingSet(R3DCullingSet* set);                                           // Remove all the instances
+R3DDEF int CullInstances(R3DCullingSet* set, GBuffer gbuffer, Camera camera);              // Find the instances inside the camera frustum and their detail level, returns the visible count
+R3DDEF void DrawModelCulledDeferred(Model model, R3DCullingSet* set, int lod);            // Draw the visible instances of a detail level (-1: all of them, each at its level) instanced with the mesh levels, inside BeginMode3D()
+
+#define MESH_MAX_LODS CULLING_MAX_LODS
+
+// Detail levels of a mesh, simplified copies of its index buffer sharing its vertices
+typedef struct R3DMeshLods {
+    int count;                       // Levels, the first one is the mesh as loaded
+    int indexOffset[MESH_MAX_LODS];  // First index of each level in the mesh indices, after the ones of the previous level
+    int indexCount[MESH_MAX_LODS];
+    float error[MESH_MAX_LODS];      // Largest simplification error of each level, relative to the mesh bounding sphere radius
+} R3DMeshLods;
+
+R3DDEF R3DMeshLods GenMeshLods(Mesh* mesh, int count, float reduction, float maxError);   // Generate simplified levels (each keeping a reduction ratio of the triangles, 0: 0.5) under an error (0: 0.05, grows with the level), uploads the mesh
+R3DDEF R3DMeshLods GetMeshLods(Mesh mesh);                                                // Get the detail levels of a mesh, a single one when none were generated
+R3DDEF void UnloadMeshLods(Mesh mesh);                                                    // Forget the detail levels of a mesh, before unloading it
+R3DDEF void DrawMeshLod(Mesh mesh, Material material, Matrix transform, int lod);         // Draw a detail level of a mesh, like DrawMesh()
+
+#define MESHLET_MAX_VERTICES  64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Dense mesh split into small clusters of triangles, each culled on its own against the view
+typedef struct R3DMeshlets {
+    int count;                       // Clusters, their triangles follow each other in the mesh indices
+    int visibleCount;                // Clusters kept by the last CullMeshlets()
+    int visibleTriangles;
+    int drawCount;                   // Index ranges drawn, the visible clusters next to each other are merged
+    void* data;
+} R3DMeshlets;
+
+R3DDEF R3DMeshlets LoadMeshlets(Mesh* mesh);                                              // Split a mesh into meshlets, reorders (and welds) its triangles and uploads it
+R3DDEF void UnloadMeshlets(R3DMeshlets meshlets);                                         // Unload meshlets, the mesh is left as is
+R3DDEF R3DMeshlets* GetMeshMeshlets(Mesh mesh);                                           // Get the meshlets built at import by LoadModelAdvancedEx(), NULL when there are none
+R3DDEF int CullMeshlets(R3DMeshlets* meshlets, GBuffer gbuffer, Camera camera, Matrix transform); // Find the meshlets in the camera frustum and not facing away from it, returns the visible count
+R3DDEF void DrawMeshletsDeferred(Mesh mesh, R3DMeshlets meshlets, Material material, Matrix transform); // Draw the meshlets kept by CullMeshlets() with one multi draw, inside BeginMode3D()
+R3DDEF void UnloadMeshData(Mesh mesh);                                                    // Forget the bounds, detail levels and meshlets stored for a mesh, before unloading it
+R3DDEF void UnloadModelAdvanced(Model model);                                             // Unload a model and the bounds, detail levels and meshlets stored for its meshes
+
+// Mesh optimization steps, combined into the bitmask given to OptimizeMesh()
+typedef enum {
+    MESH_OPTIMIZE_VERTEX_CACHE = 1 << 0,  // Triangles reordered so their vertices are still in the post-transform cache
+    MESH_OPTIMIZE_OVERDRAW = 1 << 1,      // Triangles grouped in clusters, the ones facing out of the mesh drawn first (costs a few cache misses)
+    MESH_OPTIMIZE_VERTEX_FETCH = 1 << 2,  // Vertices reordered by first use, so fetching them walks the vertex buffers forward
+    MESH_OPTIMIZE_ALL = 0x7
+} MeshOptimizeFlags;
+
+#define MESH_OPTIMIZE_CACHE_SIZE 16       // Post-transform cache entries, optimized for and simulated (FIFO)
+
+// How well a mesh uses the GPU vertex cache and depth test
+typedef struct R3DMeshStats {
+    float acmr;                      // Average cache miss ratio, vertices transformed per triangle (0.5 at best on large meshes, 3 at worst)
+    float atvr;                      // Average transformed vertex ratio, vertices transformed per mesh vertex (1 at best)
+    float overdraw;                  // Pixels shaded per pixel covered, drawn with back face culling and a depth test from the 6 axis directions (1 at best)
+} R3DMeshStats;
+
+R3DDEF bool OptimizeMesh(Mesh* mesh, unsigned int flags);                                  // Weld a mesh and reorder its triangles and vertices (MeshOptimizeFlags), before generating levels or meshlets, uploads it again when it was
+R3DDEF R3DMeshStats GetMeshStats(Mesh mesh);                                               // Measure the vertex cache use and overdraw of a mesh, on the CPU
+
+// Software occlusion culling, occluders rasterized on the CPU into a masked hierarchical depth buffer (no GPU readback)
+typedef struct R3DOcclusionBuffer {
+    int width;                       // Depth resolution, rounded up to whole 32x16 pixel blocks
+    int height;
+    int occluderCount;               // Occluder triangles added
+    int triangles;                   // Occluder triangles rasterized by the last update, after clipping and back face culling
+    int occluded;                    // Instances removed by the last OccludeInstances()
+    void* data;                      // Occluder triangles, coverage masks and depths
+} R3DOcclusionBuffer;
+
+R3DDEF R3DOcclusionBuffer LoadOcclusionBuffer(int width, int height);                      // Load an occlusion buffer, a low resolution (256x128..) is enough
+R3DDEF void UnloadOcclusionBuffer(R3DOcclusionBuffer buffer);                              // Unload an occlusion buffer
+R3DDEF void AddOccluderMesh(R3DOcclusionBuffer* buffer, Mesh mesh, Matrix transform);      // Add the triangles of a mesh (CPU vertices) as occluders, in world space
+R3DDEF void AddOccluderModel(R3DOcclusionBuffer* buffer, Model model, Matrix transform);   // Add the meshes of a model as occluders, its transform applies before the given one
+R3DDEF void ClearOccluders(R3DOcclusionBuffer* buffer);                                    // Remove all the occluders
+R3DDEF void UpdateOcclusionBuffer(R3DOcclusionBuffer* buffer, GBuffer gbuffer, Camera camera); // Rasterize the occluders seen from the camera
+R3DDEF bool IsBoxOccluded(R3DOcclusionBuffer* buffer, BoundingBox box);                    // Check if a world space box is hidden behind the occluders of the last update
+R3DDEF int OccludeInstances(R3DOcclusionBuffer* buffer, R3DCullingSet* set);               // Remove the hidden instances from the visible ones of a culled set, returns the visible count
+R3DDEF Image GetOcclusionBufferImage(R3DOcclusionBuffer buffer);                           // Get the occluder depths as a grayscale image (brighter is nearer), for debugging
+
+#define DYNAMIC_RESOLUTION_BUCKET 128           // Window size step (in pixels) at which a dynamic resolution GBuffer is reallocated
+#define DYNAMIC_RESOLUTION_QUERIES 3            // GPU timer queries in flight, results are read back frames later without stalling
+
+// Dynamic resolution, renders into a scaled viewport of an over-allocated GBuffer
+// The scale follows the measured GPU time of the deferred passes, the lighting pass upsamples the viewport to the screen
+typedef struct R3DDynamicResolution {
+    GBuffer gbuffer;      // GBuffer sized for the window at maxScale (rounded up to DYNAMIC_RESOLUTION_BUCKET)
+    int displayWidth;     // Window size the viewport is scaled from
+    int displayHeight;
+    float scale;          // Current viewport scale, per axis
+    float minScale;       // Scale limits (default 0.5 .. 1.0)
+    float maxScale;
+    float targetTime;     // GPU time budget in milliseconds
+    float gpuTime;        // Last measured GPU time in milliseconds (0 until the first result)
+    int reallocations;    // Number of GBuffer reallocations since loaded
+    void* data;
+} R3DDynamicResolution;
+
+R3DDEF R3DDynamicResolution LoadDynamicResolution(const GBufferAttachmentDesc* descs, int count, float targetTime); // Load a dynamic resolution GBuffer for the current window size
+R3DDEF void UnloadDynamicResolution(R3DDynamicResolution dr);   // Unload a dynamic resolution GBuffer
+R3DDEF void BeginDynamicResolution(R3DDynamicResolution* dr);   // Update the scale and viewport, then start timing.. call before BeginDeferredMode(dr.gbuffer)
+R3DDEF void EndDynamicResolution(R3DDynamicResolution* dr);     // Stop timing, call after the lighting pass. NOTE: No other GL_TIME_ELAPSED query can run in between
+
+#define LIGHT_ATTENUATION_CUTOFF (1.0f/256.0f) // Attenuation under which a light contribution is ignored, defines the light radius
+#define LIGHT_TILE_SIZE 16                      // Tile size (in pixels) of tiled lighting
+#define LIGHT_TILE_MAX_LIGHTS 256               // Default maximum number of lights per tile
+
+typedef enum {
+    LIGHT_POINT = 0,
+    LIGHT_DIRECTIONAL,
+    LIGHT_SPOT,
+} R3DLightType;
+
+// Light, the point light fields match the light struct of the lighting shaders
+// NOTE: Tiled and clustered lighting only shade point lights, directional lights are handled by light volumes,
+// spot lights are only shaded through light sets
+typedef struct R3DLight {
+    Vector3 position;
+    Vector3 color;
+    float linear;      // Linear attenuation factor
+    float quadratic;   // Quadratic attenuation factor
+    int type;          // R3DLightType
+    Vector3 direction; // Direction of directional and spot lights
+    float spotAngle;   // Cone half angle of spot lights, in degrees
+    int shadow;        // Shadow atlas entry + 1, set by AddShadowLight() (0: no shadow)
+} R3DLight;
+
+// Tiled lighting, the screen is split into LIGHT_TILE_SIZE tiles and each one keeps the list of lights touching it,
+// bounded in depth by the tile min/max GBuffer depth
+typedef struct R3DLightTiles {
+    int width;                       // Screen width covered by the tiles
+    int height;                      // Screen height covered by the tiles
+    int tilesX;                      // Number of tiles horizontally
+    int tilesY;                      // Number of tiles vertically
+    int maxLights;                   // Maximum number of lights
+    int maxLightsPerTile;            // Maximum number of lights per tile, the rest are dropped
+    int lightCount;                  // Number of lights of the last update
+    bool compute;                    // Lights are culled by a compute shader (GRAPHICS_API_OPENGL_43), else on the CPU
+    unsigned int lightBuffer;        // Light data, 2 RGBA32F texels per light: (position, linear), (color, quadratic)
+    unsigned int lightTexture;       // Light data buffer texture
+    unsigned int gridBuffer;         // Light list of every tile, RG32UI (offset, count) into the index buffer
+    unsigned int gridTexture;        // Light list buffer texture
+    unsigned int indexBuffer;        // Light indices, R32UI
+    unsigned int indexTexture;       // Light indices buffer texture
+    unsigned int boundsFramebuffer;  // Framebuffer of the tile depth bounds (CPU culling)
+    Texture bounds;                  // Tile min/max depth, RG32F, one texel per tile (CPU culling)
+    Shader boundsShader;             // Tile depth bounds reduction shader (CPU culling)
+    unsigned int cullProgram;        // Light culling compute program (compute culling)
+    void* data;                      // CPU culling scratch memory
+} R3DLightTiles;
+
+R3DDEF float GetLightRadius(R3DLight light);                                                 // Get the distance at which a light contribution drops under LIGHT_ATTENUATION_CUTOFF
+R3DDEF R3DLightTiles LoadLightTiles(int width, int height, int maxLights, int maxLightsPerTile); // Load tiled lighting buffers for a given screen size
+R3DDEF void UnloadLightTiles(R3DLightTiles tiles);                                           // Unload tiled lighting buffers
+R3DDEF void UpdateLightTiles(R3DLightTiles* tiles, GBuffer gbuffer, Camera camera, const R3DLight* lights, int count); // Upload lights and build the per tile light lists, call after EndDeferredMode
+R3DDEF void SetDeferredModeShaderTiles(Shader shader, R3DLightTiles tiles);                  // Sets and binds the tiled lighting buffers on a tiled lighting shader
+
+#define LIGHT_CLUSTER_X 16                      // Clusters along the screen width
+#define LIGHT_CLUSTER_Y 9                       // Clusters along the screen height
+#define LIGHT_CLUSTER_Z 24                      // Depth slices, exponentially spaced between the camera near and far planes
+#define LIGHT_CLUSTER_MAX_LIGHTS 128            // Default maximum number of lights per cluster
+
+// Clustered lighting, the view frustum is split into screen tiles and depth slices (froxels) and each cluster keeps
+// the list of lights touching it. It does not depend on the GBuffer, so deferred and forward passes can share it
+typedef struct R3DLightClusters {
+    int width;                       // Screen width covered by the clusters
+    int height;                      // Screen height covered by the clusters
+    int clustersX;                   // Number of clusters horizontally
+    int clustersY;                   // Number of clusters vertically
+    int clustersZ;                   // Number of depth slices
+    int maxLights;                   // Maximum number of lights
+    int maxLightsPerCluster;         // Maximum number of lights per cluster, the rest are dropped
+    int lightCount;                  // Number of lights of the last update
+    Matrix view;                     // Camera view of the last update
+    float depthScale;                // Depth slice of a view depth: log(depth)*depthScale + depthBias
+    float depthBias;
+    unsigned int lightBuffer;        // Light data, 2 RGBA32F texels per light: (position, linear), (color, quadratic)
+    unsigned int lightTexture;       // Light data buffer texture
+    unsigned int gridBuffer;         // Light list of every cluster, RG32UI (offset, count) into the index buffer
+    unsigned int gridTexture;        // Light list buffer texture
+    unsigned int indexBuffer;        // Light indices, R32UI
+    unsigned int indexTexture;       // Light indices buffer texture
+    void* data;                      // Light binning scratch memory
+} R3DLightClusters;
+
+R3DDEF R3DLightClusters LoadLightClusters(int width, int height, int maxLights, int maxLightsPerCluster); // Load clustered lighting buffers for a given screen size
+R3DDEF void UnloadLightClusters(R3DLightClusters clusters);                                  // Unload clustered lighting buffers
+R3DDEF void UpdateLightClusters(R3DLightClusters* clusters, Camera camera, const R3DLight* lights, int count); // Upload lights and build the per cluster light lists, call once per frame before the passes using them
+R3DDEF void SetShaderLightClusters(Shader shader, R3DLightClusters clusters);                // Sets and binds the clustered lighting buffers on a deferred or forward lighting shader
+
+// Light volumes, every point light is drawn as a sphere bounding its attenuation and only shades the GBuffer pixels
+// inside it (stencil marked), directional lights are drawn full screen. Lighting is accumulated in a HDR target
+typedef struct R3DLightVolumes {
+    int width;                       // Lighting target width, same as the GBuffer
+    int height;                      // Lighting target height, same as the GBuffer
+    unsigned int framebuffer;        // Lighting accumulation framebuffer
+    Texture lighting;                // Accumulated lighting, RGBA16F (tone map when presenting)
+    unsigned int depthStencil;       // Depth (copied from the GBuffer) and stencil renderbuffer
+    float ambient;                   // Ambient light factor applied to the albedo
+    void* data;                      // Light volume shaders and sphere mesh
+} R3DLightVolumes;
+
+R3DDEF R3DLightVolumes LoadLightVolumes(int width, int height);                              // Load a light volumes lighting target for a given GBuffer size
+R3DDEF void UnloadLightVolumes(R3DLightVolumes volumes);                                     // Unload a light volumes lighting target
+R3DDEF void DrawLightVolumes(R3DLightVolumes volumes, GBuffer gbuffer, Camera camera, const R3DLight* lights, int count); // Draw the lights into the lighting target, call after EndDeferredMode
+
+#define LIGHT_SET_MAX_LIGHTS 255                // Lights of a light set, matches the LightBlock array size of the lighting shaders
+#define LIGHT_SET_BINDING 0                     // Uniform buffer binding point of light sets
+
+// Light set, lights packed in a std140 uniform buffer (LightBlock), only the changed lights are uploaded
+typedef struct R3DLightSet {
+    int count;                       // Number of lights in use, the shader only iterates these
+    R3DLight* lights;                // Lights, change them through SetLight() so they get uploaded
+    unsigned int ubo;                // Uniform buffer, std140 LightBlock
+    int dirtyFirst;                  // First light to upload
+    int dirtyLast;                   // Last light to upload (exclusive), nothing to upload when <= dirtyFirst
+    bool countDirty;                 // Light count needs to be uploaded
+    void* data;                      // Upload staging memory
+} R3DLightSet;
+
+R3DDEF R3DLightSet LoadLightSet(void);                                                       // Load an empty light set (up to LIGHT_SET_MAX_LIGHTS lights)
+R3DDEF void UnloadLightSet(R3DLightSet set);                                                 // Unload a light set
+R3DDEF int AddLight(R3DLightSet* set, R3DLight light);                                       // Add a light to a light set, returns its index (-1 when full)
+R3DDEF void SetLight(R3DLightSet* set, int index, R3DLight light);                           // Change a light of a light set
+R3DDEF void RemoveLight(R3DLightSet* set, int index);                                        // Remove a light of a light set, the last light takes its index
+R3DDEF void UpdateLightSet(R3DLightSet* set);                                                // Upload the changed lights, call once per frame before drawing
+R3DDEF void SetShaderLightSet(Shader shader, R3DLightSet set);                               // Binds a light set to the LightBlock of a lighting shader
+
+// Lighting pass resolutions, the value is the divisor of the GBuffer size
+typedef enum {
+    LIGHTING_RESOLUTION_FULL = 1,
+    LIGHTING_RESOLUTION_HALF = 2,
+    LIGHTING_RESOLUTION_QUARTER = 4
+} LightingResolution;
+
+// Lighting buffer, runs the lighting pass at a reduced resolution
+// The lighting shader writes the lighting without albedo (lightingDemodulate uniform), which is upsampled with a
+// joint bilateral filter on GBuffer depth and normals, then multiplied by the full resolution albedo
+typedef struct R3DLightingBuffer {
+    int width;                       // Lighting target size, the GBuffer size divided by the resolution
+    int height;
+    int resolution;                  // LightingResolution
+    unsigned int framebuffer;
+    Texture lighting;                // Diffuse lighting (rgb) and specular luminance (a), RGBA16F
+    void* data;                      // Upsample shader and saved state
+} R3DLightingBuffer;
+
+R3DDEF R3DLightingBuffer LoadLightingBuffer(int width, int height, int resolution);         // Load a lighting buffer for a given GBuffer size and LightingResolution
+R3DDEF void UnloadLightingBuffer(R3DLightingBuffer buffer);                                  // Unload a lighting buffer
+R3DDEF void BeginLightingMode(R3DLightingBuffer buffer, GBuffer gbuffer, Shader shader);     // Begin drawing the lighting pass with a lighting shader, into the lighting buffer when not at full resolution
+R3DDEF void EndLightingMode(R3DLightingBuffer buffer, GBuffer gbuffer);                      // End the lighting pass, upsampling the lighting buffer into the previous framebuffer
+
+#define SSAO_MAX_KERNEL 32                      // Samples per pixel and frame upper bound
+#define SSAO_MIN_KERNEL 4                       // Samples per pixel and frame the time budget can't go under
+#define SSAO_BUDGET_INTERVAL 30                 // Frames between kernel size changes of the time budget
+
+// Screen space ambient occlusion, computed at half the GBuffer resolution from its depth and normals
+// Every frame takes a few samples with a rotated kernel and blends them with the reprojected previous frames, history
+// is rejected where its depth does not match. A depth aware (bilateral) blur then removes the remaining noise
+typedef struct R3DSSAO {
+    int width;                       // Half of the GBuffer size
+    int height;
+    float radius;                    // Sampling radius in world units (default 0.5)
+    float intensity;                 // Occlusion strength (default 1.0)
+    float bias;                      // Depth difference in world units under which a sample doesn't occlude (default 0.02)
+    int kernelSize;                  // Samples per pixel and frame (default 8, up to SSAO_MAX_KERNEL)
+    float temporalWeight;            // Weight of the accepted history (default 0.9), more is smoother but slower to react
+    float budget;                    // GPU time budget in milliseconds, the kernel size follows the profiler timings (0: fixed kernel)
+    int frame;                       // Frames computed since loaded, rotates the kernel
+    unsigned int framebuffer;
+    Texture occlusion;               // Blurred occlusion, R8 read as rgb.. bind it to the ssaobuffer slot of the lighting shader
+    Texture history[2];              // Accumulated occlusion (r) and view depth (g), RG16F, swapped every frame
+    Texture blur;                    // Horizontal blur pass, RG16F
+    void* data;                      // Shaders and previous frame camera
+} R3DSSAO;
+
+R3DDEF R3DSSAO LoadSSAO(int width, int height);                                              // Load an SSAO pass for a given GBuffer size
+R3DDEF void UnloadSSAO(R3DSSAO ssao);                                                        // Unload an SSAO pass
+R3DDEF void UpdateSSAO(R3DSSAO* ssao, GBuffer gbuffer, Camera camera);                       // Compute the occlusion of the GBuffer contents, after EndDeferredMode() and before the lighting pass
+
+#define DECAL_CLUSTER_MAX_DECALS 32             // Default maximum number of decals per cluster
+#define DECAL_DATA_TEXELS 6                     // RGBA32F texels per decal in the decal buffer
+
+// Deferred decal, an oriented box projecting a part of the decal atlases on the GBuffer along its local Y axis
+// NOTE: The transform may rotate, scale and translate the box, but not shear it
+typedef struct R3DDecal {
+    Matrix transform;                // Unit box (-0.5 .. 0.5) to world, the atlas u and v follow its X and Z axes
+    Rectangle source;                // Part of the atlases covered, in normalized texture coordinates
+    Color tint;                      // Albedo tint, alpha scales the opacity
+    float normalOpacity;             // Weight of the decal normal over the surface one (0: albedo only)
+} R3DDecal;
+
+// Deferred decals, drawn into the GBuffer albedo and normal attachments after the GBuffer fill, no mesh is drawn again
+// Every decal box is rasterized in a single instanced draw, and the decals are binned in the light clusters grid so a
+// pixel only tests the decals of its cluster: the first one containing the pixel blends all of them, the others leave it
+typedef struct R3DDecals {
+    int count;                       // Number of decals in use
+    int maxDecals;
+    R3DDecal* decals;                // Decals, in drawing order.. change them through SetDecal() so they get uploaded
+    Texture albedo;                  // Albedo (rgb) and coverage (a) atlas, set by the application
+    Texture normal;                  // Tangent space normal atlas, set by the application (id = 0: decals only change the albedo)
+    float angleFade;                 // Cosine between the surface normal and the decal Y axis where decals start to fade (default 0.5)
+    bool dirty;                      // Decals changed since the last upload
+    unsigned int buffer;             // Decal data, DECAL_DATA_TEXELS RGBA32F texels per decal
+    unsigned int texture;            // Decal data buffer texture
+    R3DLightClusters clusters;       // Decal lists of the clusters, rebuilt by DrawDecals()
+    void* data;                      // Shader, box mesh and upload staging memory
+} R3DDecals;
+
+R3DDEF R3DDecals LoadDecals(int maxDecals, int maxDecalsPerCluster);                        // Load an empty decal set
+R3DDEF void UnloadDecals(R3DDecals decals);                                                  // Unload a decal set (not its atlases)
+R3DDEF int AddDecal(R3DDecals* decals, R3DDecal decal);                                      // Add a decal on top of the others, returns its index (-1 when full)
+R3DDEF void SetDecal(R3DDecals* decals, int index, R3DDecal decal);                          // Change a decal
+R3DDEF void RemoveDecal(R3DDecals* decals, int index);                                       // Remove a decal, the next ones move down an index
+R3DDEF Matrix GetDecalTransform(Vector3 position, Vector3 normal, float angle, Vector3 size); // Get the transform of a decal centered on a surface point, projected along its normal (angle in degrees)
+R3DDEF void DrawDecals(R3DDecals* decals, GBuffer gbuffer, Camera camera);                   // Draw the decals into the GBuffer, after EndDeferredMode() and before the passes reading it
+
+#define SHADOW_MAX_CASCADES 4                   // Cascades of a directional light, matches the lighting shaders
+#define SHADOW_CASCADE_UNIT 11                  // Texture unit of the cascade shadow maps
+
+// Shadow map layers, static casters are cached and only drawn when their cascade moves
+typedef enum {
+    SHADOW_LAYER_STATIC = 0,         // Level geometry.. drawn only when BeginShadowCascade() returns true
+    SHADOW_LAYER_DYNAMIC             // Moving casters, drawn every frame on top of a copy of the static layer
+} ShadowLayer;
+
+// Cascaded shadow maps of a directional light, the view frustum is split in depth and every slice gets its own
+// shadow map. A cascade covers a bounding sphere of its slice plus a margin, and only moves (snapped to texels)
+// once the slice leaves it, so the static layer stays valid while the camera moves inside it
+typedef struct R3DShadowCascades {
+    int size;                        // Shadow map size of every cascade
+    int cascadeCount;                // Up to SHADOW_MAX_CASCADES
+    float maxDistance;               // Shadow distance from the camera (default 50)
+    float splitLambda;               // Cascade splits, 0: uniform .. 1: logarithmic (default 0.75)
+    float margin;                    // Cascade extent added around the slice sphere, as a fraction of its radius (default 0.25)
+    float casterDistance;            // Distance behind a cascade, toward the light, where casters are still drawn (default 50)
+    float bias;                      // Normal offset applied when sampling, in texels (default 1.5)
+    Vector3 lightDirection;          // Light direction of the last update, normalized
+    Vector3 viewDirection;           // Camera forward of the last update
+    float splits[SHADOW_MAX_CASCADES];     // View depth where each cascade ends
+    float texelSizes[SHADOW_MAX_CASCADES]; // World size of a shadow map texel of each cascade
+    Matrix matrices[SHADOW_MAX_CASCADES];  // Light view projection of each cascade
+    unsigned int framebuffer;
+    unsigned int staticDepth;        // Static casters, DEPTH24 texture array (a layer per cascade)
+    unsigned int depth;              // Static layer copy and dynamic casters, DEPTH24 texture array sampled by lighting
+    int staticUpdates;               // Static layers drawn since loaded
+    void* data;                      // Cascade placement and saved state
+} R3DShadowCascades;
+
+R3DDEF R3DShadowCascades LoadShadowCascades(int size, int cascadeCount);                     // Load cascaded shadow maps (size x size per cascade)
+R3DDEF void UnloadShadowCascades(R3DShadowCascades shadows);                                 // Unload cascaded shadow maps
+R3DDEF void UpdateShadowCascades(R3DShadowCascades* shadows, Camera camera, float aspect, Vector3 lightDirection); // Fit the cascades to the camera view, call once per frame before drawing the casters
+R3DDEF void InvalidateShadowCache(R3DShadowCascades* shadows);                               // Static casters changed, their layer is drawn again in every cascade
+R3DDEF bool BeginShadowCascade(R3DShadowCascades* shadows, int cascade, int layer);          // Begin drawing casters of a ShadowLayer in a cascade, false when the static layer is still cached (skip its drawing)
+R3DDEF void EndShadowCascade(R3DShadowCascades* shadows);                                    // End drawing casters in a cascade
+R3DDEF void SetShaderShadowCascades(Shader shader, R3DShadowCascades shadows);               // Sets and binds the cascades on a lighting shader (SHADER_FEATURE_SHADOWS variant)
+
+#define SHADOW_ATLAS_MAX_LIGHTS 32              // Shadowed point and spot lights of an atlas, matches the ShadowBlock array size of the lighting shaders
+#define SHADOW_ATLAS_BINDING 1                  // Uniform buffer binding point of the shadow atlas
+#define SHADOW_ATLAS_UNIT 12                    // Texture unit of the shadow atlas
+
+// Shadow atlas of point and spot lights, every light view (six cube faces for point lights, one for spot lights)
+// gets a power of two tile sized by how much of the screen the light covers. Views are only drawn again when their
+// light moves or their tile changes, at most updateBudget per frame (new tiles first, then the most important and
+// longest waiting), and a light keeps sampling its previous tile until the new one is drawn
+typedef struct R3DShadowAtlas {
+    int size;                        // Atlas size
+    int minTileSize;                 // Smallest tile, lights outside the view get it (default 64)
+    int maxTileSize;                 // Tile of a light covering the whole screen (default size/4)
+    int updateBudget;                // Views drawn per frame at most, a point light has 6 views and a spot light 1 (default 6)
+    float nearPlane;                 // Near plane of the light views (default 0.05)
+    float bias;                      // Normal offset applied when sampling, in texels (default 1.5)
+    int lightCount;                  // Shadowed lights
+    int updateCount;                 // Views to draw this frame, see BeginShadowAtlasView()
+    int viewUpdates;                 // Views drawn since loaded
+    unsigned int framebuffer;
+    unsigned int depth;              // DEPTH24 atlas texture sampled by lighting
+    unsigned int ubo;                // Uniform buffer, std140 ShadowBlock
+    void* data;                      // Tile allocator, light views and saved state
+} R3DShadowAtlas;
+
+R3DDEF R3DShadowAtlas LoadShadowAtlas(int size);                                             // Load a shadow atlas (size x size, a power of two)
+R3DDEF void UnloadShadowAtlas(R3DShadowAtlas atlas);                                         // Unload a shadow atlas
+R3DDEF int AddShadowLight(R3DShadowAtlas* atlas, R3DLightSet* set, int light);               // Shadow a point or spot light of a light set, returns its atlas entry (-1 when full)
+R3DDEF void RemoveShadowLight(R3DShadowAtlas* atlas, R3DLightSet* set, int entry);           // Stop shadowing a light, its tiles are freed
+R3DDEF void UpdateShadowAtlas(R3DShadowAtlas* atlas, R3DLightSet* set, Camera camera, float aspect); // Size the tiles and pick the views to draw this frame, call before UpdateLightSet()
+R3DDEF void InvalidateShadowAtlas(R3DShadowAtlas* atlas);                                    // Casters changed everywhere, every view is drawn again
+R3DDEF void InvalidateShadowAtlasBox(R3DShadowAtlas* atlas, BoundingBox box);                // A caster moved inside a box, the views of the lights reaching it are drawn again
+R3DDEF void BeginShadowAtlasView(R3DShadowAtlas* atlas, int update);                         // Begin drawing the casters of a view picked this frame (0 <= update < updateCount)
+R3DDEF void EndShadowAtlasView(R3DShadowAtlas* atlas);                                       // End drawing casters in a view
+R3DDEF void SetShaderShadowAtlas(Shader shader, R3DShadowAtlas atlas);                       // Sets and binds the atlas on a lighting shader (SHADER_FEATURE_SHADOWS variant)
+
+#define MATERIAL_MAP_LIGHTMAP MATERIAL_MAP_OCCLUSION // Material map of the baked lighting, sampled with the second texcoords (texture4)
+
+// Lightmap baking settings, zero fields take their default value
+typedef struct R3DBakeSettings {
+    int size;                        // Lightmap size (default 512)
+    float texelsPerUnit;             // Texel density of generated second texcoords (default 0: as dense as the lightmap fits)
+    int padding;                     // Texels between charts, filled from the chart border against bilinear bleeding (default 2)
+    int samples;                     // Indirect paths per texel (default 64)
+    int bounces;                     // Indirect bounces of a path (default 2)
+    float albedo;                    // Reflectance of the surfaces for bounced light, scales the material albedo color (default 0.5)
+    Vector3 ambient;                 // Light of the rays leaving the model (default black)
+    bool indirectOnly;               // Only bake bounced light, the direct light stays dynamic
+} R3DBakeSettings;
+
+R3DDEF Image BakeLightmaps(Model* model, const R3DLight* lights, int count, R3DBakeSettings settings); // Bake the lighting of all the model meshes into one RGB32F lightmap on the CPU, meshes without second texcoords get them
+
+// Program binary cache statistics, since the program started
+typedef struct R3DShaderCacheStats {
+    int hits;                        // Programs loaded from a cached binary
+    int misses;                      // Programs compiled from source (and cached)
+    int rejected;                    // Cached binaries refused by the driver (driver update..), compiled from source again
+    float compileTime;               // Milliseconds spent compiling and linking from source
+    float loadTime;                  // Milliseconds spent loading cached binaries
+    float timeSaved;                 // Milliseconds saved by the hits, using the compile time stored with each binary
+} R3DShaderCacheStats;
+
+R3DDEF void SetShaderCacheDirectory(const char* path);                                       // Set the directory of the program binary cache, it must exist (NULL disables the cache)
+R3DDEF Shader LoadShaderCached(const char* vsFileName, const char* fsFileName, const char* defines); // Load a shader through the program binary cache, defines ("#define NAME\n" lines) are added after #version
+R3DDEF Shader LoadShaderFromMemoryCached(const char* vsCode, const char* fsCode, const char* defines); // Load a shader from code through the program binary cache, NULL vsCode uses the raylib default vertex shader
+R3DDEF R3DShaderCacheStats GetShaderCacheStats(void);                                        // Get the program binary cache statistics
+
+// Shader features, combined into the bitmask selecting a shader variant
+// Each feature compiles in with a define (R3D_NORMAL_MAP..), shaders loaded without variants keep every feature on
+typedef enum {
+    SHADER_FEATURE_NORMAL_MAP = 1 << 0,  // Normals from the normal map (texture2), else from the mesh
+    SHADER_FEATURE_SSAO = 1 << 1,        // Ambient occlusion from the ssaobuffer
+    SHADER_FEATURE_EMISSION = 1 << 2,    // Emission map (texture5) tinted by colEmission
+    SHADER_FEATURE_SKINNING = 1 << 3,    // Vertex skinning (vertexBoneIds, vertexBoneWeights, boneMatrices)
+    SHADER_FEATURE_INSTANCING = 1 << 4,  // Model matrix from the instanceTransform attribute, normal matrix from instanceNormal
+    SHADER_FEATURE_SPECULAR = 1 << 5,    // Light model, Blinn-Phong specular.. Lambert diffuse only when unset
+    SHADER_FEATURE_SHADOWS = 1 << 6,     // Cascaded shadows of directional lights and atlas shadows of point and spot lights (see R3DShadowCascades,
+                                         // R3DShadowAtlas), off when loaded without variants
+    SHADER_FEATURE_LIGHTMAP = 1 << 7     // Baked lighting (MATERIAL_MAP_LIGHTMAP) times albedo added to the emission output, off when loaded without variants
+} ShaderFeature;
+
+#define SHADER_FEATURE_COUNT 8
+#define SHADER_VARIANT_MAX_BONES 64     // Size of the boneMatrices array of skinned variants
+
+// Shader variants, one shader source compiled once per feature bitmask used
+typedef struct R3DShaderVariants {
+    int count;                       // Variants compiled so far
+    void* data;                      // Shader code and variants, indexed by feature bitmask
+} R3DShaderVariants;
+
+R3DDEF R3DShaderVariants LoadShaderVariants(const char* vsFileName, const char* fsFileName); // Load a shader source for variants, nothing is compiled yet (NULL vsFileName uses the default vertex shader)
+R3DDEF void UnloadShaderVariants(R3DShaderVariants variants);                                // Unload a shader source and all its compiled variants
+R3DDEF Shader GetShaderVariant(R3DShaderVariants* variants, unsigned int features);          // Get the variant of a ShaderFeature bitmask, compiled (through the binary cache) on first use
+R3DDEF int PrewarmShaderVariants(R3DShaderVariants* variants, const char* manifestFileName);  // Compile the variants listed in a manifest (one variant per line, feature names like NORMAL_MAP SSAO), returns the number listed
+R3DDEF unsigned int GetMaterialShaderFeatures(Material material);                            // Get the features a material needs (normal, emission and lightmap maps that are not the default texture)
+
+// Location of colEmission in Shader.locs, set from MATERIAL_MAP_EMISSION color by the r3d draws (unset: white)
+// NOTE: The last slot, past the ShaderLocationIndex values of raylib (5.x adds bone and instance locations after SHADER_LOC_MAP_BRDF)
+#define SHADER_LOC_COLOR_EMISSION 31
+
+#if defined(R3D_SKELETAL_ANIMATION_SUPPORT)
+typedef struct SkeletalBone {
+    unsigned int id;       // id correlates directly to Raylib's BoneInfo id
+    Matrix offsetMatrix;   // transforms local spaced vertices into bone space (skeleton)
+    Matrix finalTransform; // Combination of the inverse matrix, offset matrix and global transform
+} SkeletalBone;
+
+typedef struct SkeletalAnimationChannel {
+    char* name;            // name of this bone... NOTE: Could this changed to the id?
+    Transform* transforms; // each transform represents this bone's position, rotation, and scale 
+    unsigned int transformsAmount;
+} SkeletalAnimationChannel;
+
+typedef struct SkeletalAnimation {
+    float duration;                      // length in ticks
+    float ticksPerSecond;                // e.g 100 duration (ticks) at 25 ticks per second would give us a ~4 second animation
+    unsigned int channelsAmount;
+    SkeletalAnimationChannel* channels;  // these are the bones (skeleton) for an animation.. TODO: Channels should be replaced with a HashMap<channelName, channel> for 0(1) lookup.. must find c lib for such
+} SkeletalAnimation;
+
+typedef struct Skeleton {
+    unsigned int bonesCount;
+    SkeletalBone* bones;
+} Skeleton;
+
+typedef struct AnimatedModel {
+    Model model;
+    Skeleton skeleton;
+    SkeletalAnimation* animations;
+    unsigned int animationsCount;
+} AnimatedModel;
+
+R3DDEF AnimatedModel LoadAnimatedModel(const char* filename); // Load from file, uses raylib for (LoadModel)
+#endif   
+
+#if defined(R3D_ASSIMP_SUPPORT)
+// Optional processing of the imported meshes
+typedef struct R3DImportSettings {
+    unsigned int optimizeFlags;      // OptimizeMesh() steps run on each mesh, the stats before and after are logged (0: none)
+    int lodCount;                    // Detail levels generated per mesh, the authored one included (0 or 1: none)
+    float lodReduction;              // Triangles kept from one level to the next (0: 0.5)
+    float lodMaxError;               // Largest error of the first simplified level, relative to the mesh radius (0: 0.05)
+    int meshletMinTriangles;         // Meshes with at least this many triangles are split into meshlets (0: none)
+} R3DImportSettings;
+
+R3DDEF Model LoadModelAdvanced(const char* filename); // Loads a model from ASSIMP (External Dependency)
+R3DDEF Model LoadModelAdvancedEx(const char* filename, R3DImportSettings settings); // Loads a model from ASSIMP, processing its meshes
+#if defined(R3D_SKELETAL_ANIMATION_SUPPORT)
+R3DDEF AnimatedModel LoadAnimatedModelAdvanced(const char* filename); // Load from file
+#endif
+#endif                                                // R3D_ASSIMP_SUPPORT
+
+#endif // R3D_H
+
+#if defined(R3D_IMPLEMENTATION)
+#include <rlgl.h>
+
+#if !defined(R3D_GLAD)
+//#define GLAD_IMPLEMENTATION
+#include "glad.h"
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+
+#if SHADER_LOC_COLOR_EMISSION >= MAX_SHADER_LOCATIONS
+#error "SHADER_LOC_COLOR_EMISSION must be under MAX_SHADER_LOCATIONS"
+#endif
+
+#if !defined(R3D_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define R3D_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+// AVX is only used when the compiler targets it (-mavx, /arch:AVX), there is no runtime dispatch
+#if defined(R3D_SIMD_SSE) && defined(__AVX__)
+#define R3D_SIMD_AVX
+#include <immintrin.h>
+#endif
+
+#if !defined(R3D_NO_THREADS)
+#if defined(_WIN32)
+// NOTE: windows.h is not included on purpose, it collides with raylib names (CloseWindow, DrawText, Rectangle...)
+typedef struct { void* ptr; } R3DSRWLock;
+typedef struct { void* ptr; } R3DConditionVariable;
+__declspec(dllimport) void* __stdcall CreateThread(void* attributes, size_t stackSize, unsigned long (__stdcall *start)(void*), void* param, unsigned long flags, unsigned long* threadId);
+__declspec(dllimport) unsigned long __stdcall GetActiveProcessorCount(unsigned short groupNumber);
+__declspec(dllimport) void __stdcall InitializeSRWLock(R3DSRWLock* lock);
+__declspec(dllimport) void __stdcall AcquireSRWLockExclusive(R3DSRWLock* lock);
+__declspec(dllimport) void __stdcall ReleaseSRWLockExclusive(R3DSRWLock* lock);
+__declspec(dllimport) void __stdcall InitializeConditionVariable(R3DConditionVariable* cond);
+__declspec(dllimport) int __stdcall SleepConditionVariableSRW(R3DConditionVariable* cond, R3DSRWLock* lock, unsigned long milliseconds, unsigned long flags);
+__declspec(dllimport) void __stdcall WakeAllConditionVariable(R3DConditionVariable* cond);
+long _InterlockedExchangeAdd(long volatile* addend, long value);
+#pragma intrinsic(_InterlockedExchangeAdd)
+#define R3D_ATOMIC_FETCH_ADD(ptr, value) _InterlockedExchangeAdd((long volatile*)(ptr), (value))
+#else
+#include <pthread.h>
+#include <unistd.h>
+#define R3D_ATOMIC_FETCH_ADD(ptr, value) __sync_fetch_and_add((ptr), (value))
+#endif
+#endif
+
+#ifndef R3D_MAX_THREADS
+#define R3D_MAX_THREADS 32
+#endif
+
+#pragma region THREADS
+// Job system used by the CPU side passes (light culling, baking...)
+// A fixed pool of worker threads is started on first use, jobs are indices pulled from a shared atomic counter
+typedef void (*R3DJobFunc)(void* data, int index);
+
+#if !defined(R3D_NO_THREADS)
+static struct {
+    bool initialized;
+    bool busy;                     // A parallel for is running, nested calls run serially
+    int threadCount;               // Worker threads, the calling thread also runs jobs
+    unsigned int generation;       // Incremented on every dispatch, wakes up the workers
+    int active;                    // Workers still running the current dispatch
+    volatile long next;            // Next job index
+    int count;
+    R3DJobFunc func;
+    void* data;
+#if defined(_WIN32)
+    R3DSRWLock lock;
+    R3DConditionVariable wake;
+    R3DConditionVariable done;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+#endif
+} r3dJobs = { 0 };
+
+#if defined(_WIN32)
+#define R3D_JOBS_LOCK() AcquireSRWLockExclusive(&r3dJobs.lock)
+#define R3D_JOBS_UNLOCK() ReleaseSRWLockExclusive(&r3dJobs.lock)
+#define R3D_JOBS_WAIT(cond) SleepConditionVariableSRW(&(cond), &r3dJobs.lock, 0xFFFFFFFF, 0)
+#define R3D_JOBS_WAKE(cond) WakeAllConditionVariable(&(cond))
+#else
+#define R3D_JOBS_LOCK() pthread_mutex_lock(&r3dJobs.lock)
+#define R3D_JOBS_UNLOCK() pthread_mutex_unlock(&r3dJobs.lock)
+#define R3D_JOBS_WAIT(cond) pthread_cond_wait(&(cond), &r3dJobs.lock)
+#define R3D_JOBS_WAKE(cond) pthread_cond_broadcast(&(cond))
+#endif
+
+static void RunJobs(void)
+{
+    long index = 0;
+    while ((index = R3D_ATOMIC_FETCH_ADD(&r3dJobs.next, 1)) < r3dJobs.count)
+    {
+        r3dJobs.func(r3dJobs.data, (int)index);
+    }
+}
+
+#if defined(_WIN32)
+static unsigned long __stdcall JobWorker(void* param)
+#else
+static void* JobWorker(void* param)
+#endif
+{
+    unsigned int generation = 0;
+    (void)param;
+
+    while (true)
+    {
+        R3D_JOBS_LOCK();
+        while (r3dJobs.generation == generation) R3D_JOBS_WAIT(r3dJobs.wake);
+        generation = r3dJobs.generation;
+        R3D_JOBS_UNLOCK();
+
+        RunJobs();
+
+        R3D_JOBS_LOCK();
+        r3dJobs.active--;
+        if (r3dJobs.active == 0) R3D_JOBS_WAKE(r3dJobs.done);
+        R3D_JOBS_UNLOCK();
+    }
+
+    return 0;
+}
+
+static void InitJobs(void)
+{
+    r3dJobs.initialized = true;
+
+#if defined(_WIN32)
+    int cores = (int)GetActiveProcessorCount(0xFFFF);
+    InitializeSRWLock(&r3dJobs.lock);
+    InitializeConditionVariable(&r3dJobs.wake);
+    InitializeConditionVariable(&r3dJobs.done);
+#else
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_mutex_init(&r3dJobs.lock, NULL);
+    pthread_cond_init(&r3dJobs.wake, NULL);
+    pthread_cond_init(&r3dJobs.done, NULL);
+#endif
+
+    if (cores > R3D_MAX_THREADS) cores = R3D_MAX_THREADS;
+
+    for (int i = 0; i < cores - 1; i++)
+    {
+#if defined(_WIN32)
+        bool created = (CreateThread(NULL, 0, JobWorker, NULL, 0, NULL) != NULL);
+#else
+        pthread_t thread;
+        bool created = (pthread_create(&thread, NULL, JobWorker, NULL) == 0);
+        if (created) pthread_detach(thread);
+#endif
+        if (!created) break;
+        r3dJobs.threadCount++;
+    }
+
+    TraceLog(LOG_INFO, "R3D: Job system started with %i worker threads", r3dJobs.threadCount);
+}
+#endif // R3D_NO_THREADS
+
+// Runs func(data, i) for every i in [0, count) over all the cores, returns when every job is finished
+static void ParallelFor(int count, R3DJobFunc func, void* data)
+{
+#if !defined(R3D_NO_THREADS)
+    if (!r3dJobs.initialized) InitJobs();
+
+    if ((count > 1) && (r3dJobs.threadCount > 0) && !r3dJobs.busy)
+    {
+        R3D_JOBS_LOCK();
+        r3dJobs.busy = true;
+        r3dJobs.func = func;
+        r3dJobs.data = data;
+        r3dJobs.count = count;
+        r3dJobs.next = 0;
+        r3dJobs.active = r3dJobs.threadCount;
+        r3dJobs.generation++;
+        R3D_JOBS_WAKE(r3dJobs.wake);
+        R3D_JOBS_UNLOCK();
+
+        RunJobs();
+
+        R3D_JOBS_LOCK();
+        while (r3dJobs.active > 0) R3D_JOBS_WAIT(r3dJobs.done);
+        r3dJobs.busy = false;
+        R3D_JOBS_UNLOCK();
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; i++) func(data, i);
+}
+
+// Number of threads running jobs, including the calling thread
+static int GetJobThreadCount(void)
+{
+#if !defined(R3D_NO_THREADS)
+    if (!r3dJobs.initialized) InitJobs();
+    return r3dJobs.threadCount + 1;
+#else
+    return 1;
+#endif
+}
+#pragma endregion
+
+#pragma region INTERNAL
+// Full screen triangle, positions are generated from gl_VertexID so no vertex buffer is needed
+static const char* r3dFullscreenVS =
+    "#version 330\n"
+    "out vec2 fragTexCoord;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 position = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);\n"
+    "    fragTexCoord = position*0.5 + 0.5;\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+static unsigned int r3dEmptyVao = 0;
+
+static void DrawFullscreenTriangle(void)
+{
+    if (r3dEmptyVao == 0) glGenVertexArrays(1, &r3dEmptyVao);
+
+    glBindVertexArray(r3dEmptyVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+// Transforms a homogeneous point, same convention as Vector3Transform()
+static Vector4 TransformVector4(Vector4 v, Matrix mat)
+{
+    Vector4 result = { 0 };
+    result.x = mat.m0*v.x + mat.m4*v.y + mat.m8*v.z + mat.m12*v.w;
+    result.y = mat.m1*v.x + mat.m5*v.y + mat.m9*v.z + mat.m13*v.w;
+    result.z = mat.m2*v.x + mat.m6*v.y + mat.m10*v.z + mat.m14*v.w;
+    result.w = mat.m3*v.x + mat.m7*v.y + mat.m11*v.z + mat.m15*v.w;
+    return result;
+}
+
+// Moves a normalized device coordinates point into view space
+static Vector3 UnprojectNDC(Matrix invProjection, float x, float y, float z)
+{
+    Vector4 point = { x, y, z, 1.0f };
+    point = TransformVector4(point, invProjection);
+
+    Vector3 result = { point.x/point.w, point.y/point.w, point.z/point.w };
+    return result;
+}
+
+// Data kept aside for meshes (bounds, detail levels, meshlets), found again from the mesh vertex array and one of its
+// buffers. Each entry starts with its key, the entries of a bucket are chained by index
+typedef struct MeshTableKey {
+    unsigned int vaoId;
+    const void* buffer;              // Tells apart a vertex array id reused after an UnloadMesh()
+    int next;                        // Next entry of the same bucket, -1 at the end
+} MeshTableKey;
+
+typedef struct MeshTable {
+    int count;
+    int capacity;                    // Entries and buckets, a power of two
+    int entrySize;
+    unsigned char* entries;
+    int* buckets;                    // First entry of each bucket, -1 when empty
+} MeshTable;
+
+// Vertex array ids are handed out in sequence, their low bits spread them over the buckets
+static int* GetMeshTableBucket(const MeshTable* table, unsigned int vaoId)
+{
+    return &table->buckets[vaoId & (unsigned int)(table->capacity - 1)];
+}
+
+static MeshTableKey* GetMeshTableEntry(const MeshTable* table, int index)
+{
+    return (MeshTableKey*)(table->entries + (size_t)index*table->entrySize);
+}
+
+static void* FindMeshTableEntry(const MeshTable* table, unsigned int vaoId, const void* buffer)
+{
+    if (table->count == 0) return NULL;
+
+    for (int i = *GetMeshTableBucket(table, vaoId); i != -1; i = GetMeshTableEntry(table, i)->next)
+    {
+        MeshTableKey* key = GetMeshTableEntry(table, i);
+        if ((key->vaoId == vaoId) && (key->buffer == buffer)) return key;
+    }
+
+    return NULL;
+}
+
+// Adds an entry, the data after its key is left to the caller
+static void* AddMeshTableEntry(MeshTable* table, unsigned int vaoId, const void* buffer)
+{
+    if (table->count == table->capacity)
+    {
+        int capacity = (table->capacity > 0)? table->capacity*2 : 64;
+        unsigned char* entries = (unsigned char*)R3D_MALLOC((size_t)capacity*table->entrySize);
+        if (table->count > 0) memcpy(entries, table->entries, (size_t)table->count*table->entrySize);
+        R3D_FREE(table->entries);
+        R3D_FREE(table->buckets);
+        table->entries = entries;
+        table->buckets = (int*)R3D_MALLOC(capacity*sizeof(int));
+        table->capacity = capacity;
+
+        for (int i = 0; i < capacity; i++) table->buckets[i] = -1;
+        for (int i = 0; i < table->count; i++)
+        {
+            MeshTableKey* key = GetMeshTableEntry(table, i);
+            int* bucket = GetMeshTableBucket(table, key->vaoId);
+            key->next = *bucket;
+            *bucket = i;
+        }
+    }
+
+    int index = table->count++;
+    MeshTableKey* key = GetMeshTableEntry(table, index);
+    int* bucket = GetMeshTableBucket(table, vaoId);
+    key->vaoId = vaoId;
+    key->buffer = buffer;
+    key->next = *bucket;
+    *bucket = index;
+
+    return key;
+}
+
+// Bucket or chain link holding the index of an entry
+static int* GetMeshTableLink(const MeshTable* table, int index)
+{
+    int* link = GetMeshTableBucket(table, GetMeshTableEntry(table, index)->vaoId);
+    while (*link != index) link = &GetMeshTableEntry(table, *link)->next;
+    return link;
+}
+
+// Removes an entry given by FindMeshTableEntry(), the last entry moves into its place
+static void RemoveMeshTableEntry(MeshTable* table, void* entry)
+{
+    int index = (int)(((unsigned char*)entry - table->entries)/table->entrySize);
+    *GetMeshTableLink(table, index) = ((MeshTableKey*)entry)->next;
+
+    int last = --table->count;
+    if (index != last)
+    {
+        *GetMeshTableLink(table, last) = index;
+        memcpy(entry, GetMeshTableEntry(table, last), table->entrySize);
+    }
+}
+
+// Bounds computed at import, found again by GetMeshBounds() from the mesh vertex array and vertices
+typedef struct MeshBoundsEntry {
+    MeshTableKey key;
+    R3DBounds bounds;
+} MeshBoundsEntry;
+
+static MeshTable r3dMeshBounds = { 0, 0, sizeof(MeshBoundsEntry), NULL, NULL };
+
+static void StoreMeshBounds(Mesh mesh, R3DBounds bounds)
+{
+    MeshBoundsEntry* entry = (MeshBoundsEntry*)FindMeshTableEntry(&r3dMeshBounds, mesh.vaoId, mesh.vertices);
+    if (entry == NULL) entry = (MeshBoundsEntry*)AddMeshTableEntry(&r3dMeshBounds, mesh.vaoId, mesh.vertices);
+    entry->bounds = bounds;
+}
+
+static void ForgetMeshBounds(Mesh mesh)
+{
+    MeshBoundsEntry* entry = (MeshBoundsEntry*)FindMeshTableEntry(&r3dMeshBounds, mesh.vaoId, mesh.vertices);
+    if (entry != NULL) RemoveMeshTableEntry(&r3dMeshBounds, entry);
+}
+
+// Stored bounds follow a mesh uploaded again or given new vertices (welded, reordered), its positions are unchanged
+static void MoveMeshBounds(Mesh original, Mesh mesh)
+{
+    MeshBoundsEntry* entry = (MeshBoundsEntry*)FindMeshTableEntry(&r3dMeshBounds, original.vaoId, original.vertices);
+    if (entry == NULL) return;
+
+    R3DBounds bounds = entry->bounds;
+    RemoveMeshTableEntry(&r3dMeshBounds, entry);
+    StoreMeshBounds(mesh, bounds);
+}
+
+// Meshlets built at import, found again from the mesh indices and vertex array
+typedef struct MeshletEntry {
+    MeshTableKey key;                // Vertex array and indices
+    R3DMeshlets* meshlets;
+} MeshletEntry;
+
+static MeshTable r3dMeshlets = { 0, 0, sizeof(MeshletEntry), NULL, NULL };
+
+static void ForgetMeshMeshlets(Mesh mesh)
+{
+    MeshletEntry* entry = (MeshletEntry*)FindMeshTableEntry(&r3dMeshlets, mesh.vaoId, mesh.indices);
+    if (entry == NULL) return;
+
+    UnloadMeshlets(*entry->meshlets);
+    R3D_FREE(entry->meshlets);
+    RemoveMeshTableEntry(&r3dMeshlets, entry);
+}
+
+static void StoreMeshMeshlets(Mesh mesh, R3DMeshlets meshlets)
+{
+    if (meshlets.count == 0) return;
+
+    ForgetMeshMeshlets(mesh);
+
+    // Kept apart from the entries, so the pointers given by GetMeshMeshlets() stay valid as the entries grow
+    MeshletEntry* entry = (MeshletEntry*)AddMeshTableEntry(&r3dMeshlets, mesh.vaoId, mesh.indices);
+    entry->meshlets = (R3DMeshlets*)R3D_MALLOC(sizeof(R3DMeshlets));
+    *entry->meshlets = meshlets;
+}
+#pragma endregion
+
+#pragma region PROFILER
+static const char* profilerPassNames[PROFILER_PASS_COUNT] = {
+    "gbuffer", "light_culling", "light_volumes", "lighting", "upsample", "ssao", "decals", "shadows", "composite", "custom"
+};
+
+#if !defined(R3D_NO_PROFILER)
+// NOTE: Passes are timed with GL_TIMESTAMP pairs rather than GL_TIME_ELAPSED, those can't nest (e.g. inside R3DDynamicResolution)
+typedef struct ProfilerPassData {
+    unsigned int queries[PROFILER_QUERIES][2];   // Begin and end timestamps
+    float cpuTimes[PROFILER_QUERIES];            // CPU time of the pass of each query pair
+    int first;                                   // Oldest query pair in flight
+    int pending;                                 // Query pairs in flight
+    int current;                                 // Query pair of the running pass, -1 when it is not timed
+    bool active;
+    double cpuStart;
+    float gpuHistory[PROFILER_HISTORY];
+    float cpuHistory[PROFILER_HISTORY];
+    int historyCount;
+    int historyNext;
+} ProfilerPassData;
+
+static struct {
+    bool initialized;
+    int dropped;
+    ProfilerPassData passes[PROFILER_PASS_COUNT];
+} r3dProfiler = { 0 };
+
+// Reads back the results already available, oldest first
+static void PollProfilerPass(ProfilerPassData* pass)
+{
+    while (pass->pending > 0)
+    {
+        unsigned int* queries = pass->queries[pass->first];
+        int available = 0;
+        glGetQueryObjectiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+
+        pass->gpuHistory[pass->historyNext] = (float)((double)(end - begin)/1000000.0);
+        pass->cpuHistory[pass->historyNext] = pass->cpuTimes[pass->first];
+        pass->historyNext = (pass->historyNext + 1)%PROFILER_HISTORY;
+        if (pass->historyCount < PROFILER_HISTORY) pass->historyCount++;
+
+        pass->first = (pass->first + 1)%PROFILER_QUERIES;
+        pass->pending--;
+    }
+}
+
+static int CompareProfilerSamples(const void* a, const void* b)
+{
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts the samples in place
+static void GetProfilerSampleStats(float* samples, int count, float* min, float* avg, float* p99)
+{
+    qsort(samples, count, sizeof(float), CompareProfilerSamples);
+
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += samples[i];
+
+    *min = samples[0];
+    *avg = (float)(sum/count);
+    *p99 = samples[(int)ceilf(0.99f*(float)count) - 1];
+}
+#endif
+
+R3DDEF void BeginProfilerPass(int pass)
+{
+#if !defined(R3D_NO_PROFILER)
+    if ((pass < 0) || (pass >= PROFILER_PASS_COUNT)) return;
+
+    ProfilerPassData* data = &r3dProfiler.passes[pass];
+    if (data->active) return;
+
+    if (!r3dProfiler.initialized)
+    {
+        for (int i = 0; i < PROFILER_PASS_COUNT; i++) glGenQueries(PROFILER_QUERIES*2, r3dProfiler.passes[i].queries[0]);
+        r3dProfiler.initialized = true;
+    }
+
+    PollProfilerPass(data);
+
+    // Rather than waiting for a query pair, the pass is not timed when all of them are still in flight
+    data->active = true;
+    data->current = -1;
+    if (data->pending == PROFILER_QUERIES)
+    {
+        r3dProfiler.dropped++;
+        return;
+    }
+    data->current = (data->first + data->pending)%PROFILER_QUERIES;
+
+    rlDrawRenderBatchActive();
+    glQueryCounter(data->queries[data->current][0], GL_TIMESTAMP);
+    data->cpuStart = GetTime();
+#endif
+}
+
+R3DDEF void EndProfilerPass(int pass)
+{
+#if !defined(R3D_NO_PROFILER)
+    if ((pass < 0) || (pass >= PROFILER_PASS_COUNT)) return;
+
+    ProfilerPassData* data = &r3dProfiler.passes[pass];
+    if (!data->active) return;
+    data->active = false;
+    if (data->current == -1) return;
+
+    rlDrawRenderBatchActive();
+    glQueryCounter(data->queries[data->current][1], GL_TIMESTAMP);
+    data->cpuTimes[data->current] = (float)((GetTime() - data->cpuStart)*1000.0);
+    data->pending++;
+#endif
+}
+
+R3DDEF R3DFrameStats GetFrameStats(void)
+{
+    R3DFrameStats stats = { 0 };
+
+#if !defined(R3D_NO_PROFILER)
+    float samples[PROFILER_HISTORY];
+
+    for (int i = 0; i < PROFILER_PASS_COUNT; i++)
+    {
+        ProfilerPassData* data = &r3dProfiler.passes[i];
+        if (r3dProfiler.initialized) PollProfilerPass(data);
+
+        R3DPassStats* pass = &stats.passes[i];
+        pass->samples = data->historyCount;
+        if (data->historyCount == 0) continue;
+
+        memcpy(samples, data->gpuHistory, data->historyCount*sizeof(float));
+        GetProfilerSampleStats(samples, data->historyCount, &pass->gpuMin, &pass->gpuAvg, &pass->gpuP99);
+        memcpy(samples, data->cpuHistory, data->historyCount*sizeof(float));
+        GetProfilerSampleStats(samples, data->historyCount, &pass->cpuMin, &pass->cpuAvg, &pass->cpuP99);
+    }
+    stats.dropped = r3dProfiler.dropped;
+#endif
+
+    return stats;
+}
+
+R3DDEF const char* GetProfilerPassName(int pass)
+{
+    if ((pass < 0) || (pass >= PROFILER_PASS_COUNT)) return "unknown";
+    return profilerPassNames[pass];
+}
+
+R3DDEF void ResetFrameStats(void)
+{
+#if !defined(R3D_NO_PROFILER)
+    // Queries in flight are kept, their results land in the new window
+    for (int i = 0; i < PROFILER_PASS_COUNT; i++)
+    {
+        r3dProfiler.passes[i].historyCount = 0;
+        r3dProfiler.passes[i].historyNext = 0;
+    }
+    r3dProfiler.dropped = 0;
+#endif
+}
+#pragma endregion
+
+#pragma region SHADERS
+// NOTE: The bundled glad profile is GL 3.3, the program binary entry points (core in GL 4.1, GL_ARB_get_program_binary
+// before) are looked up in the current context by SetShaderCacheDirectory()
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+typedef void (APIENTRYP R3DGetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP R3DProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP R3DProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+#if defined(_WIN32)
+#include <stdint.h>
+typedef intptr_t (__stdcall *R3DWglProc)();
+__declspec(dllimport) R3DWglProc __stdcall wglGetProcAddress(const char* name);    // opengl32, linked by raylib
+#else
+#include <dlfcn.h>
+#endif
+
+// UnloadShader() frees the shader locations with RL_FREE, they are allocated the same way
+#if !defined(RL_CALLOC)
+#define RL_CALLOC(n, sz) calloc(n, sz)
+#endif
+
+#define SHADER_CACHE_MAGIC 0x50443352    // "R3DP"
+#define SHADER_CACHE_VERSION 1          // Bump when the cache file layout changes
+
+// raylib default vertex shader, used when no vertex shader is given
+static const char* r3dDefaultVS =
+    "#version 330\n"
+    "in vec3 vertexPosition;\n"
+    "in vec2 vertexTexCoord;\n"
+    "in vec4 vertexColor;\n"
+    "out vec2 fragTexCoord;\n"
+    "out vec4 fragColor;\n"
+    "uniform mat4 mvp;\n"
+    "void main()\n"
+    "{\n"
+    "    fragTexCoord = vertexTexCoord;\n"
+    "    fragColor = vertexColor;\n"
+    "    gl_Position = mvp*vec4(vertexPosition, 1.0);\n"
+    "}\n";
+
+// Cache file header, followed by the program binary
+typedef struct ShaderCacheHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long key;          // Checked against the file name, in case of a collision on the name
+    unsigned int format;             // Program binary format
+    unsigned int length;             // Program binary size
+    float compileTime;               // Milliseconds it took to compile and link from source
+} ShaderCacheHeader;
+
+static struct {
+    char directory[512];
+    bool enabled;
+    R3DShaderCacheStats stats;
+    R3DGetProgramBinaryProc getProgramBinary;
+    R3DProgramBinaryProc programBinary;
+    R3DProgramParameteriProc programParameteri;
+} r3dShaderCache = { { 0 }, false, { 0 }, NULL, NULL, NULL };
+
+// FNV-1a, chained over the parts of a cache key
+static unsigned long long HashShaderCacheKey(unsigned long long hash, const char* text)
+{
+    if (text == NULL) text = "";
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++)
+    {
+        hash ^= *c;
+        hash *= 0x100000001B3ULL;
+    }
+
+    // Separator, so moving text from one part to the next changes the key
+    hash ^= 0xFF;
+    hash *= 0x100000001B3ULL;
+    return hash;
+}
+
+// Adds the defines after the #version line (or at the start when there is none)
+static char* InsertShaderDefines(const char* code, const char* defines)
+{
+    int codeLength = (int)strlen(code);
+    int definesLength = (defines != NULL)? (int)strlen(defines) : 0;
+    char* result = (char*)R3D_MALLOC(codeLength + definesLength + 2);
+
+    int split = 0;
+    const char* version = strstr(code, "#version");
+    if (version != NULL)
+    {
+        const char* end = strchr(version, '\n');
+        split = (end != NULL)? (int)(end - code) + 1 : codeLength;
+    }
+
+    memcpy(result, code, split);
+    int length = split;
+    if ((split > 0) && (code[split - 1] != '\n')) result[length++] = '\n';
+    memcpy(result + length, defines, definesLength);
+    length += definesLength;
+    memcpy(result + length, code + split, codeLength - split);
+    length += codeLength - split;
+    result[length] = '\0';
+
+    return result;
+}
+
+static unsigned int CompileShaderCode(const char* code, int type)
+{
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+
+    int success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success != GL_TRUE)
+    {
+        char log[1024] = { 0 };
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        TraceLog(LOG_WARNING, "SHADER: [ID %i] Failed to compile %s shader code: %s", shader, (type == GL_VERTEX_SHADER)? "vertex" : "fragment", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+// Compiles and links a program with the raylib default attribute locations
+static unsigned int LinkShaderProgram(const char* vsCode, const char* fsCode, bool retrievable)
+{
+    unsigned int vertexShader = CompileShaderCode(vsCode, GL_VERTEX_SHADER);
+    unsigned int fragmentShader = CompileShaderCode(fsCode, GL_FRAGMENT_SHADER);
+    if ((vertexShader == 0) || (fragmentShader == 0))
+    {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, 0, "vertexPosition");
+    glBindAttribLocation(program, 1, "vertexTexCoord");
+    glBindAttribLocation(program, 2, "vertexNormal");
+    glBindAttribLocation(program, 3, "vertexColor");
+    glBindAttribLocation(program, 4, "vertexTangent");
+    glBindAttribLocation(program, 5, "vertexTexCoord2");
+    glBindAttribLocation(program, 6, "vertexBoneIds");
+    glBindAttribLocation(program, 7, "vertexBoneWeights");
+    glBindAttribLocation(program, 8, "instanceTransform");    // mat4, locations 8 to 11
+    glBindAttribLocation(program, 12, "instanceNormal");      // mat3, locations 12 to 14
+    if (retrievable) r3dShaderCache.programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success != GL_TRUE)
+    {
+        char log[1024] = { 0 };
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        TraceLog(LOG_WARNING, "SHADER: [ID %i] Failed to link shader program: %s", program, log);
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+// Shader with the same default locations LoadShader() sets, so it works with DrawModel() and UnloadShader()
+static Shader GetShaderFromProgram(unsigned int program)
+{
+    Shader shader = { 0 };
+    shader.id = program;
+    shader.locs = (int*)RL_CALLOC(MAX_SHADER_LOCATIONS, sizeof(int));
+    for (int i = 0; i < MAX_SHADER_LOCATIONS; i++) shader.locs[i] = -1;
+
+    shader.locs[SHADER_LOC_VERTEX_POSITION] = glGetAttribLocation(program, "vertexPosition");
+    shader.locs[SHADER_LOC_VERTEX_TEXCOORD01] = glGetAttribLocation(program, "vertexTexCoord");
+    shader.locs[SHADER_LOC_VERTEX_TEXCOORD02] = glGetAttribLocation(program, "vertexTexCoord2");
+    shader.locs[SHADER_LOC_VERTEX_NORMAL] = glGetAttribLocation(program, "vertexNormal");
+    shader.locs[SHADER_LOC_VERTEX_TANGENT] = glGetAttribLocation(program, "vertexTangent");
+    shader.locs[SHADER_LOC_VERTEX_COLOR] = glGetAttribLocation(program, "vertexColor");
+    shader.locs[SHADER_LOC_MATRIX_MVP] = glGetUniformLocation(program, "mvp");
+    shader.locs[SHADER_LOC_MATRIX_PROJECTION] = glGetUniformLocation(program, "projection");
+    shader.locs[SHADER_LOC_MATRIX_VIEW] = glGetUniformLocation(program, "view");
+    shader.locs[SHADER_LOC_COLOR_DIFFUSE] = glGetUniformLocation(program, "colDiffuse");
+    shader.locs[SHADER_LOC_MAP_ALBEDO] = glGetUniformLocation(program, "texture0");
+    shader.locs[SHADER_LOC_MAP_METALNESS] = glGetUniformLocation(program, "texture1");
+    shader.locs[SHADER_LOC_MAP_NORMAL] = glGetUniformLocation(program, "texture2");
+    shader.locs[SHADER_LOC_MAP_OCCLUSION] = glGetUniformLocation(program, "texture4");    // MATERIAL_MAP_LIGHTMAP
+    shader.locs[SHADER_LOC_MAP_EMISSION] = glGetUniformLocation(program, "texture5");
+    shader.locs[SHADER_LOC_COLOR_EMISSION] = glGetUniformLocation(program, "colEmission");
+
+    return shader;
+}
+
+// Loads a cached program binary, 0 when there is none or the driver refuses it
+static unsigned int LoadShaderCacheBinary(const char* fileName, unsigned long long key)
+{
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) return 0;
+
+    ShaderCacheHeader header = { 0 };
+    unsigned int program = 0;
+    void* binary = NULL;
+
+    if ((fread(&header, sizeof(header), 1, file) == 1) && (header.magic == SHADER_CACHE_MAGIC) &&
+        (header.version == SHADER_CACHE_VERSION) && (header.key == key) && (header.length > 0))
+    {
+        binary = R3D_MALLOC(header.length);
+        if (fread(binary, 1, header.length, file) == header.length)
+        {
+            program = glCreateProgram();
+            r3dShaderCache.programBinary(program, header.format, binary, header.length);
+
+            int success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (success != GL_TRUE)
+            {
+                TraceLog(LOG_INFO, "SHADER: Cached program binary %s refused by the driver, compiling from source", fileName);
+                r3dShaderCache.stats.rejected++;
+                glDeleteProgram(program);
+                program = 0;
+            }
+            else r3dShaderCache.stats.timeSaved += header.compileTime;
+        }
+    }
+
+    R3D_FREE(binary);
+    fclose(file);
+    return program;
+}
+
+static void SaveShaderCacheBinary(const char* fileName, unsigned long long key, unsigned int program, float compileTime)
+{
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    ShaderCacheHeader header = { 0 };
+    header.magic = SHADER_CACHE_MAGIC;
+    header.version = SHADER_CACHE_VERSION;
+    header.key = key;
+    header.compileTime = compileTime;
+
+    void* binary = R3D_MALLOC(length);
+    GLenum format = 0;
+    r3dShaderCache.getProgramBinary(program, length, &length, &format, binary);
+    header.format = format;
+    header.length = (unsigned int)length;
+
+    FILE* file = fopen(fileName, "wb");
+    if (file != NULL)
+    {
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(binary, 1, header.length, file);
+        fclose(file);
+    }
+    else TraceLog(LOG_WARNING, "SHADER: Failed to write program binary cache file %s", fileName);
+
+    R3D_FREE(binary);
+}
+
+// GL entry point outside the bundled GL 3.3 profile, from the loader of the context the application made current
+static void* GetGLProcAddress(const char* name)
+{
+#if defined(_WIN32)
+    return (void*)wglGetProcAddress(name);
+#else
+    // EGL (headless, Wayland) or GLX, whichever is loaded, else the GL library itself (macOS)
+    typedef void* (*GetProcAddressProc)(const char* name);
+    void* process = dlopen(NULL, RTLD_LAZY);
+    if (process == NULL) return NULL;
+
+    GetProcAddressProc getProcAddress = (GetProcAddressProc)dlsym(process, "eglGetProcAddress");
+    if (getProcAddress == NULL) getProcAddress = (GetProcAddressProc)dlsym(process, "glXGetProcAddressARB");
+
+    void* proc = (getProcAddress != NULL)? getProcAddress(name) : NULL;
+    if (proc == NULL) proc = dlsym(process, name);
+    dlclose(process);
+    return proc;
+#endif
+}
+
+static bool HasGLExtension(const char* name)
+{
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+    }
+
+    return false;
+}
+
+R3DDEF void SetShaderCacheDirectory(const char* path)
+{
+    r3dShaderCache.enabled = false;
+    r3dShaderCache.directory[0] = '\0';
+    if (path == NULL) return;
+
+    // Core since GL 4.1, GL 3.3 drivers expose it as an extension (Mesa llvmpipe does)
+    int major = 0;
+    int minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if ((major*10 + minor >= 41) || HasGLExtension("GL_ARB_get_program_binary"))
+    {
+        r3dShaderCache.getProgramBinary = (R3DGetProgramBinaryProc)GetGLProcAddress("glGetProgramBinary");
+        r3dShaderCache.programBinary = (R3DProgramBinaryProc)GetGLProcAddress("glProgramBinary");
+        r3dShaderCache.programParameteri = (R3DProgramParameteriProc)GetGLProcAddress("glProgramParameteri");
+    }
+
+    int formats = 0;
+    if ((r3dShaderCache.getProgramBinary != NULL) && (r3dShaderCache.programBinary != NULL) && (r3dShaderCache.programParameteri != NULL))
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    if (formats <= 0)
+    {
+        TraceLog(LOG_WARNING, "SHADER: Program binaries not supported by the driver, shader cache disabled");
+        return;
+    }
+
+    strncpy(r3dShaderCache.directory, path, sizeof(r3dShaderCache.directory) - 1);
+    r3dShaderCache.enabled = true;
+    TraceLog(LOG_INFO, "SHADER: Program binary cache enabled (%s, %i binary formats)", path, formats);
+}
+
+R3DDEF Shader LoadShaderFromMemoryCached(const char* vsCode, const char* fsCode, const char* defines)
+{
+    if (vsCode == NULL) vsCode = r3dDefaultVS;
+    char* vertexCode = InsertShaderDefines(vsCode, defines);
+    char* fragmentCode = InsertShaderDefines(fsCode, defines);
+    unsigned int program = 0;
+    unsigned long long key = 0;
+    char fileName[600] = { 0 };
+
+    if (r3dShaderCache.enabled)
+    {
+        // The driver strings invalidate the binaries of another driver (or version)
+        key = 0xCBF29CE484222325ULL;
+        key = HashShaderCacheKey(key, vertexCode);
+        key = HashShaderCacheKey(key, fragmentCode);
+        key = HashShaderCacheKey(key, (const char*)glGetString(GL_VENDOR));
+        key = HashShaderCacheKey(key, (const char*)glGetString(GL_RENDERER));
+        key = HashShaderCacheKey(key, (const char*)glGetString(GL_VERSION));
+        snprintf(fileName, sizeof(fileName), "%s/%016llx.bin", r3dShaderCache.directory, key);
+
+        double start = GetTime();
+        program = LoadShaderCacheBinary(fileName, key);
+        if (program != 0)
+        {
+            float loadTime = (float)((GetTime() - start)*1000.0);
+            r3dShaderCache.stats.hits++;
+            r3dShaderCache.stats.loadTime += loadTime;
+            r3dShaderCache.stats.timeSaved -= loadTime;
+        }
+    }
+
+    if (program == 0)
+    {
+        double start = GetTime();
+        program = LinkShaderProgram(vertexCode, fragmentCode, r3dShaderCache.enabled);
+        float compileTime = (float)((GetTime() - start)*1000.0);
+        r3dShaderCache.stats.compileTime += compileTime;
+        r3dShaderCache.stats.misses++;
+
+        if (r3dShaderCache.enabled && (program != 0)) SaveShaderCacheBinary(fileName, key, program, compileTime);
+    }
+
+    R3D_FREE(vertexCode);
+    R3D_FREE(fragmentCode);
+
+    // Same fallback as LoadShader(), a failed shader is replaced by the default one
+    if (program == 0) return LoadShaderFromMemory(NULL, NULL);
+    return GetShaderFromProgram(program);
+}
+
+R3DDEF Shader LoadShaderCached(const char* vsFileName, const char* fsFileName, const char* defines)
+{
+    char* vsCode = (vsFileName != NULL)? LoadFileText(vsFileName) : NULL;
+    char* fsCode = (fsFileName != NULL)? LoadFileText(fsFileName) : NULL;
+
+    Shader shader = { 0 };
+    if (fsCode != NULL) shader = LoadShaderFromMemoryCached(vsCode, fsCode, defines);
+    else
+    {
+        TraceLog(LOG_WARNING, "SHADER: Cached shaders need a fragment shader, default shader used");
+        shader = LoadShaderFromMemory(NULL, NULL);
+    }
+
+    if (vsCode != NULL) UnloadFileText((unsigned char*)vsCode);
+    if (fsCode != NULL) UnloadFileText((unsigned char*)fsCode);
+
+    return shader;
+}
+
+R3DDEF R3DShaderCacheStats GetShaderCacheStats(void)
+{
+    return r3dShaderCache.stats;
+}
+
+#define SHADER_VARIANT_COUNT (1 << SHADER_FEATURE_COUNT)
+
+// Feature names, as used by the defines (R3D_<name>) and the prewarm manifests
+static const char* shaderFeatureNames[SHADER_FEATURE_COUNT] = {
+    "NORMAL_MAP", "SSAO", "EMISSION", "SKINNING", "INSTANCING", "SPECULAR", "SHADOWS", "LIGHTMAP"
+};
+
+typedef struct ShaderVariantsData {
+    char* vsCode;                    // NULL for the default vertex shader
+    char* fsCode;
+    bool loaded[SHADER_VARIANT_COUNT];
+    Shader shaders[SHADER_VARIANT_COUNT];
+} ShaderVariantsData;
+
+R3DDEF R3DShaderVariants LoadShaderVariants(const char* vsFileName, const char* fsFileName)
+{
+    R3DShaderVariants variants = { 0 };
+    ShaderVariantsData* data = (ShaderVariantsData*)R3D_CALLOC(1, sizeof(ShaderVariantsData));
+
+    // Kept for the variants compiled later
+    if (vsFileName != NULL) data->vsCode = LoadFileText(vsFileName);
+    if (fsFileName != NULL) data->fsCode = LoadFileText(fsFileName);
+    if (data->fsCode == NULL) TraceLog(LOG_WARNING, "SHADER: Shader variants need a fragment shader, the default shader is used");
+
+    variants.data = data;
+    return variants;
+}
+
+R3DDEF void UnloadShaderVariants(R3DShaderVariants variants)
+{
+    ShaderVariantsData* data = (ShaderVariantsData*)variants.data;
+    if (data == NULL) return;
+
+    for (int i = 0; i < SHADER_VARIANT_COUNT; i++)
+    {
+        if (data->loaded[i]) UnloadShader(data->shaders[i]);
+    }
+    if (data->vsCode != NULL) UnloadFileText((unsigned char*)data->vsCode);
+    if (data->fsCode != NULL) UnloadFileText((unsigned char*)data->fsCode);
+    R3D_FREE(data);
+}
+
+R3DDEF Shader GetShaderVariant(R3DShaderVariants* variants, unsigned int features)
+{
+    ShaderVariantsData* data = (ShaderVariantsData*)variants->data;
+    features &= SHADER_VARIANT_COUNT - 1;
+
+    if (!data->loaded[features])
+    {
+        // R3D_VARIANT tells the shader the features are decided at compile time
+        char defines[512] = "#define R3D_VARIANT\n";
+        for (int i = 0; i < SHADER_FEATURE_COUNT; i++)
+        {
+            if (features & (1 << i)) strcat(strcat(strcat(defines, "#define R3D_"), shaderFeatureNames[i]), "\n");
+        }
+
+        if (data->fsCode != NULL) data->shaders[features] = LoadShaderFromMemoryCached(data->vsCode, data->fsCode, defines);
+        else data->shaders[features] = LoadShaderFromMemory(NULL, NULL);
+        data->loaded[features] = true;
+
+        // Shadow samplers left on unit 0 would clash with texture0 when only one of them is set
+        if (features & SHADER_FEATURE_SHADOWS)
+        {
+            int unit = SHADOW_CASCADE_UNIT;
+            SetShaderValue(data->shaders[features], GetShaderLocation(data->shaders[features], "shadowMap"), &unit, SHADER_UNIFORM_INT);
+            unit = SHADOW_ATLAS_UNIT;
+            SetShaderValue(data->shaders[features], GetShaderLocation(data->shaders[features], "shadowAtlas"), &unit, SHADER_UNIFORM_INT);
+        }
+        variants->count++;
+
+        TraceLog(LOG_INFO, "SHADER: [ID %i] Shader variant 0x%02x compiled", data->shaders[features].id, features);
+    }
+
+    return data->shaders[features];
+}
+
+R3DDEF int PrewarmShaderVariants(R3DShaderVariants* variants, const char* manifestFileName)
+{
+    char* manifest = LoadFileText(manifestFileName);
+    if (manifest == NULL) return 0;
+
+    int count = 0;
+    char* line = manifest;
+    while (*line != '\0')
+    {
+        char* end = line + strcspn(line, "\r\n");
+        char next = *end;
+        *end = '\0';
+
+        // Features separated by spaces or '|', '#' starts a comment, NONE for the variant without features
+        char* comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+
+        unsigned int features = 0;
+        bool listed = false;
+        for (char* token = strtok(line, " \t|"); token != NULL; token = strtok(NULL, " \t|"))
+        {
+            listed = true;
+            if (strcmp(token, "NONE") == 0) continue;
+
+            int feature = 0;
+            while ((feature < SHADER_FEATURE_COUNT) && (strcmp(token, shaderFeatureNames[feature]) != 0)) feature++;
+
+            if (feature < SHADER_FEATURE_COUNT) features |= (1 << feature);
+            else TraceLog(LOG_WARNING, "SHADER: Unknown shader feature %s in %s", token, manifestFileName);
+        }
+
+        if (listed)
+        {
+            GetShaderVariant(variants, features);
+            count++;
+        }
+
+        line = (next != '\0')? end + 1 : end;
+    }
+
+    UnloadFileText((unsigned char*)manifest);
+    return count;
+}
+
+R3DDEF unsigned int GetMaterialShaderFeatures(Material material)
+{
+    unsigned int features = 0;
+    unsigned int defaultId = rlGetTextureIdDefault();
+
+    unsigned int normalId = material.maps[MATERIAL_MAP_NORMAL].texture.id;
+    if ((normalId != 0) && (normalId != defaultId)) features |= SHADER_FEATURE_NORMAL_MAP;
+
+    unsigned int emissionId = material.maps[MATERIAL_MAP_EMISSION].texture.id;
+    if ((emissionId != 0) && (emissionId != defaultId)) features |= SHADER_FEATURE_EMISSION;
+
+    unsigned int lightmapId = material.maps[MATERIAL_MAP_LIGHTMAP].texture.id;
+    if ((lightmapId != 0) && (lightmapId != defaultId)) features |= SHADER_FEATURE_LIGHTMAP;
+
+    return features;
+}
+
+// Emission tint of a material, a color never set (all zero) leaves the emission map untinted
+static void GetMaterialEmissionColor(Material material, float* color)
+{
+    Color emission = material.maps[MATERIAL_MAP_EMISSION].color;
+    if ((emission.r | emission.g | emission.b | emission.a) == 0) emission = WHITE;
+
+    color[0] = emission.r/255.0f; color[1] = emission.g/255.0f; color[2] = emission.b/255.0f; color[3] = emission.a/255.0f;
+}
+#pragma endregion
+
+#pragma region GBUFFER
+// GBuffer attachment format properties, indexed by GBufferAttachmentFormat
+// NOTE: RGB16F is counted as RGBA16F, as that is how most hardware stores (and fetches) it
+static const struct {
+    int internalFormat;
+    int format;
+    int type;
+    int pixelFormat;
+    int bytes;
+} gbufferFormats[] = {
+    { GL_R8, GL_RED, GL_UNSIGNED_BYTE, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE, 1 },
+    { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 4 },
+    { GL_RG16, GL_RG, GL_UNSIGNED_SHORT, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA, 4 },
+    { GL_RG16F, GL_RG, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA, 4 },
+    { GL_RGB16F, GL_RGB, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_R32G32B32, 8 },
+    { GL_RGBA16F, GL_RGBA, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, 8 },
+};
+
+#define GBUFFER_DEPTH_BYTES 4 // GL_DEPTH_COMPONENT24, padded
+
+static const GBufferAttachmentDesc gbufferStandardDescs[] = {
+    { GBUFFER_ATTACHMENT_POSITION, GBUFFER_FORMAT_RGB16F },
+    { GBUFFER_ATTACHMENT_NORMAL, GBUFFER_FORMAT_RGB16F },
+    { GBUFFER_ATTACHMENT_ALBEDO_SPEC, GBUFFER_FORMAT_RGBA8 },
+};
+
+static const GBufferAttachmentDesc gbufferCompactDescs[] = {
+    { GBUFFER_ATTACHMENT_NORMAL, GBUFFER_FORMAT_RG16 },
+    { GBUFFER_ATTACHMENT_ALBEDO_SPEC, GBUFFER_FORMAT_RGBA8 },
+};
+
+// Decodes an octahedral encoded normal of the compact layout, shared by the internal shaders reading the GBuffer
+static const char* gbufferDecodeNormalGLSL =
+    "vec3 decode_normal(vec2 f)\n"
+    "{\n"
+    "    f = f*2.0 - 1.0;\n"
+    "    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));\n"
+    "    float t = clamp(-n.z, 0.0, 1.0);\n"
+    "    n.x += (n.x >= 0.0) ? -t : t;\n"
+    "    n.y += (n.y >= 0.0) ? -t : t;\n"
+    "    return normalize(n);\n"
+    "}\n";
+
+// Loads an internal shader whose fragment code calls decode_normal(), the snippet is added after the #version line
+static Shader LoadGBufferReaderShader(const char* vsCode, const char* fsCode)
+{
+    char* code = InsertShaderDefines(fsCode, gbufferDecodeNormalGLSL);
+    Shader shader = LoadShaderFromMemory(vsCode, code);
+    R3D_FREE(code);
+
+    return shader;
+}
+
+// Creates a render target texture and attaches it to the currently bound framebuffer
+static Texture LoadGBufferTarget(int width, int height, int internalFormat, int format, int type, int pixelFormat, int attachment)
+{
+    Texture target = { 0 };
+    target.width = width;
+    target.height = height;
+    target.format = pixelFormat;
+    target.mipmaps = 0;
+
+    glGenTextures(1, &target.id);
+    glBindTexture(GL_TEXTURE_2D, target.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+    rlTextureParameters(target.id, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_NEAREST);
+    rlTextureParameters(target.id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, target.id, 0);
+
+    return target;
+}
+
+R3DDEF GBuffer LoadGBufferEx(int width, int height, const GBufferAttachmentDesc* descs, int count)
+{
+    GBuffer gbuffer = { 0 };
+    gbuffer.id = 0;
+    gbuffer.width = width;
+    gbuffer.height = height;
+    gbuffer.viewportWidth = width;
+    gbuffer.viewportHeight = height;
+    gbuffer.layout = GBUFFER_LAYOUT_COMPACT;
+
+    glGenFramebuffers(1, &gbuffer.id);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.id);
+
+    // Fragment output locations are fixed by attachment type, so the same gbuffer shader can write to
+    // any set of attachments.. outputs without an attachment are discarded (GL_NONE)
+    unsigned int buffers[GBUFFER_MAX_ATTACHMENTS] = { GL_NONE, GL_NONE, GL_NONE, GL_NONE, GL_NONE, GL_NONE };
+    int buffersCount = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        GBufferAttachmentDesc desc = descs[i];
+
+        if ((desc.type < 0) || (desc.type >= GBUFFER_MAX_ATTACHMENTS) || (desc.format < 0) || (desc.format > GBUFFER_FORMAT_RGBA16F))
+        {
+            TraceLog(LOG_WARNING, "GBUFFER: Attachment %i has an invalid type or format, skipped", i);
+            continue;
+        }
+        if (buffers[desc.type] != GL_NONE)
+        {
+            TraceLog(LOG_WARNING, "GBUFFER: Attachment %i has a duplicated type (%i), skipped", i, desc.type);
+            continue;
+        }
+
+        int attachment = GL_COLOR_ATTACHMENT0 + gbuffer.attachmentCount;
+        Texture target = LoadGBufferTarget(width, height, gbufferFormats[desc.format].internalFormat, gbufferFormats[desc.format].format,
+            gbufferFormats[desc.format].type, gbufferFormats[desc.format].pixelFormat, attachment);
+
+        gbuffer.attachments[gbuffer.attachmentCount] = target;
+        gbuffer.descs[gbuffer.attachmentCount] = desc;
+        gbuffer.attachmentCount++;
+
+        buffers[desc.type] = attachment;
+        if (desc.type + 1 > buffersCount) buffersCount = desc.type + 1;
+
+        if (desc.type == GBUFFER_ATTACHMENT_POSITION)
+        {
+            gbuffer.position = target;
+            gbuffer.layout = GBUFFER_LAYOUT_STANDARD;
+        }
+        else if (desc.type == GBUFFER_ATTACHMENT_NORMAL) gbuffer.normal = target;
+        else if (desc.type == GBUFFER_ATTACHMENT_ALBEDO_SPEC) gbuffer.color = target;
+    }
+
+    //TODO: Query for extensions, these must be checked to ensure the user platform supports them.. ES2 may support glDrawBuffersEXT().. WebGL may support through the ANGLE web extensions
+#if defined(GRAPHICS_API_OPENGL_ES2) // use extension where availible
+    glDrawBuffersEXT(buffersCount, buffers);
+#else //glDrawBuffers only availible on ES 3.0, GL 2, 3, 4
+    glDrawBuffers(buffersCount, buffers);
+#endif
+
+    gbuffer.depth = LoadGBufferTarget(width, height, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, PIXELFORMAT_UNCOMPRESSED_R32, GL_DEPTH_ATTACHMENT);
+    rlTextureParameters(gbuffer.depth.id, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_CLAMP);
+    rlTextureParameters(gbuffer.depth.id, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_CLAMP);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        TraceLog(LOG_WARNING, "Framebuffer object could not be created...");
+
+        switch (status)
+        {
+        case GL_FRAMEBUFFER_UNSUPPORTED:
+            break;
+        case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
+            TraceLog(LOG_WARNING, "Framebuffer incomplete attachment");
+            break;
+#if defined(GRAPHICS_API_OPENGL_ES2)
+        case GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS:
+            TraceLog(LOG_WARNING, "Framebuffer incomplete dimensions");
+            break;
+#endif
+        case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
+            TraceLog(LOG_WARNING, "Framebuffer incomplete missing attachment");
+            break;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    TraceLog(LOG_INFO, "GBUFFER: [ID %i] GBuffer loaded successfully (%i x %i, %i attachments, %s layout, %i bytes per pixel)", gbuffer.id, width, height,
+        gbuffer.attachmentCount, (gbuffer.layout == GBUFFER_LAYOUT_COMPACT)? "compact" : "standard", GetGBufferBytesPerPixel(gbuffer));
+
+    return gbuffer;
+}
+
+R3DDEF GBuffer LoadGBuffer(int width, int height)
+{
+    return LoadGBufferEx(width, height, gbufferStandardDescs, sizeof(gbufferStandardDescs)/sizeof(gbufferStandardDescs[0]));
+}
+
+R3DDEF GBuffer LoadGBufferCompact(int width, int height)
+{
+    return LoadGBufferEx(width, height, gbufferCompactDescs, sizeof(gbufferCompactDescs)/sizeof(gbufferCompactDescs[0]));
+}
+
+R3DDEF void UnloadGBuffer(GBuffer gbuffer)
+{
+    rlUnloadFramebuffer(gbuffer.id);
+    for (int i = 0; i < gbuffer.attachmentCount; i++)
+    {
+        rlUnloadTexture(gbuffer.attachments[i].id);
+    }
+    rlUnloadTexture(gbuffer.depth.id);
+}
+
+R3DDEF Texture GetGBufferAttachment(GBuffer gbuffer, int type)
+{
+    Texture attachment = { 0 };
+    for (int i = 0; i < gbuffer.attachmentCount; i++)
+    {
+        if (gbuffer.descs[i].type == type) attachment = gbuffer.attachments[i];
+    }
+    return attachment;
+}
+
+// Binds every attachment type on the texture unit of the same value, types without an attachment get no texture (sampled black)
+static void BindGBufferAttachments(GBuffer gbuffer)
+{
+    for (int type = 0; type < GBUFFER_MAX_ATTACHMENTS; type++)
+    {
+        glActiveTexture(GL_TEXTURE0 + type);
+        glBindTexture(GL_TEXTURE_2D, GetGBufferAttachment(gbuffer, type).id);
+    }
+}
+
+R3DDEF int GetGBufferBytesPerPixel(GBuffer gbuffer)
+{
+    int bytes = GBUFFER_DEPTH_BYTES;
+    for (int i = 0; i < gbuffer.attachmentCount; i++)
+    {
+        bytes += gbufferFormats[gbuffer.descs[i].format].bytes;
+    }
+    return bytes;
+}
+
+// Render queue, draws queued in deferred mode are sorted by a 64 bit key and executed at EndDeferredMode()
+// Key, most significant first: shader (12 bits), material (16 bits), mesh vertex array (14 bits), view depth (22 bits)
+// Shader and vertex array ids are truncated and materials hashed, a collision only costs binds as the state is tracked
+#define RENDER_QUEUE_DEPTH_BITS 22
+#define RENDER_QUEUE_MESH_BITS 14
+#define RENDER_QUEUE_MATERIAL_BITS 16
+
+typedef struct RenderQueueDraw {
+    Matrix transform;
+    Material material;
+    Color tint;                      // Multiplies the material diffuse color, like DrawModel()
+    unsigned int vaoId;
+    int vertexCount;
+    int triangleCount;
+    bool indexed;
+} RenderQueueDraw;
+
+static struct {
+    bool active;                     // Between BeginDeferredMode() and EndDeferredMode()
+    int count;
+    int capacity;
+    RenderQueueDraw* draws;
+    unsigned long long* keys;        // Sort keys, then two buffers for the radix sort
+    unsigned long long* sortKeys;
+    unsigned int* order;
+    unsigned int* sortOrder;
+    Matrix view;                     // Camera of the queued draws, the queue is flushed when it changes
+    Matrix projection;
+    R3DRenderQueueStats stats;
+} r3dRenderQueue = { 0 };
+
+// LSD radix sort of keys with their indices, 8 bits per pass, skipping the bytes all keys share
+// NOTE: Keys are scrambled, the sorted indices are left in order (tmpKeys and tmpOrder are scratch buffers)
+static void RadixSortKeys(unsigned long long* keys, unsigned long long* tmpKeys, unsigned int* order, unsigned int* tmpOrder, int count)
+{
+    unsigned int* result = order;
+
+    static unsigned int histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (int i = 0; i < count; i++)
+    {
+        order[i] = i;
+        for (int pass = 0; pass < 8; pass++) histograms[pass][(keys[i] >> (pass*8)) & 0xff]++;
+    }
+
+    for (int pass = 0; pass < 8; pass++)
+    {
+        unsigned int* histogram = histograms[pass];
+        if (histogram[(keys[0] >> (pass*8)) & 0xff] == (unsigned int)count) continue;
+
+        unsigned int offset = 0;
+        for (int i = 0; i < 256; i++)
+        {
+            unsigned int size = histogram[i];
+            histogram[i] = offset;
+            offset += size;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            unsigned int slot = histogram[(keys[i] >> (pass*8)) & 0xff]++;
+            tmpKeys[slot] = keys[i];
+            tmpOrder[slot] = order[i];
+        }
+
+        unsigned long long* swapKeys = keys; keys = tmpKeys; tmpKeys = swapKeys;
+        unsigned int* swapOrder = order; order = tmpOrder; tmpOrder = swapOrder;
+    }
+
+    if (order != result) memcpy(result, order, count*sizeof(unsigned int));
+}
+
+// Sort key of a draw, the distance is the view depth (0 when the order does not depend on the camera)
+static unsigned long long GetRenderQueueKey(Material material, unsigned int vaoId, float distance)
+{
+    // Float bits of a positive distance sort like the distance
+    if (!(distance > 0.0f)) distance = 0.0f;
+    unsigned int distanceBits = 0;
+    memcpy(&distanceBits, &distance, sizeof(float));
+
+    unsigned long long materialHash = ((unsigned long long)(size_t)material.maps*0x9E3779B97F4A7C15ULL) >> (64 - RENDER_QUEUE_MATERIAL_BITS);
+    unsigned long long key = (unsigned long long)(material.shader.id & 0xfff);
+    key = (key << RENDER_QUEUE_MATERIAL_BITS) | materialHash;
+    key = (key << RENDER_QUEUE_MESH_BITS) | (vaoId & ((1 << RENDER_QUEUE_MESH_BITS) - 1));
+    key = (key << RENDER_QUEUE_DEPTH_BITS) | (distanceBits >> (31 - RENDER_QUEUE_DEPTH_BITS));
+    return key;
+}
+
+static void FlushRenderQueue(void)
+{
+    if (r3dRenderQueue.count == 0) return;
+
+    RadixSortKeys(r3dRenderQueue.keys, r3dRenderQueue.sortKeys, r3dRenderQueue.order, r3dRenderQueue.sortOrder, r3dRenderQueue.count);
+
+    Matrix viewProj = MatrixMultiply(r3dRenderQueue.view, r3dRenderQueue.projection);
+    R3DRenderQueueStats* stats = &r3dRenderQueue.stats;
+
+    // Bound state is only trusted within a flush, the code in between may change it
+    unsigned int program = 0;
+    const MaterialMap* maps = NULL;
+    unsigned int vao = 0;
+    unsigned int textures[MAX_MATERIAL_MAPS] = { 0 };
+
+    for (int i = 0; i < r3dRenderQueue.count; i++)
+    {
+        const RenderQueueDraw* draw = &r3dRenderQueue.draws[r3dRenderQueue.order[i]];
+        const Material* material = &draw->material;
+        int* locs = material->shader.locs;
+        bool programChanged = (material->shader.id != program);
+
+        if (programChanged)
+        {
+            glUseProgram(material->shader.id);
+            program = material->shader.id;
+            stats->shaderBinds++;
+
+            if (locs[SHADER_LOC_MATRIX_VIEW] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_VIEW], 1, false, MatrixToFloat(r3dRenderQueue.view));
+            if (locs[SHADER_LOC_MATRIX_PROJECTION] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_PROJECTION], 1, false, MatrixToFloat(r3dRenderQueue.projection));
+        }
+        else stats->shaderBindsAvoided++;
+
+        // Texture binds follow DrawMesh(), each map on the unit of its map
+        for (int m = 0; m < MAX_MATERIAL_MAPS; m++)
+        {
+            unsigned int id = material->maps[m].texture.id;
+            if (id == 0) continue;
+
+            if (textures[m] != id)
+            {
+                glActiveTexture(GL_TEXTURE0 + m);
+                bool cubemap = (m == MATERIAL_MAP_CUBEMAP) || (m == MATERIAL_MAP_IRRADIANCE) || (m == MATERIAL_MAP_PREFILTER);
+                glBindTexture(cubemap? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, id);
+                textures[m] = id;
+                stats->textureBinds++;
+            }
+            else stats->textureBindsAvoided++;
+
+            if ((programChanged || (material->maps != maps)) && (locs[SHADER_LOC_MAP_ALBEDO + m] != -1)) glUniform1i(locs[SHADER_LOC_MAP_ALBEDO + m], m);
+        }
+
+        if (programChanged || (material->maps != maps))
+        {
+            int specularLoc = locs[SHADER_LOC_COLOR_SPECULAR];
+            Color specular = material->maps[MATERIAL_MAP_SPECULAR].color;
+            if (specularLoc != -1) glUniform4f(specularLoc, specular.r/255.0f, specular.g/255.0f, specular.b/255.0f, specular.a/255.0f);
+            float emission[4];
+            GetMaterialEmissionColor(*material, emission);
+            if (locs[SHADER_LOC_COLOR_EMISSION] != -1) glUniform4fv(locs[SHADER_LOC_COLOR_EMISSION], 1, emission);
+            maps = material->maps;
+        }
+
+        int diffuseLoc = locs[SHADER_LOC_COLOR_DIFFUSE];
+        Color diffuse = material->maps[MATERIAL_MAP_DIFFUSE].color;
+        if (diffuseLoc != -1) glUniform4f(diffuseLoc, diffuse.r*draw->tint.r/65025.0f, diffuse.g*draw->tint.g/65025.0f, diffuse.b*draw->tint.b/65025.0f, diffuse.a*draw->tint.a/65025.0f);
+
+        if (locs[SHADER_LOC_MATRIX_MVP] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_MVP], 1, false, MatrixToFloat(MatrixMultiply(draw->transform, viewProj)));
+        if (locs[SHADER_LOC_MATRIX_MODEL] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_MODEL], 1, false, MatrixToFloat(draw->transform));
+        if (locs[SHADER_LOC_MATRIX_NORMAL] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_NORMAL], 1, false, MatrixToFloat(MatrixTranspose(MatrixInvert(draw->transform))));
+
+        if (draw->vaoId != vao)
+        {
+            glBindVertexArray(draw->vaoId);
+            vao = draw->vaoId;
+            stats->vaoBinds++;
+        }
+        else stats->vaoBindsAvoided++;
+
+        if (draw->indexed) glDrawElements(GL_TRIANGLES, draw->triangleCount*3, GL_UNSIGNED_SHORT, 0);
+        else glDrawArrays(GL_TRIANGLES, 0, draw->vertexCount);
+        stats->draws++;
+    }
+
+    glBindVertexArray(0);
+    for (int m = 0; m < MAX_MATERIAL_MAPS; m++)
+    {
+        if (textures[m] == 0) continue;
+
+        glActiveTexture(GL_TEXTURE0 + m);
+        bool cubemap = (m == MATERIAL_MAP_CUBEMAP) || (m == MATERIAL_MAP_IRRADIANCE) || (m == MATERIAL_MAP_PREFILTER);
+        glBindTexture(cubemap? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(0);
+
+    r3dRenderQueue.count = 0;
+}
+
+static void QueueMeshDraw(Mesh mesh, Material material, Matrix transform, Color tint)
+{
+    // Draws under another camera (a second BeginMode3D()) are not sorted with the previous ones
+    Matrix view = rlGetMatrixModelview();
+    Matrix projection = rlGetMatrixProjection();
+    if ((r3dRenderQueue.count > 0) && ((memcmp(&view, &r3dRenderQueue.view, sizeof(Matrix)) != 0) || (memcmp(&projection, &r3dRenderQueue.projection, sizeof(Matrix)) != 0)))
+    {
+        rlDrawRenderBatchActive();
+        FlushRenderQueue();
+    }
+    r3dRenderQueue.view = view;
+    r3dRenderQueue.projection = projection;
+
+    if (r3dRenderQueue.count == r3dRenderQueue.capacity)
+    {
+        // Only the queued draws and their keys are kept, the sort buffers are filled by each flush
+        int capacity = (r3dRenderQueue.capacity > 0)? r3dRenderQueue.capacity*2 : 256;
+        RenderQueueDraw* draws = (RenderQueueDraw*)R3D_MALLOC(capacity*sizeof(RenderQueueDraw));
+        unsigned long long* keys = (unsigned long long*)R3D_MALLOC(capacity*sizeof(unsigned long long));
+        if (r3dRenderQueue.count > 0)
+        {
+            memcpy(draws, r3dRenderQueue.draws, r3dRenderQueue.count*sizeof(RenderQueueDraw));
+            memcpy(keys, r3dRenderQueue.keys, r3dRenderQueue.count*sizeof(unsigned long long));
+        }
+        R3D_FREE(r3dRenderQueue.draws);
+        R3D_FREE(r3dRenderQueue.keys);
+        R3D_FREE(r3dRenderQueue.sortKeys);
+        R3D_FREE(r3dRenderQueue.order);
+        R3D_FREE(r3dRenderQueue.sortOrder);
+
+        r3dRenderQueue.draws = draws;
+        r3dRenderQueue.keys = keys;
+        r3dRenderQueue.sortKeys = (unsigned long long*)R3D_MALLOC(capacity*sizeof(unsigned long long));
+        r3dRenderQueue.order = (unsigned int*)R3D_MALLOC(capacity*sizeof(unsigned int));
+        r3dRenderQueue.sortOrder = (unsigned int*)R3D_MALLOC(capacity*sizeof(unsigned int));
+        r3dRenderQueue.capacity = capacity;
+    }
+
+    // The rlgl transform (rlPushMatrix()..) applies after the mesh transform, like DrawMesh()
+    RenderQueueDraw* draw = &r3dRenderQueue.draws[r3dRenderQueue.count];
+    draw->transform = MatrixMultiply(transform, rlGetMatrixTransform());
+    draw->material = material;
+    draw->tint = tint;
+    draw->vaoId = mesh.vaoId;
+    draw->vertexCount = mesh.vertexCount;
+    draw->triangleCount = mesh.triangleCount;
+    draw->indexed = (mesh.indices != NULL);
+
+    // Front to back within the same state
+    Vector3 center = { draw->transform.m12, draw->transform.m13, draw->transform.m14 };
+    r3dRenderQueue.keys[r3dRenderQueue.count] = GetRenderQueueKey(material, mesh.vaoId, -Vector3Transform(center, view).z);
+    r3dRenderQueue.count++;
+
+    // Outside of deferred mode there is nothing to flush the queue later
+    if (!r3dRenderQueue.active)
+    {
+        rlDrawRenderBatchActive();
+        FlushRenderQueue();
+    }
+}
+
+R3DDEF void DrawMeshQueued(Mesh mesh, Material material, Matrix transform)
+{
+    QueueMeshDraw(mesh, material, transform, WHITE);
+}
+
+R3DDEF void DrawModelQueued(Model model, Vector3 position, float scale, Color tint)
+{
+    Matrix transform = MatrixMultiply(model.transform, MatrixMultiply(MatrixScale(scale, scale, scale), MatrixTranslate(position.x, position.y, position.z)));
+
+    for (int i = 0; i < model.meshCount; i++) QueueMeshDraw(model.meshes[i], model.materials[model.meshMaterial[i]], transform, tint);
+}
+
+R3DDEF R3DRenderQueueStats GetRenderQueueStats(void)
+{
+    return r3dRenderQueue.stats;
+}
+
+// Draw list batch, consecutive draws sharing a shader and a material
+typedef struct DrawListBatch {
+    unsigned int program;            // 0 when the previous batch has the same program
+    int mvpLoc;
+    int modelLoc;
+    int normalLoc;
+    int viewLoc;
+    int projectionLoc;
+    int diffuseLoc;
+    int specularLoc;
+    int emissionLoc;
+    float diffuse[4];
+    float specular[4];
+    float emission[4];
+    int samplerCount;                // Sampler uniforms of the material maps
+    int samplerLocs[MAX_MATERIAL_MAPS];
+    int samplerUnits[MAX_MATERIAL_MAPS];
+    int textureCount;                // Texture binds, only the units that change from the previous batch
+    unsigned int textureUnits[MAX_MATERIAL_MAPS];
+    unsigned int textureTargets[MAX_MATERIAL_MAPS];
+    unsigned int textureIds[MAX_MATERIAL_MAPS];
+    int firstDraw;
+    int drawCount;
+} DrawListBatch;
+
+typedef struct DrawListDraw {
+    Matrix transform;
+    float model[16];                 // Transform and normal matrix, as uploaded
+    float normal[16];
+    unsigned int vaoId;              // 0 when the previous draw has the same vertex array
+    int elementCount;
+    bool indexed;
+} DrawListDraw;
+
+typedef struct DrawListData {
+    RenderQueueDraw* recorded;       // Draws as added, with the render queue layout
+    int capacity;
+    DrawListBatch* batches;
+    DrawListDraw* draws;
+    unsigned int usedUnits;          // Texture units bound by a replay, unbound after it
+} DrawListData;
+
+R3DDEF R3DDrawList LoadDrawList(void)
+{
+    R3DDrawList list = { 0 };
+    list.data = R3D_CALLOC(1, sizeof(DrawListData));
+    return list;
+}
+
+R3DDEF void UnloadDrawList(R3DDrawList list)
+{
+    DrawListData* data = (DrawListData*)list.data;
+    if (data == NULL) return;
+
+    R3D_FREE(data->recorded);
+    R3D_FREE(data->batches);
+    R3D_FREE(data->draws);
+    R3D_FREE(data);
+}
+
+R3DDEF void AddDrawListMesh(R3DDrawList* list, Mesh mesh, Material material, Matrix transform)
+{
+    DrawListData* data = (DrawListData*)list->data;
+
+    if (list->count == data->capacity)
+    {
+        int capacity = (data->capacity > 0)? data->capacity*2 : 64;
+        RenderQueueDraw* recorded = (RenderQueueDraw*)R3D_MALLOC(capacity*sizeof(RenderQueueDraw));
+        if (list->count > 0) memcpy(recorded, data->recorded, list->count*sizeof(RenderQueueDraw));
+        R3D_FREE(data->recorded);
+        data->recorded = recorded;
+        data->capacity = capacity;
+    }
+
+    RenderQueueDraw* draw = &data->recorded[list->count];
+    draw->transform = transform;
+    draw->material = material;
+    draw->tint = WHITE;
+    draw->vaoId = mesh.vaoId;
+    draw->vertexCount = mesh.vertexCount;
+    draw->triangleCount = mesh.triangleCount;
+    draw->indexed = (mesh.indices != NULL);
+
+    list->count++;
+    list->dirty = true;
+}
+
+R3DDEF void AddDrawListModel(R3DDrawList* list, Model model, Matrix transform)
+{
+    Matrix modelTransform = MatrixMultiply(model.transform, transform);
+    for (int i = 0; i < model.meshCount; i++) AddDrawListMesh(list, model.meshes[i], model.materials[model.meshMaterial[i]], modelTransform);
+}
+
+R3DDEF void ClearDrawList(R3DDrawList* list)
+{
+    list->count = 0;
+    list->dirty = true;
+}
+
+R3DDEF void InvalidateDrawList(R3DDrawList* list)
+{
+    list->dirty = true;
+}
+
+// Sorts the draws by state like the render queue (keeping the recording order otherwise) and resolves what each
+// batch and draw has to set, the binds a replay would repeat are dropped here
+static void BuildDrawList(R3DDrawList* list)
+{
+    DrawListData* data = (DrawListData*)list->data;
+    int count = list->count;
+
+    R3D_FREE(data->batches);
+    R3D_FREE(data->draws);
+    data->batches = (DrawListBatch*)R3D_CALLOC((count > 0)? count : 1, sizeof(DrawListBatch));
+    data->draws = (DrawListDraw*)R3D_CALLOC((count > 0)? count : 1, sizeof(DrawListDraw));
+    data->usedUnits = 0;
+    list->batchCount = 0;
+    list->dirty = false;
+    if (count == 0) return;
+
+    unsigned long long* keys = (unsigned long long*)R3D_MALLOC(2*count*sizeof(unsigned long long));
+    unsigned int* order = (unsigned int*)R3D_MALLOC(2*count*sizeof(unsigned int));
+    for (int i = 0; i < count; i++) keys[i] = GetRenderQueueKey(data->recorded[i].material, data->recorded[i].vaoId, 0.0f);
+    RadixSortKeys(keys, keys + count, order, order + count, count);
+
+    unsigned int program = 0;
+    const MaterialMap* maps = NULL;
+    unsigned int vao = 0;
+    unsigned int textures[MAX_MATERIAL_MAPS] = { 0 };
+    DrawListBatch* batch = NULL;
+
+    for (int i = 0; i < count; i++)
+    {
+        const RenderQueueDraw* recorded = &data->recorded[order[i]];
+        const Material* material = &recorded->material;
+        const int* locs = material->shader.locs;
+
+        if ((batch == NULL) || (material->shader.id != program) || (material->maps != maps))
+        {
+            batch = &data->batches[list->batchCount++];
+            batch->program = (material->shader.id != program)? material->shader.id : 0;
+            batch->mvpLoc = locs[SHADER_LOC_MATRIX_MVP];
+            batch->modelLoc = locs[SHADER_LOC_MATRIX_MODEL];
+            batch->normalLoc = locs[SHADER_LOC_MATRIX_NORMAL];
+            batch->viewLoc = locs[SHADER_LOC_MATRIX_VIEW];
+            batch->projectionLoc = locs[SHADER_LOC_MATRIX_PROJECTION];
+            batch->diffuseLoc = locs[SHADER_LOC_COLOR_DIFFUSE];
+            batch->specularLoc = locs[SHADER_LOC_COLOR_SPECULAR];
+            Color diffuse = material->maps[MATERIAL_MAP_DIFFUSE].color;
+            Color specular = material->maps[MATERIAL_MAP_SPECULAR].color;
+            batch->diffuse[0] = diffuse.r/255.0f; batch->diffuse[1] = diffuse.g/255.0f; batch->diffuse[2] = diffuse.b/255.0f; batch->diffuse[3] = diffuse.a/255.0f;
+            batch->specular[0] = specular.r/255.0f; batch->specular[1] = specular.g/255.0f; batch->specular[2] = specular.b/255.0f; batch->specular[3] = specular.a/255.0f;
+            batch->emissionLoc = locs[SHADER_LOC_COLOR_EMISSION];
+            GetMaterialEmissionColor(*material, batch->emission);
+
+            for (int m = 0; m < MAX_MATERIAL_MAPS; m++)
+            {
+                unsigned int id = material->maps[m].texture.id;
+                if (id == 0) continue;
+
+                if (locs[SHADER_LOC_MAP_ALBEDO + m] != -1)
+                {
+                    batch->samplerLocs[batch->samplerCount] = locs[SHADER_LOC_MAP_ALBEDO + m];
+                    batch->samplerUnits[batch->samplerCount] = m;
+                    batch->samplerCount++;
+                }
+                if (textures[m] != id)
+                {
+                    bool cubemap = (m == MATERIAL_MAP_CUBEMAP) || (m == MATERIAL_MAP_IRRADIANCE) || (m == MATERIAL_MAP_PREFILTER);
+                    batch->textureUnits[batch->textureCount] = m;
+                    batch->textureTargets[batch->textureCount] = cubemap? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+                    batch->textureIds[batch->textureCount] = id;
+                    batch->textureCount++;
+                    textures[m] = id;
+                    data->usedUnits |= 1u << m;
+                }
+            }
+
+            batch->firstDraw = i;
+            program = material->shader.id;
+            maps = material->maps;
+        }
+
+        DrawListDraw* draw = &data->draws[i];
+        draw->transform = recorded->transform;
+        memcpy(draw->model, MatrixToFloat(recorded->transform), sizeof(draw->model));
+        if (batch->normalLoc != -1) memcpy(draw->normal, MatrixToFloat(MatrixTranspose(MatrixInvert(recorded->transform))), sizeof(draw->normal));
+        draw->vaoId = (recorded->vaoId != vao)? recorded->vaoId : 0;
+        draw->indexed = recorded->indexed;
+        draw->elementCount = recorded->indexed? recorded->triangleCount*3 : recorded->vertexCount;
+        vao = recorded->vaoId;
+        batch->drawCount++;
+    }
+
+    R3D_FREE(keys);
+    R3D_FREE(order);
+}
+
+R3DDEF void ReplayDrawList(R3DDrawList* list)
+{
+    DrawListData* data = (DrawListData*)list->data;
+    if (list->dirty) BuildDrawList(list);
+    if (list->batchCount == 0) return;
+
+    rlDrawRenderBatchActive();
+
+    Matrix view = rlGetMatrixModelview();
+    Matrix projection = rlGetMatrixProjection();
+    Matrix viewProj = MatrixMultiply(view, projection);
+
+    for (int b = 0; b < list->batchCount; b++)
+    {
+        const DrawListBatch* batch = &data->batches[b];
+
+        if (batch->program != 0)
+        {
+            glUseProgram(batch->program);
+            if (batch->viewLoc != -1) glUniformMatrix4fv(batch->viewLoc, 1, false, MatrixToFloat(view));
+            if (batch->projectionLoc != -1) glUniformMatrix4fv(batch->projectionLoc, 1, false, MatrixToFloat(projection));
+        }
+        if (batch->diffuseLoc != -1) glUniform4fv(batch->diffuseLoc, 1, batch->diffuse);
+        if (batch->specularLoc != -1) glUniform4fv(batch->specularLoc, 1, batch->specular);
+        if (batch->emissionLoc != -1) glUniform4fv(batch->emissionLoc, 1, batch->emission);
+        for (int i = 0; i < batch->samplerCount; i++) glUniform1i(batch->samplerLocs[i], batch->samplerUnits[i]);
+        for (int i = 0; i < batch->textureCount; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + batch->textureUnits[i]);
+            glBindTexture(batch->textureTargets[i], batch->textureIds[i]);
+        }
+
+        for (int i = batch->firstDraw; i < batch->firstDraw + batch->drawCount; i++)
+        {
+            const DrawListDraw* draw = &data->draws[i];
+
+            if (batch->mvpLoc != -1) glUniformMatrix4fv(batch->mvpLoc, 1, false, MatrixToFloat(MatrixMultiply(draw->transform, viewProj)));
+            if (batch->modelLoc != -1) glUniformMatrix4fv(batch->modelLoc, 1, false, draw->model);
+            if (batch->normalLoc != -1) glUniformMatrix4fv(batch->normalLoc, 1, false, draw->normal);
+            if (draw->vaoId != 0) glBindVertexArray(draw->vaoId);
+
+            if (draw->indexed) glDrawElements(GL_TRIANGLES, draw->elementCount, GL_UNSIGNED_SHORT, 0);
+            else glDrawArrays(GL_TRIANGLES, 0, draw->elementCount);
+        }
+    }
+
+    glBindVertexArray(0);
+    for (int m = 0; m < MAX_MATERIAL_MAPS; m++)
+    {
+        if ((data->usedUnits & (1u << m)) == 0) continue;
+
+        glActiveTexture(GL_TEXTURE0 + m);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(0);
+}
+
+R3DDEF void BeginDeferredMode(GBuffer gbuffer)
+{
+    rlDrawRenderBatchActive();
+    BeginProfilerPass(PROFILER_PASS_GBUFFER);
+    memset(&r3dRenderQueue.stats, 0, sizeof(R3DRenderQueueStats));
+    r3dRenderQueue.active = true;
+    rlEnableFramebuffer(gbuffer.id);
+    rlClearScreenBuffers();
+
+    rlViewport(0, 0, gbuffer.viewportWidth, gbuffer.viewportHeight);
+
+    rlMatrixMode(RL_PROJECTION);
+    rlLoadIdentity();
+
+    rlOrtho(0, gbuffer.viewportWidth, gbuffer.viewportHeight, 0, 0, 1);
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+
+    // Materials without an emission map leave its unit empty, emission is sampled black instead of a stale texture
+    glActiveTexture(GL_TEXTURE0 + MATERIAL_MAP_EMISSION);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glDisable(GL_BLEND);
+}
+
+R3DDEF void EndDeferredMode()
+{
+    rlDrawRenderBatchActive();
+    FlushRenderQueue();
+    r3dRenderQueue.active = false;
+
+    glEnable(GL_BLEND);
+    rlDrawRenderBatchActive();
+    EndProfilerPass(PROFILER_PASS_GBUFFER);
+
+    rlDisableFramebuffer();
+
+    rlViewport(0, 0, GetScreenWidth(), GetScreenHeight());
+
+    rlMatrixMode(RL_PROJECTION);
+    rlLoadIdentity();
+
+    rlOrtho(0, GetScreenWidth(), GetScreenHeight(), 0, 0, 1);
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+}
+
+R3DDEF void SetDeferredModeShaderTexture(Texture texture, int i)
+{
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+}
+
+R3DDEF void SetGBufferViewport(GBuffer* gbuffer, int width, int height)
+{
+    gbuffer->viewportWidth = (width < 1)? 1 : ((width > gbuffer->width)? gbuffer->width : width);
+    gbuffer->viewportHeight = (height < 1)? 1 : ((height > gbuffer->height)? gbuffer->height : height);
+}
+
+R3DDEF void SetDeferredModeShaderLayout(Shader shader, GBuffer gbuffer)
+{
+    int layoutLoc = GetShaderLocation(shader, "gbufferLayout");
+    if (layoutLoc != -1) SetShaderValue(shader, layoutLoc, &gbuffer.layout, SHADER_UNIFORM_INT);
+
+    // Part of the GBuffer covered by the viewport, the texture coordinates of the viewport are scaled by it
+    int scaleLoc = GetShaderLocation(shader, "gbufferScale");
+    float scale[2] = { (float)gbuffer.viewportWidth/(float)gbuffer.width, (float)gbuffer.viewportHeight/(float)gbuffer.height };
+    if (scaleLoc != -1) SetShaderValue(shader, scaleLoc, scale, SHADER_UNIFORM_VEC2);
+}
+
+// Projection matching BeginMode3D(), needed to move between screen and world space outside of it
+static Matrix GetCameraProjection(Camera camera, float aspect)
+{
+    if (camera.projection == CAMERA_ORTHOGRAPHIC)
+    {
+        double top = camera.fovy/2.0;
+        double right = top*aspect;
+        return MatrixOrtho(-right, right, -top, top, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+    }
+
+    return MatrixPerspective(camera.fovy*DEG2RAD, aspect, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+}
+
+// Aspect ratio used by BeginMode3D(), falls back to the GBuffer size when there is no screen
+static float GetDeferredModeAspect(GBuffer gbuffer)
+{
+    if ((GetScreenWidth() > 0) && (GetScreenHeight() > 0)) return (float)GetScreenWidth()/(float)GetScreenHeight();
+    return (float)gbuffer.width/(float)gbuffer.height;
+}
+
+// View projection matching BeginMode3D() for the given camera
+static Matrix GetDeferredModeViewProjection(GBuffer gbuffer, Camera camera)
+{
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection = GetCameraProjection(camera, GetDeferredModeAspect(gbuffer));
+    return MatrixMultiply(view, projection);
+}
+
+R3DDEF void SetDeferredModeShaderCamera(Shader shader, GBuffer gbuffer, Camera camera)
+{
+    int viewPosLoc = GetShaderLocation(shader, "viewpos");
+    if (viewPosLoc != -1) SetShaderValue(shader, viewPosLoc, &camera.position, SHADER_UNIFORM_VEC3);
+
+    // Used to rebuild the world position from GBuffer depth
+    int invViewProjLoc = GetShaderLocation(shader, "invViewProj");
+    if (invViewProjLoc != -1) SetShaderValueMatrix(shader, invViewProjLoc, MatrixInvert(GetDeferredModeViewProjection(gbuffer, camera)));
+
+    SetDeferredModeShaderLayout(shader, gbuffer);
+}
+
+R3DDEF void SetDeferredModeShaderMotion(Shader shader, GBuffer gbuffer, Camera previousCamera)
+{
+    int prevViewProjLoc = GetShaderLocation(shader, "prevViewProj");
+    if (prevViewProjLoc != -1) SetShaderValueMatrix(shader, prevViewProjLoc, GetDeferredModeViewProjection(gbuffer, previousCamera));
+}
+
+// Per instance data streamed by DrawModelInstancedDeferred(): world matrix (instanceTransform, locations 8 to 11)
+// then normal matrix (instanceNormal, locations 12 to 14), so the vertex shader does not invert a matrix per vertex
+#define DEFERRED_INSTANCE_FLOATS 25
+#define DEFERRED_INSTANCE_JOB_SIZE 1024     // Instances prepared per job
+
+static struct {
+    unsigned int vbo;
+    int capacity;                    // Instances the buffer and the staging memory hold
+    float* staging;
+} r3dInstances = { 0 };
+
+typedef struct DeferredInstanceJob {
+    Matrix base;                     // Model transform and the current rlgl transform, applied before each instance
+    const Matrix* transforms;
+    int count;
+} DeferredInstanceJob;
+
+static void PrepareDeferredInstances(void* data, int index)
+{
+    DeferredInstanceJob* job = (DeferredInstanceJob*)data;
+    int first = index*DEFERRED_INSTANCE_JOB_SIZE;
+    int last = (first + DEFERRED_INSTANCE_JOB_SIZE < job->count)? first + DEFERRED_INSTANCE_JOB_SIZE : job->count;
+
+    for (int i = first; i < last; i++)
+    {
+        Matrix m = MatrixMultiply(job->base, job->transforms[i]);
+        float* out = r3dInstances.staging + i*DEFERRED_INSTANCE_FLOATS;
+        out[0] = m.m0; out[1] = m.m1; out[2] = m.m2; out[3] = m.m3;
+        out[4] = m.m4; out[5] = m.m5; out[6] = m.m6; out[7] = m.m7;
+        out[8] = m.m8; out[9] = m.m9; out[10] = m.m10; out[11] = m.m11;
+        out[12] = m.m12; out[13] = m.m13; out[14] = m.m14; out[15] = m.m15;
+
+        // Inverse transpose of the upper 3x3 from the cross products of its columns
+        Vector3 a = { m.m0, m.m1, m.m2 };
+        Vector3 b = { m.m4, m.m5, m.m6 };
+        Vector3 c = { m.m8, m.m9, m.m10 };
+        Vector3 bc = Vector3CrossProduct(b, c);
+        Vector3 ca = Vector3CrossProduct(c, a);
+        Vector3 ab = Vector3CrossProduct(a, b);
+        float det = Vector3DotProduct(a, bc);
+        float scale = (det != 0.0f)? 1.0f/det : 1.0f;
+        out[16] = bc.x*scale; out[17] = bc.y*scale; out[18] = bc.z*scale;
+        out[19] = ca.x*scale; out[20] = ca.y*scale; out[21] = ca.z*scale;
+        out[22] = ab.x*scale; out[23] = ab.y*scale; out[24] = ab.z*scale;
+    }
+}
+
+// Material state set by DrawMesh(): colors, and each map texture on the unit of its map
+static void BindMeshMaterial(Material material)
+{
+    glUseProgram(material.shader.id);
+
+    int diffuseLoc = material.shader.locs[SHADER_LOC_COLOR_DIFFUSE];
+    Color diffuse = material.maps[MATERIAL_MAP_DIFFUSE].color;
+    if (diffuseLoc != -1) glUniform4f(diffuseLoc, diffuse.r/255.0f, diffuse.g/255.0f, diffuse.b/255.0f, diffuse.a/255.0f);
+    int specularLoc = material.shader.locs[SHADER_LOC_COLOR_SPECULAR];
+    Color specular = material.maps[MATERIAL_MAP_SPECULAR].color;
+    if (specularLoc != -1) glUniform4f(specularLoc, specular.r/255.0f, specular.g/255.0f, specular.b/255.0f, specular.a/255.0f);
+    float emission[4];
+    GetMaterialEmissionColor(material, emission);
+    if (material.shader.locs[SHADER_LOC_COLOR_EMISSION] != -1) glUniform4fv(material.shader.locs[SHADER_LOC_COLOR_EMISSION], 1, emission);
+
+    for (int i = 0; i < MAX_MATERIAL_MAPS; i++)
+    {
+        if (material.maps[i].texture.id == 0) continue;
+
+        glActiveTexture(GL_TEXTURE0 + i);
+        bool cubemap = (i == MATERIAL_MAP_CUBEMAP) || (i == MATERIAL_MAP_IRRADIANCE) || (i == MATERIAL_MAP_PREFILTER);
+        glBindTexture(cubemap? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, material.maps[i].texture.id);
+        if (material.shader.locs[SHADER_LOC_MAP_ALBEDO + i] != -1) glUniform1i(material.shader.locs[SHADER_LOC_MAP_ALBEDO + i], i);
+    }
+}
+
+static void UnbindMeshMaterial(Material material)
+{
+    for (int i = 0; i < MAX_MATERIAL_MAPS; i++)
+    {
+        if (material.maps[i].texture.id == 0) continue;
+
+        glActiveTexture(GL_TEXTURE0 + i);
+        bool cubemap = (i == MATERIAL_MAP_CUBEMAP) || (i == MATERIAL_MAP_IRRADIANCE) || (i == MATERIAL_MAP_PREFILTER);
+        glBindTexture(cubemap? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Uploads the matrices of DrawMesh() to the bound shader, the rlgl transform (rlPushMatrix()..) applies after the mesh transform
+static void SetMeshDrawMatrices(Shader shader, Matrix transform)
+{
+    Matrix model = MatrixMultiply(transform, rlGetMatrixTransform());
+    Matrix view = rlGetMatrixModelview();
+    Matrix projection = rlGetMatrixProjection();
+
+    int* locs = shader.locs;
+    if (locs[SHADER_LOC_MATRIX_MVP] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_MVP], 1, false, MatrixToFloat(MatrixMultiply(MatrixMultiply(model, view), projection)));
+    if (locs[SHADER_LOC_MATRIX_VIEW] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_VIEW], 1, false, MatrixToFloat(view));
+    if (locs[SHADER_LOC_MATRIX_PROJECTION] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_PROJECTION], 1, false, MatrixToFloat(projection));
+    if (locs[SHADER_LOC_MATRIX_MODEL] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_MODEL], 1, false, MatrixToFloat(model));
+    if (locs[SHADER_LOC_MATRIX_NORMAL] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_NORMAL], 1, false, MatrixToFloat(MatrixTranspose(MatrixInvert(model))));
+}
+
+// Instanced draw of a detail level of the model meshes, meshes with fewer levels draw their last one
+static void DrawModelInstancedLevel(Model model, const Matrix* transforms, int count, int lod)
+{
+    if ((count <= 0) || (transforms == NULL)) return;
+
+    // A shader without the instance attributes would draw every instance at the model transform
+    for (int m = 0; m < model.meshCount; m++)
+    {
+        unsigned int shader = model.materials[model.meshMaterial[m]].shader.id;
+        if (glGetAttribLocation(shader, "instanceTransform") == -1)
+        {
+            TraceLog(LOG_WARNING, "SHADER: [ID %i] Instanced draws need the SHADER_FEATURE_INSTANCING variant, model not drawn", shader);
+            return;
+        }
+    }
+
+    rlDrawRenderBatchActive();
+
+    if (count > r3dInstances.capacity)
+    {
+        // Grown to the next power of two so a slowly rising count does not reallocate every frame
+        int capacity = 256;
+        while (capacity < count) capacity *= 2;
+
+        if (r3dInstances.vbo == 0) glGenBuffers(1, &r3dInstances.vbo);
+        R3D_FREE(r3dInstances.staging);
+        r3dInstances.staging = (float*)R3D_MALLOC(capacity*DEFERRED_INSTANCE_FLOATS*sizeof(float));
+        r3dInstances.capacity = capacity;
+    }
+
+    // Model transform and the rlgl transform (rlPushMatrix()..) apply before the instance transforms, like DrawModel()
+    DeferredInstanceJob job = { 0 };
+    job.base = MatrixMultiply(model.transform, rlGetMatrixTransform());
+    job.transforms = transforms;
+    job.count = count;
+    ParallelFor((count + DEFERRED_INSTANCE_JOB_SIZE - 1)/DEFERRED_INSTANCE_JOB_SIZE, PrepareDeferredInstances, &job);
+
+    // Orphaned first, so the driver does not wait on draws still reading the previous contents
+    int stride = DEFERRED_INSTANCE_FLOATS*sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, r3dInstances.vbo);
+    glBufferData(GL_ARRAY_BUFFER, r3dInstances.capacity*stride, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count*stride, r3dInstances.staging);
+
+    // World space is in the instance data, the model matrix is left as identity
+    Matrix view = rlGetMatrixModelview();
+    Matrix projection = rlGetMatrixProjection();
+    Matrix viewProj = MatrixMultiply(view, projection);
+    Matrix identity = MatrixIdentity();
+
+    for (int m = 0; m < model.meshCount; m++)
+    {
+        Mesh mesh = model.meshes[m];
+        Material material = model.materials[model.meshMaterial[m]];
+        BindMeshMaterial(material);
+
+        int* locs = material.shader.locs;
+        if (locs[SHADER_LOC_MATRIX_MVP] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_MVP], 1, false, MatrixToFloat(viewProj));
+        if (locs[SHADER_LOC_MATRIX_VIEW] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_VIEW], 1, false, MatrixToFloat(view));
+        if (locs[SHADER_LOC_MATRIX_PROJECTION] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_PROJECTION], 1, false, MatrixToFloat(projection));
+        if (locs[SHADER_LOC_MATRIX_MODEL] != -1) glUniformMatrix4fv(locs[SHADER_LOC_MATRIX_MODEL], 1, false, MatrixToFloat(identity));
+
+        // The instance attributes are added to the mesh vertex array for this draw only
+        glBindVertexArray(mesh.vaoId);
+        glBindBuffer(GL_ARRAY_BUFFER, r3dInstances.vbo);
+        for (int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(8 + i);
+            glVertexAttribPointer(8 + i, 4, GL_FLOAT, GL_FALSE, stride, (void*)(i*4*sizeof(float)));
+            glVertexAttribDivisor(8 + i, 1);
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            glEnableVertexAttribArray(12 + i);
+            glVertexAttribPointer(12 + i, 3, GL_FLOAT, GL_FALSE, stride, (void*)((16 + i*3)*sizeof(float)));
+            glVertexAttribDivisor(12 + i, 1);
+        }
+
+        R3DMeshLods lods = GetMeshLods(mesh);
+        int level = (lod < lods.count)? lod : lods.count - 1;
+        if (mesh.indices != NULL) glDrawElementsInstanced(GL_TRIANGLES, lods.indexCount[level], GL_UNSIGNED_SHORT, (void*)(lods.indexOffset[level]*sizeof(unsigned short)), count);
+        else glDrawArraysInstanced(GL_TRIANGLES, 0, mesh.vertexCount, count);
+
+        for (int i = 8; i < 15; i++)
+        {
+            glVertexAttribDivisor(i, 0);
+            glDisableVertexAttribArray(i);
+        }
+        glBindVertexArray(0);
+
+        UnbindMeshMaterial(material);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+}
+
+R3DDEF void DrawModelInstancedDeferred(Model model, const Matrix* transforms, int count)
+{
+    DrawModelInstancedLevel(model, transforms, count, 0);
+}
+
+#define DYNAMIC_RESOLUTION_STEP 0.02f // Smallest scale change applied, keeps the viewport from changing every frame
+
+typedef struct DynamicResolutionData {
+    unsigned int queries[DYNAMIC_RESOLUTION_QUERIES];
+    float queryScales[DYNAMIC_RESOLUTION_QUERIES]; // Scale each query was measured at
+    int first;                                     // Oldest query waiting for its result
+    int pending;                                   // Queries waiting for their result
+    bool timing;                                   // A query is running (between Begin/EndDynamicResolution)
+} DynamicResolutionData;
+
+// GBuffer size for a window size, at the maximum scale and rounded up to whole buckets
+static int GetDynamicResolutionTargetSize(int size, float maxScale)
+{
+    int scaled = (int)ceilf((float)size*maxScale);
+    return ((scaled + DYNAMIC_RESOLUTION_BUCKET - 1)/DYNAMIC_RESOLUTION_BUCKET)*DYNAMIC_RESOLUTION_BUCKET;
+}
+
+R3DDEF R3DDynamicResolution LoadDynamicResolution(const GBufferAttachmentDesc* descs, int count, float targetTime)
+{
+    R3DDynamicResolution dr = { 0 };
+    dr.displayWidth = GetScreenWidth();
+    dr.displayHeight = GetScreenHeight();
+    dr.scale = 1.0f;
+    dr.minScale = 0.5f;
+    dr.maxScale = 1.0f;
+    dr.targetTime = targetTime;
+
+    dr.gbuffer = LoadGBufferEx(GetDynamicResolutionTargetSize(dr.displayWidth, dr.maxScale), GetDynamicResolutionTargetSize(dr.displayHeight, dr.maxScale), descs, count);
+    SetGBufferViewport(&dr.gbuffer, dr.displayWidth, dr.displayHeight);
+
+    DynamicResolutionData* data = (DynamicResolutionData*)R3D_CALLOC(1, sizeof(DynamicResolutionData));
+    glGenQueries(DYNAMIC_RESOLUTION_QUERIES, data->queries);
+    dr.data = data;
+
+    return dr;
+}
+
+R3DDEF void UnloadDynamicResolution(R3DDynamicResolution dr)
+{
+    DynamicResolutionData* data = (DynamicResolutionData*)dr.data;
+    if (data != NULL)
+    {
+        glDeleteQueries(DYNAMIC_RESOLUTION_QUERIES, data->queries);
+        R3D_FREE(data);
+    }
+    UnloadGBuffer(dr.gbuffer);
+}
+
+R3DDEF void BeginDynamicResolution(R3DDynamicResolution* dr)
+{
+    DynamicResolutionData* data = (DynamicResolutionData*)dr->data;
+
+    // Results arrive a few frames late, only the ones already available are read
+    while (data->pending > 0)
+    {
+        unsigned int query = data->queries[data->first];
+        int available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        dr->gpuTime = (float)((double)elapsed/1000000.0);
+
+        // The cost follows the pixel count, so the scale follows the square root of the time ratio.. the scale drops
+        // quickly to keep the budget and grows back slowly, to avoid bouncing around it
+        if (dr->gpuTime > 0.0f)
+        {
+            float desired = Clamp(data->queryScales[data->first]*sqrtf(dr->targetTime/dr->gpuTime), dr->minScale, dr->maxScale);
+            float rate = (desired < dr->scale)? 0.5f : 0.1f;
+            if (fabsf(desired - dr->scale) >= DYNAMIC_RESOLUTION_STEP) dr->scale += (desired - dr->scale)*rate;
+        }
+
+        data->first = (data->first + 1)%DYNAMIC_RESOLUTION_QUERIES;
+        data->pending--;
+    }
+    dr->scale = Clamp(dr->scale, dr->minScale, dr->maxScale);
+
+    // Window resizes only reallocate the GBuffer when crossing a bucket boundary
+    dr->displayWidth = GetScreenWidth();
+    dr->displayHeight = GetScreenHeight();
+    int width = GetDynamicResolutionTargetSize(dr->displayWidth, dr->maxScale);
+    int height = GetDynamicResolutionTargetSize(dr->displayHeight, dr->maxScale);
+    bool reallocated = (width != dr->gbuffer.width) || (height != dr->gbuffer.height);
+    if (reallocated)
+    {
+        GBuffer previous = dr->gbuffer;
+        dr->gbuffer = LoadGBufferEx(width, height, previous.descs, previous.attachmentCount);
+        UnloadGBuffer(previous);
+        dr->reallocations++;
+    }
+    SetGBufferViewport(&dr->gbuffer, (int)((float)dr->displayWidth*dr->scale + 0.5f), (int)((float)dr->displayHeight*dr->scale + 0.5f));
+
+    // Frames reallocating the GBuffer are not timed, nor frames with every query still in flight (rather than waiting for one)
+    if (!reallocated && (data->pending < DYNAMIC_RESOLUTION_QUERIES))
+    {
+        int next = (data->first + data->pending)%DYNAMIC_RESOLUTION_QUERIES;
+        data->queryScales[next] = dr->scale;
+
+        rlDrawRenderBatchActive();
+        glBeginQuery(GL_TIME_ELAPSED, data->queries[next]);
+        data->timing = true;
+    }
+}
+
+R3DDEF void EndDynamicResolution(R3DDynamicResolution* dr)
+{
+    DynamicResolutionData* data = (DynamicResolutionData*)dr->data;
+    if (!data->timing) return;
+
+    rlDrawRenderBatchActive();
+    glEndQuery(GL_TIME_ELAPSED);
+    data->timing = false;
+    data->pending++;
+}
+#pragma endregion
+
+#pragma region LIGHTING
+#if defined(GRAPHICS_API_OPENGL_43) && !defined(GL_VERSION_4_3)
+// NOTE: The bundled glad profile is GL 3.3, compute entry points are resolved by the raylib GL 4.3 loader
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+GLAPI PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute;
+GLAPI PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier;
+#define glDispatchCompute glad_glDispatchCompute
+#define glMemoryBarrier glad_glMemoryBarrier
+#endif
+
+#define LIGHT_DATA_UNIT 8         // Texture unit of the light data buffer
+#define LIGHT_GRID_UNIT 9         // Texture unit of the tile/cluster light lists buffer
+#define LIGHT_INDEX_UNIT 10       // Texture unit of the light indices buffer
+
+// Expands a define into a string literal, for the constants shared with the shader sources
+#define R3D_STRINGIFY(x) #x
+#define R3D_TO_STRING(x) R3D_STRINGIFY(x)
+
+// Reduces the GBuffer depth of every tile into its min (r) and max (g) depth
+static const char* lightTilesBoundsFS =
+    "#version 330\n"
+    "#define TILE_SIZE " R3D_TO_STRING(LIGHT_TILE_SIZE) "\n"
+    "uniform sampler2D depthbuffer;\n"
+    "out vec2 finalBounds;\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 size = textureSize(depthbuffer, 0);\n"
+    "    ivec2 origin = ivec2(gl_FragCoord.xy)*TILE_SIZE;\n"
+    "    vec2 bounds = vec2(1.0, 0.0);\n"
+    "    for (int y = 0; y < TILE_SIZE; y++) {\n"
+    "        for (int x = 0; x < TILE_SIZE; x++) {\n"
+    "            ivec2 pixel = min(origin + ivec2(x, y), size - 1);\n"
+    "            float depth = texelFetch(depthbuffer, pixel, 0).r;\n"
+    "            bounds = vec2(min(bounds.x, depth), max(bounds.y, depth));\n"
+    "        }\n"
+    "    }\n"
+    "    finalBounds = bounds;\n"
+    "}\n";
+
+#if defined(GRAPHICS_API_OPENGL_43)
+// One work group per tile: reduces the tile depth bounds, then every invocation tests a slice of the lights
+static const char* lightTilesCullCS =
+    "#version 430\n"
+    "#define TILE_SIZE " R3D_TO_STRING(LIGHT_TILE_SIZE) "\n"
+    "#define LIGHT_ATTENUATION_CUTOFF " R3D_TO_STRING(LIGHT_ATTENUATION_CUTOFF) "\n"
+    "layout (local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;\n"
+    "uniform sampler2D depthbuffer;\n"
+    "uniform samplerBuffer lightData;\n"
+    "uniform int lightCount;\n"
+    "uniform int maxLightsPerTile;\n"
+    "uniform mat4 view;\n"
+    "uniform mat4 invProjection;\n"
+    "layout (std430, binding = 0) writeonly buffer TileGrid { uvec2 grid[]; };\n"
+    "layout (std430, binding = 1) writeonly buffer TileIndices { uint indices[]; };\n"
+    "shared uint minDepth;\n"
+    "shared uint maxDepth;\n"
+    "shared uint tileLightCount;\n"
+    "vec3 unproject(vec3 ndc) { vec4 p = invProjection*vec4(ndc, 1.0); return p.xyz/p.w; }\n"
+    "float light_radius(vec3 color, float linear, float quadratic)\n"
+    "{\n"
+    "    float c = 1.0 - max(color.r, max(color.g, color.b))/LIGHT_ATTENUATION_CUTOFF;\n"
+    "    if (c >= 0.0) return 0.0;\n"
+    "    if (quadratic > 0.0) return (-linear + sqrt(linear*linear - 4.0*quadratic*c))/(2.0*quadratic);\n"
+    "    if (linear > 0.0) return -c/linear;\n"
+    "    return 3.402823e38;\n"
+    "}\n"
+    "vec4 make_plane(vec3 a, vec3 b, vec3 c, vec3 inside)\n"
+    "{\n"
+    "    vec3 n = normalize(cross(b - a, c - a));\n"
+    "    vec4 plane = vec4(n, -dot(n, a));\n"
+    "    return (dot(plane.xyz, inside) + plane.w < 0.0)? -plane : plane;\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 size = textureSize(depthbuffer, 0);\n"
+    "    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);\n"
+    "    if (gl_LocalInvocationIndex == 0u) { minDepth = floatBitsToUint(1.0); maxDepth = 0u; tileLightCount = 0u; }\n"
+    "    barrier();\n"
+    "    if (all(lessThan(pixel, size))) {\n"
+    "        uint depth = floatBitsToUint(texelFetch(depthbuffer, pixel, 0).r);\n"
+    "        atomicMin(minDepth, depth);\n"
+    "        atomicMax(maxDepth, depth);\n"
+    "    }\n"
+    "    barrier();\n"
+    "    vec2 ndcMin = vec2(gl_WorkGroupID.xy*uint(TILE_SIZE))/vec2(size)*2.0 - 1.0;\n"
+    "    vec2 ndcMax = min(vec2((gl_WorkGroupID.xy + 1u)*uint(TILE_SIZE))/vec2(size), vec2(1.0))*2.0 - 1.0;\n"
+    "    vec3 n00 = unproject(vec3(ndcMin.x, ndcMin.y, -1.0)); vec3 f00 = unproject(vec3(ndcMin.x, ndcMin.y, 1.0));\n"
+    "    vec3 n10 = unproject(vec3(ndcMax.x, ndcMin.y, -1.0)); vec3 f10 = unproject(vec3(ndcMax.x, ndcMin.y, 1.0));\n"
+    "    vec3 n11 = unproject(vec3(ndcMax.x, ndcMax.y, -1.0)); vec3 f11 = unproject(vec3(ndcMax.x, ndcMax.y, 1.0));\n"
+    "    vec3 n01 = unproject(vec3(ndcMin.x, ndcMax.y, -1.0)); vec3 f01 = unproject(vec3(ndcMin.x, ndcMax.y, 1.0));\n"
+    "    vec3 inside = (n00 + n11 + f00 + f11)*0.25;\n"
+    "    vec4 planes[4];\n"
+    "    planes[0] = make_plane(n00, n01, f00, inside);\n"
+    "    planes[1] = make_plane(n10, n11, f10, inside);\n"
+    "    planes[2] = make_plane(n00, n10, f00, inside);\n"
+    "    planes[3] = make_plane(n01, n11, f01, inside);\n"
+    "    float zNear = unproject(vec3(0.0, 0.0, uintBitsToFloat(minDepth)*2.0 - 1.0)).z;\n"
+    "    float zFar = unproject(vec3(0.0, 0.0, uintBitsToFloat(maxDepth)*2.0 - 1.0)).z;\n"
+    "    uint tile = gl_WorkGroupID.y*gl_NumWorkGroups.x + gl_WorkGroupID.x;\n"
+    "    for (int i = int(gl_LocalInvocationIndex); i < lightCount; i += TILE_SIZE*TILE_SIZE) {\n"
+    "        vec4 positionLinear = texelFetch(lightData, i*2);\n"
+    "        vec4 colorQuadratic = texelFetch(lightData, i*2 + 1);\n"
+    "        float radius = light_radius(colorQuadratic.rgb, positionLinear.w, colorQuadratic.w);\n"
+    "        vec3 center = (view*vec4(positionLinear.xyz, 1.0)).xyz;\n"
+    "        bool visible = (center.z - radius <= zNear) && (center.z + radius >= zFar);\n"
+    "        for (int p = 0; p < 4; p++) visible = visible && (dot(planes[p].xyz, center) + planes[p].w >= -radius);\n"
+    "        if (visible) {\n"
+    "            uint slot = atomicAdd(tileLightCount, 1u);\n"
+    "            if (slot < uint(maxLightsPerTile)) indices[tile*uint(maxLightsPerTile) + slot] = uint(i);\n"
+    "        }\n"
+    "    }\n"
+    "    barrier();\n"
+    "    if (gl_LocalInvocationIndex == 0u) grid[tile] = uvec2(tile*uint(maxLightsPerTile), min(tileLightCount, uint(maxLightsPerTile)));\n"
+    "}\n";
+#endif
+
+// Light tiles scratch memory
+typedef struct LightTilesData {
+    float* lights;          // Light data staging, uploaded to the light buffer
+    float* lightX;          // View space light positions and radius, structure of arrays padded to 4 lights
+    float* lightY;
+    float* lightZ;
+    float* lightRadius;
+    // NOTE: The following are only allocated for CPU culling
+    float* bounds;          // Tile depth bounds read back from the GPU
+    unsigned int* indices;  // Light indices, maxLightsPerTile slots per tile
+    unsigned int* counts;   // Lights per tile
+    unsigned int* grid;     // (offset, count) per tile, uploaded to the grid buffer
+    unsigned int* compact;  // Light indices with no empty slots, uploaded to the index buffer
+    R3DLightTiles* tiles;
+    Matrix invProjection;
+} LightTilesData;
+
+R3DDEF float GetLightRadius(R3DLight light)
+{
+    float intensity = fmaxf(light.color.x, fmaxf(light.color.y, light.color.z));
+    float c = 1.0f - intensity/LIGHT_ATTENUATION_CUTOFF; // Solves: 1/(1 + linear*d + quadratic*d^2) = cutoff/intensity
+
+    if (c >= 0.0f) return 0.0f;
+    if (light.quadratic > 0.0f) return (-light.linear + sqrtf(light.linear*light.linear - 4.0f*light.quadratic*c))/(2.0f*light.quadratic);
+    if (light.linear > 0.0f) return -c/light.linear;
+
+    return FLT_MAX;
+}
+
+// Creates a buffer object and a buffer texture sampling it
+static void LoadLightBuffer(unsigned int* buffer, unsigned int* texture, int size, int internalFormat)
+{
+    glGenBuffers(1, buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+    glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+
+    glGenTextures(1, texture);
+    glBindTexture(GL_TEXTURE_BUFFER, *texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, *buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// Packs the lights into the light data layout and uploads them
+static void UploadLightBuffer(unsigned int buffer, float* staging, const R3DLight* lights, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        // Only point lights are shaded, others are kept black so light indices stay the same
+        Vector3 color = (lights[i].type == LIGHT_POINT)? lights[i].color : Vector3Zero();
+
+        float* light = staging + i*8;
+        light[0] = lights[i].position.x; light[1] = lights[i].position.y; light[2] = lights[i].position.z; light[3] = lights[i].linear;
+        light[4] = color.x; light[5] = color.y; light[6] = color.z; light[7] = lights[i].quadratic;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, count*8*sizeof(float), staging);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+#if defined(GRAPHICS_API_OPENGL_43)
+static unsigned int LoadComputeProgram(const char* code)
+{
+    unsigned int shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+
+    int success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success != GL_TRUE)
+    {
+        char log[1024] = { 0 };
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        TraceLog(LOG_WARNING, "SHADER: [ID %i] Failed to compile compute shader code: %s", shader, log);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success != GL_TRUE)
+    {
+        TraceLog(LOG_WARNING, "SHADER: [ID %i] Failed to link compute shader program", program);
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+#endif
+
+R3DDEF R3DLightTiles LoadLightTiles(int width, int height, int maxLights, int maxLightsPerTile)
+{
+    R3DLightTiles tiles = { 0 };
+    tiles.width = width;
+    tiles.height = height;
+    tiles.tilesX = (width + LIGHT_TILE_SIZE - 1)/LIGHT_TILE_SIZE;
+    tiles.tilesY = (height + LIGHT_TILE_SIZE - 1)/LIGHT_TILE_SIZE;
+    tiles.maxLights = maxLights;
+    tiles.maxLightsPerTile = (maxLightsPerTile > 0)? maxLightsPerTile : LIGHT_TILE_MAX_LIGHTS;
+
+    int tileCount = tiles.tilesX*tiles.tilesY;
+
+    LoadLightBuffer(&tiles.lightBuffer, &tiles.lightTexture, maxLights*8*sizeof(float), GL_RGBA32F);
+    LoadLightBuffer(&tiles.gridBuffer, &tiles.gridTexture, tileCount*2*sizeof(unsigned int), GL_RG32UI);
+    LoadLightBuffer(&tiles.indexBuffer, &tiles.indexTexture, tileCount*tiles.maxLightsPerTile*sizeof(unsigned int), GL_R32UI);
+
+#if defined(GRAPHICS_API_OPENGL_43)
+    tiles.cullProgram = LoadComputeProgram(lightTilesCullCS);
+    tiles.compute = (tiles.cullProgram != 0);
+#endif
+
+    LightTilesData* data = (LightTilesData*)R3D_CALLOC(1, sizeof(LightTilesData));
+    data->lights = (float*)R3D_CALLOC(maxLights*8, sizeof(float));
+
+    if (!tiles.compute)
+    {
+        // Tile depth bounds are reduced on the GPU, then read back for culling
+        tiles.boundsShader = LoadShaderFromMemory(r3dFullscreenVS, lightTilesBoundsFS);
+
+        glGenFramebuffers(1, &tiles.boundsFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, tiles.boundsFramebuffer);
+        tiles.bounds = LoadGBufferTarget(tiles.tilesX, tiles.tilesY, GL_RG32F, GL_RG, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_R32G32B32, GL_COLOR_ATTACHMENT0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        int paddedLights = (maxLights + 3) & ~3;
+        data->lightX = (float*)R3D_CALLOC(paddedLights*4, sizeof(float));
+        data->lightY = data->lightX + paddedLights;
+        data->lightZ = data->lightY + paddedLights;
+        data->lightRadius = data->lightZ + paddedLights;
+        data->bounds = (float*)R3D_MALLOC(tileCount*2*sizeof(float));
+        data->indices = (unsigned int*)R3D_MALLOC(tileCount*tiles.maxLightsPerTile*sizeof(unsigned int));
+        data->counts = (unsigned int*)R3D_MALLOC(tileCount*sizeof(unsigned int));
+        data->grid = (unsigned int*)R3D_MALLOC(tileCount*2*sizeof(unsigned int));
+        data->compact = (unsigned int*)R3D_MALLOC(tileCount*tiles.maxLightsPerTile*sizeof(unsigned int));
+    }
+    tiles.data = data;
+
+    TraceLog(LOG_INFO, "LIGHTING: Light tiles loaded successfully (%i x %i tiles, %s culling)", tiles.tilesX, tiles.tilesY, tiles.compute? "compute" : "CPU");
+
+    return tiles;
+}
+
+R3DDEF void UnloadLightTiles(R3DLightTiles tiles)
+{
+    glDeleteTextures(1, &tiles.lightTexture);
+    glDeleteTextures(1, &tiles.gridTexture);
+    glDeleteTextures(1, &tiles.indexTexture);
+    glDeleteBuffers(1, &tiles.lightBuffer);
+    glDeleteBuffers(1, &tiles.gridBuffer);
+    glDeleteBuffers(1, &tiles.indexBuffer);
+
+    if (tiles.cullProgram != 0) glDeleteProgram(tiles.cullProgram);
+
+    LightTilesData* data = (LightTilesData*)tiles.data;
+    R3D_FREE(data->lights);
+
+    if (!tiles.compute)
+    {
+        R3D_FREE(data->lightX);
+        R3D_FREE(data->bounds);
+        R3D_FREE(data->indices);
+        R3D_FREE(data->counts);
+        R3D_FREE(data->grid);
+        R3D_FREE(data->compact);
+
+        rlUnloadFramebuffer(tiles.boundsFramebuffer);
+        rlUnloadTexture(tiles.bounds.id);
+        UnloadShader(tiles.boundsShader);
+    }
+
+    R3D_FREE(data);
+}
+
+// Plane (xyz: normal, w: distance) through three points, facing the inside point
+static Vector4 GetLightTilePlane(Vector3 a, Vector3 b, Vector3 c, Vector3 inside)
+{
+    Vector3 normal = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(b, a), Vector3Subtract(c, a)));
+    Vector4 plane = { normal.x, normal.y, normal.z, -Vector3DotProduct(normal, a) };
+
+    if (Vector3DotProduct(normal, inside) + plane.w < 0.0f)
+    {
+        plane.x = -plane.x; plane.y = -plane.y; plane.z = -plane.z; plane.w = -plane.w;
+    }
+
+    return plane;
+}
+
+// Culls the lights against every tile of a row, run by the job system
+static void CullLightTilesRow(void* userData, int row)
+{
+    LightTilesData* data = (LightTilesData*)userData;
+    R3DLightTiles* tiles = data->tiles;
+    int lightCount = tiles->lightCount;
+    int maxLights = tiles->maxLightsPerTile;
+
+    for (int column = 0; column < tiles->tilesX; column++)
+    {
+        int tile = row*tiles->tilesX + column;
+
+        // Tile frustum side planes, from its corners on the near and far planes
+        float x0 = (float)(column*LIGHT_TILE_SIZE)/tiles->width*2.0f - 1.0f;
+        float x1 = fminf((float)((column + 1)*LIGHT_TILE_SIZE)/tiles->width, 1.0f)*2.0f - 1.0f;
+        float y0 = (float)(row*LIGHT_TILE_SIZE)/tiles->height*2.0f - 1.0f;
+        float y1 = fminf((float)((row + 1)*LIGHT_TILE_SIZE)/tiles->height, 1.0f)*2.0f - 1.0f;
+
+        Vector3 n00 = UnprojectNDC(data->invProjection, x0, y0, -1.0f), f00 = UnprojectNDC(data->invProjection, x0, y0, 1.0f);
+        Vector3 n10 = UnprojectNDC(data->invProjection, x1, y0, -1.0f), f10 = UnprojectNDC(data->invProjection, x1, y0, 1.0f);
+        Vector3 n11 = UnprojectNDC(data->invProjection, x1, y1, -1.0f);
+        Vector3 n01 = UnprojectNDC(data->invProjection, x0, y1, -1.0f), f01 = UnprojectNDC(data->invProjection, x0, y1, 1.0f);
+        Vector3 f11 = UnprojectNDC(data->invProjection, x1, y1, 1.0f);
+        Vector3 inside = Vector3Scale(Vector3Add(Vector3Add(n00, n11), Vector3Add(f00, f11)), 0.25f);
+
+        Vector4 planes[4];
+        planes[0] = GetLightTilePlane(n00, n01, f00, inside);
+        planes[1] = GetLightTilePlane(n10, n11, f10, inside);
+        planes[2] = GetLightTilePlane(n00, n10, f00, inside);
+        planes[3] = GetLightTilePlane(n01, n11, f01, inside);
+
+        // View space depth range of the tile (view space looks down -Z, zNear > zFar)
+        float zNear = UnprojectNDC(data->invProjection, 0.0f, 0.0f, data->bounds[tile*2]*2.0f - 1.0f).z;
+        float zFar = UnprojectNDC(data->invProjection, 0.0f, 0.0f, data->bounds[tile*2 + 1]*2.0f - 1.0f).z;
+
+        unsigned int* indices = data->indices + tile*maxLights;
+        unsigned int count = 0;
+        int i = 0;
+
+#if defined(R3D_SIMD_SSE)
+        __m128 planeX[4], planeY[4], planeZ[4], planeW[4];
+        for (int p = 0; p < 4; p++)
+        {
+            planeX[p] = _mm_set1_ps(planes[p].x);
+            planeY[p] = _mm_set1_ps(planes[p].y);
+            planeZ[p] = _mm_set1_ps(planes[p].z);
+            planeW[p] = _mm_set1_ps(planes[p].w);
+        }
+        __m128 nearZ = _mm_set1_ps(zNear);
+        __m128 farZ = _mm_set1_ps(zFar);
+
+        for (; i + 4 <= lightCount; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(data->lightX + i);
+            __m128 y = _mm_loadu_ps(data->lightY + i);
+            __m128 z = _mm_loadu_ps(data->lightZ + i);
+            __m128 radius = _mm_loadu_ps(data->lightRadius + i);
+            __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+            __m128 visible = _mm_and_ps(_mm_cmple_ps(_mm_sub_ps(z, radius), nearZ), _mm_cmpge_ps(_mm_add_ps(z, radius), farZ));
+            for (int p = 0; p < 4; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)), _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+                visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negRadius));
+            }
+
+            int mask = _mm_movemask_ps(visible);
+            while ((mask != 0) && (count < (unsigned int)maxLights))
+            {
+                int bit = 0;
+                while (((mask >> bit) & 1) == 0) bit++;
+                indices[count++] = i + bit;
+                mask &= ~(1 << bit);
+            }
+        }
+#endif
+        for (; i < lightCount; i++)
+        {
+            float x = data->lightX[i], y = data->lightY[i], z = data->lightZ[i], radius = data->lightRadius[i];
+            bool visible = (z - radius <= zNear) && (z + radius >= zFar);
+
+            for (int p = 0; (p < 4) && visible; p++)
+            {
+                visible = (planes[p].x*x + planes[p].y*y + planes[p].z*z + planes[p].w >= -radius);
+            }
+
+            if (visible && (count < (unsigned int)maxLights)) indices[count++] = i;
+        }
+
+        data->counts[tile] = count;
+    }
+}
+
+R3DDEF void UpdateLightTiles(R3DLightTiles* tiles, GBuffer gbuffer, Camera camera, const R3DLight* lights, int count)
+{
+    if (count > tiles->maxLights)
+    {
+        TraceLog(LOG_WARNING, "LIGHTING: Light tiles support up to %i lights, %i lights dropped", tiles->maxLights, count - tiles->maxLights);
+        count = tiles->maxLights;
+    }
+    tiles->lightCount = count;
+
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection = GetCameraProjection(camera, GetDeferredModeAspect(gbuffer));
+    Matrix invProjection = MatrixInvert(projection);
+
+    BeginProfilerPass(PROFILER_PASS_LIGHT_CULLING);
+
+    LightTilesData* data = (LightTilesData*)tiles->data;
+    UploadLightBuffer(tiles->lightBuffer, data->lights, lights, count);
+
+    rlDrawRenderBatchActive();
+
+#if defined(GRAPHICS_API_OPENGL_43)
+    if (tiles->compute)
+    {
+        glUseProgram(tiles->cullProgram);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.depth.id);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, tiles->lightTexture);
+        glUniform1i(glGetUniformLocation(tiles->cullProgram, "depthbuffer"), 0);
+        glUniform1i(glGetUniformLocation(tiles->cullProgram, "lightData"), 1);
+        glUniform1i(glGetUniformLocation(tiles->cullProgram, "lightCount"), count);
+        glUniform1i(glGetUniformLocation(tiles->cullProgram, "maxLightsPerTile"), tiles->maxLightsPerTile);
+        glUniformMatrix4fv(glGetUniformLocation(tiles->cullProgram, "view"), 1, false, MatrixToFloat(view));
+        glUniformMatrix4fv(glGetUniformLocation(tiles->cullProgram, "invProjection"), 1, false, MatrixToFloat(invProjection));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, tiles->gridBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, tiles->indexBuffer);
+
+        glDispatchCompute(tiles->tilesX, tiles->tilesY, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glUseProgram(0);
+        EndProfilerPass(PROFILER_PASS_LIGHT_CULLING);
+        return;
+    }
+#endif
+
+    data->tiles = tiles;
+    data->invProjection = invProjection;
+
+    // Tile depth bounds, reduced on the GPU so only one texel per tile is read back
+    // NOTE: Reading back stalls until the GBuffer is done, the compute path avoids it
+    int viewport[4] = { 0 };
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    bool depthTest = glIsEnabled(GL_DEPTH_TEST);
+    bool blend = glIsEnabled(GL_BLEND);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, tiles->boundsFramebuffer);
+    glViewport(0, 0, tiles->tilesX, tiles->tilesY);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glUseProgram(tiles->boundsShader.id);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gbuffer.depth.id);
+    glUniform1i(GetShaderLocation(tiles->boundsShader, "depthbuffer"), 0);
+    DrawFullscreenTriangle();
+    glReadPixels(0, 0, tiles->tilesX, tiles->tilesY, GL_RG, GL_FLOAT, data->bounds);
+    glUseProgram(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+    if (blend) glEnable(GL_BLEND);
+
+    // View space light spheres, as a structure of arrays for the SIMD tests
+    for (int i = 0; i < count; i++)
+    {
+        Vector3 position = Vector3Transform(lights[i].position, view);
+        data->lightX[i] = position.x;
+        data->lightY[i] = position.y;
+        data->lightZ[i] = position.z;
+        data->lightRadius[i] = (lights[i].type == LIGHT_POINT)? GetLightRadius(lights[i]) : 0.0f;
+    }
+
+    ParallelFor(tiles->tilesY, CullLightTilesRow, data);
+
+    // Compact the tile light lists
+    int tileCount = tiles->tilesX*tiles->tilesY;
+    unsigned int offset = 0;
+    for (int tile = 0; tile < tileCount; tile++)
+    {
+        data->grid[tile*2] = offset;
+        data->grid[tile*2 + 1] = data->counts[tile];
+        memcpy(data->compact + offset, data->indices + tile*tiles->maxLightsPerTile, data->counts[tile]*sizeof(unsigned int));
+        offset += data->counts[tile];
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, tiles->gridBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, tileCount*2*sizeof(unsigned int), data->grid);
+    glBindBuffer(GL_TEXTURE_BUFFER, tiles->indexBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, offset*sizeof(unsigned int), data->compact);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    EndProfilerPass(PROFILER_PASS_LIGHT_CULLING);
+}
+
+R3DDEF void SetDeferredModeShaderTiles(Shader shader, R3DLightTiles tiles)
+{
+    int unit = LIGHT_DATA_UNIT;
+    SetShaderValue(shader, GetShaderLocation(shader, "lightData"), &unit, SHADER_UNIFORM_INT);
+    unit = LIGHT_GRID_UNIT;
+    SetShaderValue(shader, GetShaderLocation(shader, "lightTileGrid"), &unit, SHADER_UNIFORM_INT);
+    unit = LIGHT_INDEX_UNIT;
+    SetShaderValue(shader, GetShaderLocation(shader, "lightTileIndices"), &unit, SHADER_UNIFORM_INT);
+    SetShaderValue(shader, GetShaderLocation(shader, "lightTilesX"), &tiles.tilesX, SHADER_UNIFORM_INT);
+    int tileSize = LIGHT_TILE_SIZE;
+    SetShaderValue(shader, GetShaderLocation(shader, "lightTileSize"), &tileSize, SHADER_UNIFORM_INT);
+
+    glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, tiles.lightTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_GRID_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, tiles.gridTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_INDEX_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, tiles.indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Light clusters scratch memory
+typedef struct LightClustersData {
+    float* lights;          // Light data staging, uploaded to the light buffer
+    float* lightX;          // View space light positions and radius, structure of arrays
+    float* lightY;
+    float* lightZ;
+    float* lightRadius;
+    float* sliceLights;     // Per depth slice culling scratch, 8 light arrays (see CullLightClustersSlice())
+    int* sliceIndices;      // Per depth slice culling scratch, 3 index arrays
+    int sliceStride;        // Elements per scratch array, lights padded to 4
+    float sliceDepth[LIGHT_CLUSTER_Z + 1]; // View depth of the slice boundaries
+    Vector3* clusterMin;    // View space bounding box of every cluster
+    Vector3* clusterMax;
+    Matrix projection;      // Projection the cluster bounds were built for
+    unsigned int* indices;  // Light indices, maxLightsPerCluster slots per cluster
+    unsigned int* counts;   // Lights per cluster
+    unsigned int* grid;     // (offset, count) per cluster, uploaded to the grid buffer
+    unsigned int* compact;  // Light indices with no empty slots, uploaded to the index buffer
+    R3DLightClusters* clusters;
+} LightClustersData;
+
+// Cluster grid of up to maxItems spheres, without the light data (decals are binned with it too, see R3DDecals)
+static R3DLightClusters LoadLightClusterGrid(int width, int height, int maxItems, int maxItemsPerCluster)
+{
+    R3DLightClusters clusters = { 0 };
+    clusters.width = width;
+    clusters.height = height;
+    clusters.clustersX = LIGHT_CLUSTER_X;
+    clusters.clustersY = LIGHT_CLUSTER_Y;
+    clusters.clustersZ = LIGHT_CLUSTER_Z;
+    clusters.maxLights = maxItems;
+    clusters.maxLightsPerCluster = (maxItemsPerCluster > 0)? maxItemsPerCluster : LIGHT_CLUSTER_MAX_LIGHTS;
+    clusters.view = MatrixIdentity();
+
+    int clusterCount = LIGHT_CLUSTER_X*LIGHT_CLUSTER_Y*LIGHT_CLUSTER_Z;
+
+    LoadLightBuffer(&clusters.gridBuffer, &clusters.gridTexture, clusterCount*2*sizeof(unsigned int), GL_RG32UI);
+    LoadLightBuffer(&clusters.indexBuffer, &clusters.indexTexture, clusterCount*clusters.maxLightsPerCluster*sizeof(unsigned int), GL_R32UI);
+
+    // Exponential slices keep clusters roughly cubic, z slice k starts at near*(far/near)^(k/slices)
+    float depthRange = logf((float)RL_CULL_DISTANCE_FAR/(float)RL_CULL_DISTANCE_NEAR);
+    clusters.depthScale = LIGHT_CLUSTER_Z/depthRange;
+    clusters.depthBias = -LIGHT_CLUSTER_Z*logf((float)RL_CULL_DISTANCE_NEAR)/depthRange;
+
+    LightClustersData* data = (LightClustersData*)R3D_CALLOC(1, sizeof(LightClustersData));
+    for (int z = 0; z <= LIGHT_CLUSTER_Z; z++) data->sliceDepth[z] = (float)RL_CULL_DISTANCE_NEAR*expf(depthRange*z/LIGHT_CLUSTER_Z);
+
+    data->lightX = (float*)R3D_CALLOC(maxItems*4, sizeof(float));
+    data->lightY = data->lightX + maxItems;
+    data->lightZ = data->lightY + maxItems;
+    data->lightRadius = data->lightZ + maxItems;
+    data->sliceStride = (maxItems + 3) & ~3;
+    data->sliceLights = (float*)R3D_CALLOC(LIGHT_CLUSTER_Z*8*data->sliceStride, sizeof(float));
+    data->sliceIndices = (int*)R3D_CALLOC(LIGHT_CLUSTER_Z*3*data->sliceStride, sizeof(int));
+    data->clusterMin = (Vector3*)R3D_CALLOC(clusterCount, sizeof(Vector3));
+    data->clusterMax = (Vector3*)R3D_CALLOC(clusterCount, sizeof(Vector3));
+    data->indices = (unsigned int*)R3D_MALLOC(clusterCount*clusters.maxLightsPerCluster*sizeof(unsigned int));
+    data->counts = (unsigned int*)R3D_MALLOC(clusterCount*sizeof(unsigned int));
+    data->grid = (unsigned int*)R3D_MALLOC(clusterCount*2*sizeof(unsigned int));
+    data->compact = (unsigned int*)R3D_MALLOC(clusterCount*clusters.maxLightsPerCluster*sizeof(unsigned int));
+    clusters.data = data;
+
+    return clusters;
+}
+
+R3DDEF R3DLightClusters LoadLightClusters(int width, int height, int maxLights, int maxLightsPerCluster)
+{
+    R3DLightClusters clusters = LoadLightClusterGrid(width, height, maxLights, maxLightsPerCluster);
+
+    LightClustersData* data = (LightClustersData*)clusters.data;
+    LoadLightBuffer(&clusters.lightBuffer, &clusters.lightTexture, maxLights*8*sizeof(float), GL_RGBA32F);
+    data->lights = (float*)R3D_CALLOC(maxLights*8, sizeof(float));
+
+    TraceLog(LOG_INFO, "LIGHTING: Light clusters loaded successfully (%i x %i x %i clusters)", clusters.clustersX, clusters.clustersY, clusters.clustersZ);
+
+    return clusters;
+}
+
+R3DDEF void UnloadLightClusters(R3DLightClusters clusters)
+{
+    glDeleteTextures(1, &clusters.lightTexture);
+    glDeleteTextures(1, &clusters.gridTexture);
+    glDeleteTextures(1, &clusters.indexTexture);
+    glDeleteBuffers(1, &clusters.lightBuffer);
+    glDeleteBuffers(1, &clusters.gridBuffer);
+    glDeleteBuffers(1, &clusters.indexBuffer);
+
+    LightClustersData* data = (LightClustersData*)clusters.data;
+    R3D_FREE(data->lights);
+    R3D_FREE(data->lightX);
+    R3D_FREE(data->sliceLights);
+    R3D_FREE(data->sliceIndices);
+    R3D_FREE(data->clusterMin);
+    R3D_FREE(data->clusterMax);
+    R3D_FREE(data->indices);
+    R3D_FREE(data->counts);
+    R3D_FREE(data->grid);
+    R3D_FREE(data->compact);
+    R3D_FREE(data);
+}
+
+// View space bounding boxes of the clusters, only rebuilt when the projection changes
+static void UpdateLightClusterBounds(LightClustersData* data, Matrix projection)
+{
+    if (memcmp(&data->projection, &projection, sizeof(Matrix)) == 0) return;
+    data->projection = projection;
+
+    Matrix invProjection = MatrixInvert(projection);
+
+    for (int y = 0; y < LIGHT_CLUSTER_Y; y++)
+    {
+        for (int x = 0; x < LIGHT_CLUSTER_X; x++)
+        {
+            // Rays through the tile corners, from the near to the far plane
+            Vector3 nearPoints[4], farPoints[4];
+            for (int c = 0; c < 4; c++)
+            {
+                float ndcX = (float)(x + (c & 1))/LIGHT_CLUSTER_X*2.0f - 1.0f;
+                float ndcY = (float)(y + (c >> 1))/LIGHT_CLUSTER_Y*2.0f - 1.0f;
+                nearPoints[c] = UnprojectNDC(invProjection, ndcX, ndcY, -1.0f);
+                farPoints[c] = UnprojectNDC(invProjection, ndcX, ndcY, 1.0f);
+            }
+
+            for (int z = 0; z < LIGHT_CLUSTER_Z; z++)
+            {
+                Vector3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+                Vector3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+                for (int c = 0; c < 8; c++)
+                {
+                    // View space looks down -Z, slices are placed at positive view depths
+                    float depth = data->sliceDepth[z + (c >> 2)];
+                    Vector3 a = nearPoints[c & 3], b = farPoints[c & 3];
+                    Vector3 point = Vector3Lerp(a, b, (-depth - a.z)/(b.z - a.z));
+                    min = Vector3Min(min, point);
+                    max = Vector3Max(max, point);
+                }
+
+                int cluster = (z*LIGHT_CLUSTER_Y + y)*LIGHT_CLUSTER_X + x;
+                data->clusterMin[cluster] = min;
+                data->clusterMax[cluster] = max;
+            }
+        }
+    }
+}
+
+// Tests light spheres against a view space box, writes the position of the touching ones in the arrays
+static int CullLightSpheres(const float* x, const float* y, const float* z, const float* radius, int count, Vector3 min, Vector3 max, int* result, int maxResult)
+{
+    int hits = 0;
+    int i = 0;
+
+    // Sphere against box, distance from the center to the box under the radius
+#if defined(R3D_SIMD_SSE)
+    __m128 minX = _mm_set1_ps(min.x), minY = _mm_set1_ps(min.y), minZ = _mm_set1_ps(min.z);
+    __m128 maxX = _mm_set1_ps(max.x), maxY = _mm_set1_ps(max.y), maxZ = _mm_set1_ps(max.z);
+    __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 r = _mm_loadu_ps(radius + i);
+
+        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, px), _mm_sub_ps(px, maxX)), zero);
+        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, py), _mm_sub_ps(py, maxY)), zero);
+        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, pz), _mm_sub_ps(pz, maxZ)), zero);
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+        int mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(r, r)));
+        while ((mask != 0) && (hits < maxResult))
+        {
+            int bit = 0;
+            while (((mask >> bit) & 1) == 0) bit++;
+            result[hits++] = i + bit;
+            mask &= ~(1 << bit);
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float dx = fmaxf(fmaxf(min.x - x[i], x[i] - max.x), 0.0f);
+        float dy = fmaxf(fmaxf(min.y - y[i], y[i] - max.y), 0.0f);
+        float dz = fmaxf(fmaxf(min.z - z[i], z[i] - max.z), 0.0f);
+
+        if ((dx*dx + dy*dy + dz*dz <= radius[i]*radius[i]) && (hits < maxResult)) result[hits++] = i;
+    }
+
+    return hits;
+}
+
+// Keeps the lights of the given positions, packed at the start of the arrays
+static void GatherLightSpheres(float* x, float* y, float* z, float* radius, int* indices, const float* srcX, const float* srcY, const float* srcZ, const float* srcRadius, const int* srcIndices, const int* positions, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int p = positions[i];
+        x[i] = srcX[p];
+        y[i] = srcY[p];
+        z[i] = srcZ[p];
+        radius[i] = srcRadius[p];
+        indices[i] = srcIndices[p];
+    }
+}
+
+// Bins the lights into every cluster of a depth slice, run by the job system
+static void CullLightClustersSlice(void* userData, int slice)
+{
+    LightClustersData* data = (LightClustersData*)userData;
+    R3DLightClusters* clusters = data->clusters;
+    int maxLights = clusters->maxLightsPerCluster;
+    int stride = data->sliceStride;
+
+    // Slice scratch: lights touching the slice, then the ones touching the current cluster row
+    float* sliceX = data->sliceLights + slice*8*stride;
+    float* sliceY = sliceX + stride;
+    float* sliceZ = sliceY + stride;
+    float* sliceRadius = sliceZ + stride;
+    float* rowX = sliceRadius + stride;
+    float* rowY = rowX + stride;
+    float* rowZ = rowY + stride;
+    float* rowRadius = rowZ + stride;
+    int* sliceIndices = data->sliceIndices + slice*3*stride;
+    int* rowIndices = sliceIndices + stride;
+    int* hits = rowIndices + stride;
+
+    float sliceNear = data->sliceDepth[slice];
+    float sliceFar = data->sliceDepth[slice + 1];
+    int sliceCount = 0;
+
+    for (int i = 0; i < clusters->lightCount; i++)
+    {
+        float depth = -data->lightZ[i], radius = data->lightRadius[i];
+        if ((depth + radius < sliceNear) || (depth - radius > sliceFar)) continue;
+
+        sliceX[sliceCount] = data->lightX[i];
+        sliceY[sliceCount] = data->lightY[i];
+        sliceZ[sliceCount] = data->lightZ[i];
+        sliceRadius[sliceCount] = radius;
+        sliceIndices[sliceCount] = i;
+        sliceCount++;
+    }
+
+    for (int y = 0; y < LIGHT_CLUSTER_Y; y++)
+    {
+        int row = (slice*LIGHT_CLUSTER_Y + y)*LIGHT_CLUSTER_X;
+
+        // Narrow the lights down to the row first, most of them only touch a few rows
+        Vector3 rowMin = data->clusterMin[row];
+        Vector3 rowMax = data->clusterMax[row];
+        for (int x = 1; x < LIGHT_CLUSTER_X; x++)
+        {
+            rowMin = Vector3Min(rowMin, data->clusterMin[row + x]);
+            rowMax = Vector3Max(rowMax, data->clusterMax[row + x]);
+        }
+
+        int rowCount = CullLightSpheres(sliceX, sliceY, sliceZ, sliceRadius, sliceCount, rowMin, rowMax, hits, stride);
+        GatherLightSpheres(rowX, rowY, rowZ, rowRadius, rowIndices, sliceX, sliceY, sliceZ, sliceRadius, sliceIndices, hits, rowCount);
+
+        for (int x = 0; x < LIGHT_CLUSTER_X; x++)
+        {
+            int cluster = row + x;
+            int count = CullLightSpheres(rowX, rowY, rowZ, rowRadius, rowCount, data->clusterMin[cluster], data->clusterMax[cluster], hits, (maxLights < stride)? maxLights : stride);
+
+            unsigned int* indices = data->indices + cluster*maxLights;
+            for (int i = 0; i < count; i++) indices[i] = rowIndices[hits[i]];
+            data->counts[cluster] = count;
+        }
+    }
+}
+
+// Bins the view space spheres (lightX, lightY, lightZ, lightRadius) into the clusters and uploads the cluster lists
+static void BuildLightClusterLists(R3DLightClusters* clusters, Camera camera)
+{
+    LightClustersData* data = (LightClustersData*)clusters->data;
+    data->clusters = clusters;
+    UpdateLightClusterBounds(data, GetCameraProjection(camera, (float)clusters->width/(float)clusters->height));
+
+    ParallelFor(LIGHT_CLUSTER_Z, CullLightClustersSlice, data);
+
+    // Compact the cluster light lists
+    int clusterCount = LIGHT_CLUSTER_X*LIGHT_CLUSTER_Y*LIGHT_CLUSTER_Z;
+    unsigned int offset = 0;
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        data->grid[cluster*2] = offset;
+        data->grid[cluster*2 + 1] = data->counts[cluster];
+        memcpy(data->compact + offset, data->indices + cluster*clusters->maxLightsPerCluster, data->counts[cluster]*sizeof(unsigned int));
+        offset += data->counts[cluster];
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, clusters->gridBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, clusterCount*2*sizeof(unsigned int), data->grid);
+    glBindBuffer(GL_TEXTURE_BUFFER, clusters->indexBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, offset*sizeof(unsigned int), data->compact);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+R3DDEF void UpdateLightClusters(R3DLightClusters* clusters, Camera camera, const R3DLight* lights, int count)
+{
+    if (count > clusters->maxLights)
+    {
+        TraceLog(LOG_WARNING, "LIGHTING: Light clusters support up to %i lights, %i lights dropped", clusters->maxLights, count - clusters->maxLights);
+        count = clusters->maxLights;
+    }
+    clusters->lightCount = count;
+    clusters->view = MatrixLookAt(camera.position, camera.target, camera.up);
+
+    BeginProfilerPass(PROFILER_PASS_LIGHT_CULLING);
+
+    LightClustersData* data = (LightClustersData*)clusters->data;
+    UploadLightBuffer(clusters->lightBuffer, data->lights, lights, count);
+
+    for (int i = 0; i < count; i++)
+    {
+        Vector3 position = Vector3Transform(lights[i].position, clusters->view);
+        data->lightX[i] = position.x;
+        data->lightY[i] = position.y;
+        data->lightZ[i] = position.z;
+        data->lightRadius[i] = (lights[i].type == LIGHT_POINT)? GetLightRadius(lights[i]) : 0.0f;
+    }
+
+    BuildLightClusterLists(clusters, camera);
+
+    EndProfilerPass(PROFILER_PASS_LIGHT_CULLING);
+}
+
+R3DDEF void SetShaderLightClusters(Shader shader, R3DLightClusters clusters)
+{
+    int unit = LIGHT_DATA_UNIT;
+    SetShaderValue(shader, GetShaderLocation(shader, "lightData"), &unit, SHADER_UNIFORM_INT);
+    unit = LIGHT_GRID_UNIT;
+    SetShaderValue(shader, GetShaderLocation(shader, "lightClusterGrid"), &unit, SHADER_UNIFORM_INT);
+    unit = LIGHT_INDEX_UNIT;
+    SetShaderValue(shader, GetShaderLocation(shader, "lightClusterIndices"), &unit, SHADER_UNIFORM_INT);
+
+    int size[3] = { clusters.clustersX, clusters.clustersY, clusters.clustersZ };
+    SetShaderValue(shader, GetShaderLocation(shader, "lightClusterSize"), size, SHADER_UNIFORM_IVEC3);
+    Vector2 screen = { (float)clusters.width, (float)clusters.height };
+    SetShaderValue(shader, GetShaderLocation(shader, "lightClusterScreen"), &screen, SHADER_UNIFORM_VEC2);
+    Vector2 depth = { clusters.depthScale, clusters.depthBias };
+    SetShaderValue(shader, GetShaderLocation(shader, "lightClusterDepth"), &depth, SHADER_UNIFORM_VEC2);
+    SetShaderValueMatrix(shader, GetShaderLocation(shader, "lightClusterView"), clusters.view);
+
+    glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, clusters.lightTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_GRID_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, clusters.gridTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_INDEX_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, clusters.indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+#define LIGHT_VOLUME_RINGS 8   // Light volume sphere latitude rings
+#define LIGHT_VOLUME_SLICES 12 // Light volume sphere longitude slices
+
+// Light volume sphere, the pass marking the pixels inside it only needs the position
+static const char* lightVolumeVS =
+    "#version 330\n"
+    "layout (location = 0) in vec3 vertexPosition;\n"
+    "uniform mat4 mvp;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = mvp*vec4(vertexPosition, 1.0);\n"
+    "}\n";
+
+static const char* lightVolumeStencilFS =
+    "#version 330\n"
+    "void main()\n"
+    "{\n"
+    "}\n";
+
+// Copies the GBuffer depth into the lighting target depth stencil
+static const char* lightVolumeDepthFS =
+    "#version 330\n"
+    "uniform sampler2D depthbuffer;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragDepth = texelFetch(depthbuffer, ivec2(gl_FragCoord.xy), 0).r;\n"
+    "}\n";
+
+// Shades a single light, same lighting model as deferredLighting.fs
+static const char* lightVolumeFS =
+    "#version 330\n"
+    "uniform sampler2D colorbuffer;\n"
+    "uniform sampler2D normalbuffer;\n"
+    "uniform sampler2D positionbuffer;\n"
+    "uniform sampler2D depthbuffer;\n"
+    "uniform sampler2D emissionbuffer;\n"
+    "uniform int gbufferLayout;\n"
+    "uniform vec2 gbufferScale;\n"
+    "uniform mat4 invViewProj;\n"
+    "uniform vec3 viewpos;\n"
+    "uniform int lightType;\n"  // -1: ambient, else R3DLightType
+    "uniform vec3 lightPosition;\n"
+    "uniform vec3 lightDirection;\n"
+    "uniform vec3 lightColor;\n"
+    "uniform float lightLinear;\n"
+    "uniform float lightQuadratic;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+    "    float depth = texelFetch(depthbuffer, pixel, 0).r;\n"
+    "    if (depth == 1.0) discard;\n"
+    "    vec4 albedoSpec = texelFetch(colorbuffer, pixel, 0);\n"
+    "    if (lightType < 0) { finalColor = vec4(albedoSpec.rgb*lightColor + texelFetch(emissionbuffer, pixel, 0).rgb, 1.0); return; }\n"
+    "    vec3 normal;\n"
+    "    vec3 position;\n"
+    "    if (gbufferLayout == 1) {\n"
+    "        normal = decode_normal(texelFetch(normalbuffer, pixel, 0).rg);\n"
+    "        vec2 uv = (vec2(pixel) + 0.5)/(vec2(textureSize(depthbuffer, 0))*gbufferScale);\n"
+    "        vec4 world = invViewProj*vec4(vec3(uv, depth)*2.0 - 1.0, 1.0);\n"
+    "        position = world.xyz/world.w;\n"
+    "    } else {\n"
+    "        normal = texelFetch(normalbuffer, pixel, 0).rgb;\n"
+    "        position = texelFetch(positionbuffer, pixel, 0).rgb;\n"
+    "    }\n"
+    "    vec3 lightdir = -normalize(lightDirection);\n"
+    "    float attenuation = 1.0;\n"
+    "    if (lightType == 0) {\n"
+    "        float distance = length(lightPosition - position);\n"
+    "        lightdir = (lightPosition - position)/distance;\n"
+    "        attenuation = 1.0/(1.0 + lightLinear*distance + lightQuadratic*distance*distance);\n"
+    "    }\n"
+    "    vec3 viewdir = normalize(viewpos - position);\n"
+    "    vec3 diffuse = max(dot(normal, lightdir), 0.0)*albedoSpec.rgb*lightColor;\n"
+    "    vec3 halfwaydir = normalize(lightdir + viewdir);\n"
+    "    vec3 specular = lightColor*pow(max(dot(normal, halfwaydir), 0.0), 16.0)*albedoSpec.a;\n"
+    "    finalColor = vec4((diffuse + specular)*attenuation, 1.0);\n"
+    "}\n";
+
+// Light volume shader uniforms
+typedef enum {
+    LIGHT_VOLUME_LOC_MVP = 0,
+    LIGHT_VOLUME_LOC_LAYOUT,
+    LIGHT_VOLUME_LOC_SCALE,
+    LIGHT_VOLUME_LOC_INV_VIEW_PROJ,
+    LIGHT_VOLUME_LOC_VIEW_POS,
+    LIGHT_VOLUME_LOC_TYPE,
+    LIGHT_VOLUME_LOC_POSITION,
+    LIGHT_VOLUME_LOC_DIRECTION,
+    LIGHT_VOLUME_LOC_COLOR,
+    LIGHT_VOLUME_LOC_LINEAR,
+    LIGHT_VOLUME_LOC_QUADRATIC,
+    LIGHT_VOLUME_LOC_COUNT
+} LightVolumeLocation;
+
+static const char* lightVolumeUniforms[LIGHT_VOLUME_LOC_COUNT] = {
+    "mvp", "gbufferLayout", "gbufferScale", "invViewProj", "viewpos", "lightType", "lightPosition", "lightDirection", "lightColor", "lightLinear", "lightQuadratic"
+};
+
+// Light volumes shaders and sphere mesh
+typedef struct LightVolumesData {
+    Shader depthShader;      // GBuffer depth copy
+    Shader stencilShader;    // Marks the pixels inside a light volume
+    Shader volumeShader;     // Point lights, drawn as spheres
+    Shader screenShader;     // Ambient and directional lights, drawn full screen
+    int volumeLocs[LIGHT_VOLUME_LOC_COUNT];
+    int screenLocs[LIGHT_VOLUME_LOC_COUNT];
+    int stencilMvpLoc;
+    unsigned int sphereVao;
+    unsigned int sphereVbo;
+    unsigned int sphereEbo;
+    int sphereIndexCount;
+    float sphereScale;       // Scale making the sphere mesh cover the unit sphere
+} LightVolumesData;
+
+// Gets the light volume uniforms and assigns the GBuffer textures units (GBufferAttachmentType order)
+static void LoadLightVolumeShaderLocations(Shader shader, int* locs)
+{
+    for (int i = 0; i < LIGHT_VOLUME_LOC_COUNT; i++) locs[i] = GetShaderLocation(shader, lightVolumeUniforms[i]);
+
+    glUseProgram(shader.id);
+    glUniform1i(GetShaderLocation(shader, "positionbuffer"), GBUFFER_ATTACHMENT_POSITION);
+    glUniform1i(GetShaderLocation(shader, "normalbuffer"), GBUFFER_ATTACHMENT_NORMAL);
+    glUniform1i(GetShaderLocation(shader, "colorbuffer"), GBUFFER_ATTACHMENT_ALBEDO_SPEC);
+    glUniform1i(GetShaderLocation(shader, "emissionbuffer"), GBUFFER_ATTACHMENT_EMISSION);
+    glUniform1i(GetShaderLocation(shader, "depthbuffer"), GBUFFER_MAX_ATTACHMENTS);
+    glUseProgram(0);
+}
+
+// Sets the per frame uniforms of a light volume shader
+static void SetLightVolumeShaderFrame(Shader shader, const int* locs, GBuffer gbuffer, Camera camera, Matrix viewProj)
+{
+    glUseProgram(shader.id);
+    glUniform1i(locs[LIGHT_VOLUME_LOC_LAYOUT], gbuffer.layout);
+    glUniform2f(locs[LIGHT_VOLUME_LOC_SCALE], (float)gbuffer.viewportWidth/(float)gbuffer.width, (float)gbuffer.viewportHeight/(float)gbuffer.height);
+    glUniformMatrix4fv(locs[LIGHT_VOLUME_LOC_INV_VIEW_PROJ], 1, false, MatrixToFloat(MatrixInvert(viewProj)));
+    glUniform3f(locs[LIGHT_VOLUME_LOC_VIEW_POS], camera.position.x, camera.position.y, camera.position.z);
+}
+
+static void SetLightVolumeShaderLight(const int* locs, int type, R3DLight light)
+{
+    glUniform1i(locs[LIGHT_VOLUME_LOC_TYPE], type);
+    glUniform3f(locs[LIGHT_VOLUME_LOC_POSITION], light.position.x, light.position.y, light.position.z);
+    glUniform3f(locs[LIGHT_VOLUME_LOC_DIRECTION], light.direction.x, light.direction.y, light.direction.z);
+    glUniform3f(locs[LIGHT_VOLUME_LOC_COLOR], light.color.x, light.color.y, light.color.z);
+    glUniform1f(locs[LIGHT_VOLUME_LOC_LINEAR], light.linear);
+    glUniform1f(locs[LIGHT_VOLUME_LOC_QUADRATIC], light.quadratic);
+}
+
+// Unit UV sphere, counter clockwise faces looking outwards
+static void LoadLightVolumeSphere(LightVolumesData* data)
+{
+    float vertices[(LIGHT_VOLUME_RINGS + 1)*LIGHT_VOLUME_SLICES*3];
+    unsigned short indices[LIGHT_VOLUME_RINGS*LIGHT_VOLUME_SLICES*6];
+
+    for (int ring = 0; ring <= LIGHT_VOLUME_RINGS; ring++)
+    {
+        float theta = PI*ring/LIGHT_VOLUME_RINGS;
+        for (int slice = 0; slice < LIGHT_VOLUME_SLICES; slice++)
+        {
+            float phi = 2.0f*PI*slice/LIGHT_VOLUME_SLICES;
+            float* vertex = vertices + (ring*LIGHT_VOLUME_SLICES + slice)*3;
+            vertex[0] = sinf(theta)*cosf(phi);
+            vertex[1] = cosf(theta);
+            vertex[2] = sinf(theta)*sinf(phi);
+        }
+    }
+
+    int count = 0;
+    for (int ring = 0; ring < LIGHT_VOLUME_RINGS; ring++)
+    {
+        for (int slice = 0; slice < LIGHT_VOLUME_SLICES; slice++)
+        {
+            unsigned short a = ring*LIGHT_VOLUME_SLICES + slice;
+            unsigned short b = (ring + 1)*LIGHT_VOLUME_SLICES + slice;
+            unsigned short c = ring*LIGHT_VOLUME_SLICES + (slice + 1)%LIGHT_VOLUME_SLICES;
+            unsigned short d = (ring + 1)*LIGHT_VOLUME_SLICES + (slice + 1)%LIGHT_VOLUME_SLICES;
+            indices[count++] = a; indices[count++] = c; indices[count++] = b;
+            indices[count++] = b; indices[count++] = c; indices[count++] = d;
+        }
+    }
+
+    data->sphereIndexCount = count;
+    // Faces are inside the sphere, closest at the middle of a face
+    data->sphereScale = 1.0f/(cosf(PI/LIGHT_VOLUME_SLICES)*cosf(PI/LIGHT_VOLUME_RINGS));
+
+    glGenVertexArrays(1, &data->sphereVao);
+    glBindVertexArray(data->sphereVao);
+    glGenBuffers(1, &data->sphereVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, data->sphereVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+    glGenBuffers(1, &data->sphereEbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data->sphereEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+R3DDEF R3DLightVolumes LoadLightVolumes(int width, int height)
+{
+    R3DLightVolumes volumes = { 0 };
+    volumes.width = width;
+    volumes.height = height;
+    volumes.ambient = 0.1f;
+
+    glGenFramebuffers(1, &volumes.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, volumes.framebuffer);
+    volumes.lighting = LoadGBufferTarget(width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, GL_COLOR_ATTACHMENT0);
+
+    glGenRenderbuffers(1, &volumes.depthStencil);
+    glBindRenderbuffer(GL_RENDERBUFFER, volumes.depthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, volumes.depthStencil);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) TraceLog(LOG_WARNING, "LIGHTING: Light volumes framebuffer is not complete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    LightVolumesData* data = (LightVolumesData*)R3D_CALLOC(1, sizeof(LightVolumesData));
+    data->depthShader = LoadShaderFromMemory(r3dFullscreenVS, lightVolumeDepthFS);
+    data->stencilShader = LoadShaderFromMemory(lightVolumeVS, lightVolumeStencilFS);
+    data->volumeShader = LoadGBufferReaderShader(lightVolumeVS, lightVolumeFS);
+    data->screenShader = LoadGBufferReaderShader(r3dFullscreenVS, lightVolumeFS);
+    data->stencilMvpLoc = GetShaderLocation(data->stencilShader, "mvp");
+    LoadLightVolumeShaderLocations(data->volumeShader, data->volumeLocs);
+    LoadLightVolumeShaderLocations(data->screenShader, data->screenLocs);
+    LoadLightVolumeSphere(data);
+    volumes.data = data;
+
+    TraceLog(LOG_INFO, "LIGHTING: Light volumes loaded successfully (%i x %i)", width, height);
+
+    return volumes;
+}
+
+R3DDEF void UnloadLightVolumes(R3DLightVolumes volumes)
+{
+    LightVolumesData* data = (LightVolumesData*)volumes.data;
+    UnloadShader(data->depthShader);
+    UnloadShader(data->stencilShader);
+    UnloadShader(data->volumeShader);
+    UnloadShader(data->screenShader);
+    glDeleteVertexArrays(1, &data->sphereVao);
+    glDeleteBuffers(1, &data->sphereVbo);
+    glDeleteBuffers(1, &data->sphereEbo);
+    R3D_FREE(data);
+
+    glDeleteRenderbuffers(1, &volumes.depthStencil);
+    rlUnloadTexture(volumes.lighting.id);
+    rlUnloadFramebuffer(volumes.framebuffer);
+}
+
+R3DDEF void DrawLightVolumes(R3DLightVolumes volumes, GBuffer gbuffer, Camera camera, const R3DLight* lights, int count)
+{
+    LightVolumesData* data = (LightVolumesData*)volumes.data;
+    Matrix viewProj = GetDeferredModeViewProjection(gbuffer, camera);
+
+    rlDrawRenderBatchActive();
+    BeginProfilerPass(PROFILER_PASS_LIGHT_VOLUMES);
+
+    int viewport[4] = { 0 };
+    int depthFunc = 0, cullFaceMode = 0;
+    int blendSrcRGB = 0, blendDstRGB = 0, blendSrcAlpha = 0, blendDstAlpha = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glGetIntegerv(GL_CULL_FACE_MODE, &cullFaceMode);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrcRGB);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blendDstRGB);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDstAlpha);
+    bool depthTest = glIsEnabled(GL_DEPTH_TEST);
+    bool blend = glIsEnabled(GL_BLEND);
+    bool cullFace = glIsEnabled(GL_CULL_FACE);
+
+    // Lights are drawn over the GBuffer viewport only, pixel for pixel
+    glBindFramebuffer(GL_FRAMEBUFFER, volumes.framebuffer);
+    glViewport(0, 0, (gbuffer.viewportWidth < volumes.width)? gbuffer.viewportWidth : volumes.width,
+        (gbuffer.viewportHeight < volumes.height)? gbuffer.viewportHeight : volumes.height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    // GBuffer textures, on the units of their attachment type
+    BindGBufferAttachments(gbuffer);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_MAX_ATTACHMENTS);
+    glBindTexture(GL_TEXTURE_2D, gbuffer.depth.id);
+
+    // Scene depth, the light volumes are depth tested against it
+    glUseProgram(data->depthShader.id);
+    glUniform1i(GetShaderLocation(data->depthShader, "depthbuffer"), GBUFFER_MAX_ATTACHMENTS);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    DrawFullscreenTriangle();
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // Ambient and directional lights cover the whole screen
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    SetLightVolumeShaderFrame(data->screenShader, data->screenLocs, gbuffer, camera, viewProj);
+    R3DLight ambient = { 0 };
+    ambient.color.x = ambient.color.y = ambient.color.z = volumes.ambient;
+    SetLightVolumeShaderLight(data->screenLocs, -1, ambient);
+    DrawFullscreenTriangle();
+
+    for (int i = 0; i < count; i++)
+    {
+        if (lights[i].type != LIGHT_DIRECTIONAL) continue;
+
+        SetLightVolumeShaderLight(data->screenLocs, LIGHT_DIRECTIONAL, lights[i]);
+        DrawFullscreenTriangle();
+    }
+
+    // Point lights: the stencil pass marks the pixels with geometry inside the volume (back face behind it, front
+    // face in front of it), then the light pass shades them and clears the mark for the next light
+    SetLightVolumeShaderFrame(data->volumeShader, data->volumeLocs, gbuffer, camera, viewProj);
+    glBindVertexArray(data->sphereVao);
+    glEnable(GL_STENCIL_TEST);
+    glEnable(GL_DEPTH_CLAMP);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (lights[i].type != LIGHT_POINT) continue;
+
+        float radius = fminf(GetLightRadius(lights[i]), (float)RL_CULL_DISTANCE_FAR);
+        if (radius <= 0.0f) continue;
+
+        radius *= data->sphereScale;
+        Matrix model = MatrixMultiply(MatrixScale(radius, radius, radius), MatrixTranslate(lights[i].position.x, lights[i].position.y, lights[i].position.z));
+        float16 mvp = MatrixToFloatV(MatrixMultiply(model, viewProj));
+
+        glUseProgram(data->stencilShader.id);
+        glUniformMatrix4fv(data->stencilMvpLoc, 1, false, mvp.v);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        glDrawElements(GL_TRIANGLES, data->sphereIndexCount, GL_UNSIGNED_SHORT, 0);
+
+        // Back faces still cover the volume when the camera is inside it
+        glUseProgram(data->volumeShader.id);
+        glUniformMatrix4fv(data->volumeLocs[LIGHT_VOLUME_LOC_MVP], 1, false, mvp.v);
+        SetLightVolumeShaderLight(data->volumeLocs, LIGHT_POINT, lights[i]);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+        glDrawElements(GL_TRIANGLES, data->sphereIndexCount, GL_UNSIGNED_SHORT, 0);
+    }
+
+    glDisable(GL_DEPTH_CLAMP);
+    glDisable(GL_STENCIL_TEST);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glDepthFunc(depthFunc);
+    glDepthMask(GL_TRUE);
+    glCullFace(cullFaceMode);
+    glBlendFuncSeparate(blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha);
+    if (depthTest) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+    if (blend) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    if (cullFace) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+
+    EndProfilerPass(PROFILER_PASS_LIGHT_VOLUMES);
+}
+
+#define LIGHT_SET_LIGHT_FLOATS 16 // std140 light struct: position, linear, color, quadratic, direction, type, spot cutoff, shadow, padding
+#define LIGHT_SET_HEADER_SIZE 16  // std140 LightBlock light count, padded to the light array alignment
+// NOTE: 255 lights keep the LightBlock (16 + 255*64 bytes) within 16 KB, the GL_MAX_UNIFORM_BLOCK_SIZE every GL 3.3 driver supports
+
+R3DDEF R3DLightSet LoadLightSet(void)
+{
+    R3DLightSet set = { 0 };
+    set.lights = (R3DLight*)R3D_CALLOC(LIGHT_SET_MAX_LIGHTS, sizeof(R3DLight));
+    set.data = R3D_CALLOC(LIGHT_SET_MAX_LIGHTS*LIGHT_SET_LIGHT_FLOATS, sizeof(float));
+
+    // The whole block is allocated, the shader declares all LIGHT_SET_MAX_LIGHTS lights
+    glGenBuffers(1, &set.ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, set.ubo);
+    glBufferData(GL_UNIFORM_BUFFER, LIGHT_SET_HEADER_SIZE + LIGHT_SET_MAX_LIGHTS*LIGHT_SET_LIGHT_FLOATS*sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    set.countDirty = true;
+
+    return set;
+}
+
+R3DDEF void UnloadLightSet(R3DLightSet set)
+{
+    glDeleteBuffers(1, &set.ubo);
+    R3D_FREE(set.lights);
+    R3D_FREE(set.data);
+}
+
+// Extends the range of lights to upload
+static void SetLightSetDirty(R3DLightSet* set, int first, int last)
+{
+    if (set->dirtyLast <= set->dirtyFirst)
+    {
+        set->dirtyFirst = first;
+        set->dirtyLast = last;
+    }
+    else
+    {
+        if (first < set->dirtyFirst) set->dirtyFirst = first;
+        if (last > set->dirtyLast) set->dirtyLast = last;
+    }
+}
+
+R3DDEF int AddLight(R3DLightSet* set, R3DLight light)
+{
+    if (set->count >= LIGHT_SET_MAX_LIGHTS)
+    {
+        TraceLog(LOG_WARNING, "LIGHTING: Light set is full (%i lights)", LIGHT_SET_MAX_LIGHTS);
+        return -1;
+    }
+
+    int index = set->count++;
+    set->lights[index] = light;
+    set->countDirty = true;
+    SetLightSetDirty(set, index, index + 1);
+
+    return index;
+}
+
+R3DDEF void SetLight(R3DLightSet* set, int index, R3DLight light)
+{
+    if ((index < 0) || (index >= set->count)) return;
+
+    set->lights[index] = light;
+    SetLightSetDirty(set, index, index + 1);
+}
+
+R3DDEF void RemoveLight(R3DLightSet* set, int index)
+{
+    if ((index < 0) || (index >= set->count)) return;
+
+    set->count--;
+    set->countDirty = true;
+    if (index < set->count)
+    {
+        set->lights[index] = set->lights[set->count];
+        SetLightSetDirty(set, index, index + 1);
+    }
+}
+
+R3DDEF void UpdateLightSet(R3DLightSet* set)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, set->ubo);
+
+    if (set->countDirty)
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(int), &set->count);
+        set->countDirty = false;
+    }
+
+    if (set->dirtyLast > set->dirtyFirst)
+    {
+        float* staging = (float*)set->data;
+        for (int i = set->dirtyFirst; i < set->dirtyLast; i++)
+        {
+            R3DLight light = set->lights[i];
+            float* packed = staging + i*LIGHT_SET_LIGHT_FLOATS;
+            packed[0] = light.position.x; packed[1] = light.position.y; packed[2] = light.position.z; packed[3] = light.linear;
+            packed[4] = light.color.x; packed[5] = light.color.y; packed[6] = light.color.z; packed[7] = light.quadratic;
+            packed[8] = light.direction.x; packed[9] = light.direction.y; packed[10] = light.direction.z;
+            memcpy(packed + 11, &light.type, sizeof(int));
+            int shadow = light.shadow - 1;
+            packed[12] = cosf(light.spotAngle*DEG2RAD);
+            memcpy(packed + 13, &shadow, sizeof(int));
+            packed[14] = packed[15] = 0.0f;
+        }
+
+        int size = LIGHT_SET_LIGHT_FLOATS*sizeof(float);
+        glBufferSubData(GL_UNIFORM_BUFFER, LIGHT_SET_HEADER_SIZE + set->dirtyFirst*size, (set->dirtyLast - set->dirtyFirst)*size, staging + set->dirtyFirst*LIGHT_SET_LIGHT_FLOATS);
+        set->dirtyFirst = set->dirtyLast = 0;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+R3DDEF void SetShaderLightSet(Shader shader, R3DLightSet set)
+{
+    unsigned int block = glGetUniformBlockIndex(shader.id, "LightBlock");
+    if (block == GL_INVALID_INDEX)
+    {
+        TraceLog(LOG_WARNING, "SHADER: [ID %i] LightBlock uniform block not found", shader.id);
+        return;
+    }
+
+    glUniformBlockBinding(shader.id, block, LIGHT_SET_BINDING);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_SET_BINDING, set.ubo);
+}
+// Joint bilateral upsample of a reduced resolution lighting pass, the bilinear weights of the four nearest lighting
+// samples are scaled by how close their GBuffer depth and normal are to the pixel ones, so lighting does not leak across edges
+static const char* lightingUpsampleFS =
+    "#version 330\n"
+    "uniform sampler2D colorbuffer;\n"
+    "uniform sampler2D normalbuffer;\n"
+    "uniform sampler2D depthbuffer;\n"
+    "uniform sampler2D emissionbuffer;\n"
+    "uniform sampler2D lightingbuffer;\n"
+    "uniform int gbufferLayout;\n"
+    "uniform vec2 gbufferScale;\n"
+    "uniform vec2 lightingViewport;\n"  // Part of the lighting buffer drawn by the lighting pass
+    "uniform vec4 viewport;\n"
+    "uniform vec2 depthRange;\n"        // Camera near and far planes
+    "out vec4 finalColor;\n"
+    "vec3 fetch_normal(ivec2 texel)\n"
+    "{\n"
+    "    if (gbufferLayout == 1) return decode_normal(texelFetch(normalbuffer, texel, 0).rg);\n"
+    "    return texelFetch(normalbuffer, texel, 0).rgb;\n"
+    "}\n"
+    "float fetch_depth(ivec2 texel)\n"
+    "{\n"
+    "    float depth = texelFetch(depthbuffer, texel, 0).r;\n"
+    "    return depthRange.x*depthRange.y/(depthRange.y - depth*(depthRange.y - depthRange.x));\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 uv = (gl_FragCoord.xy - viewport.xy)/viewport.zw;\n"
+    "    vec2 gbufferViewport = vec2(textureSize(depthbuffer, 0))*gbufferScale;\n"
+    "    ivec2 pixel = ivec2(uv*gbufferViewport);\n"
+    "    float depth = fetch_depth(pixel);\n"
+    "    vec3 normal = fetch_normal(pixel);\n"
+    "    vec2 position = uv*lightingViewport - 0.5;\n"
+    "    vec2 base = floor(position);\n"
+    "    vec2 f = position - base;\n"
+    "    vec4 lighting = vec4(0.0);\n"
+    "    float total = 0.0;\n"
+    "    vec4 closest = vec4(0.0);\n"
+    "    float closestDelta = 1e30;\n"
+    "    for (int i = 0; i < 4; i++) {\n"
+    "        vec2 offset = vec2(i & 1, i >> 1);\n"
+    "        vec2 tap = clamp(base + offset, vec2(0.0), lightingViewport - 1.0);\n"
+    // The lighting pass sampled one of the 2x2 GBuffer texels around the sample center, which one depends on rounding..
+    // the sample is only trusted as much as the least similar of them
+    "        ivec2 texel = ivec2(floor((tap + 0.5)/lightingViewport*gbufferViewport - 0.5));\n"
+    "        float delta = 0.0;\n"
+    "        float facing = 1.0;\n"
+    "        for (int j = 0; j < 4; j++) {\n"
+    "            ivec2 candidate = clamp(texel + ivec2(j & 1, j >> 1), ivec2(0), ivec2(gbufferViewport) - 1);\n"
+    "            delta = max(delta, abs(fetch_depth(candidate) - depth));\n"
+    "            facing = min(facing, dot(fetch_normal(candidate), normal));\n"
+    "        }\n"
+    "        vec4 value = texelFetch(lightingbuffer, ivec2(tap), 0);\n"
+    "        float weight = mix(1.0 - f.x, f.x, offset.x)*mix(1.0 - f.y, f.y, offset.y);\n"
+    "        weight *= exp(-delta/(depth*0.05))*pow(max(facing, 0.0), 8.0);\n"
+    "        lighting += value*weight;\n"
+    "        total += weight;\n"
+    "        if (delta < closestDelta) { closestDelta = delta; closest = value; }\n"
+    "    }\n"
+    "    lighting = (total > 1e-4) ? lighting/total : closest;\n"  // No sample on the same surface, the closest in depth is the best guess
+    "    finalColor = vec4(texelFetch(colorbuffer, pixel, 0).rgb*lighting.rgb + lighting.a + texelFetch(emissionbuffer, pixel, 0).rgb, 1.0);\n"
+    "}\n";
+
+// Lighting buffer upsample shader uniforms
+typedef enum {
+    LIGHTING_UPSAMPLE_LOC_LAYOUT = 0,
+    LIGHTING_UPSAMPLE_LOC_SCALE,
+    LIGHTING_UPSAMPLE_LOC_LIGHTING_VIEWPORT,
+    LIGHTING_UPSAMPLE_LOC_VIEWPORT,
+    LIGHTING_UPSAMPLE_LOC_DEPTH_RANGE,
+    LIGHTING_UPSAMPLE_LOC_COUNT
+} LightingUpsampleLocation;
+
+static const char* lightingUpsampleUniforms[LIGHTING_UPSAMPLE_LOC_COUNT] = {
+    "gbufferLayout", "gbufferScale", "lightingViewport", "viewport", "depthRange"
+};
+
+typedef struct LightingBufferData {
+    Shader upsampleShader;
+    int locs[LIGHTING_UPSAMPLE_LOC_COUNT];
+    int viewportWidth;               // Part of the lighting buffer drawn this frame
+    int viewportHeight;
+    int framebuffer;                 // Framebuffer and viewport to restore after the lighting pass
+    int viewport[4];
+} LightingBufferData;
+
+R3DDEF R3DLightingBuffer LoadLightingBuffer(int width, int height, int resolution)
+{
+    R3DLightingBuffer buffer = { 0 };
+    if ((resolution != LIGHTING_RESOLUTION_HALF) && (resolution != LIGHTING_RESOLUTION_QUARTER)) resolution = LIGHTING_RESOLUTION_FULL;
+    buffer.resolution = resolution;
+    buffer.width = (width + resolution - 1)/resolution;
+    buffer.height = (height + resolution - 1)/resolution;
+
+    // Full resolution lighting is drawn straight into the output
+    if (resolution == LIGHTING_RESOLUTION_FULL) return buffer;
+
+    glGenFramebuffers(1, &buffer.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, buffer.framebuffer);
+    buffer.lighting = LoadGBufferTarget(buffer.width, buffer.height, GL_RGBA16F, GL_RGBA, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, GL_COLOR_ATTACHMENT0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) TraceLog(LOG_WARNING, "LIGHTING: Lighting buffer framebuffer is not complete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    LightingBufferData* data = (LightingBufferData*)R3D_CALLOC(1, sizeof(LightingBufferData));
+    data->upsampleShader = LoadGBufferReaderShader(r3dFullscreenVS, lightingUpsampleFS);
+    for (int i = 0; i < LIGHTING_UPSAMPLE_LOC_COUNT; i++) data->locs[i] = GetShaderLocation(data->upsampleShader, lightingUpsampleUniforms[i]);
+
+    // GBuffer textures on the units of their attachment type, as light volumes
+    glUseProgram(data->upsampleShader.id);
+    glUniform1i(GetShaderLocation(data->upsampleShader, "normalbuffer"), GBUFFER_ATTACHMENT_NORMAL);
+    glUniform1i(GetShaderLocation(data->upsampleShader, "colorbuffer"), GBUFFER_ATTACHMENT_ALBEDO_SPEC);
+    glUniform1i(GetShaderLocation(data->upsampleShader, "emissionbuffer"), GBUFFER_ATTACHMENT_EMISSION);
+    glUniform1i(GetShaderLocation(data->upsampleShader, "depthbuffer"), GBUFFER_MAX_ATTACHMENTS);
+    glUniform1i(GetShaderLocation(data->upsampleShader, "lightingbuffer"), GBUFFER_MAX_ATTACHMENTS + 1);
+    glUniform2f(data->locs[LIGHTING_UPSAMPLE_LOC_DEPTH_RANGE], (float)RL_CULL_DISTANCE_NEAR, (float)RL_CULL_DISTANCE_FAR);
+    glUseProgram(0);
+    buffer.data = data;
+
+    TraceLog(LOG_INFO, "LIGHTING: Lighting buffer loaded successfully (%i x %i, 1/%i resolution)", buffer.width, buffer.height, resolution);
+
+    return buffer;
+}
+
+R3DDEF void UnloadLightingBuffer(R3DLightingBuffer buffer)
+{
+    LightingBufferData* data = (LightingBufferData*)buffer.data;
+    if (data == NULL) return;
+
+    UnloadShader(data->upsampleShader);
+    rlUnloadFramebuffer(buffer.framebuffer);
+    rlUnloadTexture(buffer.lighting.id);
+    R3D_FREE(data);
+}
+
+R3DDEF void BeginLightingMode(R3DLightingBuffer buffer, GBuffer gbuffer, Shader shader)
+{
+    rlDrawRenderBatchActive();
+    BeginProfilerPass(PROFILER_PASS_LIGHTING);
+
+    int demodulate = (buffer.resolution != LIGHTING_RESOLUTION_FULL)? 1 : 0;
+    int demodulateLoc = GetShaderLocation(shader, "lightingDemodulate");
+    if (demodulateLoc != -1) SetShaderValue(shader, demodulateLoc, &demodulate, SHADER_UNIFORM_INT);
+    else if (demodulate) TraceLog(LOG_WARNING, "LIGHTING: Lighting shader [ID %i] has no lightingDemodulate uniform, albedo is applied twice", shader.id);
+
+    LightingBufferData* data = (LightingBufferData*)buffer.data;
+    if (data == NULL) return;
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &data->framebuffer);
+    glGetIntegerv(GL_VIEWPORT, data->viewport);
+
+    // Same projection as the full resolution pass, only the viewport shrinks.. so the lighting pass draws the same quad
+    data->viewportWidth = (gbuffer.viewportWidth + buffer.resolution - 1)/buffer.resolution;
+    data->viewportHeight = (gbuffer.viewportHeight + buffer.resolution - 1)/buffer.resolution;
+    if (data->viewportWidth > buffer.width) data->viewportWidth = buffer.width;
+    if (data->viewportHeight > buffer.height) data->viewportHeight = buffer.height;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, buffer.framebuffer);
+    glViewport(0, 0, data->viewportWidth, data->viewportHeight);
+
+    // Specular is kept in alpha
+    glDisable(GL_BLEND);
+}
+
+R3DDEF void EndLightingMode(R3DLightingBuffer buffer, GBuffer gbuffer)
+{
+    rlDrawRenderBatchActive();
+    EndProfilerPass(PROFILER_PASS_LIGHTING);
+
+    LightingBufferData* data = (LightingBufferData*)buffer.data;
+    if (data == NULL) return;
+
+    BeginProfilerPass(PROFILER_PASS_UPSAMPLE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, data->framebuffer);
+    glViewport(data->viewport[0], data->viewport[1], data->viewport[2], data->viewport[3]);
+
+    BindGBufferAttachments(gbuffer);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_MAX_ATTACHMENTS);
+    glBindTexture(GL_TEXTURE_2D, gbuffer.depth.id);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_MAX_ATTACHMENTS + 1);
+    glBindTexture(GL_TEXTURE_2D, buffer.lighting.id);
+
+    glUseProgram(data->upsampleShader.id);
+    glUniform1i(data->locs[LIGHTING_UPSAMPLE_LOC_LAYOUT], gbuffer.layout);
+    glUniform2f(data->locs[LIGHTING_UPSAMPLE_LOC_SCALE], (float)gbuffer.viewportWidth/(float)gbuffer.width, (float)gbuffer.viewportHeight/(float)gbuffer.height);
+    glUniform2f(data->locs[LIGHTING_UPSAMPLE_LOC_LIGHTING_VIEWPORT], (float)data->viewportWidth, (float)data->viewportHeight);
+    glUniform4f(data->locs[LIGHTING_UPSAMPLE_LOC_VIEWPORT], (float)data->viewport[0], (float)data->viewport[1], (float)data->viewport[2], (float)data->viewport[3]);
+    DrawFullscreenTriangle();
+
+    glUseProgram(0);
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_BLEND);
+
+    EndProfilerPass(PROFILER_PASS_UPSAMPLE);
+}
+
+// Ambient occlusion of a half resolution pixel, blended with the reprojected history.. outputs (occlusion, view depth)
+// The kernel is a cosine weighted spiral, every pixel and frame turns it so the history averages many directions
+static const char* ssaoFS =
+    "#version 330\n"
+    "uniform sampler2D normalbuffer;\n"
+    "uniform sampler2D depthbuffer;\n"
+    "uniform sampler2D historybuffer;\n"
+    "uniform int gbufferLayout;\n"
+    "uniform vec2 gbufferScale;\n"
+    "uniform vec2 prevGbufferScale;\n"
+    "uniform mat4 viewProj;\n"
+    "uniform mat4 invViewProj;\n"
+    "uniform mat4 prevViewProj;\n"
+    "uniform vec2 depthRange;\n"        // Camera near and far planes
+    "uniform float radius;\n"
+    "uniform float intensity;\n"
+    "uniform float bias;\n"
+    "uniform int kernelSize;\n"
+    "uniform float temporalWeight;\n"   // 0 without history
+    "uniform int frame;\n"
+    "out vec4 finalColor;\n"
+    "float linear_depth(float depth)\n"
+    "{\n"
+    "    return depthRange.x*depthRange.y/(depthRange.y - depth*(depthRange.y - depthRange.x));\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 size = vec2(textureSize(depthbuffer, 0));\n"
+    "    vec2 uv = gl_FragCoord.xy/vec2(textureSize(historybuffer, 0));\n"
+    "    ivec2 texel = min(ivec2(uv*size), ivec2(size) - 1);\n"
+    "    float depth = texelFetch(depthbuffer, texel, 0).r;\n"
+    "    if (depth >= 1.0) { finalColor = vec4(1.0, depthRange.y, 0.0, 1.0); return; }\n"
+    "    vec2 center = (vec2(texel) + 0.5)/size;\n"    // Position of the depth texel read, not of the half resolution pixel
+    "    vec4 world = invViewProj*vec4(vec3(center/gbufferScale, depth)*2.0 - 1.0, 1.0);\n"
+    "    vec3 position = world.xyz/world.w;\n"
+    "    vec3 normal = (gbufferLayout == 1) ? decode_normal(texelFetch(normalbuffer, texel, 0).rg) : normalize(texelFetch(normalbuffer, texel, 0).rgb);\n"
+    "    float viewDepth = linear_depth(depth);\n"
+    "    float noise = fract(52.9829189*fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));\n"  // Interleaved gradient noise
+    "    float rotation = (noise + float(frame)*0.618034)*6.2831853;\n"
+    "    vec3 helper = (abs(normal.y) > 0.9) ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);\n"
+    "    vec3 tangent = normalize(cross(helper, normal));\n"
+    "    vec3 bitangent = cross(normal, tangent);\n"
+    "    float occlusion = 0.0;\n"
+    "    for (int i = 0; i < kernelSize; i++) {\n"
+    "        float t = (float(i) + 0.5)/float(kernelSize);\n"
+    "        float phi = rotation + float(i)*2.3999632;\n"  // Golden angle
+    "        float r = sqrt(t);\n"
+    "        vec3 dir = (tangent*cos(phi) + bitangent*sin(phi))*r + normal*sqrt(1.0 - t);\n"
+    "        float scale = fract(t*5.0 + noise);\n"           // Distances spread over the radius, more of them close
+    "        vec4 clip = viewProj*vec4(position + dir*radius*mix(0.1, 1.0, scale*scale), 1.0);\n"
+    "        if (clip.w <= 0.0) continue;\n"
+    "        vec2 sampleUv = (clip.xy/clip.w*0.5 + 0.5)*gbufferScale;\n"
+    "        if (any(lessThan(sampleUv, vec2(0.0))) || any(greaterThan(sampleUv, gbufferScale))) continue;\n"
+    "        float sceneDepth = linear_depth(texelFetch(depthbuffer, min(ivec2(sampleUv*size), ivec2(size) - 1), 0).r);\n"
+    "        float range = smoothstep(0.0, 1.0, radius/max(abs(viewDepth - sceneDepth), 1e-4));\n"  // Far occluders don't count
+    // A texel covers more depth with the distance, the bias grows with it so grazing surfaces don't occlude themselves
+    "        occlusion += ((sceneDepth < clip.w - bias - clip.w*0.005) ? 1.0 : 0.0)*range;\n"
+    "    }\n"
+    "    float ao = clamp(1.0 - intensity*occlusion/float(kernelSize), 0.0, 1.0);\n"
+    "    float weight = 0.0;\n"
+    "    float history = ao;\n"
+    "    vec4 prev = prevViewProj*vec4(position, 1.0);\n"
+    "    if (prev.w > 0.0) {\n"
+    "        vec2 prevUv = (prev.xy/prev.w*0.5 + 0.5)*prevGbufferScale;\n"
+    "        if (all(greaterThanEqual(prevUv, vec2(0.0))) && all(lessThanEqual(prevUv, prevGbufferScale))) {\n"
+    "            vec2 previous = texture(historybuffer, prevUv).rg;\n"
+    // The point was somewhere else last frame (disocclusion), its history belongs to another surface
+    "            if (abs(previous.y - prev.w) < 0.02*prev.w) { weight = temporalWeight; history = previous.x; }\n"
+    "        }\n"
+    "    }\n"
+    "    finalColor = vec4(mix(ao, history, weight), viewDepth, 0.0, 1.0);\n"
+    "}\n";
+
+// Separable bilateral blur of (occlusion, view depth), taps on other surfaces lose their weight
+static const char* ssaoBlurFS =
+    "#version 330\n"
+    "uniform sampler2D ssaobuffer;\n"
+    "uniform ivec2 direction;\n"
+    "uniform ivec2 ssaoViewport;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    const float gaussian[5] = float[](0.2270, 0.1946, 0.1216, 0.0541, 0.0162);\n"
+    "    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+    "    vec2 center = texelFetch(ssaobuffer, pixel, 0).rg;\n"
+    "    float sum = center.r*gaussian[0];\n"
+    "    float total = gaussian[0];\n"
+    "    for (int i = 1; i < 5; i++) {\n"
+    "        for (int s = -1; s <= 1; s += 2) {\n"
+    "            vec2 tap = texelFetch(ssaobuffer, clamp(pixel + direction*i*s, ivec2(0), ssaoViewport - 1), 0).rg;\n"
+    "            float weight = gaussian[i]*exp(-abs(tap.g - center.g)/(center.g*0.02));\n"
+    "            sum += tap.r*weight;\n"
+    "            total += weight;\n"
+    "        }\n"
+    "    }\n"
+    "    finalColor = vec4(sum/total, center.g, 0.0, 1.0);\n"
+    "}\n";
+
+// SSAO shader uniforms
+typedef enum {
+    SSAO_LOC_LAYOUT = 0,
+    SSAO_LOC_SCALE,
+    SSAO_LOC_PREV_SCALE,
+    SSAO_LOC_VIEW_PROJ,
+    SSAO_LOC_INV_VIEW_PROJ,
+    SSAO_LOC_PREV_VIEW_PROJ,
+    SSAO_LOC_RADIUS,
+    SSAO_LOC_INTENSITY,
+    SSAO_LOC_BIAS,
+    SSAO_LOC_KERNEL_SIZE,
+    SSAO_LOC_TEMPORAL_WEIGHT,
+    SSAO_LOC_FRAME,
+    SSAO_LOC_COUNT
+} SSAOLocation;
+
+static const char* ssaoUniforms[SSAO_LOC_COUNT] = {
+    "gbufferLayout", "gbufferScale", "prevGbufferScale", "viewProj", "invViewProj", "prevViewProj", "radius", "intensity",
+    "bias", "kernelSize", "temporalWeight", "frame"
+};
+
+typedef struct SSAOData {
+    Shader shader;
+    Shader blurShader;
+    int locs[SSAO_LOC_COUNT];
+    int blurDirectionLoc;
+    int blurViewportLoc;
+    bool hasHistory;                 // The previous frame was computed, its camera is set
+    Matrix prevViewProj;
+    Vector2 prevScale;
+} SSAOData;
+
+R3DDEF R3DSSAO LoadSSAO(int width, int height)
+{
+    R3DSSAO ssao = { 0 };
+    ssao.width = (width + 1)/2;
+    ssao.height = (height + 1)/2;
+    ssao.radius = 0.5f;
+    ssao.intensity = 1.0f;
+    ssao.bias = 0.02f;
+    ssao.kernelSize = 8;
+    ssao.temporalWeight = 0.9f;
+
+    glGenFramebuffers(1, &ssao.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, ssao.framebuffer);
+    ssao.history[0] = LoadGBufferTarget(ssao.width, ssao.height, GL_RG16F, GL_RG, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, GL_COLOR_ATTACHMENT0);
+    ssao.history[1] = LoadGBufferTarget(ssao.width, ssao.height, GL_RG16F, GL_RG, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, GL_COLOR_ATTACHMENT0);
+    ssao.blur = LoadGBufferTarget(ssao.width, ssao.height, GL_RG16F, GL_RG, GL_FLOAT, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, GL_COLOR_ATTACHMENT0);
+    ssao.occlusion = LoadGBufferTarget(ssao.width, ssao.height, GL_R8, GL_RED, GL_UNSIGNED_BYTE, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE, GL_COLOR_ATTACHMENT0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) TraceLog(LOG_WARNING, "LIGHTING: SSAO framebuffer is not complete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // History is reprojected between texels, the occlusion is upsampled by the lighting pass
+    for (int i = 0; i < 2; i++)
+    {
+        rlTextureParameters(ssao.history[i].id, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_LINEAR);
+        rlTextureParameters(ssao.history[i].id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_LINEAR);
+        rlTextureParameters(ssao.history[i].id, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_CLAMP);
+        rlTextureParameters(ssao.history[i].id, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_CLAMP);
+    }
+    rlTextureParameters(ssao.occlusion.id, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_LINEAR);
+    rlTextureParameters(ssao.occlusion.id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_LINEAR);
+    rlTextureParameters(ssao.occlusion.id, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_CLAMP);
+    rlTextureParameters(ssao.occlusion.id, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_CLAMP);
+
+    // The lighting shaders multiply by the rgb of the ssaobuffer
+    glBindTexture(GL_TEXTURE_2D, ssao.occlusion.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    SSAOData* data = (SSAOData*)R3D_CALLOC(1, sizeof(SSAOData));
+    data->shader = LoadGBufferReaderShader(r3dFullscreenVS, ssaoFS);
+    for (int i = 0; i < SSAO_LOC_COUNT; i++) data->locs[i] = GetShaderLocation(data->shader, ssaoUniforms[i]);
+    data->blurShader = LoadShaderFromMemory(r3dFullscreenVS, ssaoBlurFS);
+    data->blurDirectionLoc = GetShaderLocation(data->blurShader, "direction");
+    data->blurViewportLoc = GetShaderLocation(data->blurShader, "ssaoViewport");
+
+    // GBuffer textures on the units of their attachment type, as the lighting buffer upsample
+    glUseProgram(data->shader.id);
+    glUniform1i(GetShaderLocation(data->shader, "normalbuffer"), GBUFFER_ATTACHMENT_NORMAL);
+    glUniform1i(GetShaderLocation(data->shader, "depthbuffer"), GBUFFER_MAX_ATTACHMENTS);
+    glUniform1i(GetShaderLocation(data->shader, "historybuffer"), GBUFFER_MAX_ATTACHMENTS + 1);
+    glUniform2f(GetShaderLocation(data->shader, "depthRange"), (float)RL_CULL_DISTANCE_NEAR, (float)RL_CULL_DISTANCE_FAR);
+    glUseProgram(data->blurShader.id);
+    glUniform1i(GetShaderLocation(data->blurShader, "ssaobuffer"), GBUFFER_MAX_ATTACHMENTS + 1);
+    glUseProgram(0);
+    ssao.data = data;
+
+    TraceLog(LOG_INFO, "LIGHTING: SSAO loaded successfully (%i x %i)", ssao.width, ssao.height);
+
+    return ssao;
+}
+
+R3DDEF void UnloadSSAO(R3DSSAO ssao)
+{
+    SSAOData* data = (SSAOData*)ssao.data;
+    if (data == NULL) return;
+
+    UnloadShader(data->shader);
+    UnloadShader(data->blurShader);
+    rlUnloadFramebuffer(ssao.framebuffer);
+    rlUnloadTexture(ssao.history[0].id);
+    rlUnloadTexture(ssao.history[1].id);
+    rlUnloadTexture(ssao.blur.id);
+    rlUnloadTexture(ssao.occlusion.id);
+    R3D_FREE(data);
+}
+
+// Draws a full screen pass of the SSAO into one of its targets, reading another on the history unit
+static void DrawSSAOPass(Texture target, Texture source)
+{
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.id, 0);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_MAX_ATTACHMENTS + 1);
+    glBindTexture(GL_TEXTURE_2D, source.id);
+    DrawFullscreenTriangle();
+}
+
+R3DDEF void UpdateSSAO(R3DSSAO* ssao, GBuffer gbuffer, Camera camera)
+{
+    SSAOData* data = (SSAOData*)ssao->data;
+    if (data == NULL) return;
+
+    // Kernel size follows the measured cost, one sample at a time as the timings average over many frames
+    if ((ssao->budget > 0.0f) && (ssao->frame%SSAO_BUDGET_INTERVAL == 0))
+    {
+        R3DPassStats stats = GetFrameStats().passes[PROFILER_PASS_SSAO];
+        if (stats.samples > 0)
+        {
+            if ((stats.gpuAvg > ssao->budget) && (ssao->kernelSize > SSAO_MIN_KERNEL)) ssao->kernelSize--;
+            else if ((stats.gpuAvg < ssao->budget*0.75f) && (ssao->kernelSize < SSAO_MAX_KERNEL)) ssao->kernelSize++;
+        }
+    }
+    if (ssao->kernelSize < 1) ssao->kernelSize = 1;
+    if (ssao->kernelSize > SSAO_MAX_KERNEL) ssao->kernelSize = SSAO_MAX_KERNEL;
+
+    rlDrawRenderBatchActive();
+    BeginProfilerPass(PROFILER_PASS_SSAO);
+
+    int framebuffer = 0;
+    int viewport[4] = { 0 };
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // Half of the GBuffer viewport, the rest of the targets is not drawn (dynamic resolution)
+    int viewportWidth = (gbuffer.viewportWidth + 1)/2;
+    int viewportHeight = (gbuffer.viewportHeight + 1)/2;
+    if (viewportWidth > ssao->width) viewportWidth = ssao->width;
+    if (viewportHeight > ssao->height) viewportHeight = ssao->height;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, ssao->framebuffer);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+    glDisable(GL_BLEND);
+
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_ATTACHMENT_NORMAL);
+    glBindTexture(GL_TEXTURE_2D, GetGBufferAttachment(gbuffer, GBUFFER_ATTACHMENT_NORMAL).id);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_MAX_ATTACHMENTS);
+    glBindTexture(GL_TEXTURE_2D, gbuffer.depth.id);
+
+    Matrix viewProj = GetDeferredModeViewProjection(gbuffer, camera);
+    Vector2 scale = { (float)gbuffer.viewportWidth/(float)gbuffer.width, (float)gbuffer.viewportHeight/(float)gbuffer.height };
+    if (!data->hasHistory)
+    {
+        data->prevViewProj = viewProj;
+        data->prevScale = scale;
+    }
+
+    // Occlusion and temporal accumulation, from one history target into the other
+    int current = ssao->frame%2;
+    glUseProgram(data->shader.id);
+    glUniform1i(data->locs[SSAO_LOC_LAYOUT], gbuffer.layout);
+    glUniform2f(data->locs[SSAO_LOC_SCALE], scale.x, scale.y);
+    glUniform2f(data->locs[SSAO_LOC_PREV_SCALE], data->prevScale.x, data->prevScale.y);
+    glUniformMatrix4fv(data->locs[SSAO_LOC_VIEW_PROJ], 1, false, MatrixToFloat(viewProj));
+    glUniformMatrix4fv(data->locs[SSAO_LOC_INV_VIEW_PROJ], 1, false, MatrixToFloat(MatrixInvert(viewProj)));
+    glUniformMatrix4fv(data->locs[SSAO_LOC_PREV_VIEW_PROJ], 1, false, MatrixToFloat(data->prevViewProj));
+    glUniform1f(data->locs[SSAO_LOC_RADIUS], ssao->radius);
+    glUniform1f(data->locs[SSAO_LOC_INTENSITY], ssao->intensity);
+    glUniform1f(data->locs[SSAO_LOC_BIAS], ssao->bias);
+    glUniform1i(data->locs[SSAO_LOC_KERNEL_SIZE], ssao->kernelSize);
+    glUniform1f(data->locs[SSAO_LOC_TEMPORAL_WEIGHT], data->hasHistory? ssao->temporalWeight : 0.0f);
+    glUniform1i(data->locs[SSAO_LOC_FRAME], ssao->frame);
+    DrawSSAOPass(ssao->history[current], ssao->history[1 - current]);
+
+    // Blur, horizontal then vertical.. the history keeps the unblurred occlusion
+    glUseProgram(data->blurShader.id);
+    glUniform2i(data->blurViewportLoc, viewportWidth, viewportHeight);
+    glUniform2i(data->blurDirectionLoc, 1, 0);
+    DrawSSAOPass(ssao->blur, ssao->history[current]);
+    glUniform2i(data->blurDirectionLoc, 0, 1);
+    DrawSSAOPass(ssao->occlusion, ssao->blur);
+
+    glUseProgram(0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glEnable(GL_BLEND);
+
+    data->prevViewProj = viewProj;
+    data->prevScale = scale;
+    data->hasHistory = true;
+    ssao->frame++;
+
+    EndProfilerPass(PROFILER_PASS_SSAO);
+}
+#pragma endregion
+
+#pragma region DECALS
+// Decal box, instanced once per decal.. the decal data holds the box axes with the center in their w
+static const char* decalVS =
+    "#version 330\n"
+    "layout (location = 0) in vec3 vertexPosition;\n"
+    "uniform samplerBuffer decalData;\n"
+    "uniform mat4 viewProj;\n"
+    "flat out int decalIndex;\n"
+    "void main()\n"
+    "{\n"
+    "    int base = gl_InstanceID*6;\n"    // DECAL_DATA_TEXELS
+    "    vec4 axisX = texelFetch(decalData, base);\n"
+    "    vec4 axisY = texelFetch(decalData, base + 1);\n"
+    "    vec4 axisZ = texelFetch(decalData, base + 2);\n"
+    // A mirrored box covers the same volume with one axis flipped, which keeps its faces winding
+    "    if (dot(cross(axisX.xyz, axisY.xyz), axisZ.xyz) < 0.0) axisX.xyz = -axisX.xyz;\n"
+    "    vec3 position = vec3(axisX.w, axisY.w, axisZ.w) + axisX.xyz*vertexPosition.x + axisY.xyz*vertexPosition.y + axisZ.xyz*vertexPosition.z;\n"
+    "    decalIndex = gl_InstanceID;\n"
+    "    gl_Position = viewProj*vec4(position, 1.0);\n"
+    "}\n";
+
+// Blends the decals of a pixel in order, from the cluster list.. only the first decal containing the pixel writes it
+// Albedo is blended by the GL (dst*transmittance + decals), normals are read from a copy of the attachment
+static const char* decalFS =
+    "#version 330\n"
+    "flat in int decalIndex;\n"
+    "uniform sampler2D depthbuffer;\n"
+    "uniform sampler2D normalbuffer;\n"
+    "uniform sampler2D decalAlbedo;\n"
+    "uniform sampler2D decalNormal;\n"
+    "uniform samplerBuffer decalData;\n"
+    "uniform usamplerBuffer lightClusterGrid;\n"
+    "uniform usamplerBuffer lightClusterIndices;\n"
+    "uniform ivec3 lightClusterSize;\n"
+    "uniform vec2 lightClusterScreen;\n"
+    "uniform vec2 lightClusterDepth;\n"
+    "uniform mat4 lightClusterView;\n"
+    "uniform int gbufferLayout;\n"
+    "uniform vec2 gbufferScale;\n"
+    "uniform mat4 invViewProj;\n"
+    "uniform int decalNormals;\n"      // 1: the normal atlas is bound and the normals are written
+    "uniform float angleFade;\n"
+    "layout (location = 0) out vec4 galbedospec;\n"
+    "layout (location = 1) out vec4 gnormal;\n"
+    "vec2 encode_normal(vec3 n)\n"
+    "{\n"
+    "    n /= (abs(n.x) + abs(n.y) + abs(n.z));\n"
+    "    n.xy = (n.z >= 0.0) ? n.xy : (1.0 - abs(n.yx))*vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n"
+    "    return n.xy*0.5 + 0.5;\n"
+    "}\n"
+    "vec3 decal_local(int decal, vec3 position)\n"
+    "{\n"
+    "    vec4 axisX = texelFetch(decalData, decal*6);\n"
+    "    vec4 axisY = texelFetch(decalData, decal*6 + 1);\n"
+    "    vec4 axisZ = texelFetch(decalData, decal*6 + 2);\n"
+    "    vec3 d = position - vec3(axisX.w, axisY.w, axisZ.w);\n"
+    "    return vec3(dot(d, axisX.xyz)/dot(axisX.xyz, axisX.xyz), dot(d, axisY.xyz)/dot(axisY.xyz, axisY.xyz), dot(d, axisZ.xyz)/dot(axisZ.xyz, axisZ.xyz));\n"
+    "}\n"
+    "bool decal_inside(vec3 local)\n"
+    "{\n"
+    "    return all(lessThanEqual(abs(local), vec3(0.5)));\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+    "    float depth = texelFetch(depthbuffer, pixel, 0).r;\n"
+    "    vec2 uv = (vec2(pixel) + 0.5)/(vec2(textureSize(depthbuffer, 0))*gbufferScale);\n"
+    "    vec4 world = invViewProj*vec4(vec3(uv, depth)*2.0 - 1.0, 1.0);\n"
+    "    vec3 position = world.xyz/world.w;\n"
+    "    vec3 dpdx = dFdx(position);\n"     // Atlas mip selection, before any discard
+    "    vec3 dpdy = dFdy(position);\n"
+    "    if ((depth >= 1.0) || !decal_inside(decal_local(decalIndex, position))) discard;\n"
+    "    float viewDepth = max(-(lightClusterView*vec4(position, 1.0)).z, 1e-4);\n"
+    "    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy*vec2(lightClusterSize.xy)/lightClusterScreen), int(log(viewDepth)*lightClusterDepth.x + lightClusterDepth.y));\n"
+    "    cluster = clamp(cluster, ivec3(0), lightClusterSize - 1);\n"
+    "    uvec2 list = texelFetch(lightClusterGrid, (cluster.z*lightClusterSize.y + cluster.y)*lightClusterSize.x + cluster.x).xy;\n"
+    "    uint first = 0u;\n"
+    "    for (; first < list.y; first++) {\n"
+    "        int decal = int(texelFetch(lightClusterIndices, int(list.x + first)).r);\n"
+    "        if (decal == decalIndex) break;\n"
+    "        if (decal_inside(decal_local(decal, position))) discard;\n"
+    "    }\n"
+    "    if (first == list.y) discard;\n"  // Dropped from a full cluster
+    "    vec3 surfaceNormal = (gbufferLayout == 1) ? decode_normal(texelFetch(normalbuffer, pixel, 0).rg) : normalize(texelFetch(normalbuffer, pixel, 0).rgb);\n"
+    "    vec3 normal = surfaceNormal;\n"
+    "    vec3 color = vec3(0.0);\n"
+    "    float transmittance = 1.0;\n"
+    "    for (uint i = first; i < list.y; i++) {\n"
+    "        int decal = int(texelFetch(lightClusterIndices, int(list.x + i)).r);\n"
+    "        vec3 local = decal_local(decal, position);\n"
+    "        if (!decal_inside(local)) continue;\n"
+    "        vec3 axisX = texelFetch(decalData, decal*6).xyz;\n"
+    "        vec3 axisY = texelFetch(decalData, decal*6 + 1).xyz;\n"
+    "        vec3 axisZ = texelFetch(decalData, decal*6 + 2).xyz;\n"
+    "        vec4 source = texelFetch(decalData, decal*6 + 3);\n"
+    "        vec4 tint = texelFetch(decalData, decal*6 + 4);\n"
+    "        float normalOpacity = texelFetch(decalData, decal*6 + 5).x;\n"
+    "        vec2 texcoord = source.xy + (local.xz + 0.5)*source.zw;\n"
+    "        vec2 gradX = vec2(dot(dpdx, axisX)/dot(axisX, axisX), dot(dpdx, axisZ)/dot(axisZ, axisZ))*source.zw;\n"
+    "        vec2 gradY = vec2(dot(dpdy, axisX)/dot(axisX, axisX), dot(dpdy, axisZ)/dot(axisZ, axisZ))*source.zw;\n"
+    "        vec4 albedo = textureGrad(decalAlbedo, texcoord, gradX, gradY)*tint;\n"
+    // Surfaces turning away from the projection axis stretch the decal, it fades out on them
+    "        vec3 up = normalize(axisY);\n"
+    "        float alpha = albedo.a*smoothstep(angleFade*0.5, angleFade, dot(surfaceNormal, up));\n"
+    "        color = color*(1.0 - alpha) + albedo.rgb*alpha;\n"
+    "        transmittance *= 1.0 - alpha;\n"
+    "        if (decalNormals == 1) {\n"
+    "            vec3 n = textureGrad(decalNormal, texcoord, gradX, gradY).rgb*2.0 - 1.0;\n"
+    "            n = normalize(normalize(axisX)*n.x - normalize(axisZ)*n.y + up*n.z);\n"
+    "            normal = normalize(mix(normal, n, alpha*normalOpacity));\n"
+    "        }\n"
+    "    }\n"
+    "    galbedospec = vec4(color, transmittance);\n"
+    "    gnormal = (gbufferLayout == 1) ? vec4(encode_normal(normal), 0.0, 0.0) : vec4(normal, 0.0);\n"
+    "}\n";
+
+// Decal shader uniforms
+typedef enum {
+    DECAL_LOC_VIEW_PROJ = 0,
+    DECAL_LOC_INV_VIEW_PROJ,
+    DECAL_LOC_LAYOUT,
+    DECAL_LOC_SCALE,
+    DECAL_LOC_NORMALS,
+    DECAL_LOC_ANGLE_FADE,
+    DECAL_LOC_COUNT
+} DecalLocation;
+
+static const char* decalUniforms[DECAL_LOC_COUNT] = {
+    "viewProj", "invViewProj", "gbufferLayout", "gbufferScale", "decalNormals", "angleFade"
+};
+
+// Decal shader, box mesh and the copy of the GBuffer normals
+typedef struct DecalsData {
+    Shader shader;
+    int locs[DECAL_LOC_COUNT];
+    unsigned int framebuffer;        // GBuffer albedo (0) and normal (1) attachments, without depth so it can be sampled
+    unsigned int boxVao;
+    unsigned int boxVbo;
+    Texture normalCopy;              // GBuffer normals read by the decals while they write the attachment
+    int normalCopyFormat;            // GBufferAttachmentFormat of the copy
+    float* staging;                  // Decal data upload
+} DecalsData;
+
+// Unit box, counter clockwise faces looking outwards
+static void LoadDecalBox(DecalsData* data)
+{
+    static const float corners[8][3] = {
+        { -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f },
+        { -0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f }, { -0.5f, 0.5f, 0.5f }, { 0.5f, 0.5f, 0.5f }
+    };
+    static const int faces[36] = {
+        0, 2, 1, 1, 2, 3,   // -z
+        4, 5, 6, 5, 7, 6,   // +z
+        0, 4, 2, 2, 4, 6,   // -x
+        1, 3, 5, 3, 7, 5,   // +x
+        0, 1, 4, 1, 5, 4,   // -y
+        2, 6, 3, 3, 6, 7    // +y
+    };
+
+    float vertices[36*3];
+    for (int i = 0; i < 36; i++) memcpy(vertices + i*3, corners[faces[i]], 3*sizeof(float));
+
+    glGenVertexArrays(1, &data->boxVao);
+    glBindVertexArray(data->boxVao);
+    glGenBuffers(1, &data->boxVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, data->boxVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+R3DDEF R3DDecals LoadDecals(int maxDecals, int maxDecalsPerCluster)
+{
+    R3DDecals decals = { 0 };
+    decals.maxDecals = maxDecals;
+    decals.decals = (R3DDecal*)R3D_CALLOC(maxDecals, sizeof(R3DDecal));
+    decals.angleFade = 0.5f;
+
+    LoadLightBuffer(&decals.buffer, &decals.texture, maxDecals*DECAL_DATA_TEXELS*4*sizeof(float), GL_RGBA32F);
+    decals.clusters = LoadLightClusterGrid(0, 0, maxDecals, (maxDecalsPerCluster > 0)? maxDecalsPerCluster : DECAL_CLUSTER_MAX_DECALS);
+
+    DecalsData* data = (DecalsData*)R3D_CALLOC(1, sizeof(DecalsData));
+    data->shader = LoadGBufferReaderShader(decalVS, decalFS);
+    for (int i = 0; i < DECAL_LOC_COUNT; i++) data->locs[i] = GetShaderLocation(data->shader, decalUniforms[i]);
+    data->staging = (float*)R3D_MALLOC(maxDecals*DECAL_DATA_TEXELS*4*sizeof(float));
+    data->normalCopyFormat = -1;
+    glGenFramebuffers(1, &data->framebuffer);
+    LoadDecalBox(data);
+
+    // The atlases take the units of the attachments they change, no attachment is sampled by type here
+    glUseProgram(data->shader.id);
+    glUniform1i(GetShaderLocation(data->shader, "decalAlbedo"), GBUFFER_ATTACHMENT_ALBEDO_SPEC);
+    glUniform1i(GetShaderLocation(data->shader, "decalNormal"), GBUFFER_ATTACHMENT_NORMAL);
+    glUniform1i(GetShaderLocation(data->shader, "depthbuffer"), GBUFFER_MAX_ATTACHMENTS);
+    glUniform1i(GetShaderLocation(data->shader, "normalbuffer"), GBUFFER_MAX_ATTACHMENTS + 1);
+    glUseProgram(0);
+    decals.data = data;
+
+    TraceLog(LOG_INFO, "DECALS: Decal set loaded successfully (%i decals, %i per cluster)", maxDecals, decals.clusters.maxLightsPerCluster);
+
+    return decals;
+}
+
+R3DDEF void UnloadDecals(R3DDecals decals)
+{
+    DecalsData* data = (DecalsData*)decals.data;
+    if (data == NULL) return;
+
+    UnloadShader(data->shader);
+    glDeleteVertexArrays(1, &data->boxVao);
+    glDeleteBuffers(1, &data->boxVbo);
+    rlUnloadFramebuffer(data->framebuffer);
+    if (data->normalCopy.id != 0) rlUnloadTexture(data->normalCopy.id);
+    R3D_FREE(data->staging);
+    R3D_FREE(data);
+
+    glDeleteTextures(1, &decals.texture);
+    glDeleteBuffers(1, &decals.buffer);
+    UnloadLightClusters(decals.clusters);
+    R3D_FREE(decals.decals);
+}
+
+R3DDEF int AddDecal(R3DDecals* decals, R3DDecal decal)
+{
+    if (decals->count >= decals->maxDecals)
+    {
+        TraceLog(LOG_WARNING, "DECALS: Decal set is full (%i decals)", decals->maxDecals);
+        return -1;
+    }
+
+    decals->decals[decals->count] = decal;
+    decals->dirty = true;
+    return decals->count++;
+}
+
+R3DDEF void SetDecal(R3DDecals* decals, int index, R3DDecal decal)
+{
+    if ((index < 0) || (index >= decals->count)) return;
+
+    decals->decals[index] = decal;
+    decals->dirty = true;
+}
+
+R3DDEF void RemoveDecal(R3DDecals* decals, int index)
+{
+    if ((index < 0) || (index >= decals->count)) return;
+
+    // Decals are blended in index order, the next ones keep theirs
+    memmove(decals->decals + index, decals->decals + index + 1, (decals->count - index - 1)*sizeof(R3DDecal));
+    decals->count--;
+    decals->dirty = true;
+}
+
+R3DDEF Matrix GetDecalTransform(Vector3 position, Vector3 normal, float angle, Vector3 size)
+{
+    Vector3 up = Vector3Normalize(normal);
+
+    // Upright on walls (the atlas v goes down), along the world X axis on floors and ceilings
+    Vector3 helper = { 0.0f, 1.0f, 0.0f };
+    if (fabsf(up.y) > 0.9f)
+    {
+        helper.y = 0.0f;
+        helper.z = -1.0f;
+    }
+    Vector3 tangent = Vector3Normalize(Vector3CrossProduct(helper, up));
+    Vector3 bitangent = Vector3CrossProduct(up, tangent);
+
+    // Turned around the normal
+    float c = cosf(angle*DEG2RAD), s = sinf(angle*DEG2RAD);
+    Vector3 x = Vector3Add(Vector3Scale(tangent, c), Vector3Scale(bitangent, s));
+    Vector3 z = Vector3CrossProduct(x, up);
+
+    Matrix transform = MatrixIdentity();
+    transform.m0 = x.x*size.x; transform.m1 = x.y*size.x; transform.m2 = x.z*size.x;
+    transform.m4 = up.x*size.y; transform.m5 = up.y*size.y; transform.m6 = up.z*size.y;
+    transform.m8 = z.x*size.z; transform.m9 = z.y*size.z; transform.m10 = z.z*size.z;
+    transform.m12 = position.x; transform.m13 = position.y; transform.m14 = position.z;
+    return transform;
+}
+
+// Uploads the box axes and center, atlas rectangle, tint and normal opacity of every decal
+static void UploadDecals(R3DDecals* decals, DecalsData* data)
+{
+    for (int i = 0; i < decals->count; i++)
+    {
+        R3DDecal decal = decals->decals[i];
+        Matrix m = decal.transform;
+        float texels[DECAL_DATA_TEXELS*4] = {
+            m.m0, m.m1, m.m2, m.m12,
+            m.m4, m.m5, m.m6, m.m13,
+            m.m8, m.m9, m.m10, m.m14,
+            decal.source.x, decal.source.y, decal.source.width, decal.source.height,
+            decal.tint.r/255.0f, decal.tint.g/255.0f, decal.tint.b/255.0f, decal.tint.a/255.0f,
+            decal.normalOpacity, 0.0f, 0.0f, 0.0f
+        };
+        memcpy(data->staging + i*DECAL_DATA_TEXELS*4, texels, sizeof(texels));
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, decals->buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, decals->count*DECAL_DATA_TEXELS*4*sizeof(float), data->staging);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    decals->dirty = false;
+}
+
+// Copies the GBuffer normals the decals read, the copy follows the attachment size and format
+static void CopyDecalNormals(DecalsData* data, GBuffer gbuffer)
+{
+    int attachment = -1;
+    for (int i = 0; i < gbuffer.attachmentCount; i++)
+    {
+        if (gbuffer.descs[i].type == GBUFFER_ATTACHMENT_NORMAL) attachment = i;
+    }
+    int format = gbuffer.descs[attachment].format;
+
+    if ((data->normalCopy.width != gbuffer.width) || (data->normalCopy.height != gbuffer.height) || (data->normalCopyFormat != format))
+    {
+        if (data->normalCopy.id != 0) rlUnloadTexture(data->normalCopy.id);
+
+        data->normalCopy.width = gbuffer.width;
+        data->normalCopy.height = gbuffer.height;
+        data->normalCopy.format = gbufferFormats[format].pixelFormat;
+        data->normalCopy.mipmaps = 1;
+        data->normalCopyFormat = format;
+        glGenTextures(1, &data->normalCopy.id);
+        glBindTexture(GL_TEXTURE_2D, data->normalCopy.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, gbufferFormats[format].internalFormat, gbuffer.width, gbuffer.height, 0, gbufferFormats[format].format, gbufferFormats[format].type, NULL);
+        rlTextureParameters(data->normalCopy.id, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_NEAREST);
+        rlTextureParameters(data->normalCopy.id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_NEAREST);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer.id);
+    glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment);
+    glBindTexture(GL_TEXTURE_2D, data->normalCopy.id);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, gbuffer.viewportWidth, gbuffer.viewportHeight);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+R3DDEF void DrawDecals(R3DDecals* decals, GBuffer gbuffer, Camera camera)
+{
+    DecalsData* data = (DecalsData*)decals->data;
+    if ((data == NULL) || (decals->count == 0)) return;
+
+    rlDrawRenderBatchActive();
+    BeginProfilerPass(PROFILER_PASS_DECALS);
+
+    if (decals->dirty) UploadDecals(decals, data);
+
+    // Decal lists of the clusters, binned by the bounding sphere of their box over the GBuffer viewport
+    R3DLightClusters* clusters = &decals->clusters;
+    LightClustersData* clusterData = (LightClustersData*)clusters->data;
+    clusters->width = gbuffer.viewportWidth;
+    clusters->height = gbuffer.viewportHeight;
+    clusters->lightCount = decals->count;
+    clusters->view = MatrixLookAt(camera.position, camera.target, camera.up);
+
+    for (int i = 0; i < decals->count; i++)
+    {
+        Matrix m = decals->decals[i].transform;
+        Vector3 center = { m.m12, m.m13, m.m14 };
+        center = Vector3Transform(center, clusters->view);
+        clusterData->lightX[i] = center.x;
+        clusterData->lightY[i] = center.y;
+        clusterData->lightZ[i] = center.z;
+        clusterData->lightRadius[i] = 0.5f*sqrtf(m.m0*m.m0 + m.m1*m.m1 + m.m2*m.m2 + m.m4*m.m4 + m.m5*m.m5 + m.m6*m.m6 + m.m8*m.m8 + m.m9*m.m9 + m.m10*m.m10);
+    }
+
+    BuildLightClusterLists(clusters, camera);
+
+    int framebuffer = 0;
+    int readFramebuffer = 0;
+    int viewport[4] = { 0 };
+    int cullFaceMode = 0;
+    int blendSrcRGB = 0, blendDstRGB = 0, blendSrcAlpha = 0, blendDstAlpha = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_CULL_FACE_MODE, &cullFaceMode);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrcRGB);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blendDstRGB);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDstAlpha);
+    bool depthTest = glIsEnabled(GL_DEPTH_TEST);
+    bool blend = glIsEnabled(GL_BLEND);
+    bool cullFace = glIsEnabled(GL_CULL_FACE);
+
+    // Normals are only written with a normal atlas, then the attachment is read from a copy
+    Texture albedo = GetGBufferAttachment(gbuffer, GBUFFER_ATTACHMENT_ALBEDO_SPEC);
+    Texture normal = GetGBufferAttachment(gbuffer, GBUFFER_ATTACHMENT_NORMAL);
+    bool writeNormals = (decals->normal.id != 0) && (normal.id != 0);
+    if (writeNormals) CopyDecalNormals(data, gbuffer);
+
+    unsigned int buffers[2] = { (unsigned int)((albedo.id != 0)? GL_COLOR_ATTACHMENT0 : GL_NONE), (unsigned int)(writeNormals? GL_COLOR_ATTACHMENT1 : GL_NONE) };
+    glBindFramebuffer(GL_FRAMEBUFFER, data->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedo.id, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, writeNormals? normal.id : 0, 0);
+    glDrawBuffers(2, buffers);
+    glViewport(0, 0, gbuffer.viewportWidth, gbuffer.viewportHeight);
+
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_ATTACHMENT_ALBEDO_SPEC);
+    glBindTexture(GL_TEXTURE_2D, (decals->albedo.id != 0)? decals->albedo.id : rlGetTextureIdDefault());
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_ATTACHMENT_NORMAL);
+    glBindTexture(GL_TEXTURE_2D, decals->normal.id);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_MAX_ATTACHMENTS);
+    glBindTexture(GL_TEXTURE_2D, gbuffer.depth.id);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_MAX_ATTACHMENTS + 1);
+    glBindTexture(GL_TEXTURE_2D, writeNormals? data->normalCopy.id : normal.id);
+
+    // Cluster lists, the decal data takes the place of the light data
+    SetShaderLightClusters(data->shader, *clusters);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, decals->texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    Matrix viewProj = GetDeferredModeViewProjection(gbuffer, camera);
+    glUseProgram(data->shader.id);
+    glUniform1i(GetShaderLocation(data->shader, "decalData"), LIGHT_DATA_UNIT);
+    glUniformMatrix4fv(data->locs[DECAL_LOC_VIEW_PROJ], 1, false, MatrixToFloat(viewProj));
+    glUniformMatrix4fv(data->locs[DECAL_LOC_INV_VIEW_PROJ], 1, false, MatrixToFloat(MatrixInvert(viewProj)));
+    glUniform1i(data->locs[DECAL_LOC_LAYOUT], gbuffer.layout);
+    glUniform2f(data->locs[DECAL_LOC_SCALE], (float)gbuffer.viewportWidth/(float)gbuffer.width, (float)gbuffer.viewportHeight/(float)gbuffer.height);
+    glUniform1i(data->locs[DECAL_LOC_NORMALS], writeNormals? 1 : 0);
+    glUniform1f(data->locs[DECAL_LOC_ANGLE_FADE], decals->angleFade);
+
+    // Back faces cover every pixel of a box once, also with the camera inside it.. the albedo keeps its specular
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glEnable(GL_BLEND);
+    glDisablei(GL_BLEND, 1);
+    glBlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE);
+
+    glBindVertexArray(data->boxVao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, decals->count);
+    glBindVertexArray(0);
+
+    glUseProgram(0);
+    glDisable(GL_DEPTH_CLAMP);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glCullFace(cullFaceMode);
+    glBlendFuncSeparate(blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha);
+    if (depthTest) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+    if (blend) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    if (cullFace) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+
+    EndProfilerPass(PROFILER_PASS_DECALS);
+}
+#pragma endregion
+
+#pragma region SHADOWS
+typedef struct ShadowCascadesData {
+    unsigned int copyFramebuffer;                // Reads the static layer, copied into the dynamic one
+    bool placed[SHADOW_MAX_CASCADES];            // Cascade has a position
+    bool staticDirty[SHADOW_MAX_CASCADES];       // Static layer must be drawn
+    Vector3 centers[SHADOW_MAX_CASCADES];        // Cascade center in light space, x and y snapped to texels
+    float extents[SHADOW_MAX_CASCADES];          // Half size of each cascade
+    Matrix rotation;                             // World to light space, no translation so snapped centers stay on the texel grid
+    Matrix projections[SHADOW_MAX_CASCADES];
+    int framebuffer;                             // State saved by BeginShadowCascade()
+    int viewport[4];
+} ShadowCascadesData;
+
+R3DDEF R3DShadowCascades LoadShadowCascades(int size, int cascadeCount)
+{
+    R3DShadowCascades shadows = { 0 };
+    if (cascadeCount > SHADOW_MAX_CASCADES) cascadeCount = SHADOW_MAX_CASCADES;
+    if (cascadeCount < 1) cascadeCount = 1;
+
+    shadows.size = size;
+    shadows.cascadeCount = cascadeCount;
+    shadows.maxDistance = 50.0f;
+    shadows.splitLambda = 0.75f;
+    shadows.margin = 0.25f;
+    shadows.casterDistance = 50.0f;
+    shadows.bias = 1.5f;
+
+    // Outside the maps is lit
+    float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    unsigned int textures[2] = { 0 };
+    glGenTextures(2, textures);
+    for (int i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textures[i]);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    shadows.staticDepth = textures[0];
+    shadows.depth = textures[1];
+
+    ShadowCascadesData* data = (ShadowCascadesData*)R3D_CALLOC(1, sizeof(ShadowCascadesData));
+
+    // Depth only framebuffers, the layer is attached when drawing
+    glGenFramebuffers(1, &shadows.framebuffer);
+    glGenFramebuffers(1, &data->copyFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows.framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows.depth, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) TraceLog(LOG_WARNING, "SHADOWS: Shadow cascades framebuffer is not complete");
+    glBindFramebuffer(GL_FRAMEBUFFER, data->copyFramebuffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    shadows.data = data;
+
+    TraceLog(LOG_INFO, "SHADOWS: Shadow cascades loaded successfully (%i cascades, %i x %i)", cascadeCount, size, size);
+
+    return shadows;
+}
+
+R3DDEF void UnloadShadowCascades(R3DShadowCascades shadows)
+{
+    ShadowCascadesData* data = (ShadowCascadesData*)shadows.data;
+
+    glDeleteFramebuffers(1, &shadows.framebuffer);
+    glDeleteTextures(1, &shadows.staticDepth);
+    glDeleteTextures(1, &shadows.depth);
+    if (data != NULL) glDeleteFramebuffers(1, &data->copyFramebuffer);
+    R3D_FREE(data);
+}
+
+R3DDEF void UpdateShadowCascades(R3DShadowCascades* shadows, Camera camera, float aspect, Vector3 lightDirection)
+{
+    ShadowCascadesData* data = (ShadowCascadesData*)shadows->data;
+
+    // A new light direction moves every texel
+    Vector3 direction = Vector3Normalize(lightDirection);
+    if (Vector3Length(Vector3Subtract(direction, shadows->lightDirection)) > 1e-4f)
+    {
+        shadows->lightDirection = direction;
+        Vector3 up = { 0.0f, 1.0f, 0.0f };
+        if (fabsf(direction.y) > 0.99f) up = Vector3Normalize(Vector3CrossProduct(direction, Vector3One()));
+        data->rotation = MatrixLookAt(Vector3Zero(), direction, up);
+        InvalidateShadowCache(shadows);
+        for (int i = 0; i < SHADOW_MAX_CASCADES; i++) data->placed[i] = false;
+    }
+
+    Vector3 forward = Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+    Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, camera.up));
+    Vector3 up = Vector3CrossProduct(right, forward);
+    shadows->viewDirection = forward;
+
+    // NOTE: Orthographic cameras are fitted as perspective ones, the slices are only bounded a bit looser
+    float tanY = tanf(camera.fovy*0.5f*DEG2RAD);
+    float tanX = tanY*aspect;
+    float nearPlane = (float)RL_CULL_DISTANCE_NEAR;
+    float farPlane = fminf(shadows->maxDistance, (float)RL_CULL_DISTANCE_FAR);
+    float previousSplit = nearPlane;
+
+    for (int i = 0; i < shadows->cascadeCount; i++)
+    {
+        // Practical split scheme, blends logarithmic and uniform splits
+        float p = (float)(i + 1)/(float)shadows->cascadeCount;
+        float split = shadows->splitLambda*nearPlane*powf(farPlane/nearPlane, p) + (1.0f - shadows->splitLambda)*(nearPlane + (farPlane - nearPlane)*p);
+
+        // Bounding sphere of the slice, its radius does not change when the camera rotates
+        Vector3 corners[8] = { 0 };
+        Vector3 center = Vector3Zero();
+        for (int c = 0; c < 8; c++)
+        {
+            float depth = (c < 4)? previousSplit : split;
+            Vector3 point = Vector3Add(camera.position, Vector3Scale(forward, depth));
+            point = Vector3Add(point, Vector3Scale(right, ((c & 1)? 1.0f : -1.0f)*depth*tanX));
+            point = Vector3Add(point, Vector3Scale(up, ((c & 2)? 1.0f : -1.0f)*depth*tanY));
+            corners[c] = point;
+            center = Vector3Add(center, Vector3Scale(point, 0.125f));
+        }
+        float radius = 0.0f;
+        for (int c = 0; c < 8; c++) radius = fmaxf(radius, Vector3Length(Vector3Subtract(corners[c], center)));
+        radius = ceilf(radius*16.0f)/16.0f;
+
+        float extent = radius*(1.0f + shadows->margin);
+        float texelSize = 2.0f*extent/(float)shadows->size;
+        Vector3 lightCenter = Vector3Transform(center, data->rotation);
+
+        // The cascade only moves when the slice sphere leaves it, snapped to whole texels so static texels don't shimmer
+        Vector3 offset = Vector3Subtract(lightCenter, data->centers[i]);
+        bool inside = (fabsf(offset.x) + radius <= data->extents[i]) && (fabsf(offset.y) + radius <= data->extents[i]) && (fabsf(offset.z) + radius <= data->extents[i]);
+        if (!data->placed[i] || !inside || (fabsf(extent - data->extents[i]) > 1e-4f))
+        {
+            data->centers[i].x = floorf(lightCenter.x/texelSize + 0.5f)*texelSize;
+            data->centers[i].y = floorf(lightCenter.y/texelSize + 0.5f)*texelSize;
+            data->centers[i].z = lightCenter.z;
+            data->extents[i] = extent;
+            data->placed[i] = true;
+            data->staticDirty[i] = true;
+        }
+
+        // Light space looks down -z, casters up to casterDistance toward the light are kept
+        Vector3 c = data->centers[i];
+        data->projections[i] = MatrixOrtho(c.x - extent, c.x + extent, c.y - extent, c.y + extent, -(c.z + extent + shadows->casterDistance), -(c.z - extent));
+        shadows->matrices[i] = MatrixMultiply(data->rotation, data->projections[i]);
+        shadows->splits[i] = split;
+        shadows->texelSizes[i] = texelSize;
+
+        previousSplit = split;
+    }
+}
+
+R3DDEF void InvalidateShadowCache(R3DShadowCascades* shadows)
+{
+    ShadowCascadesData* data = (ShadowCascadesData*)shadows->data;
+    for (int i = 0; i < SHADOW_MAX_CASCADES; i++) data->staticDirty[i] = true;
+}
+
+R3DDEF bool BeginShadowCascade(R3DShadowCascades* shadows, int cascade, int layer)
+{
+    ShadowCascadesData* data = (ShadowCascadesData*)shadows->data;
+    if ((cascade < 0) || (cascade >= shadows->cascadeCount)) return false;
+    if ((layer == SHADOW_LAYER_STATIC) && !data->staticDirty[cascade]) return false;
+
+    rlDrawRenderBatchActive();
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &data->framebuffer);
+    glGetIntegerv(GL_VIEWPORT, data->viewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows->framebuffer);
+    glViewport(0, 0, shadows->size, shadows->size);
+
+    if (layer == SHADOW_LAYER_STATIC)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows->staticDepth, 0, cascade);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        data->staticDirty[cascade] = false;
+        shadows->staticUpdates++;
+    }
+    else
+    {
+        // Dynamic casters are depth tested against the cached static layer
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows->depth, 0, cascade);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, data->copyFramebuffer);
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows->staticDepth, 0, cascade);
+        glBlitFramebuffer(0, 0, shadows->size, shadows->size, 0, 0, shadows->size, shadows->size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, shadows->framebuffer);
+    }
+
+    // Slope scaled bias, sampling adds a normal offset on top
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.5f, 4.0f);
+
+    rlMatrixMode(RL_PROJECTION);
+    rlPushMatrix();
+    rlLoadIdentity();
+    rlMultMatrixf(MatrixToFloat(data->projections[cascade]));
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+    rlMultMatrixf(MatrixToFloat(data->rotation));
+
+    return true;
+}
+
+R3DDEF void EndShadowCascade(R3DShadowCascades* shadows)
+{
+    ShadowCascadesData* data = (ShadowCascadesData*)shadows->data;
+
+    rlDrawRenderBatchActive();
+
+    rlMatrixMode(RL_PROJECTION);
+    rlPopMatrix();
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_TEST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, data->framebuffer);
+    glViewport(data->viewport[0], data->viewport[1], data->viewport[2], data->viewport[3]);
+}
+
+R3DDEF void SetShaderShadowCascades(Shader shader, R3DShadowCascades shadows)
+{
+    int unit = SHADOW_CASCADE_UNIT;
+    SetShaderValue(shader, GetShaderLocation(shader, "shadowMap"), &unit, SHADER_UNIFORM_INT);
+    SetShaderValue(shader, GetShaderLocation(shader, "shadowCascadeCount"), &shadows.cascadeCount, SHADER_UNIFORM_INT);
+    SetShaderValue(shader, GetShaderLocation(shader, "shadowViewDir"), &shadows.viewDirection, SHADER_UNIFORM_VEC3);
+    SetShaderValue(shader, GetShaderLocation(shader, "shadowBias"), &shadows.bias, SHADER_UNIFORM_FLOAT);
+    SetShaderValueV(shader, GetShaderLocation(shader, "shadowSplits"), shadows.splits, SHADER_UNIFORM_FLOAT, shadows.cascadeCount);
+    SetShaderValueV(shader, GetShaderLocation(shader, "shadowTexelSizes"), shadows.texelSizes, SHADER_UNIFORM_FLOAT, shadows.cascadeCount);
+
+    // Array uniform, every element has its own location
+    for (int i = 0; i < shadows.cascadeCount; i++)
+    {
+        int loc = GetShaderLocation(shader, TextFormat("shadowMatrices[%i]", i));
+        if (loc != -1) SetShaderValueMatrix(shader, loc, shadows.matrices[i]);
+    }
+
+    glActiveTexture(GL_TEXTURE0 + SHADOW_CASCADE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadows.depth);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+#define SHADOW_ATLAS_VIEWS 6              // Views of a point light, cube faces +x -x +y -y +z -z
+#define SHADOW_ATLAS_SMALLEST_TILE 16     // Smallest tile of the allocator, minTileSize is clamped to it
+#define SHADOW_ATLAS_LIGHT_FLOATS 124     // std140 shadow light struct: view projections, tile rects, params
+#define SHADOW_ATLAS_STALE_WEIGHT 0.25f   // Priority a dirty view gains every frame it waits
+
+// Quadtree node states of the tile allocator
+typedef enum {
+    SHADOW_NODE_FREE = 0,
+    SHADOW_NODE_SPLIT,               // Some children are in use
+    SHADOW_NODE_USED
+} ShadowNodeState;
+
+// Cube face directions and up vectors, the lighting shaders pick the faces in the same order
+static const float shadowAtlasFaces[SHADOW_ATLAS_VIEWS][6] = {
+    { 1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f }, { -1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f },
+    { 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, -1.0f },
+    { 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f }
+};
+
+typedef struct ShadowAtlasTile {
+    int level;                       // Quadtree level, 0 is the whole atlas (-1: no tile)
+    int x;                           // Position, in tiles of its level
+    int y;
+} ShadowAtlasTile;
+
+typedef struct ShadowAtlasLight {
+    bool used;
+    int light;                       // Light set index
+    int type;                        // Light placement the views are drawn for
+    Vector3 position;
+    Vector3 direction;
+    float spotAngle;
+    float radius;
+    float importance;                // Screen coverage, 0 when the light does not reach the view
+    int level;                       // Tile level requested for the views
+    ShadowAtlasTile tiles[SHADOW_ATLAS_VIEWS];   // Sampled tile of each view
+    ShadowAtlasTile pending[SHADOW_ATLAS_VIEWS]; // New tile, sampled once drawn
+    Matrix matrices[SHADOW_ATLAS_VIEWS];         // View projection the sampled tiles were drawn with
+    bool dirty[SHADOW_ATLAS_VIEWS];              // View must be drawn
+    int stale[SHADOW_ATLAS_VIEWS];               // Frames the view has been waiting to be drawn
+} ShadowAtlasLight;
+
+typedef struct ShadowAtlasUpdate {
+    int entry;
+    int view;
+    float priority;
+} ShadowAtlasUpdate;
+
+typedef struct ShadowAtlasData {
+    int levels;                      // Quadtree levels, down to SHADOW_ATLAS_SMALLEST_TILE tiles
+    unsigned char* nodes;            // ShadowNodeState of every quadtree node, level after level
+    ShadowAtlasLight lights[SHADOW_ATLAS_MAX_LIGHTS];
+    ShadowAtlasUpdate updates[SHADOW_ATLAS_MAX_LIGHTS*SHADOW_ATLAS_VIEWS];
+    float* staging;                  // ShadowBlock contents
+    bool uploadDirty;                // Tiles or matrices changed since the last upload
+    Matrix view;                     // Matrices of the view being drawn
+    Matrix projection;
+    int framebuffer;                 // State saved by BeginShadowAtlasView()
+    int viewport[4];
+    int scissor[4];
+    bool scissorTest;
+} ShadowAtlasData;
+
+static int GetShadowNodeIndex(int level, int x, int y)
+{
+    return ((1 << 2*level) - 1)/3 + y*(1 << level) + x;
+}
+
+static int GetShadowAtlasViewCount(int type)
+{
+    if (type == LIGHT_POINT) return SHADOW_ATLAS_VIEWS;
+    if (type == LIGHT_SPOT) return 1;
+    return 0;
+}
+
+// Finds a free node of the tile level in a subtree, free nodes on the way are split
+static bool AllocShadowTileNode(ShadowAtlasData* data, int level, int x, int y, ShadowAtlasTile* tile)
+{
+    unsigned char* node = &data->nodes[GetShadowNodeIndex(level, x, y)];
+    if (*node == SHADOW_NODE_USED) return false;
+
+    if (level == tile->level)
+    {
+        if (*node != SHADOW_NODE_FREE) return false;
+        *node = SHADOW_NODE_USED;
+        tile->x = x;
+        tile->y = y;
+        return true;
+    }
+
+    // Children of a free node are all free, the first one takes the tile
+    *node = SHADOW_NODE_SPLIT;
+    for (int i = 0; i < 4; i++)
+    {
+        if (AllocShadowTileNode(data, level + 1, 2*x + (i & 1), 2*y + (i >> 1), tile)) return true;
+    }
+    return false;
+}
+
+// Allocates a tile of a level, or a smaller one down to maxLevel when the atlas is too full
+static bool AllocShadowTile(ShadowAtlasData* data, int level, int maxLevel, ShadowAtlasTile* tile)
+{
+    for (tile->level = level; tile->level <= maxLevel; tile->level++)
+    {
+        if (AllocShadowTileNode(data, 0, 0, 0, tile)) return true;
+    }
+    tile->level = -1;
+    return false;
+}
+
+// Frees a tile, merging the parents left with four free children
+static void FreeShadowTile(ShadowAtlasData* data, ShadowAtlasTile* tile)
+{
+    if (tile->level < 0) return;
+
+    int level = tile->level;
+    int x = tile->x;
+    int y = tile->y;
+    data->nodes[GetShadowNodeIndex(level, x, y)] = SHADOW_NODE_FREE;
+
+    while (level > 0)
+    {
+        level--;
+        x >>= 1;
+        y >>= 1;
+
+        bool empty = true;
+        for (int i = 0; i < 4; i++)
+        {
+            if (data->nodes[GetShadowNodeIndex(level + 1, 2*x + (i & 1), 2*y + (i >> 1))] != SHADOW_NODE_FREE) empty = false;
+        }
+        if (!empty) break;
+        data->nodes[GetShadowNodeIndex(level, x, y)] = SHADOW_NODE_FREE;
+    }
+
+    tile->level = -1;
+    data->uploadDirty = true;
+}
+
+R3DDEF R3DShadowAtlas LoadShadowAtlas(int size)
+{
+    R3DShadowAtlas atlas = { 0 };
+    if ((size & (size - 1)) != 0) TraceLog(LOG_WARNING, "SHADOWS: Shadow atlas size (%i) is not a power of two", size);
+
+    atlas.size = size;
+    atlas.minTileSize = (size < 64)? size : 64;
+    atlas.maxTileSize = size/4;
+    atlas.updateBudget = SHADOW_ATLAS_VIEWS;
+    atlas.nearPlane = 0.05f;
+    atlas.bias = 1.5f;
+
+    ShadowAtlasData* data = (ShadowAtlasData*)R3D_CALLOC(1, sizeof(ShadowAtlasData));
+    data->levels = 1;
+    while ((size >> data->levels) >= SHADOW_ATLAS_SMALLEST_TILE) data->levels++;
+    data->nodes = (unsigned char*)R3D_CALLOC(((1 << 2*data->levels) - 1)/3, sizeof(unsigned char));
+    data->staging = (float*)R3D_CALLOC(SHADOW_ATLAS_MAX_LIGHTS*SHADOW_ATLAS_LIGHT_FLOATS, sizeof(float));
+    data->uploadDirty = true;
+
+    glGenTextures(1, &atlas.depth);
+    glBindTexture(GL_TEXTURE_2D, atlas.depth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &atlas.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, atlas.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas.depth, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) TraceLog(LOG_WARNING, "SHADOWS: Shadow atlas framebuffer is not complete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenBuffers(1, &atlas.ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, atlas.ubo);
+    glBufferData(GL_UNIFORM_BUFFER, SHADOW_ATLAS_MAX_LIGHTS*SHADOW_ATLAS_LIGHT_FLOATS*sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    atlas.data = data;
+
+    TraceLog(LOG_INFO, "SHADOWS: Shadow atlas loaded successfully (%i x %i)", size, size);
+
+    return atlas;
+}
+
+R3DDEF void UnloadShadowAtlas(R3DShadowAtlas atlas)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas.data;
+
+    glDeleteFramebuffers(1, &atlas.framebuffer);
+    glDeleteTextures(1, &atlas.depth);
+    glDeleteBuffers(1, &atlas.ubo);
+    if (data != NULL)
+    {
+        R3D_FREE(data->nodes);
+        R3D_FREE(data->staging);
+    }
+    R3D_FREE(data);
+}
+
+R3DDEF int AddShadowLight(R3DShadowAtlas* atlas, R3DLightSet* set, int light)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas->data;
+    if ((light < 0) || (light >= set->count)) return -1;
+    if (set->lights[light].shadow > 0) return set->lights[light].shadow - 1;
+
+    if (GetShadowAtlasViewCount(set->lights[light].type) == 0)
+    {
+        TraceLog(LOG_WARNING, "SHADOWS: Light %i is not a point or spot light, it has no atlas shadow", light);
+        return -1;
+    }
+
+    int entry = -1;
+    for (int i = 0; (i < SHADOW_ATLAS_MAX_LIGHTS) && (entry < 0); i++)
+    {
+        if (!data->lights[i].used) entry = i;
+    }
+    if (entry < 0)
+    {
+        TraceLog(LOG_WARNING, "SHADOWS: Shadow atlas is full (%i lights)", SHADOW_ATLAS_MAX_LIGHTS);
+        return -1;
+    }
+
+    // The type is unset so the first update places every view
+    ShadowAtlasLight* shadowLight = &data->lights[entry];
+    memset(shadowLight, 0, sizeof(ShadowAtlasLight));
+    shadowLight->used = true;
+    shadowLight->light = light;
+    shadowLight->type = -1;
+    shadowLight->level = -1;
+    for (int v = 0; v < SHADOW_ATLAS_VIEWS; v++)
+    {
+        shadowLight->tiles[v].level = -1;
+        shadowLight->pending[v].level = -1;
+    }
+    atlas->lightCount++;
+
+    set->lights[light].shadow = entry + 1;
+    SetLightSetDirty(set, light, light + 1);
+
+    return entry;
+}
+
+R3DDEF void RemoveShadowLight(R3DShadowAtlas* atlas, R3DLightSet* set, int entry)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas->data;
+    if ((entry < 0) || (entry >= SHADOW_ATLAS_MAX_LIGHTS) || !data->lights[entry].used) return;
+
+    ShadowAtlasLight* shadowLight = &data->lights[entry];
+    for (int v = 0; v < SHADOW_ATLAS_VIEWS; v++)
+    {
+        FreeShadowTile(data, &shadowLight->tiles[v]);
+        FreeShadowTile(data, &shadowLight->pending[v]);
+    }
+    shadowLight->used = false;
+    atlas->lightCount--;
+    data->uploadDirty = true;
+
+    int light = shadowLight->light;
+    if ((light >= 0) && (light < set->count) && (set->lights[light].shadow == entry + 1))
+    {
+        set->lights[light].shadow = 0;
+        SetLightSetDirty(set, light, light + 1);
+    }
+}
+
+R3DDEF void UpdateShadowAtlas(R3DShadowAtlas* atlas, R3DLightSet* set, Camera camera, float aspect)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas->data;
+
+    // Tile levels between the largest and smallest tile sizes
+    int minLevel = 0;
+    while ((minLevel < data->levels - 1) && ((atlas->size >> minLevel) > atlas->maxTileSize)) minLevel++;
+    int maxLevel = minLevel;
+    while ((maxLevel < data->levels - 1) && ((atlas->size >> (maxLevel + 1)) >= atlas->minTileSize)) maxLevel++;
+
+    // Cone around the view frustum, lights whose sphere is out of it get no updates
+    Vector3 forward = Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+    float tanY = tanf(camera.fovy*0.5f*DEG2RAD);
+    float viewAngle = atanf(tanY*sqrtf(1.0f + aspect*aspect));
+
+    int order[SHADOW_ATLAS_MAX_LIGHTS] = { 0 };
+    int orderCount = 0;
+
+    for (int e = 0; e < SHADOW_ATLAS_MAX_LIGHTS; e++)
+    {
+        ShadowAtlasLight* shadowLight = &data->lights[e];
+        if (!shadowLight->used) continue;
+
+        // RemoveLight() gives the index of a removed light to the last one, follow the light
+        if ((shadowLight->light >= set->count) || (set->lights[shadowLight->light].shadow != e + 1))
+        {
+            shadowLight->light = -1;
+            for (int i = 0; (i < set->count) && (shadowLight->light < 0); i++)
+            {
+                if (set->lights[i].shadow == e + 1) shadowLight->light = i;
+            }
+            if (shadowLight->light < 0)
+            {
+                RemoveShadowLight(atlas, set, e);
+                continue;
+            }
+        }
+
+        R3DLight light = set->lights[shadowLight->light];
+        Vector3 direction = Vector3Normalize(light.direction);
+        float radius = GetLightRadius(light);
+
+        bool moved = (light.type != shadowLight->type) || (Vector3Length(Vector3Subtract(light.position, shadowLight->position)) > 1e-4f) ||
+            (fabsf(radius - shadowLight->radius) > radius*1e-3f);
+        if (light.type == LIGHT_SPOT) moved = moved || (Vector3Length(Vector3Subtract(direction, shadowLight->direction)) > 1e-4f) || (fabsf(light.spotAngle - shadowLight->spotAngle) > 1e-3f);
+
+        if (moved)
+        {
+            // Views a light no longer has give their tiles back
+            for (int v = GetShadowAtlasViewCount(light.type); v < SHADOW_ATLAS_VIEWS; v++)
+            {
+                FreeShadowTile(data, &shadowLight->tiles[v]);
+                FreeShadowTile(data, &shadowLight->pending[v]);
+            }
+            for (int v = 0; v < SHADOW_ATLAS_VIEWS; v++) shadowLight->dirty[v] = true;
+
+            shadowLight->type = light.type;
+            shadowLight->position = light.position;
+            shadowLight->direction = direction;
+            shadowLight->spotAngle = light.spotAngle;
+            shadowLight->radius = radius;
+        }
+
+        // Fraction of the screen height covered by the light sphere
+        Vector3 toLight = Vector3Subtract(light.position, camera.position);
+        float distance = Vector3Length(toLight);
+        shadowLight->importance = 1.0f;
+        if (distance > radius)
+        {
+            float angle = acosf(Clamp(Vector3DotProduct(toLight, forward)/distance, -1.0f, 1.0f));
+            if (angle - asinf(radius/distance) > viewAngle) shadowLight->importance = 0.0f;
+            else shadowLight->importance = fminf(radius/(distance*tanY), 1.0f);
+        }
+
+        // Most important lights first, they get the tiles when the atlas is full
+        int i = orderCount++;
+        while ((i > 0) && (data->lights[order[i - 1]].importance < shadowLight->importance))
+        {
+            order[i] = order[i - 1];
+            i--;
+        }
+        order[i] = e;
+    }
+
+    // Smallest tile holding the coverage, shrinking only once well under the next size so tiles don't flip every frame
+    int levels[SHADOW_ATLAS_MAX_LIGHTS] = { 0 };
+    for (int k = 0; k < orderCount; k++)
+    {
+        ShadowAtlasLight* shadowLight = &data->lights[order[k]];
+        float texels = shadowLight->importance*(float)atlas->maxTileSize;
+        int level = maxLevel;
+        while ((level > minLevel) && ((float)(atlas->size >> level) < texels)) level--;
+        if ((level == shadowLight->level + 1) && (texels >= 0.75f*(float)(atlas->size >> level))) level = shadowLight->level;
+        levels[k] = level;
+    }
+
+    // Too many tiles for the atlas, every light drops a level until they fit
+    for (int bias = 0; bias < maxLevel - minLevel; bias++)
+    {
+        double area = 0.0;
+        for (int k = 0; k < orderCount; k++)
+        {
+            int level = (levels[k] + bias < maxLevel)? levels[k] + bias : maxLevel;
+            area += (double)GetShadowAtlasViewCount(data->lights[order[k]].type)/(double)(1 << 2*level);
+        }
+        if (area <= 1.0)
+        {
+            for (int k = 0; k < orderCount; k++) levels[k] = (levels[k] + bias < maxLevel)? levels[k] + bias : maxLevel;
+            break;
+        }
+    }
+
+    int updateCount = 0;
+    for (int k = 0; k < orderCount; k++)
+    {
+        ShadowAtlasLight* shadowLight = &data->lights[order[k]];
+        int views = GetShadowAtlasViewCount(shadowLight->type);
+        int level = levels[k];
+
+        if (level != shadowLight->level)
+        {
+            shadowLight->level = level;
+            for (int v = 0; v < views; v++)
+            {
+                FreeShadowTile(data, &shadowLight->pending[v]);
+                if (shadowLight->tiles[v].level != level)
+                {
+                    AllocShadowTile(data, level, maxLevel, &shadowLight->pending[v]);
+                    shadowLight->dirty[v] = true;
+                }
+            }
+        }
+
+        for (int v = 0; v < views; v++)
+        {
+            // A full atlas may have left the view without any tile, try again
+            if ((shadowLight->tiles[v].level < 0) && (shadowLight->pending[v].level < 0))
+            {
+                if (!AllocShadowTile(data, shadowLight->level, maxLevel, &shadowLight->pending[v])) continue;
+                shadowLight->dirty[v] = true;
+            }
+            if (!shadowLight->dirty[v]) continue;
+
+            // Lights out of the view wait, their staleness keeps growing
+            if (shadowLight->importance > 0.0f)
+            {
+                float priority = shadowLight->importance*(1.0f + SHADOW_ATLAS_STALE_WEIGHT*(float)shadowLight->stale[v]);
+                if (shadowLight->tiles[v].level < 0) priority += 1000.0f;
+
+                ShadowAtlasUpdate update = { order[k], v, priority };
+                int i = updateCount++;
+                while ((i > 0) && (data->updates[i - 1].priority < priority))
+                {
+                    data->updates[i] = data->updates[i - 1];
+                    i--;
+                }
+                data->updates[i] = update;
+            }
+            shadowLight->stale[v]++;
+        }
+    }
+
+    atlas->updateCount = (updateCount < atlas->updateBudget)? updateCount : atlas->updateBudget;
+}
+
+R3DDEF void InvalidateShadowAtlas(R3DShadowAtlas* atlas)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas->data;
+    for (int e = 0; e < SHADOW_ATLAS_MAX_LIGHTS; e++)
+    {
+        for (int v = 0; v < SHADOW_ATLAS_VIEWS; v++) data->lights[e].dirty[v] = true;
+    }
+}
+
+R3DDEF void InvalidateShadowAtlasBox(R3DShadowAtlas* atlas, BoundingBox box)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas->data;
+    for (int e = 0; e < SHADOW_ATLAS_MAX_LIGHTS; e++)
+    {
+        ShadowAtlasLight* shadowLight = &data->lights[e];
+        if (!shadowLight->used) continue;
+
+        // Closest point of the box to the light, within the radius when the box is lit
+        Vector3 closest = Vector3Min(Vector3Max(shadowLight->position, box.min), box.max);
+        if (Vector3Length(Vector3Subtract(closest, shadowLight->position)) > shadowLight->radius) continue;
+        for (int v = 0; v < SHADOW_ATLAS_VIEWS; v++) shadowLight->dirty[v] = true;
+    }
+}
+
+R3DDEF void BeginShadowAtlasView(R3DShadowAtlas* atlas, int update)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas->data;
+    if ((update < 0) || (update >= atlas->updateCount)) return;
+
+    ShadowAtlasLight* shadowLight = &data->lights[data->updates[update].entry];
+    int v = data->updates[update].view;
+
+    // The new tile replaces the sampled one once drawn
+    if (shadowLight->pending[v].level >= 0)
+    {
+        FreeShadowTile(data, &shadowLight->tiles[v]);
+        shadowLight->tiles[v] = shadowLight->pending[v];
+        shadowLight->pending[v].level = -1;
+    }
+
+    Vector3 position = shadowLight->position;
+    float fovy = 90.0f;
+    if (shadowLight->type == LIGHT_SPOT)
+    {
+        Vector3 up = { 0.0f, 1.0f, 0.0f };
+        if (fabsf(shadowLight->direction.y) > 0.99f) up = Vector3Normalize(Vector3CrossProduct(shadowLight->direction, Vector3One()));
+        data->view = MatrixLookAt(position, Vector3Add(position, shadowLight->direction), up);
+        fovy = 2.0f*Clamp(shadowLight->spotAngle, 1.0f, 89.0f);
+    }
+    else
+    {
+        const float* face = shadowAtlasFaces[v];
+        Vector3 axis = { face[0], face[1], face[2] };
+        Vector3 up = { face[3], face[4], face[5] };
+        data->view = MatrixLookAt(position, Vector3Add(position, axis), up);
+    }
+    data->projection = MatrixPerspective(fovy*DEG2RAD, 1.0, atlas->nearPlane, fmaxf(shadowLight->radius, atlas->nearPlane*2.0f));
+
+    shadowLight->matrices[v] = MatrixMultiply(data->view, data->projection);
+    shadowLight->dirty[v] = false;
+    shadowLight->stale[v] = 0;
+    data->uploadDirty = true;
+    atlas->viewUpdates++;
+
+    rlDrawRenderBatchActive();
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &data->framebuffer);
+    glGetIntegerv(GL_VIEWPORT, data->viewport);
+    glGetIntegerv(GL_SCISSOR_BOX, data->scissor);
+    data->scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+
+    // Only the tile is cleared, the rest of the atlas is still sampled
+    ShadowAtlasTile tile = shadowLight->tiles[v];
+    int tileSize = atlas->size >> tile.level;
+    glBindFramebuffer(GL_FRAMEBUFFER, atlas->framebuffer);
+    glViewport(tile.x*tileSize, tile.y*tileSize, tileSize, tileSize);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(tile.x*tileSize, tile.y*tileSize, tileSize, tileSize);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // Slope scaled bias, sampling adds a normal offset on top
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.5f, 4.0f);
+
+    rlMatrixMode(RL_PROJECTION);
+    rlPushMatrix();
+    rlLoadIdentity();
+    rlMultMatrixf(MatrixToFloat(data->projection));
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+    rlMultMatrixf(MatrixToFloat(data->view));
+}
+
+R3DDEF void EndShadowAtlasView(R3DShadowAtlas* atlas)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas->data;
+
+    rlDrawRenderBatchActive();
+
+    rlMatrixMode(RL_PROJECTION);
+    rlPopMatrix();
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_TEST);
+    glScissor(data->scissor[0], data->scissor[1], data->scissor[2], data->scissor[3]);
+    if (!data->scissorTest) glDisable(GL_SCISSOR_TEST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, data->framebuffer);
+    glViewport(data->viewport[0], data->viewport[1], data->viewport[2], data->viewport[3]);
+}
+
+R3DDEF void SetShaderShadowAtlas(Shader shader, R3DShadowAtlas atlas)
+{
+    ShadowAtlasData* data = (ShadowAtlasData*)atlas.data;
+
+    if (data->uploadDirty)
+    {
+        // Views without a drawn tile keep an empty rect, the shader leaves them lit
+        memset(data->staging, 0, SHADOW_ATLAS_MAX_LIGHTS*SHADOW_ATLAS_LIGHT_FLOATS*sizeof(float));
+        for (int e = 0; e < SHADOW_ATLAS_MAX_LIGHTS; e++)
+        {
+            ShadowAtlasLight* shadowLight = &data->lights[e];
+            if (!shadowLight->used) continue;
+
+            float* packed = data->staging + e*SHADOW_ATLAS_LIGHT_FLOATS;
+            for (int v = 0; v < SHADOW_ATLAS_VIEWS; v++)
+            {
+                ShadowAtlasTile tile = shadowLight->tiles[v];
+                if (tile.level < 0) continue;
+
+                float tileSize = 1.0f/(float)(1 << tile.level);
+                memcpy(packed + v*16, MatrixToFloat(shadowLight->matrices[v]), 16*sizeof(float));
+                packed[96 + v*4] = (float)tile.x*tileSize;
+                packed[97 + v*4] = (float)tile.y*tileSize;
+                packed[98 + v*4] = tileSize;
+                packed[99 + v*4] = tileSize;
+            }
+            packed[120] = (shadowLight->type == LIGHT_SPOT)? tanf(Clamp(shadowLight->spotAngle, 1.0f, 89.0f)*DEG2RAD) : 1.0f;
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, atlas.ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, SHADOW_ATLAS_MAX_LIGHTS*SHADOW_ATLAS_LIGHT_FLOATS*sizeof(float), data->staging);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        data->uploadDirty = false;
+    }
+
+    unsigned int block = glGetUniformBlockIndex(shader.id, "ShadowBlock");
+    if (block == GL_INVALID_INDEX)
+    {
+        TraceLog(LOG_WARNING, "SHADER: [ID %i] ShadowBlock uniform block not found", shader.id);
+        return;
+    }
+    glUniformBlockBinding(shader.id, block, SHADOW_ATLAS_BINDING);
+    glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_ATLAS_BINDING, atlas.ubo);
+
+    int unit = SHADOW_ATLAS_UNIT;
+    SetShaderValue(shader, GetShaderLocation(shader, "shadowAtlas"), &unit, SHADER_UNIFORM_INT);
+    SetShaderValue(shader, GetShaderLocation(shader, "shadowAtlasBias"), &atlas.bias, SHADER_UNIFORM_FLOAT);
+
+    glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_UNIT);
+    glBindTexture(GL_TEXTURE_2D, atlas.depth);
+    glActiveTexture(GL_TEXTURE0);
+}
+#pragma endregion
+
+#pragma region LIGHTMAPS
+#define BAKE_BVH_BINS 12              // SAH split candidates per axis
+#define BAKE_BVH_LEAF_SIZE 4          // Triangles under which a node is never split
+#define BAKE_BVH_STACK 64             // Traversal stack, deeper than the build depth limit
+#define BAKE_TILE_SIZE 16             // Texels per side of a baking job
+#define BAKE_CHART_NORMAL 0.95f       // Cosine to the chart normal under which a triangle starts another chart
+#define BAKE_MESH_BUFFERS 7           // Vertex buffers of an uploaded mesh (MAX_MESH_VERTEX_BUFFERS)
+
+// UnloadMesh() and UnloadImage() free with RL_FREE, mesh and image data are allocated the same way
+#if !defined(RL_MALLOC)
+#define RL_MALLOC(sz) malloc(sz)
+#endif
+#if !defined(RL_FREE)
+#define RL_FREE(p) free(p)
+#endif
+
+typedef struct BakeTriangle {
+    Vector3 v0;                      // First vertex and edges, world space
+    Vector3 e1;
+    Vector3 e2;
+    Vector3 normal;                  // Geometric normal
+    Vector3 albedo;                  // Reflectance for bounced light
+} BakeTriangle;
+
+typedef struct BakeNode {
+    Vector3 min;
+    Vector3 max;
+    int first;                       // First triangle of a leaf, left child of an inner node (the right one follows)
+    int count;                       // Triangles of a leaf, 0 for inner nodes
+} BakeNode;
+
+// A planar group of triangles, unwrapped together
+typedef struct BakeChart {
+    int mesh;
+    int first;                       // First triangle in the chart triangle list
+    int count;
+    bool planar;                     // Projected on the plane of axisU and axisV, else keeps the mesh texcoords
+    Vector3 axisU;
+    Vector3 axisV;
+    Vector2 min;                     // Bounds, in world units (in texcoords for kept texcoords)
+    Vector2 max;
+    float scale;                     // Texels per chart unit relative to the world texel density
+    int x;                           // Packed position, in texels
+    int y;
+} BakeChart;
+
+// Baked texel, the surface point it covers
+typedef struct BakeTexel {
+    Vector3 position;
+    Vector3 normal;
+    int coverage;                    // 0: empty, 1: next to a triangle, 2: inside a triangle
+} BakeTexel;
+
+typedef struct BakeScene {
+    BakeTriangle* triangles;
+    int* order;                      // Triangles in node order
+    BakeNode* nodes;
+    int nodeCount;
+    const R3DLight* lights;
+    float* lightRadius;
+    int lightCount;
+    R3DBakeSettings settings;
+    float bias;                      // Ray origin offset, from the model size
+    BakeTexel* texels;
+    float* lightmap;
+} BakeScene;
+
+static float GetBakeBoxArea(Vector3 min, Vector3 max)
+{
+    Vector3 d = Vector3Subtract(max, min);
+    return (d.x < 0.0f)? 0.0f : 2.0f*(d.x*d.y + d.y*d.z + d.z*d.x);
+}
+
+static Vector3 GetBakeCentroid(const BakeTriangle* tri)
+{
+    return Vector3Add(tri->v0, Vector3Scale(Vector3Add(tri->e1, tri->e2), 1.0f/3.0f));
+}
+
+static void GrowBakeBox(Vector3* min, Vector3* max, const BakeTriangle* tri)
+{
+    Vector3 v1 = Vector3Add(tri->v0, tri->e1);
+    Vector3 v2 = Vector3Add(tri->v0, tri->e2);
+    *min = Vector3Min(*min, Vector3Min(tri->v0, Vector3Min(v1, v2)));
+    *max = Vector3Max(*max, Vector3Max(tri->v0, Vector3Max(v1, v2)));
+}
+
+// Binned SAH build, splits along the axis and bin boundary with the lowest surface area cost
+static void BuildBakeNode(BakeScene* scene, int index, int first, int count, int depth)
+{
+    BakeNode* node = &scene->nodes[index];
+    Vector3 cmin = { FLT_MAX, FLT_MAX, FLT_MAX };
+    Vector3 cmax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    node->min = cmin;
+    node->max = cmax;
+    for (int i = first; i < first + count; i++)
+    {
+        const BakeTriangle* tri = &scene->triangles[scene->order[i]];
+        GrowBakeBox(&node->min, &node->max, tri);
+        Vector3 c = GetBakeCentroid(tri);
+        cmin = Vector3Min(cmin, c);
+        cmax = Vector3Max(cmax, c);
+    }
+    node->first = first;
+    node->count = count;
+    if ((count <= BAKE_BVH_LEAF_SIZE) || (depth >= BAKE_BVH_STACK - 4)) return;
+
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = (float)count*GetBakeBoxArea(node->min, node->max);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float lo = (axis == 0)? cmin.x : (axis == 1)? cmin.y : cmin.z;
+        float hi = (axis == 0)? cmax.x : (axis == 1)? cmax.y : cmax.z;
+        if (hi - lo < 1e-6f) continue;
+
+        int binCounts[BAKE_BVH_BINS] = { 0 };
+        Vector3 binMin[BAKE_BVH_BINS];
+        Vector3 binMax[BAKE_BVH_BINS];
+        for (int b = 0; b < BAKE_BVH_BINS; b++)
+        {
+            binMin[b] = Vector3Scale(Vector3One(), FLT_MAX);
+            binMax[b] = Vector3Scale(Vector3One(), -FLT_MAX);
+        }
+
+        float binScale = (float)BAKE_BVH_BINS/(hi - lo);
+        for (int i = first; i < first + count; i++)
+        {
+            const BakeTriangle* tri = &scene->triangles[scene->order[i]];
+            Vector3 c = GetBakeCentroid(tri);
+            float v = (axis == 0)? c.x : (axis == 1)? c.y : c.z;
+            int b = (int)((v - lo)*binScale);
+            if (b >= BAKE_BVH_BINS) b = BAKE_BVH_BINS - 1;
+            binCounts[b]++;
+            GrowBakeBox(&binMin[b], &binMax[b], tri);
+        }
+
+        // Right side areas swept from the end, then the left side from the start
+        float rightArea[BAKE_BVH_BINS] = { 0 };
+        int rightCount[BAKE_BVH_BINS] = { 0 };
+        Vector3 min = Vector3Scale(Vector3One(), FLT_MAX);
+        Vector3 max = Vector3Scale(Vector3One(), -FLT_MAX);
+        int n = 0;
+        for (int b = BAKE_BVH_BINS - 1; b > 0; b--)
+        {
+            min = Vector3Min(min, binMin[b]);
+            max = Vector3Max(max, binMax[b]);
+            n += binCounts[b];
+            rightArea[b] = GetBakeBoxArea(min, max);
+            rightCount[b] = n;
+        }
+
+        min = Vector3Scale(Vector3One(), FLT_MAX);
+        max = Vector3Scale(Vector3One(), -FLT_MAX);
+        n = 0;
+        for (int b = 0; b < BAKE_BVH_BINS - 1; b++)
+        {
+            min = Vector3Min(min, binMin[b]);
+            max = Vector3Max(max, binMax[b]);
+            n += binCounts[b];
+            if ((n == 0) || (rightCount[b + 1] == 0)) continue;
+
+            float cost = (float)n*GetBakeBoxArea(min, max) + (float)rightCount[b + 1]*rightArea[b + 1];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b + 1;
+            }
+        }
+    }
+
+    if (bestAxis < 0) return;
+
+    // Partition the triangles on the chosen bin boundary
+    float lo = (bestAxis == 0)? cmin.x : (bestAxis == 1)? cmin.y : cmin.z;
+    float hi = (bestAxis == 0)? cmax.x : (bestAxis == 1)? cmax.y : cmax.z;
+    float binScale = (float)BAKE_BVH_BINS/(hi - lo);
+    int mid = first;
+    for (int i = first; i < first + count; i++)
+    {
+        Vector3 c = GetBakeCentroid(&scene->triangles[scene->order[i]]);
+        float v = (bestAxis == 0)? c.x : (bestAxis == 1)? c.y : c.z;
+        int b = (int)((v - lo)*binScale);
+        if (b >= BAKE_BVH_BINS) b = BAKE_BVH_BINS - 1;
+        if (b < bestSplit)
+        {
+            int t = scene->order[i];
+            scene->order[i] = scene->order[mid];
+            scene->order[mid++] = t;
+        }
+    }
+
+    int left = scene->nodeCount;
+    scene->nodeCount += 2;
+    node->first = left;
+    node->count = 0;
+    BuildBakeNode(scene, left, first, mid - first, depth + 1);
+    BuildBakeNode(scene, left + 1, mid, first + count - mid, depth + 1);
+}
+
+static bool IntersectBakeBox(const BakeNode* node, Vector3 origin, Vector3 invDir, float maxDistance)
+{
+    float tx1 = (node->min.x - origin.x)*invDir.x, tx2 = (node->max.x - origin.x)*invDir.x;
+    float ty1 = (node->min.y - origin.y)*invDir.y, ty2 = (node->max.y - origin.y)*invDir.y;
+    float tz1 = (node->min.z - origin.z)*invDir.z, tz2 = (node->max.z - origin.z)*invDir.z;
+    float tmin = fmaxf(fmaxf(fminf(tx1, tx2), fminf(ty1, ty2)), fmaxf(fminf(tz1, tz2), 0.0f));
+    float tmax = fminf(fminf(fmaxf(tx1, tx2), fmaxf(ty1, ty2)), fminf(fmaxf(tz1, tz2), maxDistance));
+    return tmin <= tmax;
+}
+
+// Möller-Trumbore, both faces, returns the hit distance (-1 when missed)
+static float IntersectBakeTriangle(const BakeTriangle* tri, Vector3 origin, Vector3 dir)
+{
+    Vector3 p = Vector3CrossProduct(dir, tri->e2);
+    float det = Vector3DotProduct(tri->e1, p);
+    if (fabsf(det) < 1e-12f) return -1.0f;
+
+    float invDet = 1.0f/det;
+    Vector3 s = Vector3Subtract(origin, tri->v0);
+    float u = Vector3DotProduct(s, p)*invDet;
+    if ((u < 0.0f) || (u > 1.0f)) return -1.0f;
+
+    Vector3 q = Vector3CrossProduct(s, tri->e1);
+    float v = Vector3DotProduct(dir, q)*invDet;
+    if ((v < 0.0f) || (u + v > 1.0f)) return -1.0f;
+
+    return Vector3DotProduct(tri->e2, q)*invDet;
+}
+
+// Closest hit (or any hit for shadow rays) under maxDistance, returns the triangle (-1 when missed)
+static int TraceBakeRay(const BakeScene* scene, Vector3 origin, Vector3 dir, float maxDistance, bool anyHit, float* distance)
+{
+    Vector3 invDir = { 1.0f/dir.x, 1.0f/dir.y, 1.0f/dir.z };
+    int stack[BAKE_BVH_STACK];
+    int top = 0;
+    int hit = -1;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const BakeNode* node = &scene->nodes[stack[--top]];
+        if (!IntersectBakeBox(node, origin, invDir, maxDistance)) continue;
+
+        if (node->count > 0)
+        {
+            for (int i = node->first; i < node->first + node->count; i++)
+            {
+                float t = IntersectBakeTriangle(&scene->triangles[scene->order[i]], origin, dir);
+                if ((t > 0.0f) && (t < maxDistance))
+                {
+                    maxDistance = t;
+                    hit = scene->order[i];
+                    if (anyHit) top = 0;
+                }
+            }
+            if (anyHit && (hit >= 0)) break;
+        }
+        else
+        {
+            stack[top++] = node->first;
+            stack[top++] = node->first + 1;
+        }
+    }
+
+    if (distance != NULL) *distance = maxDistance;
+    return hit;
+}
+
+// xorshift32, every texel has its own deterministic sequence
+static float GetBakeRandom(unsigned int* state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)(x >> 8)*(1.0f/16777216.0f);
+}
+
+// Direct light reaching a surface point, shaded like the lighting shaders (no specular)
+static Vector3 GetBakeDirectLight(const BakeScene* scene, Vector3 position, Vector3 normal)
+{
+    Vector3 result = Vector3Zero();
+    Vector3 origin = Vector3Add(position, Vector3Scale(normal, scene->bias));
+
+    for (int i = 0; i < scene->lightCount; i++)
+    {
+        const R3DLight* light = &scene->lights[i];
+        Vector3 lightDir = Vector3Negate(Vector3Normalize(light->direction));
+        float distance = FLT_MAX;
+        float attenuation = 1.0f;
+
+        if (light->type != LIGHT_DIRECTIONAL)
+        {
+            Vector3 toLight = Vector3Subtract(light->position, position);
+            distance = Vector3Length(toLight);
+            if ((distance > scene->lightRadius[i]) || (distance < 1e-6f)) continue;
+            lightDir = Vector3Scale(toLight, 1.0f/distance);
+            attenuation = 1.0f/(1.0f + light->linear*distance + light->quadratic*distance*distance);
+
+            if (light->type == LIGHT_SPOT)
+            {
+                float cutoff = cosf(light->spotAngle*DEG2RAD);
+                float cosAngle = -Vector3DotProduct(lightDir, Vector3Normalize(light->direction));
+                attenuation *= Clamp((cosAngle - cutoff)/fmaxf(1.0f - cutoff, 1e-4f)*4.0f, 0.0f, 1.0f);
+            }
+        }
+
+        float ndotl = Vector3DotProduct(normal, lightDir);
+        if ((ndotl <= 0.0f) || (attenuation <= 0.0f)) continue;
+        if (TraceBakeRay(scene, origin, lightDir, distance - scene->bias, true, NULL) >= 0) continue;
+
+        result = Vector3Add(result, Vector3Scale(light->color, ndotl*attenuation));
+    }
+
+    return result;
+}
+
+// Cosine weighted direction around a normal
+static Vector3 GetBakeHemisphereDirection(Vector3 normal, unsigned int* state)
+{
+    float r1 = GetBakeRandom(state);
+    float r2 = GetBakeRandom(state);
+    float radius = sqrtf(r1);
+    float phi = 2.0f*PI*r2;
+
+    Vector3 helper = { 1.0f, 0.0f, 0.0f };
+    if (fabsf(normal.x) > 0.9f) helper = Vector3One();
+    Vector3 tangent = Vector3Normalize(Vector3CrossProduct(normal, helper));
+    Vector3 bitangent = Vector3CrossProduct(normal, tangent);
+
+    Vector3 dir = Vector3Scale(normal, sqrtf(fmaxf(1.0f - r1, 0.0f)));
+    dir = Vector3Add(dir, Vector3Scale(tangent, radius*cosf(phi)));
+    return Vector3Add(dir, Vector3Scale(bitangent, radius*sinf(phi)));
+}
+
+// Bakes a tile of texels, tiles are small so the job counter balances uneven tiles over the threads
+static void BakeLightmapTile(void* data, int index)
+{
+    BakeScene* scene = (BakeScene*)data;
+    int size = scene->settings.size;
+    int tilesX = (size + BAKE_TILE_SIZE - 1)/BAKE_TILE_SIZE;
+    int x0 = (index%tilesX)*BAKE_TILE_SIZE;
+    int y0 = (index/tilesX)*BAKE_TILE_SIZE;
+
+    for (int y = y0; (y < y0 + BAKE_TILE_SIZE) && (y < size); y++)
+    {
+        for (int x = x0; (x < x0 + BAKE_TILE_SIZE) && (x < size); x++)
+        {
+            BakeTexel* texel = &scene->texels[y*size + x];
+            if (texel->coverage == 0) continue;
+
+            unsigned int state = (unsigned int)(y*size + x)*2654435761u + 1u;
+            Vector3 light = scene->settings.indirectOnly? Vector3Zero() : GetBakeDirectLight(scene, texel->position, texel->normal);
+            Vector3 indirect = Vector3Zero();
+            int backfaces = 0;
+
+            for (int s = 0; s < scene->settings.samples; s++)
+            {
+                Vector3 throughput = Vector3One();
+                Vector3 position = texel->position;
+                Vector3 normal = texel->normal;
+
+                for (int b = 0; b < scene->settings.bounces; b++)
+                {
+                    Vector3 dir = GetBakeHemisphereDirection(normal, &state);
+                    Vector3 origin = Vector3Add(position, Vector3Scale(normal, scene->bias));
+                    float distance = 0.0f;
+                    int hit = TraceBakeRay(scene, origin, dir, FLT_MAX, false, &distance);
+                    if (hit < 0)
+                    {
+                        indirect = Vector3Add(indirect, Vector3Multiply(throughput, scene->settings.ambient));
+                        break;
+                    }
+
+                    // The inside of a closed mesh, no light comes from there
+                    const BakeTriangle* tri = &scene->triangles[hit];
+                    if (Vector3DotProduct(dir, tri->normal) > 0.0f)
+                    {
+                        if (b == 0) backfaces++;
+                        break;
+                    }
+
+                    position = Vector3Add(origin, Vector3Scale(dir, distance));
+                    normal = tri->normal;
+                    throughput = Vector3Multiply(throughput, tri->albedo);
+                    indirect = Vector3Add(indirect, Vector3Multiply(throughput, GetBakeDirectLight(scene, position, normal)));
+                }
+            }
+
+            // Texels mostly seeing back faces are inside other geometry, the border dilation fills them instead
+            if ((scene->settings.samples > 0) && (backfaces*2 > scene->settings.samples))
+            {
+                texel->coverage = 0;
+                continue;
+            }
+
+            if (scene->settings.samples > 0) light = Vector3Add(light, Vector3Scale(indirect, 1.0f/(float)scene->settings.samples));
+            float* out = scene->lightmap + (y*size + x)*3;
+            out[0] = light.x;
+            out[1] = light.y;
+            out[2] = light.z;
+        }
+    }
+}
+
+// Gives every triangle its own vertices, charts can then split the mesh on any edge
+static void UnweldMeshAttribute(void** attribute, const unsigned short* indices, int count, int stride)
+{
+    if (*attribute == NULL) return;
+
+    unsigned char* source = (unsigned char*)*attribute;
+    unsigned char* result = (unsigned char*)RL_MALLOC(count*stride);
+    for (int i = 0; i < count; i++) memcpy(result + i*stride, source + indices[i]*stride, stride);
+    RL_FREE(source);
+    *attribute = result;
+}
+
+static void UnweldMesh(Mesh* mesh)
+{
+    if (mesh->indices == NULL) return;
+
+    int count = mesh->triangleCount*3;
+    UnweldMeshAttribute((void**)&mesh->vertices, mesh->indices, count, 3*sizeof(float));
+    UnweldMeshAttribute((void**)&mesh->texcoords, mesh->indices, count, 2*sizeof(float));
+    UnweldMeshAttribute((void**)&mesh->texcoords2, mesh->indices, count, 2*sizeof(float));
+    UnweldMeshAttribute((void**)&mesh->normals, mesh->indices, count, 3*sizeof(float));
+    UnweldMeshAttribute((void**)&mesh->tangents, mesh->indices, count, 4*sizeof(float));
+    UnweldMeshAttribute((void**)&mesh->colors, mesh->indices, count, 4*sizeof(unsigned char));
+    UnweldMeshAttribute((void**)&mesh->animVertices, mesh->indices, count, 3*sizeof(float));
+    UnweldMeshAttribute((void**)&mesh->animNormals, mesh->indices, count, 3*sizeof(float));
+    UnweldMeshAttribute((void**)&mesh->boneIds, mesh->indices, count, 4*sizeof(int));
+    UnweldMeshAttribute((void**)&mesh->boneWeights, mesh->indices, count, 4*sizeof(float));
+
+    RL_FREE(mesh->indices);
+    mesh->indices = NULL;
+    mesh->vertexCount = count;
+}
+
+// Uploads a mesh again after its vertices changed, meshes never uploaded (no GL context) are left alone
+static void ReloadMesh(Mesh* mesh)
+{
+    if (mesh->vaoId == 0) return;
+
+    glDeleteVertexArrays(1, &mesh->vaoId);
+    for (int i = 0; (mesh->vboId != NULL) && (i < BAKE_MESH_BUFFERS); i++)
+    {
+        if (mesh->vboId[i] != 0) glDeleteBuffers(1, &mesh->vboId[i]);
+    }
+    RL_FREE(mesh->vboId);
+    mesh->vboId = NULL;
+    mesh->vaoId = 0;
+    UploadMesh(mesh, false);
+}
+
+static int GetMeshVertexIndex(const Mesh* mesh, int triangle, int corner)
+{
+    return (mesh->indices != NULL)? mesh->indices[triangle*3 + corner] : triangle*3 + corner;
+}
+
+typedef struct BakeEdge {
+    int a;                           // Welded vertex ids, a < b
+    int b;
+    int triangle;
+} BakeEdge;
+
+static int CompareBakeEdges(const void* left, const void* right)
+{
+    const BakeEdge* l = (const BakeEdge*)left;
+    const BakeEdge* r = (const BakeEdge*)right;
+    if (l->a != r->a) return (l->a < r->a)? -1 : 1;
+    if (l->b != r->b) return (l->b < r->b)? -1 : 1;
+    return l->triangle - r->triangle;
+}
+
+static const Vector3* bakeSortPositions = NULL;
+
+static int CompareBakePositions(const void* left, const void* right)
+{
+    Vector3 l = bakeSortPositions[*(const int*)left];
+    Vector3 r = bakeSortPositions[*(const int*)right];
+    if (l.x != r.x) return (l.x < r.x)? -1 : 1;
+    if (l.y != r.y) return (l.y < r.y)? -1 : 1;
+    if (l.z != r.z) return (l.z < r.z)? -1 : 1;
+    return 0;
+}
+
+// Groups the triangles of a mesh into planar charts, a chart grows over shared edges while the triangle normals stay
+// close to the normal of its first triangle, so its projection on that plane does not fold
+static int BuildMeshCharts(const Vector3* positions, const Vector3* normals, int triangleCount, int mesh, BakeChart* charts, int* chartTriangles, int firstTriangle)
+{
+    int vertexCount = triangleCount*3;
+
+    // Weld vertices by position, triangles of unwelded meshes still share their edges
+    int* sorted = (int*)R3D_MALLOC(vertexCount*sizeof(int));
+    int* welded = (int*)R3D_MALLOC(vertexCount*sizeof(int));
+    for (int i = 0; i < vertexCount; i++) sorted[i] = i;
+    bakeSortPositions = positions;
+    qsort(sorted, vertexCount, sizeof(int), CompareBakePositions);
+    for (int i = 0, id = 0; i < vertexCount; i++)
+    {
+        if ((i > 0) && (CompareBakePositions(&sorted[i - 1], &sorted[i]) != 0)) id++;
+        welded[sorted[i]] = id;
+    }
+
+    BakeEdge* edges = (BakeEdge*)R3D_MALLOC(vertexCount*sizeof(BakeEdge));
+    for (int t = 0; t < triangleCount; t++)
+    {
+        for (int e = 0; e < 3; e++)
+        {
+            int a = welded[t*3 + e];
+            int b = welded[t*3 + (e + 1)%3];
+            BakeEdge edge = { (a < b)? a : b, (a < b)? b : a, t };
+            edges[t*3 + e] = edge;
+        }
+    }
+    qsort(edges, vertexCount, sizeof(BakeEdge), CompareBakeEdges);
+
+    // Neighbors over each shared edge, edges shared by more than two triangles only link the first two
+    int* neighbors = (int*)R3D_MALLOC(vertexCount*sizeof(int));
+    int* neighborCounts = (int*)R3D_CALLOC(triangleCount, sizeof(int));
+    for (int i = 0; i < vertexCount; i++) neighbors[i] = -1;
+    for (int i = 0; i + 1 < vertexCount; i++)
+    {
+        if ((edges[i].a != edges[i + 1].a) || (edges[i].b != edges[i + 1].b) || (edges[i].a == edges[i].b)) continue;
+        int t0 = edges[i].triangle;
+        int t1 = edges[i + 1].triangle;
+        if ((neighborCounts[t0] < 3) && (neighborCounts[t1] < 3))
+        {
+            neighbors[t0*3 + neighborCounts[t0]++] = t1;
+            neighbors[t1*3 + neighborCounts[t1]++] = t0;
+        }
+    }
+
+    int* chartOf = (int*)R3D_MALLOC(triangleCount*sizeof(int));
+    for (int t = 0; t < triangleCount; t++) chartOf[t] = -1;
+
+    int chartCount = 0;
+    int listed = 0;
+    for (int seed = 0; seed < triangleCount; seed++)
+    {
+        if (chartOf[seed] >= 0) continue;
+
+        BakeChart* chart = &charts[chartCount];
+        memset(chart, 0, sizeof(BakeChart));
+        chart->mesh = mesh;
+        chart->first = firstTriangle + listed;
+        chart->scale = 1.0f;
+
+        // Breadth first growth, the chart triangle list doubles as the queue
+        Vector3 normal = normals[seed];
+        int* queue = chartTriangles + firstTriangle;
+        int head = listed;
+        chartOf[seed] = chartCount;
+        queue[listed++] = seed;
+        while (head < listed)
+        {
+            int t = queue[head++];
+            for (int n = 0; n < neighborCounts[t]; n++)
+            {
+                int other = neighbors[t*3 + n];
+                if ((chartOf[other] >= 0) || (Vector3DotProduct(normals[other], normal) < BAKE_CHART_NORMAL)) continue;
+                chartOf[other] = chartCount;
+                queue[listed++] = other;
+            }
+        }
+        chart->count = listed - (chart->first - firstTriangle);
+
+        Vector3 helper = { 0.0f, 1.0f, 0.0f };
+        if (fabsf(normal.y) > 0.9f) helper.x = 1.0f, helper.y = 0.0f;
+        chart->planar = true;
+        chart->axisU = Vector3Normalize(Vector3CrossProduct(helper, normal));
+        chart->axisV = Vector3CrossProduct(normal, chart->axisU);
+        chartCount++;
+    }
+
+    R3D_FREE(sorted);
+    R3D_FREE(welded);
+    R3D_FREE(edges);
+    R3D_FREE(neighbors);
+    R3D_FREE(neighborCounts);
+    R3D_FREE(chartOf);
+
+    return chartCount;
+}
+
+static void GrowBakeRect(Vector2* min, Vector2* max, Vector2 point)
+{
+    min->x = fminf(min->x, point.x);
+    min->y = fminf(min->y, point.y);
+    max->x = fmaxf(max->x, point.x);
+    max->y = fmaxf(max->y, point.y);
+}
+
+static const BakeChart* bakeSortCharts = NULL;
+
+static int CompareBakeChartHeights(const void* left, const void* right)
+{
+    float l = (bakeSortCharts[*(const int*)left].max.y - bakeSortCharts[*(const int*)left].min.y)*bakeSortCharts[*(const int*)left].scale;
+    float r = (bakeSortCharts[*(const int*)right].max.y - bakeSortCharts[*(const int*)right].min.y)*bakeSortCharts[*(const int*)right].scale;
+    return (l > r)? -1 : (l < r)? 1 : 0;
+}
+
+// Shelf packing, tallest charts first, false when they don't fit at this density
+static bool PackBakeCharts(BakeChart* charts, const int* sorted, int count, float density, int size, int padding)
+{
+    int x = 0;
+    int y = 0;
+    int shelf = 0;
+    for (int i = 0; i < count; i++)
+    {
+        BakeChart* chart = &charts[sorted[i]];
+        int w = (int)ceilf((chart->max.x - chart->min.x)*chart->scale*density) + 1 + 2*padding;
+        int h = (int)ceilf((chart->max.y - chart->min.y)*chart->scale*density) + 1 + 2*padding;
+        if (x + w > size)
+        {
+            x = 0;
+            y += shelf;
+            shelf = 0;
+        }
+        if ((w > size) || (y + h > size)) return false;
+
+        chart->x = x + padding;
+        chart->y = y + padding;
+        x += w;
+        if (h > shelf) shelf = h;
+    }
+    return true;
+}
+
+// Fills the texels covered by a triangle, texels whose center is just outside get the closest point of the triangle
+static void RasterizeBakeTriangle(BakeScene* scene, const Vector2* uv, const Vector3* positions, const Vector3* normals)
+{
+    int size = scene->settings.size;
+    float area = (uv[1].x - uv[0].x)*(uv[2].y - uv[0].y) - (uv[2].x - uv[0].x)*(uv[1].y - uv[0].y);
+    if (fabsf(area) < 1e-12f) return;
+
+    int minX = (int)floorf(fminf(uv[0].x, fminf(uv[1].x, uv[2].x))) - 1;
+    int maxX = (int)ceilf(fmaxf(uv[0].x, fmaxf(uv[1].x, uv[2].x))) + 1;
+    int minY = (int)floorf(fminf(uv[0].y, fminf(uv[1].y, uv[2].y))) - 1;
+    int maxY = (int)ceilf(fmaxf(uv[0].y, fmaxf(uv[1].y, uv[2].y))) + 1;
+    if (minX < 0) minX = 0;
+    if (minY < 0) minY = 0;
+    if (maxX > size - 1) maxX = size - 1;
+    if (maxY > size - 1) maxY = size - 1;
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        for (int x = minX; x <= maxX; x++)
+        {
+            BakeTexel* texel = &scene->texels[y*size + x];
+            if (texel->coverage == 2) continue;
+
+            float px = (float)x + 0.5f;
+            float py = (float)y + 0.5f;
+            float w0 = ((uv[1].x - px)*(uv[2].y - py) - (uv[2].x - px)*(uv[1].y - py))/area;
+            float w1 = ((uv[2].x - px)*(uv[0].y - py) - (uv[0].x - px)*(uv[2].y - py))/area;
+            float w2 = 1.0f - w0 - w1;
+            int coverage = ((w0 >= 0.0f) && (w1 >= 0.0f) && (w2 >= 0.0f))? 2 : 1;
+
+            if (coverage == 1)
+            {
+                if (texel->coverage == 1) continue;
+
+                // Clamped to the triangle, kept when within a texel of the center
+                w0 = fmaxf(w0, 0.0f);
+                w1 = fmaxf(w1, 0.0f);
+                w2 = fmaxf(w2, 0.0f);
+                float sum = w0 + w1 + w2;
+                w0 /= sum;
+                w1 /= sum;
+                w2 /= sum;
+                float cx = uv[0].x*w0 + uv[1].x*w1 + uv[2].x*w2;
+                float cy = uv[0].y*w0 + uv[1].y*w1 + uv[2].y*w2;
+                if ((fabsf(cx - px) > 1.0f) || (fabsf(cy - py) > 1.0f)) continue;
+            }
+
+            texel->coverage = coverage;
+            texel->position = Vector3Add(Vector3Add(Vector3Scale(positions[0], w0), Vector3Scale(positions[1], w1)), Vector3Scale(positions[2], w2));
+            texel->normal = Vector3Normalize(Vector3Add(Vector3Add(Vector3Scale(normals[0], w0), Vector3Scale(normals[1], w1)), Vector3Scale(normals[2], w2)));
+        }
+    }
+}
+
+R3DDEF Image BakeLightmaps(Model* model, const R3DLight* lights, int count, R3DBakeSettings settings)
+{
+    Image lightmap = { 0 };
+    if (settings.size <= 0) settings.size = 512;
+    if (settings.padding <= 0) settings.padding = 2;
+    if (settings.samples <= 0) settings.samples = 64;
+    if (settings.bounces <= 0) settings.bounces = 2;
+    if (settings.albedo <= 0.0f) settings.albedo = 0.5f;
+    int size = settings.size;
+
+    // Meshes keep their second texcoords when the model has only one mesh, else they are packed with the others
+    bool keepTexcoords = (model->meshCount == 1) && (model->meshes[0].texcoords2 != NULL);
+
+    // Unwelding only keeps the first level of the indices, and the meshes uploaded again move the index ranges
+    for (int m = 0; !keepTexcoords && (m < model->meshCount); m++)
+    {
+        if ((GetMeshLods(model->meshes[m]).count > 1) || (GetMeshMeshlets(model->meshes[m]) != NULL))
+        {
+            TraceLog(LOG_WARNING, "LIGHTMAPS: Mesh with detail levels or meshlets, the lightmap must be baked before generating them");
+            return lightmap;
+        }
+    }
+
+    // Vertex arrays and vertices the stored bounds are found by
+    Mesh* originals = (Mesh*)R3D_MALLOC(model->meshCount*sizeof(Mesh));
+    int triangleCount = 0;
+    for (int m = 0; m < model->meshCount; m++)
+    {
+        originals[m] = model->meshes[m];
+        if (!keepTexcoords && (model->meshes[m].texcoords2 == NULL)) UnweldMesh(&model->meshes[m]);
+        triangleCount += model->meshes[m].triangleCount;
+    }
+    if (triangleCount == 0)
+    {
+        TraceLog(LOG_WARNING, "LIGHTMAPS: Model has no triangles to bake");
+        R3D_FREE(originals);
+        return lightmap;
+    }
+
+    // World space triangles, in model order
+    Vector3* positions = (Vector3*)R3D_MALLOC(triangleCount*3*sizeof(Vector3));
+    Vector3* vertexNormals = (Vector3*)R3D_MALLOC(triangleCount*3*sizeof(Vector3));
+    Vector3* faceNormals = (Vector3*)R3D_MALLOC(triangleCount*sizeof(Vector3));
+    BakeScene scene = { 0 };
+    scene.triangles = (BakeTriangle*)R3D_MALLOC(triangleCount*sizeof(BakeTriangle));
+    scene.order = (int*)R3D_MALLOC(triangleCount*sizeof(int));
+    scene.nodes = (BakeNode*)R3D_MALLOC(2*triangleCount*sizeof(BakeNode));
+    scene.nodeCount = 1;
+    scene.lights = lights;
+    scene.lightCount = count;
+    scene.lightRadius = (float*)R3D_MALLOC((count + 1)*sizeof(float));
+    scene.settings = settings;
+
+    Matrix normalMatrix = MatrixTranspose(MatrixInvert(model->transform));
+    Vector3 boundsMin = Vector3Scale(Vector3One(), FLT_MAX);
+    Vector3 boundsMax = Vector3Scale(Vector3One(), -FLT_MAX);
+    int* meshFirst = (int*)R3D_MALLOC((model->meshCount + 1)*sizeof(int));
+
+    for (int m = 0, t = 0; m < model->meshCount; m++)
+    {
+        const Mesh* mesh = &model->meshes[m];
+        Color color = model->materials[model->meshMaterial[m]].maps[MATERIAL_MAP_ALBEDO].color;
+        Vector3 albedo = { settings.albedo*color.r/255.0f, settings.albedo*color.g/255.0f, settings.albedo*color.b/255.0f };
+        meshFirst[m] = t;
+
+        for (int i = 0; i < mesh->triangleCount; i++, t++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                int v = GetMeshVertexIndex(mesh, i, c);
+                Vector3 p = { mesh->vertices[v*3], mesh->vertices[v*3 + 1], mesh->vertices[v*3 + 2] };
+                positions[t*3 + c] = Vector3Transform(p, model->transform);
+                boundsMin = Vector3Min(boundsMin, positions[t*3 + c]);
+                boundsMax = Vector3Max(boundsMax, positions[t*3 + c]);
+            }
+
+            BakeTriangle* tri = &scene.triangles[t];
+            tri->v0 = positions[t*3];
+            tri->e1 = Vector3Subtract(positions[t*3 + 1], tri->v0);
+            tri->e2 = Vector3Subtract(positions[t*3 + 2], tri->v0);
+            tri->normal = Vector3Normalize(Vector3CrossProduct(tri->e1, tri->e2));
+            tri->albedo = albedo;
+            faceNormals[t] = tri->normal;
+            scene.order[t] = t;
+
+            for (int c = 0; c < 3; c++)
+            {
+                int v = GetMeshVertexIndex(mesh, i, c);
+                vertexNormals[t*3 + c] = tri->normal;
+                if (mesh->normals != NULL)
+                {
+                    Vector3 n = { mesh->normals[v*3], mesh->normals[v*3 + 1], mesh->normals[v*3 + 2] };
+                    n = Vector3Normalize(Vector3Transform(n, normalMatrix));
+                    if (Vector3DotProduct(n, tri->normal) > 0.0f) vertexNormals[t*3 + c] = n;
+                }
+            }
+        }
+    }
+    meshFirst[model->meshCount] = triangleCount;
+
+    scene.bias = 1e-4f*fmaxf(Vector3Length(Vector3Subtract(boundsMax, boundsMin)), 1.0f);
+    for (int i = 0; i < count; i++) scene.lightRadius[i] = GetLightRadius(lights[i]);
+    BuildBakeNode(&scene, 0, 0, triangleCount, 0);
+
+    // Charts, one per planar group of triangles, or one per mesh for kept texcoords
+    BakeChart* charts = (BakeChart*)R3D_CALLOC(triangleCount + model->meshCount, sizeof(BakeChart));
+    int* chartTriangles = (int*)R3D_MALLOC(triangleCount*sizeof(int));
+    int chartCount = 0;
+    double worldArea = 0.0;
+
+    for (int m = 0; m < model->meshCount; m++)
+    {
+        const Mesh* mesh = &model->meshes[m];
+        int first = meshFirst[m];
+
+        if (keepTexcoords) continue;
+
+        if (mesh->texcoords2 != NULL)
+        {
+            // Existing texcoords are one chart, scaled to the world size of the mesh
+            BakeChart* chart = &charts[chartCount++];
+            chart->mesh = m;
+            chart->first = first;
+            chart->count = mesh->triangleCount;
+            chart->min.x = chart->min.y = FLT_MAX;
+            chart->max.x = chart->max.y = -FLT_MAX;
+            double meshArea = 0.0;
+            double uvArea = 0.0;
+            for (int i = 0; i < mesh->triangleCount; i++)
+            {
+                chartTriangles[first + i] = i;
+                Vector2 uv[3];
+                for (int c = 0; c < 3; c++)
+                {
+                    int v = GetMeshVertexIndex(mesh, i, c);
+                    uv[c].x = mesh->texcoords2[v*2];
+                    uv[c].y = mesh->texcoords2[v*2 + 1];
+                    GrowBakeRect(&chart->min, &chart->max, uv[c]);
+                }
+                meshArea += 0.5*Vector3Length(Vector3CrossProduct(scene.triangles[first + i].e1, scene.triangles[first + i].e2));
+                uvArea += 0.5*fabs((uv[1].x - uv[0].x)*(uv[2].y - uv[0].y) - (uv[2].x - uv[0].x)*(uv[1].y - uv[0].y));
+            }
+            chart->scale = (uvArea > 0.0)? (float)sqrt(meshArea/uvArea) : 1.0f;
+            worldArea += (chart->max.x - chart->min.x)*(chart->max.y - chart->min.y)*chart->scale*chart->scale;
+            continue;
+        }
+
+        int meshCharts = BuildMeshCharts(positions + first*3, faceNormals + first, mesh->triangleCount, m, charts + chartCount, chartTriangles, first);
+        for (int c = chartCount; c < chartCount + meshCharts; c++)
+        {
+            BakeChart* chart = &charts[c];
+            chart->min.x = chart->min.y = FLT_MAX;
+            chart->max.x = chart->max.y = -FLT_MAX;
+            for (int i = chart->first; i < chart->first + chart->count; i++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    Vector3 p = positions[(first + chartTriangles[i])*3 + k];
+                    Vector2 q = { Vector3DotProduct(p, chart->axisU), Vector3DotProduct(p, chart->axisV) };
+                    GrowBakeRect(&chart->min, &chart->max, q);
+                }
+            }
+            worldArea += (chart->max.x - chart->min.x)*(chart->max.y - chart->min.y);
+        }
+        chartCount += meshCharts;
+    }
+
+    // Highest texel density the charts fit at, shrinking until packed
+    int* sortedCharts = (int*)R3D_MALLOC((chartCount + 1)*sizeof(int));
+    for (int c = 0; c < chartCount; c++) sortedCharts[c] = c;
+    bakeSortCharts = charts;
+    qsort(sortedCharts, chartCount, sizeof(int), CompareBakeChartHeights);
+
+    float density = settings.texelsPerUnit;
+    if (density <= 0.0f) density = (worldArea > 0.0)? (float)sqrt(0.7*(double)size*(double)size/worldArea) : 1.0f;
+    bool packed = (chartCount == 0);
+    for (int attempt = 0; (attempt < 100) && !packed; attempt++)
+    {
+        packed = PackBakeCharts(charts, sortedCharts, chartCount, density, size, settings.padding);
+        if (!packed) density *= 0.9f;
+    }
+    if (!packed) TraceLog(LOG_WARNING, "LIGHTMAPS: Charts don't fit in a %i x %i lightmap", size, size);
+
+    // Second texcoords from the chart placement, texel space while rasterizing
+    scene.texels = (BakeTexel*)R3D_CALLOC(size*size, sizeof(BakeTexel));
+    for (int c = 0; packed && (c < chartCount); c++)
+    {
+        BakeChart* chart = &charts[c];
+        Mesh* mesh = &model->meshes[chart->mesh];
+        int first = meshFirst[chart->mesh];
+        if (mesh->texcoords2 == NULL) mesh->texcoords2 = (float*)RL_MALLOC(mesh->vertexCount*2*sizeof(float));
+
+        float scale = chart->scale*density;
+        for (int i = chart->first; i < chart->first + chart->count; i++)
+        {
+            int t = chartTriangles[i];
+            for (int k = 0; k < 3; k++)
+            {
+                int v = GetMeshVertexIndex(mesh, t, k);
+                Vector2 q = { mesh->texcoords2[v*2], mesh->texcoords2[v*2 + 1] };
+                if (chart->planar)
+                {
+                    Vector3 p = positions[(first + t)*3 + k];
+                    q.x = Vector3DotProduct(p, chart->axisU);
+                    q.y = Vector3DotProduct(p, chart->axisV);
+                }
+                mesh->texcoords2[v*2] = ((float)chart->x + 0.5f + (q.x - chart->min.x)*scale)/(float)size;
+                mesh->texcoords2[v*2 + 1] = ((float)chart->y + 0.5f + (q.y - chart->min.y)*scale)/(float)size;
+            }
+        }
+    }
+
+    for (int m = 0; m < model->meshCount; m++)
+    {
+        const Mesh* mesh = &model->meshes[m];
+        if (mesh->texcoords2 == NULL) continue;
+
+        for (int i = 0; i < mesh->triangleCount; i++)
+        {
+            int t = meshFirst[m] + i;
+            Vector2 uv[3];
+            for (int c = 0; c < 3; c++)
+            {
+                int v = GetMeshVertexIndex(mesh, i, c);
+                uv[c].x = mesh->texcoords2[v*2]*(float)size;
+                uv[c].y = mesh->texcoords2[v*2 + 1]*(float)size;
+            }
+            RasterizeBakeTriangle(&scene, uv, positions + t*3, vertexNormals + t*3);
+        }
+    }
+
+    // Path tracing over all the cores, idle threads take the next tile from the shared job counter.. uneven tiles
+    // balance out without per thread work stealing queues
+    scene.lightmap = (float*)RL_MALLOC(size*size*3*sizeof(float));
+    memset(scene.lightmap, 0, size*size*3*sizeof(float));
+    int tiles = (size + BAKE_TILE_SIZE - 1)/BAKE_TILE_SIZE;
+    ParallelFor(tiles*tiles, BakeLightmapTile, &scene);
+
+    // Empty texels around the charts take the average of their baked neighbors, bilinear filtering reads them
+    unsigned char* filled = (unsigned char*)R3D_MALLOC(size*size);
+    for (int i = 0; i < size*size; i++) filled[i] = (scene.texels[i].coverage > 0);
+    for (int pass = 0; pass < settings.padding + 1; pass++)
+    {
+        for (int i = 0; i < size*size; i++) scene.texels[i].coverage = filled[i];
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                if (scene.texels[y*size + x].coverage) continue;
+
+                Vector3 sum = Vector3Zero();
+                int n = 0;
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        int nx = x + dx;
+                        int ny = y + dy;
+                        if ((nx < 0) || (ny < 0) || (nx >= size) || (ny >= size) || !scene.texels[ny*size + nx].coverage) continue;
+                        const float* texel = scene.lightmap + (ny*size + nx)*3;
+                        sum.x += texel[0];
+                        sum.y += texel[1];
+                        sum.z += texel[2];
+                        n++;
+                    }
+                }
+                if (n == 0) continue;
+
+                float* texel = scene.lightmap + (y*size + x)*3;
+                texel[0] = sum.x/(float)n;
+                texel[1] = sum.y/(float)n;
+                texel[2] = sum.z/(float)n;
+                filled[y*size + x] = 1;
+            }
+        }
+    }
+
+    // Meshes with new texcoords are uploaded again
+    for (int m = 0; m < model->meshCount; m++)
+    {
+        if (!keepTexcoords) ReloadMesh(&model->meshes[m]);
+        MoveMeshBounds(originals[m], model->meshes[m]);
+    }
+    R3D_FREE(originals);
+
+    lightmap.data = scene.lightmap;
+    lightmap.width = size;
+    lightmap.height = size;
+    lightmap.mipmaps = 1;
+    lightmap.format = PIXELFORMAT_UNCOMPRESSED_R32G32B32;
+
+    TraceLog(LOG_INFO, "LIGHTMAPS: Lightmap baked successfully (%i x %i, %i triangles, %i charts, %i threads)", size, size, triangleCount, chartCount, GetJobThreadCount());
+
+    R3D_FREE(filled);
+    R3D_FREE(sortedCharts);
+    R3D_FREE(charts);
+    R3D_FREE(chartTriangles);
+    R3D_FREE(meshFirst);
+    R3D_FREE(positions);
+    R3D_FREE(vertexNormals);
+    R3D_FREE(faceNormals);
+    R3D_FREE(scene.triangles);
+    R3D_FREE(scene.order);
+    R3D_FREE(scene.nodes);
+    R3D_FREE(scene.lightRadius);
+    R3D_FREE(scene.texels);
+
+    return lightmap;
+}
+#pragma endregion
+
+#pragma region CULLING
+#define CULLING_JOB_SIZE 4096         // Instances tested per job, a multiple of 8
+
+typedef struct CullingSetData {
+    float* centerX;                  // World box centers
+    float* centerY;
+    float* centerZ;
+    float* extentX;                  // World box half sizes
+    float* extentY;
+    float* extentZ;
+    float* radius;                   // World bounding sphere radius, for the detail level
+    Matrix* transforms;              // Instance transforms, gathered for the instanced draws
+    int* jobCounts;                  // Visible instances found by each job, before compaction
+    Matrix* staging;                 // Visible transforms of the last DrawModelCulledDeferred()
+    int stagingCapacity;
+} CullingSetData;
+
+typedef struct CullingJob {
+    R3DCullingSet* set;
+    Vector4 planes[6];               // Frustum planes, normals pointing inside
+    Vector3 viewPosition;
+    float lodScale;                  // Projected size of a sphere of radius 1 at distance 1 (perspective) or any distance (orthographic)
+    bool orthographic;
+} CullingJob;
+
+static R3DBounds ComputeMeshBounds(Mesh mesh)
+{
+    R3DBounds bounds = { 0 };
+    if ((mesh.vertices == NULL) || (mesh.vertexCount <= 0)) return bounds;
+
+    Vector3 min = { mesh.vertices[0], mesh.vertices[1], mesh.vertices[2] };
+    Vector3 max = min;
+    for (int i = 1; i < mesh.vertexCount; i++)
+    {
+        Vector3 v = { mesh.vertices[i*3], mesh.vertices[i*3 + 1], mesh.vertices[i*3 + 2] };
+        min = Vector3Min(min, v);
+        max = Vector3Max(max, v);
+    }
+
+    // Sphere around the box center, tighter than the box corners for round meshes
+    bounds.box.min = min;
+    bounds.box.max = max;
+    bounds.center = Vector3Scale(Vector3Add(min, max), 0.5f);
+    float radiusSqr = 0.0f;
+    for (int i = 0; i < mesh.vertexCount; i++)
+    {
+        Vector3 d = { mesh.vertices[i*3] - bounds.center.x, mesh.vertices[i*3 + 1] - bounds.center.y, mesh.vertices[i*3 + 2] - bounds.center.z };
+        radiusSqr = fmaxf(radiusSqr, Vector3DotProduct(d, d));
+    }
+    bounds.radius = sqrtf(radiusSqr);
+
+    return bounds;
+}
+
+R3DDEF R3DBounds GetMeshBounds(Mesh mesh)
+{
+    MeshBoundsEntry* entry = (MeshBoundsEntry*)FindMeshTableEntry(&r3dMeshBounds, mesh.vaoId, mesh.vertices);
+    if (entry != NULL) return entry->bounds;
+
+    return ComputeMeshBounds(mesh);
+}
+
+// Box around a transformed box, from the absolute values of the rotation and scale
+static void TransformBoundsBox(BoundingBox box, Matrix transform, Vector3* center, Vector3* extent)
+{
+    Vector3 c = Vector3Transform(Vector3Scale(Vector3Add(box.min, box.max), 0.5f), transform);
+    Vector3 e = Vector3Scale(Vector3Subtract(box.max, box.min), 0.5f);
+    extent->x = fabsf(transform.m0)*e.x + fabsf(transform.m4)*e.y + fabsf(transform.m8)*e.z;
+    extent->y = fabsf(transform.m1)*e.x + fabsf(transform.m5)*e.y + fabsf(transform.m9)*e.z;
+    extent->z = fabsf(transform.m2)*e.x + fabsf(transform.m6)*e.y + fabsf(transform.m10)*e.z;
+    *center = c;
+}
+
+// Largest scale of a transform, applied to bounding sphere radii
+static float GetTransformMaxScale(Matrix transform)
+{
+    float x = transform.m0*transform.m0 + transform.m1*transform.m1 + transform.m2*transform.m2;
+    float y = transform.m4*transform.m4 + transform.m5*transform.m5 + transform.m6*transform.m6;
+    float z = transform.m8*transform.m8 + transform.m9*transform.m9 + transform.m10*transform.m10;
+    return sqrtf(fmaxf(x, fmaxf(y, z)));
+}
+
+R3DDEF R3DBounds GetModelBounds(Model model)
+{
+    R3DBounds bounds = { 0 };
+    if (model.meshCount <= 0) return bounds;
+
+    Vector3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+    Vector3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int i = 0; i < model.meshCount; i++)
+    {
+        Vector3 center, extent;
+        TransformBoundsBox(GetMeshBounds(model.meshes[i]).box, model.transform, &center, &extent);
+        min = Vector3Min(min, Vector3Subtract(center, extent));
+        max = Vector3Max(max, Vector3Add(center, extent));
+    }
+
+    // Sphere around the box center holding the mesh spheres
+    bounds.box.min = min;
+    bounds.box.max = max;
+    bounds.center = Vector3Scale(Vector3Add(min, max), 0.5f);
+    float scale = GetTransformMaxScale(model.transform);
+    for (int i = 0; i < model.meshCount; i++)
+    {
+        R3DBounds mesh = GetMeshBounds(model.meshes[i]);
+        float radius = Vector3Distance(Vector3Transform(mesh.center, model.transform), bounds.center) + mesh.radius*scale;
+        bounds.radius = fmaxf(bounds.radius, radius);
+    }
+
+    return bounds;
+}
+
+static void ResizeCullingSet(R3DCullingSet* set, int capacity)
+{
+    CullingSetData* data = (CullingSetData*)set->data;
+    float** arrays[7] = { &data->centerX, &data->centerY, &data->centerZ, &data->extentX, &data->extentY, &data->extentZ, &data->radius };
+    for (int i = 0; i < 7; i++)
+    {
+        float* array = (float*)R3D_MALLOC(capacity*sizeof(float));
+        if (set->count > 0) memcpy(array, *arrays[i], set->count*sizeof(float));
+        R3D_FREE(*arrays[i]);
+        *arrays[i] = array;
+    }
+
+    Matrix* transforms = (Matrix*)R3D_MALLOC(capacity*sizeof(Matrix));
+    if (set->count > 0) memcpy(transforms, data->transforms, set->count*sizeof(Matrix));
+    R3D_FREE(data->transforms);
+    data->transforms = transforms;
+
+    // Visibility is reset, it is only valid until the next change
+    R3D_FREE(set->visible);
+    R3D_FREE(set->lods);
+    R3D_FREE(data->jobCounts);
+    set->visible = (int*)R3D_MALLOC(capacity*sizeof(int));
+    set->lods = (unsigned char*)R3D_MALLOC(capacity*sizeof(unsigned char));
+    data->jobCounts = (int*)R3D_MALLOC(((capacity + CULLING_JOB_SIZE - 1)/CULLING_JOB_SIZE)*sizeof(int));
+    set->visibleCount = 0;
+    set->capacity = capacity;
+}
+
+R3DDEF R3DCullingSet LoadCullingSet(int capacity)
+{
+    R3DCullingSet set = { 0 };
+    set.data = R3D_CALLOC(1, sizeof(CullingSetData));
+    ResizeCullingSet(&set, (capacity > 0)? capacity : 256);
+    return set;
+}
+
+R3DDEF void UnloadCullingSet(R3DCullingSet set)
+{
+    CullingSetData* data = (CullingSetData*)set.data;
+    if (data == NULL) return;
+
+    R3D_FREE(data->centerX);
+    R3D_FREE(data->centerY);
+    R3D_FREE(data->centerZ);
+    R3D_FREE(data->extentX);
+    R3D_FREE(data->extentY);
+    R3D_FREE(data->extentZ);
+    R3D_FREE(data->radius);
+    R3D_FREE(data->transforms);
+    R3D_FREE(data->jobCounts);
+    R3D_FREE(data->staging);
+    R3D_FREE(data);
+    R3D_FREE(set.visible);
+    R3D_FREE(set.lods);
+}
+
+R3DDEF int AddCullingInstance(R3DCullingSet* set, R3DBounds bounds, Matrix transform)
+{
+    if (set->count == set->capacity) ResizeCullingSet(set, set->capacity*2);
+
+    set->count++;
+    SetCullingInstance(set, set->count - 1, bounds, transform);
+    return set->count - 1;
+}
+
+R3DDEF void SetCullingInstance(R3DCullingSet* set, int index, R3DBounds bounds, Matrix transform)
+{
+    if ((index < 0) || (index >= set->count))
+    {
+        TraceLog(LOG_WARNING, "CULLING: Instance index out of range (%i)", index);
+        return;
+    }
+
+    CullingSetData* data = (CullingSetData*)set->data;
+    Vector3 center, extent;
+    TransformBoundsBox(bounds.box, transform, &center, &extent);
+    data->centerX[index] = center.x;
+    data->centerY[index] = center.y;
+    data->centerZ[index] = center.z;
+    data->extentX[index] = extent.x;
+    data->extentY[index] = extent.y;
+    data->extentZ[index] = extent.z;
+
+    // The sphere is moved to the box center, its radius grown by the distance between both
+    Vector3 sphereCenter = Vector3Transform(bounds.center, transform);
+    data->radius[index] = bounds.radius*GetTransformMaxScale(transform) + Vector3Distance(sphereCenter, center);
+    data->transforms[index] = transform;
+}
+
+R3DDEF void ClearCullingSet(R3DCullingSet* set)
+{
+    set->count = 0;
+    set->visibleCount = 0;
+}
+
+// Frustum planes of a view projection (left, right, bottom, top, near, far), normalized with the normals pointing inside
+static void GetFrustumPlanes(Matrix m, Vector4* planes)
+{
+    Vector4 rows[4] = {
+        { m.m0, m.m4, m.m8, m.m12 },
+        { m.m1, m.m5, m.m9, m.m13 },
+        { m.m2, m.m6, m.m10, m.m14 },
+        { m.m3, m.m7, m.m11, m.m15 }
+    };
+
+    for (int i = 0; i < 6; i++)
+    {
+        Vector4 row = rows[i/2];
+        float sign = (i%2 == 0)? 1.0f : -1.0f;
+        Vector4 plane = { rows[3].x + sign*row.x, rows[3].y + sign*row.y, rows[3].z + sign*row.z, rows[3].w + sign*row.w };
+        float length = sqrtf(plane.x*plane.x + plane.y*plane.y + plane.z*plane.z);
+        float scale = (length > 0.0f)? 1.0f/length : 1.0f;
+        planes[i].x = plane.x*scale;
+        planes[i].y = plane.y*scale;
+        planes[i].z = plane.z*scale;
+        planes[i].w = plane.w*scale;
+    }
+}
+
+// Tests a job worth of instances, a box is outside when it is behind one of the planes (distance of its center under minus its extent along the normal)
+static void CullInstanceRange(void* data, int index)
+{
+    CullingJob* job = (CullingJob*)data;
+    R3DCullingSet* set = job->set;
+    CullingSetData* setData = (CullingSetData*)set->data;
+    int first = index*CULLING_JOB_SIZE;
+    int last = (first + CULLING_JOB_SIZE < set->count)? first + CULLING_JOB_SIZE : set->count;
+
+    int* visible = set->visible + first;
+    int count = 0;
+    int i = first;
+
+#if defined(R3D_SIMD_AVX)
+    // 8 boxes per iteration, the planes stop as soon as all of them are outside
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm256_set1_ps(job->planes[p].x);
+        planeY[p] = _mm256_set1_ps(job->planes[p].y);
+        planeZ[p] = _mm256_set1_ps(job->planes[p].z);
+        planeW[p] = _mm256_set1_ps(job->planes[p].w);
+        absX[p] = _mm256_set1_ps(fabsf(job->planes[p].x));
+        absY[p] = _mm256_set1_ps(fabsf(job->planes[p].y));
+        absZ[p] = _mm256_set1_ps(fabsf(job->planes[p].z));
+    }
+
+    for (; i + 8 <= last; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(setData->centerX + i);
+        __m256 y = _mm256_loadu_ps(setData->centerY + i);
+        __m256 z = _mm256_loadu_ps(setData->centerZ + i);
+        __m256 ex = _mm256_loadu_ps(setData->extentX + i);
+        __m256 ey = _mm256_loadu_ps(setData->extentY + i);
+        __m256 ez = _mm256_loadu_ps(setData->extentZ + i);
+
+        __m256 inside = _mm256_cmp_ps(ex, ex, _CMP_EQ_OQ);
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)), _mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+            __m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+            if (_mm256_movemask_ps(inside) == 0) break;
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int bit = 0; mask != 0; bit++, mask >>= 1) if (mask & 1) visible[count++] = i + bit;
+    }
+#elif defined(R3D_SIMD_SSE)
+    // 8 boxes per iteration as two groups of 4, the planes stop as soon as a group is outside
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm_set1_ps(job->planes[p].x);
+        planeY[p] = _mm_set1_ps(job->planes[p].y);
+        planeZ[p] = _mm_set1_ps(job->planes[p].z);
+        planeW[p] = _mm_set1_ps(job->planes[p].w);
+        absX[p] = _mm_set1_ps(fabsf(job->planes[p].x));
+        absY[p] = _mm_set1_ps(fabsf(job->planes[p].y));
+        absZ[p] = _mm_set1_ps(fabsf(job->planes[p].z));
+    }
+
+    for (; i + 8 <= last; i += 8)
+    {
+        int mask = 0;
+        for (int g = 0; g < 8; g += 4)
+        {
+            __m128 x = _mm_loadu_ps(setData->centerX + i + g);
+            __m128 y = _mm_loadu_ps(setData->centerY + i + g);
+            __m128 z = _mm_loadu_ps(setData->centerZ + i + g);
+            __m128 ex = _mm_loadu_ps(setData->extentX + i + g);
+            __m128 ey = _mm_loadu_ps(setData->extentY + i + g);
+            __m128 ez = _mm_loadu_ps(setData->extentZ + i + g);
+
+            __m128 inside = _mm_cmpeq_ps(ex, ex);
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)), _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+                __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+                if (_mm_movemask_ps(inside) == 0) break;
+            }
+
+            mask |= _mm_movemask_ps(inside) << g;
+        }
+
+        for (int bit = 0; mask != 0; bit++, mask >>= 1) if (mask & 1) visible[count++] = i + bit;
+    }
+#endif
+    for (; i < last; i++)
+    {
+        float x = setData->centerX[i], y = setData->centerY[i], z = setData->centerZ[i];
+        float ex = setData->extentX[i], ey = setData->extentY[i], ez = setData->extentZ[i];
+        bool inside = true;
+
+        for (int p = 0; (p < 6) && inside; p++)
+        {
+            Vector4 plane = job->planes[p];
+            float distance = plane.x*x + plane.y*y + plane.z*z + plane.w;
+            float reach = fabsf(plane.x)*ex + fabsf(plane.y)*ey + fabsf(plane.z)*ez;
+            inside = (distance + reach >= 0.0f);
+        }
+
+        if (inside) visible[count++] = i;
+    }
+
+    // Detail level of the visible instances, from the projected size of their bounding sphere
+    unsigned char* lods = set->lods + first;
+    bool singleLevel = (set->lodSizes[0] <= 0.0f);
+    if (singleLevel) memset(lods, 0, count);
+
+    for (int v = 0; (v < count) && !singleLevel; v++)
+    {
+        int instance = visible[v];
+        float radius = setData->radius[instance];
+        float size = radius*job->lodScale;
+        if (!job->orthographic)
+        {
+            float dx = setData->centerX[instance] - job->viewPosition.x;
+            float dy = setData->centerY[instance] - job->viewPosition.y;
+            float dz = setData->centerZ[instance] - job->viewPosition.z;
+            float distance = sqrtf(dx*dx + dy*dy + dz*dz);
+            size = (distance > radius)? size/distance : FLT_MAX;
+        }
+
+        int lod = 0;
+        while ((lod < CULLING_MAX_LODS - 1) && (set->lodSizes[lod] > 0.0f) && (size < set->lodSizes[lod])) lod++;
+        lods[v] = (unsigned char)lod;
+    }
+
+    setData->jobCounts[index] = count;
+}
+
+R3DDEF int CullInstances(R3DCullingSet* set, GBuffer gbuffer, Camera camera)
+{
+    CullingSetData* data = (CullingSetData*)set->data;
+
+    CullingJob job = { 0 };
+    job.set = set;
+    GetFrustumPlanes(GetDeferredModeViewProjection(gbuffer, camera), job.planes);
+    job.viewPosition = camera.position;
+    job.orthographic = (camera.projection == CAMERA_ORTHOGRAPHIC);
+    job.lodScale = job.orthographic? 2.0f/camera.fovy : 1.0f/tanf(camera.fovy*0.5f*DEG2RAD);
+
+    int jobs = (set->count + CULLING_JOB_SIZE - 1)/CULLING_JOB_SIZE;
+    ParallelFor(jobs, CullInstanceRange, &job);
+
+    // Each job wrote at the start of its range, moved down next to each other
+    int visibleCount = 0;
+    for (int i = 0; i < jobs; i++)
+    {
+        int count = data->jobCounts[i];
+        int first = i*CULLING_JOB_SIZE;
+        if ((count > 0) && (first != visibleCount))
+        {
+            memmove(set->visible + visibleCount, set->visible + first, count*sizeof(int));
+            memmove(set->lods + visibleCount, set->lods + first, count*sizeof(unsigned char));
+        }
+        visibleCount += count;
+    }
+
+    set->visibleCount = visibleCount;
+    return visibleCount;
+}
+
+R3DDEF void DrawModelCulledDeferred(Model model, R3DCullingSet* set, int lod)
+{
+    CullingSetData* data = (CullingSetData*)set->data;
+    if (set->visibleCount > data->stagingCapacity)
+    {
+        R3D_FREE(data->staging);
+        data->staging = (Matrix*)R3D_MALLOC(set->capacity*sizeof(Matrix));
+        data->stagingCapacity = set->capacity;
+    }
+
+    if (lod >= 0)
+    {
+        int count = 0;
+        for (int i = 0; i < set->visibleCount; i++)
+        {
+            if (set->lods[i] == lod) data->staging[count++] = data->transforms[set->visible[i]];
+        }
+        DrawModelInstancedLevel(model, data->staging, count, lod);
+        return;
+    }
+
+    // Each instance at its level of the model mesh levels, the levels past the last one draw the last one
+    int levels = 1;
+    for (int m = 0; m < model.meshCount; m++)
+    {
+        int meshLevels = GetMeshLods(model.meshes[m]).count;
+        if (meshLevels > levels) levels = meshLevels;
+    }
+
+    for (int level = 0; level < levels; level++)
+    {
+        int count = 0;
+        for (int i = 0; i < set->visibleCount; i++)
+        {
+            if ((set->lods[i] == level) || ((level == levels - 1) && (set->lods[i] > level))) data->staging[count++] = data->transforms[set->visible[i]];
+        }
+        DrawModelInstancedLevel(model, data->staging, count, level);
+    }
+}
+#pragma endregion
+
+#pragma region OCCLUSION
+#define OCCLUSION_MASK_WIDTH 8        // Pixels of a coverage mask, 8x4 pixels in 32 bits
+#define OCCLUSION_MASK_HEIGHT 4
+#define OCCLUSION_BLOCK_SIZE 4        // Masks per side of a hierarchical depth block, a block row is also a rasterization job
+#define OCCLUSION_JOB_TRIANGLES 1024  // Occluder triangles set up per job
+
+// Masked occlusion: every 8x4 pixel mask keeps a reference depth known to cover all of it, and a working layer
+// (coverage bits and their farthest depth) merged into the reference once full. Depths are 1/w, larger is nearer
+// NOTE: The farthest depth of a triangle over a mask is used for all the pixels it covers, keeping the buffer conservative
+typedef struct OccluderTriangle {
+    float edgeK[3];                  // Edge x at a pixel row y: k*y + m
+    float edgeM[3];
+    int edgeSide[3];                 // 1: left bound of the covered pixels, -1: right bound, 0: horizontal
+    float depthX;                    // Depth plane over the pixels
+    float depthY;
+    float depthC;
+    float minDepth;                  // Farthest vertex
+    int x0, y0, x1, y1;              // Pixels whose center may be covered, clamped to the buffer
+} OccluderTriangle;
+
+typedef struct OcclusionData {
+    float* positions;                // Occluder triangles, world space (9 floats each)
+    int capacity;
+    OccluderTriangle* setup;         // Projected triangles, 2 slots per occluder triangle for the near plane clipping
+    int* jobCounts;                  // Projected triangles of each setup job
+    int* binCounts;                  // Triangles overlapping each block row
+    int* binStarts;
+    int* bins;                       // Triangle indices, grouped by block row
+    int binCapacity;
+    unsigned int* masks;             // Working layer coverage of each 8x4 mask
+    float* workDepth;                // Farthest depth of the working layer
+    float* depth;                    // Reference depth, covering the whole mask
+    float* hiz;                      // Farthest reference depth of each block
+    Matrix viewProj;                 // Camera of the last update
+} OcclusionData;
+
+typedef struct OcclusionInstanceJob {
+    R3DOcclusionBuffer* buffer;
+    R3DCullingSet* set;
+} OcclusionInstanceJob;
+
+R3DDEF R3DOcclusionBuffer LoadOcclusionBuffer(int width, int height)
+{
+    R3DOcclusionBuffer buffer = { 0 };
+    int blockWidth = OCCLUSION_MASK_WIDTH*OCCLUSION_BLOCK_SIZE;
+    int blockHeight = OCCLUSION_MASK_HEIGHT*OCCLUSION_BLOCK_SIZE;
+    buffer.width = ((width > 0? width : 1) + blockWidth - 1)/blockWidth*blockWidth;
+    buffer.height = ((height > 0? height : 1) + blockHeight - 1)/blockHeight*blockHeight;
+
+    OcclusionData* data = (OcclusionData*)R3D_CALLOC(1, sizeof(OcclusionData));
+    int masks = (buffer.width/OCCLUSION_MASK_WIDTH)*(buffer.height/OCCLUSION_MASK_HEIGHT);
+    int blockRows = buffer.height/blockHeight;
+    data->masks = (unsigned int*)R3D_CALLOC(masks, sizeof(unsigned int));
+    data->workDepth = (float*)R3D_CALLOC(masks, sizeof(float));
+    data->depth = (float*)R3D_CALLOC(masks, sizeof(float));
+    data->hiz = (float*)R3D_CALLOC((buffer.width/blockWidth)*blockRows, sizeof(float));
+    data->binCounts = (int*)R3D_CALLOC(blockRows, sizeof(int));
+    data->binStarts = (int*)R3D_CALLOC(blockRows, sizeof(int));
+    data->viewProj = MatrixIdentity();
+    buffer.data = data;
+
+    return buffer;
+}
+
+R3DDEF void UnloadOcclusionBuffer(R3DOcclusionBuffer buffer)
+{
+    OcclusionData* data = (OcclusionData*)buffer.data;
+    if (data == NULL) return;
+
+    R3D_FREE(data->positions);
+    R3D_FREE(data->setup);
+    R3D_FREE(data->jobCounts);
+    R3D_FREE(data->binCounts);
+    R3D_FREE(data->binStarts);
+    R3D_FREE(data->bins);
+    R3D_FREE(data->masks);
+    R3D_FREE(data->workDepth);
+    R3D_FREE(data->depth);
+    R3D_FREE(data->hiz);
+    R3D_FREE(data);
+}
+
+R3DDEF void AddOccluderMesh(R3DOcclusionBuffer* buffer, Mesh mesh, Matrix transform)
+{
+    if (mesh.vertices == NULL)
+    {
+        TraceLog(LOG_WARNING, "OCCLUSION: Occluder mesh has no CPU vertices, skipped");
+        return;
+    }
+
+    OcclusionData* data = (OcclusionData*)buffer->data;
+    int triangles = (mesh.indices != NULL)? mesh.triangleCount : mesh.vertexCount/3;
+    if (buffer->occluderCount + triangles > data->capacity)
+    {
+        int capacity = (data->capacity > 0)? data->capacity : 1024;
+        while (capacity < buffer->occluderCount + triangles) capacity *= 2;
+
+        float* positions = (float*)R3D_MALLOC(capacity*9*sizeof(float));
+        if (buffer->occluderCount > 0) memcpy(positions, data->positions, buffer->occluderCount*9*sizeof(float));
+        R3D_FREE(data->positions);
+        R3D_FREE(data->setup);
+        R3D_FREE(data->jobCounts);
+        data->positions = positions;
+        data->setup = (OccluderTriangle*)R3D_MALLOC(capacity*2*sizeof(OccluderTriangle));
+        data->jobCounts = (int*)R3D_MALLOC(((capacity + OCCLUSION_JOB_TRIANGLES - 1)/OCCLUSION_JOB_TRIANGLES)*sizeof(int));
+        data->capacity = capacity;
+    }
+
+    // Stored in world space, the meshes can be unloaded afterwards
+    float* out = data->positions + buffer->occluderCount*9;
+    for (int i = 0; i < triangles*3; i++)
+    {
+        int vertex = (mesh.indices != NULL)? mesh.indices[i] : i;
+        Vector3 v = { mesh.vertices[vertex*3], mesh.vertices[vertex*3 + 1], mesh.vertices[vertex*3 + 2] };
+        v = Vector3Transform(v, transform);
+        out[i*3] = v.x;
+        out[i*3 + 1] = v.y;
+        out[i*3 + 2] = v.z;
+    }
+
+    buffer->occluderCount += triangles;
+}
+
+R3DDEF void AddOccluderModel(R3DOcclusionBuffer* buffer, Model model, Matrix transform)
+{
+    Matrix meshTransform = MatrixMultiply(model.transform, transform);
+    for (int i = 0; i < model.meshCount; i++) AddOccluderMesh(buffer, model.meshes[i], meshTransform);
+}
+
+R3DDEF void ClearOccluders(R3DOcclusionBuffer* buffer)
+{
+    buffer->occluderCount = 0;
+}
+
+// Clips a clip space triangle against the near plane, returns the vertices of the remaining polygon (0, 3 or 4)
+static int ClipOccluderTriangle(const Vector4* in, Vector4* out)
+{
+    float nearPlane = (float)RL_CULL_DISTANCE_NEAR;
+    int count = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        Vector4 a = in[i];
+        Vector4 b = in[(i + 1)%3];
+        bool insideA = (a.w >= nearPlane);
+        bool insideB = (b.w >= nearPlane);
+
+        if (insideA) out[count++] = a;
+        if (insideA != insideB)
+        {
+            float t = (nearPlane - a.w)/(b.w - a.w);
+            Vector4 v = { a.x + (b.x - a.x)*t, a.y + (b.y - a.y)*t, a.z + (b.z - a.z)*t, nearPlane };
+            out[count++] = v;
+        }
+    }
+
+    return count;
+}
+
+// Sets up a screen space triangle (x, y in pixels, z = 1/w), false when it covers no pixel center or faces away
+static bool SetupOccluderTriangle(Vector3 a, Vector3 b, Vector3 c, int width, int height, OccluderTriangle* tri)
+{
+    // Pixel rows go down, front faces (counter clockwise in NDC) have a negative area
+    float area = (b.x - a.x)*(c.y - a.y) - (c.x - a.x)*(b.y - a.y);
+    if (area >= 0.0f) return false;
+
+    float minX = fminf(a.x, fminf(b.x, c.x)), maxX = fmaxf(a.x, fmaxf(b.x, c.x));
+    float minY = fminf(a.y, fminf(b.y, c.y)), maxY = fmaxf(a.y, fmaxf(b.y, c.y));
+    tri->x0 = (int)fmaxf(ceilf(minX - 0.5f), 0.0f);
+    tri->x1 = (int)fminf(floorf(maxX - 0.5f), (float)(width - 1));
+    tri->y0 = (int)fmaxf(ceilf(minY - 0.5f), 0.0f);
+    tri->y1 = (int)fminf(floorf(maxY - 0.5f), (float)(height - 1));
+    if ((tri->x0 > tri->x1) || (tri->y0 > tri->y1)) return false;
+
+    Vector3 v[3] = { a, b, c };
+    for (int i = 0; i < 3; i++)
+    {
+        Vector3 p = v[i];
+        Vector3 q = v[(i + 1)%3];
+        float dy = q.y - p.y;
+        tri->edgeSide[i] = (dy > 1e-6f)? 1 : ((dy < -1e-6f)? -1 : 0);
+        tri->edgeK[i] = (tri->edgeSide[i] != 0)? (q.x - p.x)/dy : 0.0f;
+        tri->edgeM[i] = p.x - tri->edgeK[i]*p.y;
+    }
+
+    float dx1 = b.x - a.x, dy1 = b.y - a.y, dz1 = b.z - a.z;
+    float dx2 = c.x - a.x, dy2 = c.y - a.y, dz2 = c.z - a.z;
+    tri->depthX = (dz1*dy2 - dz2*dy1)/area;
+    tri->depthY = (dx1*dz2 - dx2*dz1)/area;
+    tri->depthC = a.z - tri->depthX*a.x - tri->depthY*a.y;
+    tri->minDepth = fminf(a.z, fminf(b.z, c.z));
+
+    return true;
+}
+
+static void SetupOccluders(void* data, int index)
+{
+    R3DOcclusionBuffer* buffer = (R3DOcclusionBuffer*)data;
+    OcclusionData* occlusion = (OcclusionData*)buffer->data;
+    Matrix m = occlusion->viewProj;
+    int first = index*OCCLUSION_JOB_TRIANGLES;
+    int last = (first + OCCLUSION_JOB_TRIANGLES < buffer->occluderCount)? first + OCCLUSION_JOB_TRIANGLES : buffer->occluderCount;
+
+    OccluderTriangle* out = occlusion->setup + first*2;
+    int count = 0;
+    for (int i = first; i < last; i++)
+    {
+        const float* p = occlusion->positions + i*9;
+        Vector4 clip[3];
+        for (int v = 0; v < 3; v++)
+        {
+            float x = p[v*3], y = p[v*3 + 1], z = p[v*3 + 2];
+            clip[v].x = m.m0*x + m.m4*y + m.m8*z + m.m12;
+            clip[v].y = m.m1*x + m.m5*y + m.m9*z + m.m13;
+            clip[v].z = m.m2*x + m.m6*y + m.m10*z + m.m14;
+            clip[v].w = m.m3*x + m.m7*y + m.m11*z + m.m15;
+        }
+
+        Vector4 polygon[4];
+        int vertices = ClipOccluderTriangle(clip, polygon);
+
+        Vector3 screen[4];
+        for (int v = 0; v < vertices; v++)
+        {
+            float invW = 1.0f/polygon[v].w;
+            screen[v].x = (polygon[v].x*invW*0.5f + 0.5f)*buffer->width;
+            screen[v].y = (0.5f - polygon[v].y*invW*0.5f)*buffer->height;
+            screen[v].z = invW;
+        }
+
+        for (int v = 2; v < vertices; v++)
+        {
+            if (SetupOccluderTriangle(screen[0], screen[v - 1], screen[v], buffer->width, buffer->height, &out[count])) count++;
+        }
+    }
+
+    occlusion->jobCounts[index] = count;
+}
+
+// Covered pixel range [first, end) of 4 pixel rows starting at row y
+static void GetOccluderSpans(const OccluderTriangle* tri, int y, int width, int* first, int* end)
+{
+#if defined(R3D_SIMD_SSE)
+    __m128 rows = _mm_add_ps(_mm_set1_ps(y + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+    __m128 left = _mm_set1_ps(-1.0f);
+    __m128 right = _mm_set1_ps(width + 1.0f);
+    for (int e = 0; e < 3; e++)
+    {
+        if (tri->edgeSide[e] == 0) continue;
+
+        __m128 x = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri->edgeK[e]), rows), _mm_set1_ps(tri->edgeM[e] - 0.5f));
+        if (tri->edgeSide[e] > 0) left = _mm_max_ps(left, x);
+        else right = _mm_min_ps(right, x);
+    }
+
+    // Clamped around the buffer, shifted to be positive so truncation floors
+    __m128 low = _mm_set1_ps(-1.0f);
+    __m128 high = _mm_set1_ps(width + 1.0f);
+    __m128 shift = _mm_set1_ps(width + 2.0f);
+    left = _mm_min_ps(_mm_max_ps(left, low), high);
+    right = _mm_min_ps(_mm_max_ps(right, low), high);
+    __m128i shiftInt = _mm_set1_epi32(width + 2);
+    __m128i firstPixel = _mm_sub_epi32(shiftInt, _mm_cvttps_epi32(_mm_sub_ps(shift, left)));                   // ceil(left)
+    __m128i endPixel = _mm_add_epi32(_mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(right, shift)), shiftInt), _mm_set1_epi32(1)); // floor(right) + 1
+    _mm_storeu_si128((__m128i*)first, firstPixel);
+    _mm_storeu_si128((__m128i*)end, endPixel);
+#else
+    for (int r = 0; r < 4; r++)
+    {
+        float row = y + r + 0.5f;
+        float left = -1.0f, right = width + 1.0f;
+        for (int e = 0; e < 3; e++)
+        {
+            float x = tri->edgeK[e]*row + tri->edgeM[e] - 0.5f;
+            if (tri->edgeSide[e] > 0) left = fmaxf(left, x);
+            else if (tri->edgeSide[e] < 0) right = fminf(right, x);
+        }
+
+        first[r] = (int)ceilf(fminf(left, width + 1.0f));
+        end[r] = (int)floorf(fmaxf(right, -1.0f)) + 1;
+    }
+#endif
+
+    // Rows outside the triangle
+    for (int r = 0; r < 4; r++)
+    {
+        if ((y + r < tri->y0) || (y + r > tri->y1)) end[r] = first[r];
+    }
+}
+
+static void RasterizeOcclusionBlockRow(void* data, int blockRow)
+{
+    R3DOcclusionBuffer* buffer = (R3DOcclusionBuffer*)data;
+    OcclusionData* occlusion = (OcclusionData*)buffer->data;
+    int masksX = buffer->width/OCCLUSION_MASK_WIDTH;
+    int firstRow = blockRow*OCCLUSION_BLOCK_SIZE;
+
+    for (int i = firstRow*masksX; i < (firstRow + OCCLUSION_BLOCK_SIZE)*masksX; i++)
+    {
+        occlusion->masks[i] = 0;
+        occlusion->workDepth[i] = 0.0f;
+        occlusion->depth[i] = 0.0f;
+    }
+
+    const int* bin = occlusion->bins + occlusion->binStarts[blockRow];
+    for (int t = 0; t < occlusion->binCounts[blockRow]; t++)
+    {
+        const OccluderTriangle* tri = &occlusion->setup[bin[t]];
+        int rowFirst = (tri->y0/OCCLUSION_MASK_HEIGHT > firstRow)? tri->y0/OCCLUSION_MASK_HEIGHT : firstRow;
+        int rowLast = (tri->y1/OCCLUSION_MASK_HEIGHT < firstRow + OCCLUSION_BLOCK_SIZE - 1)? tri->y1/OCCLUSION_MASK_HEIGHT : firstRow + OCCLUSION_BLOCK_SIZE - 1;
+
+        for (int my = rowFirst; my <= rowLast; my++)
+        {
+            int y = my*OCCLUSION_MASK_HEIGHT;
+            int first[4], end[4];
+            GetOccluderSpans(tri, y, buffer->width, first, end);
+
+            for (int mx = tri->x0/OCCLUSION_MASK_WIDTH; mx <= tri->x1/OCCLUSION_MASK_WIDTH; mx++)
+            {
+                int x = mx*OCCLUSION_MASK_WIDTH;
+                unsigned int mask = 0;
+                for (int r = 0; r < 4; r++)
+                {
+                    int a = first[r] - x, b = end[r] - x;
+                    a = (a < 0)? 0 : ((a > 8)? 8 : a);
+                    b = (b < 0)? 0 : ((b > 8)? 8 : b);
+                    if (b > a) mask |= ((1u << b) - (1u << a)) << (r*8);
+                }
+                if (mask == 0) continue;
+
+                // Farthest depth of the triangle plane over the mask, no farther than its farthest vertex
+                float px = x + ((tri->depthX < 0.0f)? OCCLUSION_MASK_WIDTH - 0.5f : 0.5f);
+                float py = y + ((tri->depthY < 0.0f)? OCCLUSION_MASK_HEIGHT - 0.5f : 0.5f);
+                float depth = fmaxf(tri->depthX*px + tri->depthY*py + tri->depthC, tri->minDepth);
+
+                int i = my*masksX + mx;
+                if (depth <= occlusion->depth[i]) continue;          // Behind what is already known to cover the mask
+
+                if (mask == 0xFFFFFFFFu)
+                {
+                    // Covers the whole mask on its own, the working layer is dropped when it is now behind
+                    occlusion->depth[i] = depth;
+                    if (occlusion->workDepth[i] <= depth) occlusion->masks[i] = 0;
+                    continue;
+                }
+
+                occlusion->workDepth[i] = (occlusion->masks[i] != 0)? fminf(occlusion->workDepth[i], depth) : depth;
+                occlusion->masks[i] |= mask;
+                if (occlusion->masks[i] == 0xFFFFFFFFu)
+                {
+                    occlusion->depth[i] = occlusion->workDepth[i];
+                    occlusion->masks[i] = 0;
+                }
+            }
+        }
+    }
+
+    // Farthest depth of each block
+    int blocksX = masksX/OCCLUSION_BLOCK_SIZE;
+    for (int bx = 0; bx < blocksX; bx++)
+    {
+        float depth = FLT_MAX;
+        for (int my = firstRow; my < firstRow + OCCLUSION_BLOCK_SIZE; my++)
+        {
+            for (int mx = bx*OCCLUSION_BLOCK_SIZE; mx < (bx + 1)*OCCLUSION_BLOCK_SIZE; mx++) depth = fminf(depth, occlusion->depth[my*masksX + mx]);
+        }
+        occlusion->hiz[blockRow*blocksX + bx] = depth;
+    }
+}
+
+R3DDEF void UpdateOcclusionBuffer(R3DOcclusionBuffer* buffer, GBuffer gbuffer, Camera camera)
+{
+    OcclusionData* data = (OcclusionData*)buffer->data;
+    data->viewProj = GetDeferredModeViewProjection(gbuffer, camera);
+
+    int jobs = (buffer->occluderCount + OCCLUSION_JOB_TRIANGLES - 1)/OCCLUSION_JOB_TRIANGLES;
+    ParallelFor(jobs, SetupOccluders, buffer);
+
+    // Each job wrote at the start of its range, moved down next to each other
+    int count = 0;
+    for (int i = 0; i < jobs; i++)
+    {
+        int first = i*OCCLUSION_JOB_TRIANGLES*2;
+        if ((data->jobCounts[i] > 0) && (first != count)) memmove(data->setup + count, data->setup + first, data->jobCounts[i]*sizeof(OccluderTriangle));
+        count += data->jobCounts[i];
+    }
+    buffer->triangles = count;
+
+    // Triangles binned by the block rows they overlap
+    int blockHeight = OCCLUSION_MASK_HEIGHT*OCCLUSION_BLOCK_SIZE;
+    int blockRows = buffer->height/blockHeight;
+    memset(data->binCounts, 0, blockRows*sizeof(int));
+    int entries = 0;
+    for (int i = 0; i < count; i++)
+    {
+        for (int row = data->setup[i].y0/blockHeight; row <= data->setup[i].y1/blockHeight; row++) data->binCounts[row]++;
+        entries += data->setup[i].y1/blockHeight - data->setup[i].y0/blockHeight + 1;
+    }
+
+    if (entries > data->binCapacity)
+    {
+        R3D_FREE(data->bins);
+        data->binCapacity = entries*2;
+        data->bins = (int*)R3D_MALLOC(data->binCapacity*sizeof(int));
+    }
+
+    for (int row = 0, start = 0; row < blockRows; row++)
+    {
+        data->binStarts[row] = start;
+        start += data->binCounts[row];
+        data->binCounts[row] = 0;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        for (int row = data->setup[i].y0/blockHeight; row <= data->setup[i].y1/blockHeight; row++) data->bins[data->binStarts[row] + data->binCounts[row]++] = i;
+    }
+
+    ParallelFor(blockRows, RasterizeOcclusionBlockRow, buffer);
+}
+
+// A box is hidden when its nearest depth is behind the reference depth of every mask its screen rectangle overlaps
+static bool IsOcclusionBoxHidden(R3DOcclusionBuffer* buffer, Vector3 center, Vector3 extent)
+{
+    OcclusionData* data = (OcclusionData*)buffer->data;
+    Matrix m = data->viewProj;
+
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    float nearest = 0.0f;
+    for (int i = 0; i < 8; i++)
+    {
+        float x = center.x + ((i & 1)? extent.x : -extent.x);
+        float y = center.y + ((i & 2)? extent.y : -extent.y);
+        float z = center.z + ((i & 4)? extent.z : -extent.z);
+        float w = m.m3*x + m.m7*y + m.m11*z + m.m15;
+        if (w < (float)RL_CULL_DISTANCE_NEAR) return false;          // Crosses the near plane
+
+        float invW = 1.0f/w;
+        float sx = ((m.m0*x + m.m4*y + m.m8*z + m.m12)*invW*0.5f + 0.5f)*buffer->width;
+        float sy = (0.5f - (m.m1*x + m.m5*y + m.m9*z + m.m13)*invW*0.5f)*buffer->height;
+        minX = fminf(minX, sx);
+        maxX = fmaxf(maxX, sx);
+        minY = fminf(minY, sy);
+        maxY = fmaxf(maxY, sy);
+        nearest = fmaxf(nearest, invW);
+    }
+
+    // Off screen boxes are left to the frustum culling
+    if ((maxX < 0.0f) || (maxY < 0.0f) || (minX >= buffer->width) || (minY >= buffer->height)) return false;
+
+    int masksX = buffer->width/OCCLUSION_MASK_WIDTH;
+    int x0 = (int)fmaxf(minX, 0.0f)/OCCLUSION_MASK_WIDTH;
+    int y0 = (int)fmaxf(minY, 0.0f)/OCCLUSION_MASK_HEIGHT;
+    int x1 = (int)fminf(maxX, buffer->width - 1.0f)/OCCLUSION_MASK_WIDTH;
+    int y1 = (int)fminf(maxY, buffer->height - 1.0f)/OCCLUSION_MASK_HEIGHT;
+
+    int blocksX = masksX/OCCLUSION_BLOCK_SIZE;
+    for (int by = y0/OCCLUSION_BLOCK_SIZE; by <= y1/OCCLUSION_BLOCK_SIZE; by++)
+    {
+        for (int bx = x0/OCCLUSION_BLOCK_SIZE; bx <= x1/OCCLUSION_BLOCK_SIZE; bx++)
+        {
+            if (nearest < data->hiz[by*blocksX + bx]) continue;      // Behind the whole block
+
+            int myFirst = (by*OCCLUSION_BLOCK_SIZE > y0)? by*OCCLUSION_BLOCK_SIZE : y0;
+            int myLast = ((by + 1)*OCCLUSION_BLOCK_SIZE - 1 < y1)? (by + 1)*OCCLUSION_BLOCK_SIZE - 1 : y1;
+            int mxFirst = (bx*OCCLUSION_BLOCK_SIZE > x0)? bx*OCCLUSION_BLOCK_SIZE : x0;
+            int mxLast = ((bx + 1)*OCCLUSION_BLOCK_SIZE - 1 < x1)? (bx + 1)*OCCLUSION_BLOCK_SIZE - 1 : x1;
+            for (int my = myFirst; my <= myLast; my++)
+            {
+                for (int mx = mxFirst; mx <= mxLast; mx++)
+                {
+                    if (nearest >= data->depth[my*masksX + mx]) return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+R3DDEF bool IsBoxOccluded(R3DOcclusionBuffer* buffer, BoundingBox box)
+{
+    Vector3 center = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+    Vector3 extent = Vector3Scale(Vector3Subtract(box.max, box.min), 0.5f);
+    return IsOcclusionBoxHidden(buffer, center, extent);
+}
+
+static void OccludeInstanceRange(void* data, int index)
+{
+    OcclusionInstanceJob* job = (OcclusionInstanceJob*)data;
+    R3DCullingSet* set = job->set;
+    CullingSetData* setData = (CullingSetData*)set->data;
+    int first = index*CULLING_JOB_SIZE;
+    int last = (first + CULLING_JOB_SIZE < set->visibleCount)? first + CULLING_JOB_SIZE : set->visibleCount;
+
+    // Filtered in place, the kept instances move to the start of the range
+    int count = first;
+    for (int v = first; v < last; v++)
+    {
+        int i = set->visible[v];
+        Vector3 center = { setData->centerX[i], setData->centerY[i], setData->centerZ[i] };
+        Vector3 extent = { setData->extentX[i], setData->extentY[i], setData->extentZ[i] };
+        if (IsOcclusionBoxHidden(job->buffer, center, extent)) continue;
+
+        set->visible[count] = i;
+        set->lods[count] = set->lods[v];
+        count++;
+    }
+
+    setData->jobCounts[index] = count - first;
+}
+
+R3DDEF int OccludeInstances(R3DOcclusionBuffer* buffer, R3DCullingSet* set)
+{
+    CullingSetData* data = (CullingSetData*)set->data;
+
+    OcclusionInstanceJob job = { 0 };
+    job.buffer = buffer;
+    job.set = set;
+    int jobs = (set->visibleCount + CULLING_JOB_SIZE - 1)/CULLING_JOB_SIZE;
+    ParallelFor(jobs, OccludeInstanceRange, &job);
+
+    int visibleCount = 0;
+    for (int i = 0; i < jobs; i++)
+    {
+        int count = data->jobCounts[i];
+        int first = i*CULLING_JOB_SIZE;
+        if ((count > 0) && (first != visibleCount))
+        {
+            memmove(set->visible + visibleCount, set->visible + first, count*sizeof(int));
+            memmove(set->lods + visibleCount, set->lods + first, count*sizeof(unsigned char));
+        }
+        visibleCount += count;
+    }
+
+    buffer->occluded = set->visibleCount - visibleCount;
+    set->visibleCount = visibleCount;
+    return visibleCount;
+}
+
+R3DDEF Image GetOcclusionBufferImage(R3DOcclusionBuffer buffer)
+{
+    OcclusionData* data = (OcclusionData*)buffer.data;
+    Image image = { 0 };
+    image.width = buffer.width;
+    image.height = buffer.height;
+    image.mipmaps = 1;
+    image.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+    image.data = RL_MALLOC(buffer.width*buffer.height);
+
+    // One value per mask, 1/w compressed so distant occluders stay visible
+    unsigned char* pixels = (unsigned char*)image.data;
+    int masksX = buffer.width/OCCLUSION_MASK_WIDTH;
+    for (int y = 0; y < buffer.height; y++)
+    {
+        for (int x = 0; x < buffer.width; x++)
+        {
+            float depth = data->depth[(y/OCCLUSION_MASK_HEIGHT)*masksX + x/OCCLUSION_MASK_WIDTH];
+            pixels[y*buffer.width + x] = (unsigned char)(255.0f*sqrtf(fminf(depth, 1.0f)));
+        }
+    }
+
+    return image;
+}
+#pragma endregion
+
+#pragma region LODS
+#define LOD_ATTRIBUTE_WEIGHT 0.01f    // Cost of a squared normal or texture coordinate change, next to the squared relative distance
+#define LOD_MIN_REDUCTION 0.9f        // A level keeping more of the previous level triangles ends the chain
+#define LOD_FLIP_COS 0.25f            // Smallest cosine between a triangle normal before and after a collapse
+
+// Levels generated by GenMeshLods(), found again from the mesh indices and vertex array
+typedef struct MeshLodEntry {
+    MeshTableKey key;                // Vertex array and indices
+    R3DMeshLods lods;
+} MeshLodEntry;
+
+static MeshTable r3dMeshLods = { 0, 0, sizeof(MeshLodEntry), NULL, NULL };
+
+// Sum of the squared distances to triangle planes, weighted by the triangle areas
+typedef struct LodQuadric {
+    double a00, a11, a22, a10, a20, a21;
+    double b0, b1, b2;
+    double c;
+    double weight;
+} LodQuadric;
+
+typedef struct LodCollapse {
+    int from;                        // Vertex removed, its triangles use the other one instead
+    int to;
+    float cost;
+} LodCollapse;
+
+typedef struct LodSimplifier {
+    const Mesh* mesh;
+    Vector3* points;                 // Positions relative to the bounding sphere, so errors are a fraction of its radius
+    int* cluster;                    // First vertex at the same position, the quadrics and locks are per position
+    bool* locked;                    // Positions on borders and attribute seams, never removed
+    LodQuadric* quadrics;
+    Vector3* triangleNormals;        // Normal of each triangle in the first level, moved along as the triangles are compacted
+    int* remap;
+    bool* touched;                   // Positions around a collapse of the current pass
+    int* firstTriangle;              // Triangles around each vertex, offsets into vertexTriangles
+    int* vertexTriangles;
+    LodCollapse* collapses;
+} LodSimplifier;
+
+static unsigned int HashLodPosition(const float* position)
+{
+    unsigned int hash = 2166136261u;
+    const unsigned char* bytes = (const unsigned char*)position;
+    for (int i = 0; i < (int)(3*sizeof(float)); i++) hash = (hash ^ bytes[i])*16777619u;
+    return hash;
+}
+
+static bool IsLodVertexEqual(const Mesh* mesh, int a, int b, bool attributes)
+{
+    if (memcmp(mesh->vertices + a*3, mesh->vertices + b*3, 3*sizeof(float)) != 0) return false;
+    if (!attributes) return true;
+
+    if ((mesh->texcoords != NULL) && (memcmp(mesh->texcoords + a*2, mesh->texcoords + b*2, 2*sizeof(float)) != 0)) return false;
+    if ((mesh->texcoords2 != NULL) && (memcmp(mesh->texcoords2 + a*2, mesh->texcoords2 + b*2, 2*sizeof(float)) != 0)) return false;
+    if ((mesh->normals != NULL) && (memcmp(mesh->normals + a*3, mesh->normals + b*3, 3*sizeof(float)) != 0)) return false;
+    if ((mesh->tangents != NULL) && (memcmp(mesh->tangents + a*4, mesh->tangents + b*4, 4*sizeof(float)) != 0)) return false;
+    if ((mesh->colors != NULL) && (memcmp(mesh->colors + a*4, mesh->colors + b*4, 4*sizeof(unsigned char)) != 0)) return false;
+    if ((mesh->boneIds != NULL) && (memcmp(mesh->boneIds + a*4, mesh->boneIds + b*4, 4*sizeof(int)) != 0)) return false;
+    if ((mesh->boneWeights != NULL) && (memcmp(mesh->boneWeights + a*4, mesh->boneWeights + b*4, 4*sizeof(float)) != 0)) return false;
+
+    return true;
+}
+
+// First vertex equal to each vertex, by position only or by every attribute
+static int* GroupLodVertices(const Mesh* mesh, bool attributes)
+{
+    int capacity = 64;
+    while (capacity < mesh->vertexCount*2) capacity *= 2;
+    int* table = (int*)R3D_MALLOC(capacity*sizeof(int));
+    memset(table, -1, capacity*sizeof(int));
+
+    int* first = (int*)R3D_MALLOC(mesh->vertexCount*sizeof(int));
+    for (int v = 0; v < mesh->vertexCount; v++)
+    {
+        unsigned int slot = HashLodPosition(mesh->vertices + v*3) & (capacity - 1);
+        first[v] = v;
+        while (table[slot] != -1)
+        {
+            if (IsLodVertexEqual(mesh, table[slot], v, attributes))
+            {
+                first[v] = table[slot];
+                break;
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (first[v] == v) table[slot] = v;
+    }
+
+    R3D_FREE(table);
+    return first;
+}
+
+static void CompactLodAttribute(void** attribute, const int* remap, int count, int unique, int stride)
+{
+    if (*attribute == NULL) return;
+
+    unsigned char* source = (unsigned char*)*attribute;
+    unsigned char* result = (unsigned char*)RL_MALLOC(unique*stride);
+    for (int i = 0; i < count; i++)
+    {
+        if (remap[i] >= 0) memcpy(result + remap[i]*stride, source + i*stride, stride);
+    }
+    RL_FREE(source);
+    *attribute = result;
+}
+
+// Moves every vertex attribute to its remapped position (-1: dropped), the mesh keeps unique vertices
+static void RemapLodVertices(Mesh* mesh, const int* remap, int unique)
+{
+    int vertexCount = mesh->vertexCount;
+    CompactLodAttribute((void**)&mesh->vertices, remap, vertexCount, unique, 3*sizeof(float));
+    CompactLodAttribute((void**)&mesh->texcoords, remap, vertexCount, unique, 2*sizeof(float));
+    CompactLodAttribute((void**)&mesh->texcoords2, remap, vertexCount, unique, 2*sizeof(float));
+    CompactLodAttribute((void**)&mesh->normals, remap, vertexCount, unique, 3*sizeof(float));
+    CompactLodAttribute((void**)&mesh->tangents, remap, vertexCount, unique, 4*sizeof(float));
+    CompactLodAttribute((void**)&mesh->colors, remap, vertexCount, unique, 4*sizeof(unsigned char));
+    CompactLodAttribute((void**)&mesh->animVertices, remap, vertexCount, unique, 3*sizeof(float));
+    CompactLodAttribute((void**)&mesh->animNormals, remap, vertexCount, unique, 3*sizeof(float));
+    CompactLodAttribute((void**)&mesh->boneIds, remap, vertexCount, unique, 4*sizeof(int));
+    CompactLodAttribute((void**)&mesh->boneWeights, remap, vertexCount, unique, 4*sizeof(float));
+    mesh->vertexCount = unique;
+}
+
+// Merges the vertices with the same attributes, so the triangles share their corners.. meshes from GenMesh*() and the
+// Assimp import give each triangle its own vertices. False when the vertices left do not fit 16 bit indices
+static bool WeldLodMesh(Mesh* mesh, bool* welded)
+{
+    int* first = GroupLodVertices(mesh, true);
+    int* remap = (int*)R3D_MALLOC(mesh->vertexCount*sizeof(int));
+    int unique = 0;
+    for (int v = 0; v < mesh->vertexCount; v++) remap[v] = (first[v] == v)? unique++ : -1;
+
+    bool fits = (unique <= 65535);
+    *welded = fits && ((unique < mesh->vertexCount) || (mesh->indices == NULL));
+    if (*welded)
+    {
+        int count = mesh->triangleCount*3;
+        unsigned short* indices = (unsigned short*)RL_MALLOC(count*sizeof(unsigned short));
+        for (int i = 0; i < count; i++) indices[i] = (unsigned short)remap[first[GetMeshVertexIndex(mesh, i/3, i%3)]];
+
+        RemapLodVertices(mesh, remap, unique);
+
+        RL_FREE(mesh->indices);
+        mesh->indices = indices;
+    }
+
+    R3D_FREE(remap);
+    R3D_FREE(first);
+    return fits;
+}
+
+static void AddLodQuadric(LodQuadric* q, const LodQuadric* other)
+{
+    q->a00 += other->a00; q->a11 += other->a11; q->a22 += other->a22;
+    q->a10 += other->a10; q->a20 += other->a20; q->a21 += other->a21;
+    q->b0 += other->b0; q->b1 += other->b1; q->b2 += other->b2;
+    q->c += other->c;
+    q->weight += other->weight;
+}
+
+static LodQuadric GetLodPlaneQuadric(Vector3 a, Vector3 b, Vector3 c)
+{
+    LodQuadric q = { 0 };
+    Vector3 normal = Vector3CrossProduct(Vector3Subtract(b, a), Vector3Subtract(c, a));
+    double length = Vector3Length(normal);
+    if (length <= 0.0) return q;
+
+    double x = normal.x/length, y = normal.y/length, z = normal.z/length;
+    double d = -(x*a.x + y*a.y + z*a.z);
+    double w = length*0.5;
+    q.a00 = w*x*x; q.a11 = w*y*y; q.a22 = w*z*z;
+    q.a10 = w*x*y; q.a20 = w*x*z; q.a21 = w*y*z;
+    q.b0 = w*x*d; q.b1 = w*y*d; q.b2 = w*z*d;
+    q.c = w*d*d;
+    q.weight = w;
+    return q;
+}
+
+static double EvaluateLodQuadric(const LodQuadric* q, Vector3 p)
+{
+    double x = p.x, y = p.y, z = p.z;
+    return q->a00*x*x + q->a11*y*y + q->a22*z*z + 2.0*(q->a10*x*y + q->a20*x*z + q->a21*y*z) + 2.0*(q->b0*x + q->b1*y + q->b2*z) + q->c;
+}
+
+// Mean squared distance of the merged position to the planes of both, plus the attribute change at the removed vertex
+static float GetLodCollapseCost(const LodSimplifier* s, int from, int to)
+{
+    LodQuadric q = s->quadrics[s->cluster[from]];
+    AddLodQuadric(&q, &s->quadrics[s->cluster[to]]);
+    double error = (q.weight > 0.0)? EvaluateLodQuadric(&q, s->points[to])/q.weight : 0.0;
+
+    const Mesh* mesh = s->mesh;
+    float attributes = 0.0f;
+    if (mesh->normals != NULL)
+    {
+        Vector3 d = { mesh->normals[to*3] - mesh->normals[from*3], mesh->normals[to*3 + 1] - mesh->normals[from*3 + 1], mesh->normals[to*3 + 2] - mesh->normals[from*3 + 2] };
+        attributes += Vector3DotProduct(d, d);
+    }
+    if (mesh->texcoords != NULL)
+    {
+        float du = mesh->texcoords[to*2] - mesh->texcoords[from*2];
+        float dv = mesh->texcoords[to*2 + 1] - mesh->texcoords[from*2 + 1];
+        attributes += du*du + dv*dv;
+    }
+
+    return (float)fmax(error, 0.0) + LOD_ATTRIBUTE_WEIGHT*attributes;
+}
+
+static int CompareLodCollapses(const void* left, const void* right)
+{
+    float l = ((const LodCollapse*)left)->cost;
+    float r = ((const LodCollapse*)right)->cost;
+    return (l < r)? -1 : (l > r)? 1 : 0;
+}
+
+static int CompareLodEdges(const void* left, const void* right)
+{
+    unsigned long long l = *(const unsigned long long*)left;
+    unsigned long long r = *(const unsigned long long*)right;
+    return (l < r)? -1 : (l > r)? 1 : 0;
+}
+
+// Triangles around the moved vertex that would fold over or become slivers, turning a lot from their current normal or
+// facing away from their first one (small turns would add up over the levels)
+static bool IsLodCollapseFlipping(const LodSimplifier* s, const int* triangles, int from, int to)
+{
+    for (int i = s->firstTriangle[from]; i < s->firstTriangle[from + 1]; i++)
+    {
+        int triangle = s->vertexTriangles[i];
+        const int* corners = &triangles[triangle*3];
+        if ((corners[0] == to) || (corners[1] == to) || (corners[2] == to)) continue;     // Removed by the collapse
+
+        Vector3 p[3] = { s->points[corners[0]], s->points[corners[1]], s->points[corners[2]] };
+        Vector3 before = Vector3CrossProduct(Vector3Subtract(p[1], p[0]), Vector3Subtract(p[2], p[0]));
+        if (Vector3DotProduct(before, before) == 0.0f) continue;   // Degenerate already, nothing to flip
+        for (int k = 0; k < 3; k++)
+        {
+            if (corners[k] == from) p[k] = s->points[to];
+        }
+        Vector3 after = Vector3CrossProduct(Vector3Subtract(p[1], p[0]), Vector3Subtract(p[2], p[0]));
+
+        if (Vector3DotProduct(before, after) <= LOD_FLIP_COS*Vector3Length(before)*Vector3Length(after)) return true;
+        if (Vector3DotProduct(s->triangleNormals[triangle], after) <= 0.0f) return true;
+    }
+
+    return false;
+}
+
+// Collapses the cheapest edges of the triangles (vertex ids, simplified in place) in passes, until the target count or the
+// error limit is reached. Returns the triangles left
+static int SimplifyLodTriangles(LodSimplifier* s, int* triangles, int triangleCount, int target, float limitSqr, float* maxCost)
+{
+    int vertexCount = s->mesh->vertexCount;
+    int count = triangleCount;
+
+    while (count > target)
+    {
+        // Triangles around each vertex, counted and then filled backwards so the offsets end at the first triangle
+        memset(s->firstTriangle, 0, (vertexCount + 1)*sizeof(int));
+        for (int i = 0; i < count*3; i++) s->firstTriangle[triangles[i]]++;
+        for (int v = 1; v < vertexCount; v++) s->firstTriangle[v] += s->firstTriangle[v - 1];
+        s->firstTriangle[vertexCount] = count*3;
+        for (int i = 0; i < count*3; i++) s->vertexTriangles[--s->firstTriangle[triangles[i]]] = i/3;
+
+        // Both directions of each edge once, manifold edges show up as a < b in one of their two triangles (so at most
+        // two edges and four collapses per triangle)
+        int candidates = 0;
+        for (int i = 0; i < count*3; i++)
+        {
+            int a = triangles[i];
+            int b = triangles[(i%3 == 2)? i - 2 : i + 1];
+            if (a > b) continue;
+
+            for (int k = 0; k < 2; k++)
+            {
+                int from = (k == 0)? a : b;
+                int to = (k == 0)? b : a;
+                if (s->locked[s->cluster[from]]) continue;
+
+                LodCollapse* collapse = &s->collapses[candidates++];
+                collapse->from = from;
+                collapse->to = to;
+                collapse->cost = GetLodCollapseCost(s, from, to);
+            }
+        }
+        qsort(s->collapses, candidates, sizeof(LodCollapse), CompareLodCollapses);
+
+        // Cheapest first, a collapse keeps the triangles around it out of the rest of the pass, the flip test of the
+        // following ones would not see its moved vertex
+        for (int v = 0; v < vertexCount; v++) s->remap[v] = v;
+        memset(s->touched, 0, vertexCount*sizeof(bool));
+        int removed = 0;
+        int collapsed = 0;
+        for (int c = 0; (c < candidates) && (count - removed > target); c++)
+        {
+            LodCollapse collapse = s->collapses[c];
+            if (collapse.cost > limitSqr) break;
+            if (s->touched[s->cluster[collapse.from]] || s->touched[s->cluster[collapse.to]]) continue;
+            if (IsLodCollapseFlipping(s, triangles, collapse.from, collapse.to)) continue;
+
+            s->remap[collapse.from] = collapse.to;
+            AddLodQuadric(&s->quadrics[s->cluster[collapse.to]], &s->quadrics[s->cluster[collapse.from]]);
+            *maxCost = fmaxf(*maxCost, collapse.cost);
+            collapsed++;
+
+            for (int i = s->firstTriangle[collapse.from]; i < s->firstTriangle[collapse.from + 1]; i++)
+            {
+                const int* corners = &triangles[s->vertexTriangles[i]*3];
+                if ((corners[0] == collapse.to) || (corners[1] == collapse.to) || (corners[2] == collapse.to)) removed++;
+                for (int k = 0; k < 3; k++) s->touched[s->cluster[corners[k]]] = true;
+            }
+        }
+        if (collapsed == 0) break;
+
+        int kept = 0;
+        for (int t = 0; t < count; t++)
+        {
+            int a = s->remap[triangles[t*3]];
+            int b = s->remap[triangles[t*3 + 1]];
+            int c = s->remap[triangles[t*3 + 2]];
+            if ((a == b) || (b == c) || (c == a)) continue;
+
+            triangles[kept*3] = a;
+            triangles[kept*3 + 1] = b;
+            triangles[kept*3 + 2] = c;
+            s->triangleNormals[kept] = s->triangleNormals[t];
+            kept++;
+        }
+        count = kept;
+    }
+
+    return count;
+}
+
+static MeshLodEntry* FindMeshLods(Mesh mesh)
+{
+    if (mesh.indices == NULL) return NULL;
+
+    return (MeshLodEntry*)FindMeshTableEntry(&r3dMeshLods, mesh.vaoId, mesh.indices);
+}
+
+static void StoreMeshLods(Mesh mesh, R3DMeshLods lods)
+{
+    MeshLodEntry* entry = FindMeshLods(mesh);
+    if (entry == NULL) entry = (MeshLodEntry*)AddMeshTableEntry(&r3dMeshLods, mesh.vaoId, mesh.indices);
+    entry->lods = lods;
+}
+
+R3DDEF R3DMeshLods GenMeshLods(Mesh* mesh, int count, float reduction, float maxError)
+{
+    if (count > MESH_MAX_LODS) count = MESH_MAX_LODS;
+    if (reduction <= 0.0f) reduction = 0.5f;
+    if (maxError <= 0.0f) maxError = 0.05f;
+
+    UnloadMeshLods(*mesh);      // Generated again from the first level
+    ForgetMeshMeshlets(*mesh);  // Their index ranges do not survive the new index buffer
+
+    if ((mesh->vertices == NULL) || (mesh->triangleCount <= 0))
+    {
+        TraceLog(LOG_WARNING, "LODS: Mesh without triangles, no levels generated");
+        return GetMeshLods(*mesh);
+    }
+
+    Mesh original = *mesh;           // Vertex array and vertices the stored bounds are found by
+    bool welded = false;
+    if (!WeldLodMesh(mesh, &welded))
+    {
+        TraceLog(LOG_WARNING, "LODS: Mesh with more than 65535 distinct vertices, no levels generated");
+        count = 1;
+    }
+
+    R3DMeshLods lods = { 0 };
+    lods.count = 1;
+    lods.indexCount[0] = mesh->triangleCount*3;
+
+    if (count > 1)
+    {
+        int vertexCount = mesh->vertexCount;
+        LodSimplifier s = { 0 };
+        s.mesh = mesh;
+        s.points = (Vector3*)R3D_MALLOC(vertexCount*sizeof(Vector3));
+        s.cluster = GroupLodVertices(mesh, false);
+        s.locked = (bool*)R3D_CALLOC(vertexCount, sizeof(bool));
+        s.quadrics = (LodQuadric*)R3D_CALLOC(vertexCount, sizeof(LodQuadric));
+        s.triangleNormals = (Vector3*)R3D_MALLOC(mesh->triangleCount*sizeof(Vector3));
+        s.remap = (int*)R3D_MALLOC(vertexCount*sizeof(int));
+        s.touched = (bool*)R3D_MALLOC(vertexCount*sizeof(bool));
+        s.firstTriangle = (int*)R3D_MALLOC((vertexCount + 1)*sizeof(int));
+        s.vertexTriangles = (int*)R3D_MALLOC(mesh->triangleCount*3*sizeof(int));
+        s.collapses = (LodCollapse*)R3D_MALLOC(mesh->triangleCount*4*sizeof(LodCollapse));
+
+        R3DBounds bounds = ComputeMeshBounds(*mesh);
+        float scale = (bounds.radius > 0.0f)? 1.0f/bounds.radius : 1.0f;
+        for (int v = 0; v < vertexCount; v++)
+        {
+            Vector3 position = { mesh->vertices[v*3], mesh->vertices[v*3 + 1], mesh->vertices[v*3 + 2] };
+            s.points[v] = Vector3Scale(Vector3Subtract(position, bounds.center), scale);
+        }
+
+        // Positions with several vertices are attribute seams, removing one would tear the surface
+        for (int v = 0; v < vertexCount; v++)
+        {
+            if (s.cluster[v] != v) s.locked[s.cluster[v]] = true;
+        }
+
+        int* triangles = (int*)R3D_MALLOC(mesh->triangleCount*3*sizeof(int));
+        unsigned long long* edges = (unsigned long long*)R3D_MALLOC(mesh->triangleCount*3*sizeof(unsigned long long));
+        for (int i = 0; i < mesh->triangleCount*3; i++)
+        {
+            triangles[i] = mesh->indices[i];
+            unsigned long long a = (unsigned long long)s.cluster[mesh->indices[i]];
+            unsigned long long b = (unsigned long long)s.cluster[mesh->indices[(i%3 == 2)? i - 2 : i + 1]];
+            edges[i] = (a < b)? (a << 32) | b : (b << 32) | a;
+        }
+
+        // Border and non manifold edges, the ones not shared by exactly two triangles, keep their positions
+        qsort(edges, mesh->triangleCount*3, sizeof(unsigned long long), CompareLodEdges);
+        for (int i = 0; i < mesh->triangleCount*3;)
+        {
+            int j = i + 1;
+            while ((j < mesh->triangleCount*3) && (edges[j] == edges[i])) j++;
+            if (j - i != 2)
+            {
+                s.locked[(int)(edges[i] >> 32)] = true;
+                s.locked[(int)(edges[i] & 0xffffffffu)] = true;
+            }
+            i = j;
+        }
+        R3D_FREE(edges);
+
+        for (int t = 0; t < mesh->triangleCount; t++)
+        {
+            Vector3 a = s.points[triangles[t*3]];
+            Vector3 b = s.points[triangles[t*3 + 1]];
+            Vector3 c = s.points[triangles[t*3 + 2]];
+            s.triangleNormals[t] = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(b, a), Vector3Subtract(c, a)));
+
+            LodQuadric q = GetLodPlaneQuadric(a, b, c);
+            for (int k = 0; k < 3; k++) AddLodQuadric(&s.quadrics[s.cluster[triangles[t*3 + k]]], &q);
+        }
+
+        // Each level simplifies the previous one, the quadrics keep the planes of the original surface
+        unsigned short* levels = (unsigned short*)R3D_MALLOC(mesh->triangleCount*3*count*sizeof(unsigned short));
+        memcpy(levels, mesh->indices, mesh->triangleCount*3*sizeof(unsigned short));
+        float maxCost = 0.0f;
+        int current = mesh->triangleCount;
+        for (int level = 1; level < count; level++)
+        {
+            float limit = maxError*level;
+            int left = SimplifyLodTriangles(&s, triangles, current, (int)(current*reduction), limit*limit, &maxCost);
+            if ((left == 0) || (left > current*LOD_MIN_REDUCTION)) break;
+
+            int offset = lods.indexOffset[level - 1] + lods.indexCount[level - 1];
+            for (int i = 0; i < left*3; i++) levels[offset + i] = (unsigned short)triangles[i];
+            lods.indexOffset[level] = offset;
+            lods.indexCount[level] = left*3;
+            lods.error[level] = sqrtf(maxCost);
+            lods.count++;
+            current = left;
+        }
+
+        if (lods.count > 1)
+        {
+            int total = lods.indexOffset[lods.count - 1] + lods.indexCount[lods.count - 1];
+            RL_FREE(mesh->indices);
+            mesh->indices = (unsigned short*)RL_MALLOC(total*sizeof(unsigned short));
+            memcpy(mesh->indices, levels, total*sizeof(unsigned short));
+        }
+
+        TraceLog(LOG_INFO, "LODS: Mesh simplified to %i levels, %i triangles down to %i", lods.count, mesh->triangleCount, lods.indexCount[lods.count - 1]/3);
+
+        R3D_FREE(levels);
+        R3D_FREE(triangles);
+        R3D_FREE(s.collapses);
+        R3D_FREE(s.vertexTriangles);
+        R3D_FREE(s.firstTriangle);
+        R3D_FREE(s.touched);
+        R3D_FREE(s.remap);
+        R3D_FREE(s.triangleNormals);
+        R3D_FREE(s.quadrics);
+        R3D_FREE(s.locked);
+        R3D_FREE(s.cluster);
+        R3D_FREE(s.points);
+    }
+
+    // The levels follow the first one in the index buffer, uploaded whole as UploadMesh() only sends the first level
+    if (mesh->vaoId == 0) UploadMesh(mesh, false);
+    else if (welded) ReloadMesh(mesh);
+    if ((mesh->vaoId != 0) && (mesh->vboId != NULL) && (mesh->vboId[6] != 0) && (lods.count > 1))
+    {
+        int total = lods.indexOffset[lods.count - 1] + lods.indexCount[lods.count - 1];
+        glBindVertexArray(mesh->vaoId);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->vboId[6]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, total*sizeof(unsigned short), mesh->indices, GL_STATIC_DRAW);
+        glBindVertexArray(0);
+    }
+
+    MoveMeshBounds(original, *mesh);
+    if (lods.count > 1) StoreMeshLods(*mesh, lods);
+    return lods;
+}
+
+R3DDEF R3DMeshLods GetMeshLods(Mesh mesh)
+{
+    MeshLodEntry* entry = FindMeshLods(mesh);
+    if (entry != NULL) return entry->lods;
+
+    R3DMeshLods lods = { 0 };
+    lods.count = 1;
+    lods.indexCount[0] = (mesh.indices != NULL)? mesh.triangleCount*3 : mesh.vertexCount;
+    return lods;
+}
+
+R3DDEF void UnloadMeshLods(Mesh mesh)
+{
+    MeshLodEntry* entry = FindMeshLods(mesh);
+    if (entry != NULL) RemoveMeshTableEntry(&r3dMeshLods, entry);
+}
+
+R3DDEF void DrawMeshLod(Mesh mesh, Material material, Matrix transform, int lod)
+{
+    R3DMeshLods lods = GetMeshLods(mesh);
+    int level = (lod < lods.count)? lod : lods.count - 1;
+    if ((level <= 0) || (mesh.indices == NULL))
+    {
+        DrawMesh(mesh, material, transform);
+        return;
+    }
+
+    rlDrawRenderBatchActive();
+    BindMeshMaterial(material);
+
+    SetMeshDrawMatrices(material.shader, transform);
+
+    glBindVertexArray(mesh.vaoId);
+    glDrawElements(GL_TRIANGLES, lods.indexCount[level], GL_UNSIGNED_SHORT, (void*)(lods.indexOffset[level]*sizeof(unsigned short)));
+    glBindVertexArray(0);
+
+    UnbindMeshMaterial(material);
+    glUseProgram(0);
+}
+#pragma endregion
+
+#pragma region MESHLETS
+#define MESHLET_JOB_SIZE 1024         // Meshlets tested per job, a multiple of 8
+#define MESHLET_CONE_WEIGHT 1.0f      // Preference for triangles facing like the meshlet, next to the vertices they add
+#define MESHLET_LIVE_WEIGHT 0.05f     // Preference for triangles with few others left around them, so none are left isolated
+
+typedef struct MeshletData {
+    float* centerX;                  // Bounding spheres, in mesh space
+    float* centerY;
+    float* centerZ;
+    float* radius;
+    float* axisX;                    // Normal cones, their triangles face at most a half angle away from the axis
+    float* axisY;
+    float* axisZ;
+    float* cutoff;                   // Sine of the half angle, above 1 for cones wider than a half sphere (never back facing)
+    int* firstIndex;                 // Triangles of each meshlet in the mesh indices
+    int* indexCount;
+    unsigned char* visible;          // Result of the last CullMeshlets()
+    int* drawCounts;                 // Index ranges of the visible meshlets, merged when next to each other
+    const void** drawOffsets;
+} MeshletData;
+
+typedef struct MeshletJob {
+    const R3DMeshlets* meshlets;
+    Vector4 planes[6];               // Frustum planes in mesh space, normals pointing inside
+    Vector3 viewPosition;            // In mesh space
+    Vector3 viewDirection;           // In mesh space, orthographic cameras only
+    bool orthographic;
+} MeshletJob;
+
+// Bounding sphere and normal cone of a meshlet, from its triangles
+static void ComputeMeshletBounds(const Mesh* mesh, const Vector3* triangleNormals, const unsigned short* indices, int firstTriangle, int triangleCount, MeshletData* data, int meshlet)
+{
+    Vector3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+    Vector3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    Vector3 axis = { 0 };
+    for (int t = firstTriangle; t < firstTriangle + triangleCount; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            const float* v = mesh->vertices + indices[t*3 + k]*3;
+            Vector3 position = { v[0], v[1], v[2] };
+            min = Vector3Min(min, position);
+            max = Vector3Max(max, position);
+        }
+        axis = Vector3Add(axis, triangleNormals[t]);
+    }
+
+    Vector3 center = Vector3Scale(Vector3Add(min, max), 0.5f);
+    float radiusSqr = 0.0f;
+    for (int i = firstTriangle*3; i < (firstTriangle + triangleCount)*3; i++)
+    {
+        const float* v = mesh->vertices + indices[i]*3;
+        Vector3 d = { v[0] - center.x, v[1] - center.y, v[2] - center.z };
+        radiusSqr = fmaxf(radiusSqr, Vector3DotProduct(d, d));
+    }
+
+    // Degenerate triangles have no normal and do not narrow the cone
+    float minDot = 1.0f;
+    float length = Vector3Length(axis);
+    if (length > 0.0f)
+    {
+        axis = Vector3Scale(axis, 1.0f/length);
+        for (int t = firstTriangle; t < firstTriangle + triangleCount; t++)
+        {
+            if (Vector3DotProduct(triangleNormals[t], triangleNormals[t]) > 0.0f) minDot = fminf(minDot, Vector3DotProduct(triangleNormals[t], axis));
+        }
+    }
+    else minDot = -1.0f;
+
+    data->centerX[meshlet] = center.x;
+    data->centerY[meshlet] = center.y;
+    data->centerZ[meshlet] = center.z;
+    data->radius[meshlet] = sqrtf(radiusSqr);
+    data->axisX[meshlet] = axis.x;
+    data->axisY[meshlet] = axis.y;
+    data->axisZ[meshlet] = axis.z;
+    data->cutoff[meshlet] = (minDot > 0.0f)? sqrtf(1.0f - minDot*minDot) : 2.0f;
+    data->firstIndex[meshlet] = firstTriangle*3;
+    data->indexCount[meshlet] = triangleCount*3;
+}
+
+R3DDEF R3DMeshlets LoadMeshlets(Mesh* mesh)
+{
+    R3DMeshlets meshlets = { 0 };
+    if ((mesh->vertices == NULL) || (mesh->triangleCount <= 0))
+    {
+        TraceLog(LOG_WARNING, "MESHLETS: Mesh without triangles, no meshlets built");
+        return meshlets;
+    }
+
+    // Meshes with detail levels are welded already, and welding again would drop the levels
+    Mesh original = *mesh;           // Vertex array and vertices the stored bounds are found by
+    bool welded = false;
+    if ((FindMeshLods(*mesh) == NULL) && !WeldLodMesh(mesh, &welded))
+    {
+        TraceLog(LOG_WARNING, "MESHLETS: Mesh with more than 65535 distinct vertices, no meshlets built");
+        if (mesh->vaoId == 0) UploadMesh(mesh, false);
+        MoveMeshBounds(original, *mesh);
+        return meshlets;
+    }
+
+    int triangleCount = mesh->triangleCount;
+    int vertexCount = mesh->vertexCount;
+
+    // Triangles around each position, so meshlets grow across attribute seams
+    int* cluster = GroupLodVertices(mesh, false);
+    int* firstTriangle = (int*)R3D_CALLOC(vertexCount + 1, sizeof(int));
+    int* vertexTriangles = (int*)R3D_MALLOC(triangleCount*3*sizeof(int));
+    for (int i = 0; i < triangleCount*3; i++) firstTriangle[cluster[mesh->indices[i]]]++;
+    for (int v = 1; v < vertexCount; v++) firstTriangle[v] += firstTriangle[v - 1];
+    firstTriangle[vertexCount] = triangleCount*3;
+    for (int i = 0; i < triangleCount*3; i++) vertexTriangles[--firstTriangle[cluster[mesh->indices[i]]]] = i/3;
+
+    Vector3* triangleNormals = (Vector3*)R3D_MALLOC(triangleCount*sizeof(Vector3));
+    for (int t = 0; t < triangleCount; t++)
+    {
+        const float* a = mesh->vertices + mesh->indices[t*3]*3;
+        const float* b = mesh->vertices + mesh->indices[t*3 + 1]*3;
+        const float* c = mesh->vertices + mesh->indices[t*3 + 2]*3;
+        Vector3 ab = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        Vector3 ac = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        triangleNormals[t] = Vector3Normalize(Vector3CrossProduct(ab, ac));
+    }
+
+    // Greedy growth: each meshlet takes the neighbour adding the fewest vertices, facing the closest to the meshlet, until
+    // it is full or has no neighbour left
+    int* order = (int*)R3D_MALLOC(triangleCount*sizeof(int));
+    int* meshletTriangles = (int*)R3D_MALLOC((triangleCount + 1)*sizeof(int));
+    int* candidates = (int*)R3D_MALLOC(triangleCount*sizeof(int));
+    int* candidateStamp = (int*)R3D_MALLOC(triangleCount*sizeof(int));
+    int* vertexStamp = (int*)R3D_MALLOC(vertexCount*sizeof(int));
+    bool* assigned = (bool*)R3D_CALLOC(triangleCount, sizeof(bool));
+    int* live = (int*)R3D_MALLOC(vertexCount*sizeof(int));
+    memset(candidateStamp, -1, triangleCount*sizeof(int));
+    memset(vertexStamp, -1, vertexCount*sizeof(int));
+    for (int v = 0; v < vertexCount; v++) live[v] = firstTriangle[v + 1] - firstTriangle[v];
+
+    int ordered = 0;
+    int next = 0;
+    int count = 0;
+    int candidateCount = 0;
+    while (ordered < triangleCount)
+    {
+        // The next meshlet starts on the border of the previous one, where the fewest triangles are left around
+        int triangle = -1;
+        int bestLive = 0x7fffffff;
+        for (int c = 0; c < candidateCount; c++)
+        {
+            int candidate = candidates[c];
+            if (assigned[candidate]) continue;
+
+            int candidateLive = live[cluster[mesh->indices[candidate*3]]] + live[cluster[mesh->indices[candidate*3 + 1]]] + live[cluster[mesh->indices[candidate*3 + 2]]];
+            if (candidateLive < bestLive)
+            {
+                bestLive = candidateLive;
+                triangle = candidate;
+            }
+        }
+        if (triangle == -1)
+        {
+            while (assigned[next]) next++;
+            triangle = next;
+        }
+
+        int meshlet = count++;
+        int vertices = 0;
+        int triangles = 0;
+        Vector3 normal = { 0 };
+        meshletTriangles[meshlet] = ordered;
+        candidateCount = 0;
+
+        while (triangle != -1)
+        {
+            assigned[triangle] = true;
+            order[ordered++] = triangle;
+            triangles++;
+            normal = Vector3Add(normal, triangleNormals[triangle]);
+
+            for (int k = 0; k < 3; k++)
+            {
+                int v = mesh->indices[triangle*3 + k];
+                if (vertexStamp[v] != meshlet)
+                {
+                    vertexStamp[v] = meshlet;
+                    vertices++;
+                }
+
+                int position = cluster[v];
+                live[position]--;
+                for (int i = firstTriangle[position]; i < firstTriangle[position + 1]; i++)
+                {
+                    int neighbour = vertexTriangles[i];
+                    if (assigned[neighbour] || (candidateStamp[neighbour] == meshlet)) continue;
+                    candidateStamp[neighbour] = meshlet;
+                    candidates[candidateCount++] = neighbour;
+                }
+            }
+
+            triangle = -1;
+            if (triangles == MESHLET_MAX_TRIANGLES) break;
+
+            // Candidates taken since are dropped while looking for the best one
+            Vector3 axis = Vector3Normalize(normal);
+            float bestScore = FLT_MAX;
+            int kept = 0;
+            for (int c = 0; c < candidateCount; c++)
+            {
+                int candidate = candidates[c];
+                if (assigned[candidate]) continue;
+                candidates[kept++] = candidate;
+
+                int added = 0;
+                for (int k = 0; k < 3; k++) added += (vertexStamp[mesh->indices[candidate*3 + k]] != meshlet)? 1 : 0;
+                if (vertices + added > MESHLET_MAX_VERTICES) continue;
+
+                int candidateLive = live[cluster[mesh->indices[candidate*3]]] + live[cluster[mesh->indices[candidate*3 + 1]]] + live[cluster[mesh->indices[candidate*3 + 2]]];
+                float score = added + MESHLET_CONE_WEIGHT*(1.0f - Vector3DotProduct(triangleNormals[candidate], axis)) + MESHLET_LIVE_WEIGHT*candidateLive;
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    triangle = candidate;
+                }
+            }
+            candidateCount = kept;
+        }
+    }
+    meshletTriangles[count] = triangleCount;
+
+    // Triangles reordered meshlet by meshlet, the levels after the first one are left where they are
+    unsigned short* indices = (unsigned short*)R3D_MALLOC(triangleCount*3*sizeof(unsigned short));
+    Vector3* orderedNormals = (Vector3*)R3D_MALLOC(triangleCount*sizeof(Vector3));
+    for (int t = 0; t < triangleCount; t++)
+    {
+        memcpy(indices + t*3, mesh->indices + order[t]*3, 3*sizeof(unsigned short));
+        orderedNormals[t] = triangleNormals[order[t]];
+    }
+    memcpy(mesh->indices, indices, triangleCount*3*sizeof(unsigned short));
+
+    MeshletData* data = (MeshletData*)R3D_CALLOC(1, sizeof(MeshletData));
+    data->centerX = (float*)R3D_MALLOC(count*sizeof(float));
+    data->centerY = (float*)R3D_MALLOC(count*sizeof(float));
+    data->centerZ = (float*)R3D_MALLOC(count*sizeof(float));
+    data->radius = (float*)R3D_MALLOC(count*sizeof(float));
+    data->axisX = (float*)R3D_MALLOC(count*sizeof(float));
+    data->axisY = (float*)R3D_MALLOC(count*sizeof(float));
+    data->axisZ = (float*)R3D_MALLOC(count*sizeof(float));
+    data->cutoff = (float*)R3D_MALLOC(count*sizeof(float));
+    data->firstIndex = (int*)R3D_MALLOC(count*sizeof(int));
+    data->indexCount = (int*)R3D_MALLOC(count*sizeof(int));
+    data->visible = (unsigned char*)R3D_MALLOC(count*sizeof(unsigned char));
+    data->drawCounts = (int*)R3D_MALLOC(count*sizeof(int));
+    data->drawOffsets = (const void**)R3D_MALLOC(count*sizeof(void*));
+    for (int m = 0; m < count; m++) ComputeMeshletBounds(mesh, orderedNormals, indices, meshletTriangles[m], meshletTriangles[m + 1] - meshletTriangles[m], data, m);
+
+    // Everything visible until the first CullMeshlets()
+    memset(data->visible, 1, count*sizeof(unsigned char));
+    data->drawCounts[0] = triangleCount*3;
+    data->drawOffsets[0] = NULL;
+
+    meshlets.count = count;
+    meshlets.visibleCount = count;
+    meshlets.visibleTriangles = triangleCount;
+    meshlets.drawCount = 1;
+    meshlets.data = data;
+
+    R3D_FREE(orderedNormals);
+    R3D_FREE(indices);
+    R3D_FREE(live);
+    R3D_FREE(assigned);
+    R3D_FREE(vertexStamp);
+    R3D_FREE(candidateStamp);
+    R3D_FREE(candidates);
+    R3D_FREE(meshletTriangles);
+    R3D_FREE(order);
+    R3D_FREE(triangleNormals);
+    R3D_FREE(vertexTriangles);
+    R3D_FREE(firstTriangle);
+    R3D_FREE(cluster);
+
+    if (mesh->vaoId == 0) UploadMesh(mesh, false);
+    else if (welded) ReloadMesh(mesh);
+    else if ((mesh->vboId != NULL) && (mesh->vboId[6] != 0))
+    {
+        glBindVertexArray(mesh->vaoId);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->vboId[6]);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, triangleCount*3*sizeof(unsigned short), mesh->indices);
+        glBindVertexArray(0);
+    }
+    MoveMeshBounds(original, *mesh);
+
+    TraceLog(LOG_INFO, "MESHLETS: Mesh split into %i meshlets (%.1f triangles each)", count, (float)triangleCount/count);
+    return meshlets;
+}
+
+R3DDEF void UnloadMeshlets(R3DMeshlets meshlets)
+{
+    MeshletData* data = (MeshletData*)meshlets.data;
+    if (data == NULL) return;
+
+    R3D_FREE(data->centerX);
+    R3D_FREE(data->centerY);
+    R3D_FREE(data->centerZ);
+    R3D_FREE(data->radius);
+    R3D_FREE(data->axisX);
+    R3D_FREE(data->axisY);
+    R3D_FREE(data->axisZ);
+    R3D_FREE(data->cutoff);
+    R3D_FREE(data->firstIndex);
+    R3D_FREE(data->indexCount);
+    R3D_FREE(data->visible);
+    R3D_FREE(data->drawCounts);
+    R3D_FREE(data->drawOffsets);
+    R3D_FREE(data);
+}
+
+R3DDEF R3DMeshlets* GetMeshMeshlets(Mesh mesh)
+{
+    if (mesh.indices == NULL) return NULL;
+
+    MeshletEntry* entry = (MeshletEntry*)FindMeshTableEntry(&r3dMeshlets, mesh.vaoId, mesh.indices);
+    return (entry != NULL)? entry->meshlets : NULL;
+}
+
+R3DDEF void UnloadMeshData(Mesh mesh)
+{
+    ForgetMeshBounds(mesh);
+    UnloadMeshLods(mesh);
+    ForgetMeshMeshlets(mesh);
+}
+
+R3DDEF void UnloadModelAdvanced(Model model)
+{
+    for (int i = 0; i < model.meshCount; i++) UnloadMeshData(model.meshes[i]);
+    UnloadModel(model);
+}
+
+// Inside every frustum plane (sphere center distance over minus its radius) and with part of its normal cone facing the
+// view. The cone faces away when the view direction is inside the cone axis, by more than its half angle and the sphere
+static bool IsMeshletVisible(const MeshletJob* job, const MeshletData* data, int i)
+{
+    Vector3 center = { data->centerX[i], data->centerY[i], data->centerZ[i] };
+    float radius = data->radius[i];
+    for (int p = 0; p < 6; p++)
+    {
+        if (job->planes[p].x*center.x + job->planes[p].y*center.y + job->planes[p].z*center.z + job->planes[p].w < -radius) return false;
+    }
+
+    Vector3 axis = { data->axisX[i], data->axisY[i], data->axisZ[i] };
+    if (job->orthographic) return Vector3DotProduct(job->viewDirection, axis) < data->cutoff[i];
+
+    Vector3 d = Vector3Subtract(center, job->viewPosition);
+    return Vector3DotProduct(d, axis) < data->cutoff[i]*Vector3Length(d) + radius;
+}
+
+static void CullMeshletRange(void* data, int index)
+{
+    MeshletJob* job = (MeshletJob*)data;
+    MeshletData* meshletData = (MeshletData*)job->meshlets->data;
+    int first = index*MESHLET_JOB_SIZE;
+    int last = (first + MESHLET_JOB_SIZE < job->meshlets->count)? first + MESHLET_JOB_SIZE : job->meshlets->count;
+    int i = first;
+
+#if defined(R3D_SIMD_AVX)
+    // 8 meshlets per iteration, the cones are only tested when one of them is in the frustum
+    for (; i + 8 <= last; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(meshletData->centerX + i);
+        __m256 y = _mm256_loadu_ps(meshletData->centerY + i);
+        __m256 z = _mm256_loadu_ps(meshletData->centerZ + i);
+        __m256 radius = _mm256_loadu_ps(meshletData->radius + i);
+        __m256 reach = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+
+        __m256 inside = _mm256_cmp_ps(radius, radius, _CMP_EQ_OQ);
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(job->planes[p].x), x), _mm256_mul_ps(_mm256_set1_ps(job->planes[p].y), y)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(job->planes[p].z), z), _mm256_set1_ps(job->planes[p].w)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, reach, _CMP_GE_OQ));
+            if (_mm256_movemask_ps(inside) == 0) break;
+        }
 
-#if defined(__cplusplus)
-#define R3DDEF extern "C"
-#else
-#define R3DDEF extern
-#endif
+        if (_mm256_movemask_ps(inside) != 0)
+        {
+            __m256 ax = _mm256_loadu_ps(meshletData->axisX + i);
+            __m256 ay = _mm256_loadu_ps(meshletData->axisY + i);
+            __m256 az = _mm256_loadu_ps(meshletData->axisZ + i);
+            __m256 cutoff = _mm256_loadu_ps(meshletData->cutoff + i);
+            __m256 facing, limit;
+            if (job->orthographic)
+            {
+                facing = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(job->viewDirection.x), ax), _mm256_mul_ps(_mm256_set1_ps(job->viewDirection.y), ay)), _mm256_mul_ps(_mm256_set1_ps(job->viewDirection.z), az));
+                limit = cutoff;
+            }
+            else
+            {
+                __m256 dx = _mm256_sub_ps(x, _mm256_set1_ps(job->viewPosition.x));
+                __m256 dy = _mm256_sub_ps(y, _mm256_set1_ps(job->viewPosition.y));
+                __m256 dz = _mm256_sub_ps(z, _mm256_set1_ps(job->viewPosition.z));
+                __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+                facing = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, ax), _mm256_mul_ps(dy, ay)), _mm256_mul_ps(dz, az));
+                limit = _mm256_add_ps(_mm256_mul_ps(cutoff, length), radius);
+            }
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(facing, limit, _CMP_LT_OQ));
+        }
 
-#include <raylib.h>
+        int mask = _mm256_movemask_ps(inside);
+        for (int bit = 0; bit < 8; bit++) meshletData->visible[i + bit] = (unsigned char)((mask >> bit) & 1);
+    }
+#elif defined(R3D_SIMD_SSE)
+    // 4 meshlets per iteration, the cones are only tested when one of them is in the frustum
+    for (; i + 4 <= last; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(meshletData->centerX + i);
+        __m128 y = _mm_loadu_ps(meshletData->centerY + i);
+        __m128 z = _mm_loadu_ps(meshletData->centerZ + i);
+        __m128 radius = _mm_loadu_ps(meshletData->radius + i);
+        __m128 reach = _mm_sub_ps(_mm_setzero_ps(), radius);
 
-#ifndef R3D_CUSTOM_ALLOCATORS
-#include <stdlib.h>
-#ifndef R3D_MALLOC
-#define R3D_MALLOC malloc
-#endif
-#ifndef R3D_CALLOC
-#define R3D_CALLOC calloc
-#endif
-#ifndef R3D_FREE
-#define R3D_FREE free
-#endif
+        __m128 inside = _mm_cmpeq_ps(radius, radius);
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(job->planes[p].x), x), _mm_mul_ps(_mm_set1_ps(job->planes[p].y), y)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(job->planes[p].z), z), _mm_set1_ps(job->planes[p].w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, reach));
+            if (_mm_movemask_ps(inside) == 0) break;
+        }
+
+        if (_mm_movemask_ps(inside) != 0)
+        {
+            __m128 ax = _mm_loadu_ps(meshletData->axisX + i);
+            __m128 ay = _mm_loadu_ps(meshletData->axisY + i);
+            __m128 az = _mm_loadu_ps(meshletData->axisZ + i);
+            __m128 cutoff = _mm_loadu_ps(meshletData->cutoff + i);
+            __m128 facing, limit;
+            if (job->orthographic)
+            {
+                facing = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(job->viewDirection.x), ax), _mm_mul_ps(_mm_set1_ps(job->viewDirection.y), ay)), _mm_mul_ps(_mm_set1_ps(job->viewDirection.z), az));
+                limit = cutoff;
+            }
+            else
+            {
+                __m128 dx = _mm_sub_ps(x, _mm_set1_ps(job->viewPosition.x));
+                __m128 dy = _mm_sub_ps(y, _mm_set1_ps(job->viewPosition.y));
+                __m128 dz = _mm_sub_ps(z, _mm_set1_ps(job->viewPosition.z));
+                __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+                facing = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, ax), _mm_mul_ps(dy, ay)), _mm_mul_ps(dz, az));
+                limit = _mm_add_ps(_mm_mul_ps(cutoff, length), radius);
+            }
+            inside = _mm_and_ps(inside, _mm_cmplt_ps(facing, limit));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (int bit = 0; bit < 4; bit++) meshletData->visible[i + bit] = (unsigned char)((mask >> bit) & 1);
+    }
 #endif
 
-// GBuffer implementation based on @TheLumaio
-// GBuffer stores multiple render targets for a single render pass
-typedef struct GBuffer {
-    unsigned int id;
-    int width;
-    int height;
-    Texture color;
-    Texture normal;
-    Texture position;
-    Texture depth;
-} GBuffer;
+    for (; i < last; i++) meshletData->visible[i] = IsMeshletVisible(job, meshletData, i)? 1 : 0;
+}
 
-R3DDEF GBuffer LoadGBuffer(int width, int height);                // Loads a new GBuffer with given screen constraints
-R3DDEF void UnloadGBuffer(GBuffer gbuffer);                       // Unload an existing GBuffer
-R3DDEF void BeginDeferredMode(GBuffer gbuffer);                   // Begin drawing in Deferred mode (using GBuffer) NOTE: Should be called after BeginDrawing, before BeginMode3D
-R3DDEF void EndDeferredMode();                                    // End drawing of Deferred mode
-R3DDEF void SetDeferredModeShaderTexture(Texture texture, int i); // Sets and binds a texture to active in GL context
+R3DDEF int CullMeshlets(R3DMeshlets* meshlets, GBuffer gbuffer, Camera camera, Matrix transform)
+{
+    MeshletData* data = (MeshletData*)meshlets->data;
+    if (data == NULL) return 0;
 
-#if defined(R3D_SKELETAL_ANIMATION_SUPPORT)
-typedef struct SkeletalBone {
-    unsigned int id;       // id correlates directly to Raylib's BoneInfo id
-    Matrix offsetMatrix;   // transforms local spaced vertices into bone space (skeleton)
-    Matrix finalTransform; // Combination of the inverse matrix, offset matrix and global transform
-} SkeletalBone;
+    // Tested in mesh space: the planes come from the full transform, and facing does not change with an affine transform
+    MeshletJob job = { 0 };
+    job.meshlets = meshlets;
+    GetFrustumPlanes(MatrixMultiply(transform, GetDeferredModeViewProjection(gbuffer, camera)), job.planes);
+    Matrix inverse = MatrixInvert(transform);
+    job.viewPosition = Vector3Transform(camera.position, inverse);
+    job.viewDirection = Vector3Normalize(Vector3Subtract(Vector3Transform(camera.target, inverse), job.viewPosition));
+    job.orthographic = (camera.projection == CAMERA_ORTHOGRAPHIC);
 
-typedef struct SkeletalAnimationChannel {
-    char* name;            // name of this bone... NOTE: Could this changed to the id?
-    Transform* transforms; // each transform represents this bone's position, rotation, and scale 
-    unsigned int transformsAmount;
-} SkeletalAnimationChannel;
+    ParallelFor((meshlets->count + MESHLET_JOB_SIZE - 1)/MESHLET_JOB_SIZE, CullMeshletRange, &job);
 
-typedef struct SkeletalAnimation {
-    float duration;                      // length in ticks
-    float ticksPerSecond;                // e.g 100 duration (ticks) at 25 ticks per second would give us a ~4 second animation
-    unsigned int channelsAmount;
-    SkeletalAnimationChannel* channels;  // these are the bones (skeleton) for an animation.. TODO: Channels should be replaced with a HashMap<channelName, channel> for 0(1) lookup.. must find c lib for such
-} SkeletalAnimation;
+    // Meshlets follow each other in the index buffer, runs of visible ones are drawn as one range
+    int visibleCount = 0;
+    int visibleTriangles = 0;
+    int drawCount = 0;
+    int end = -1;
+    for (int i = 0; i < meshlets->count; i++)
+    {
+        if (!data->visible[i]) continue;
 
-typedef struct Skeleton {
-    unsigned int bonesCount;
-    SkeletalBone* bones;
-} Skeleton;
+        if (data->firstIndex[i] == end) data->drawCounts[drawCount - 1] += data->indexCount[i];
+        else
+        {
+            data->drawCounts[drawCount] = data->indexCount[i];
+            data->drawOffsets[drawCount] = (const void*)(data->firstIndex[i]*sizeof(unsigned short));
+            drawCount++;
+        }
+        end = data->firstIndex[i] + data->indexCount[i];
+        visibleCount++;
+        visibleTriangles += data->indexCount[i]/3;
+    }
 
-typedef struct AnimatedModel {
-    Model model;
-    Skeleton skeleton;
-    SkeletalAnimation* animations;
-    unsigned int animationsCount;
-} AnimatedModel;
+    meshlets->visibleCount = visibleCount;
+    meshlets->visibleTriangles = visibleTriangles;
+    meshlets->drawCount = drawCount;
+    return visibleCount;
+}
 
-R3DDEF AnimatedModel LoadAnimatedModel(const char* filename); // Load from file, uses raylib for (LoadModel)
-#endif   
+R3DDEF void DrawMeshletsDeferred(Mesh mesh, R3DMeshlets meshlets, Material material, Matrix transform)
+{
+    MeshletData* data = (MeshletData*)meshlets.data;
+    if (data == NULL)
+    {
+        DrawMesh(mesh, material, transform);
+        return;
+    }
+    if (meshlets.drawCount == 0) return;
 
-#if defined(R3D_ASSIMP_SUPPORT)
-R3DDEF Model LoadModelAdvanced(const char* filename); // Loads a model from ASSIMP (External Dependency)
-R3DDEF void UnloadModelAdvanced(Model model);         // Unload a model.. currently same as UnloadModel
-#if defined(R3D_SKELETAL_ANIMATION_SUPPORT)
-R3DDEF AnimatedModel LoadAnimatedModelAdvanced(const char* filename); // Load from file
-#endif
-#endif                                                // R3D_ASSIMP_SUPPORT
+    rlDrawRenderBatchActive();
+    BindMeshMaterial(material);
 
-#endif // R3D_H
+    SetMeshDrawMatrices(material.shader, transform);
 
-#if defined(R3D_IMPLEMENTATION)
-#include <rlgl.h>
+    glBindVertexArray(mesh.vaoId);
+    glMultiDrawElements(GL_TRIANGLES, data->drawCounts, GL_UNSIGNED_SHORT, data->drawOffsets, meshlets.drawCount);
+    glBindVertexArray(0);
 
-#if !defined(R3D_GLAD)
-//#define GLAD_IMPLEMENTATION
-#include "glad.h"
-#endif
+    UnbindMeshMaterial(material);
+    glUseProgram(0);
+}
+#pragma endregion
 
-#pragma region GBUFFER
-R3DDEF GBuffer LoadGBuffer(int width, int height)
+#pragma region OPTIMIZATION
+#define OPTIMIZE_OVERDRAW_THRESHOLD 1.05f   // Cache miss ratio a cluster may reach over the one of its cache ordered run, more clusters sort better
+#define OPTIMIZE_OVERDRAW_SIZE 256          // Resolution of the views GetMeshStats() rasterizes
+
+typedef struct OptimizeCluster {
+    int first;                       // First triangle, in the cache order
+    int count;
+    float occlusion;                 // Centroid distance from the mesh centroid along the cluster normal, outer clusters hide the inner ones
+} OptimizeCluster;
+
+// FIFO post-transform cache, a vertex hits while fewer than MESH_OPTIMIZE_CACHE_SIZE misses followed its own.
+// Moving the time past the cache size flushes it
+static int GetVertexCacheMiss(int vertex, unsigned int* timestamps, unsigned int* time)
 {
-    GBuffer gbuffer;
-    gbuffer.id = 0;
-    gbuffer.width = width;
-    gbuffer.height = height;
+    if (*time - timestamps[vertex] <= MESH_OPTIMIZE_CACHE_SIZE) return 0;
 
-    gbuffer.color.id = 0;
-    gbuffer.color.width = width;
-    gbuffer.color.height = height;
-    gbuffer.color.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
-    gbuffer.color.mipmaps = 0;
+    timestamps[vertex] = (*time)++;
+    return 1;
+}
 
-    gbuffer.normal.id = 0;
-    gbuffer.normal.width = width;
-    gbuffer.normal.height = height;
-    gbuffer.normal.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
-    gbuffer.normal.mipmaps = 0;
+// Tipsify (Sander, Nehab and Barczak 2007): triangles are emitted in fans around a vertex, the next one being the oldest
+// candidate of the fan still cached once its own triangles are drawn, else the last vertex emitted with triangles left
+static void OptimizeVertexCache(unsigned short* indices, int triangleCount, int vertexCount)
+{
+    int indexCount = triangleCount*3;
+    int* live = (int*)R3D_CALLOC(vertexCount, sizeof(int));
+    int* firstTriangle = (int*)R3D_CALLOC(vertexCount + 1, sizeof(int));
+    int* vertexTriangles = (int*)R3D_MALLOC(indexCount*sizeof(int));
+    for (int i = 0; i < indexCount; i++) live[indices[i]]++;
+    for (int i = 0; i < indexCount; i++) firstTriangle[indices[i]]++;
+    for (int v = 1; v < vertexCount; v++) firstTriangle[v] += firstTriangle[v - 1];
+    firstTriangle[vertexCount] = indexCount;
+    for (int i = 0; i < indexCount; i++) vertexTriangles[--firstTriangle[indices[i]]] = i/3;
 
-    gbuffer.position.id = 0;
-    gbuffer.position.width = width;
-    gbuffer.position.height = height;
-    gbuffer.position.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
-    gbuffer.position.mipmaps = 0;
+    unsigned int* timestamps = (unsigned int*)R3D_CALLOC(vertexCount, sizeof(unsigned int));
+    unsigned int time = MESH_OPTIMIZE_CACHE_SIZE + 1;
+    int* deadEnd = (int*)R3D_MALLOC(indexCount*sizeof(int));
+    int* candidates = (int*)R3D_MALLOC(indexCount*sizeof(int));
+    bool* emitted = (bool*)R3D_CALLOC(triangleCount, sizeof(bool));
+    unsigned short* result = (unsigned short*)R3D_MALLOC(indexCount*sizeof(unsigned short));
 
-    glGenFramebuffers(1, &gbuffer.id);
-    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.id);
+    int emittedCount = 0;
+    int deadEndCount = 0;
+    int cursor = 0;
+    int fan = indices[0];
+    while (fan >= 0)
+    {
+        int candidateCount = 0;
+        for (int k = firstTriangle[fan]; k < firstTriangle[fan + 1]; k++)
+        {
+            int t = vertexTriangles[k];
+            if (emitted[t]) continue;
 
-    glGenTextures(1, &gbuffer.position.id);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.position.id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_NEAREST);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gbuffer.position.id, 0);
-
-    glGenTextures(1, &gbuffer.normal.id);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.normal.id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_NEAREST);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gbuffer.normal.id, 0);
-
-    glGenTextures(1, &gbuffer.color.id);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.color.id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_NEAREST);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gbuffer.color.id, 0);
-
-    unsigned int buffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+            for (int c = 0; c < 3; c++)
+            {
+                int v = indices[t*3 + c];
+                result[emittedCount*3 + c] = (unsigned short)v;
+                deadEnd[deadEndCount++] = v;
+                candidates[candidateCount++] = v;
+                live[v]--;
+                GetVertexCacheMiss(v, timestamps, &time);
+            }
+            emitted[t] = true;
+            emittedCount++;
+        }
 
-    //TODO: Query for extensions, these must be checked to ensure the user platform supports them.. ES2 may support glDrawBuffersEXT().. WebGL may support through the ANGLE web extensions
-#if defined(GRAPHICS_API_OPENGL_ES2) // use extension where availible
-    glDrawBuffersEXT(3, buffers);
-#else //glDrawBuffers only availible on ES 3.0, GL 2, 3, 4
-    glDrawBuffers(3, buffers);
-#endif
+        // A candidate whose remaining triangles (2 misses each at most) keep it in the cache, the oldest first
+        fan = -1;
+        int bestPriority = -1;
+        for (int i = 0; i < candidateCount; i++)
+        {
+            int v = candidates[i];
+            if (live[v] <= 0) continue;
 
-    glGenTextures(1, &gbuffer.depth.id);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.depth.id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_CLAMP);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_CLAMP);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_NEAREST);
-    rlTextureParameters(RL_TEXTURE, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gbuffer.depth.id, 0);
+            int age = (int)(time - timestamps[v]);
+            int priority = (age + 2*live[v] <= MESH_OPTIMIZE_CACHE_SIZE)? age : 0;
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fan = v;
+            }
+        }
 
-    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (status != GL_FRAMEBUFFER_COMPLETE)
+        // Dead end, back to a recent vertex with triangles left, else to the next one in the vertex order
+        while ((fan < 0) && (deadEndCount > 0))
+        {
+            int v = deadEnd[--deadEndCount];
+            if (live[v] > 0) fan = v;
+        }
+        while ((fan < 0) && (cursor < vertexCount))
+        {
+            if (live[cursor] > 0) fan = cursor;
+            else cursor++;
+        }
+    }
+
+    memcpy(indices, result, indexCount*sizeof(unsigned short));
+
+    R3D_FREE(result);
+    R3D_FREE(emitted);
+    R3D_FREE(candidates);
+    R3D_FREE(deadEnd);
+    R3D_FREE(timestamps);
+    R3D_FREE(vertexTriangles);
+    R3D_FREE(firstTriangle);
+    R3D_FREE(live);
+}
+
+static int CompareOptimizeClusters(const void* left, const void* right)
+{
+    const OptimizeCluster* l = (const OptimizeCluster*)left;
+    const OptimizeCluster* r = (const OptimizeCluster*)right;
+    if (l->occlusion != r->occlusion) return (l->occlusion > r->occlusion)? -1 : 1;
+    return l->first - r->first;
+}
+
+// Splits the triangles where the cache order restarts (3 misses), then where a cluster already reaches the cache miss
+// ratio of its run (times the threshold), and draws the clusters facing out of the mesh first (Sander et al. 2007)
+static void OptimizeOverdraw(unsigned short* indices, int triangleCount, const float* vertices, int vertexCount)
+{
+    unsigned int* timestamps = (unsigned int*)R3D_CALLOC(vertexCount, sizeof(unsigned int));
+    unsigned int time = MESH_OPTIMIZE_CACHE_SIZE + 1;
+    int* runs = (int*)R3D_MALLOC((triangleCount + 1)*sizeof(int));
+    int runCount = 0;
+    for (int t = 0; t < triangleCount; t++)
     {
-        TraceLog(LOG_WARNING, "Framebuffer object could not be created...");
+        int misses = 0;
+        for (int c = 0; c < 3; c++) misses += GetVertexCacheMiss(indices[t*3 + c], timestamps, &time);
+        if ((t == 0) || (misses == 3)) runs[runCount++] = t;
+    }
+    runs[runCount] = triangleCount;
 
-        switch (status)
+    OptimizeCluster* clusters = (OptimizeCluster*)R3D_MALLOC(triangleCount*sizeof(OptimizeCluster));
+    int clusterCount = 0;
+    for (int r = 0; r < runCount; r++)
+    {
+        int start = runs[r];
+        int end = runs[r + 1];
+
+        time += MESH_OPTIMIZE_CACHE_SIZE + 1;
+        int runMisses = 0;
+        for (int i = start*3; i < end*3; i++) runMisses += GetVertexCacheMiss(indices[i], timestamps, &time);
+        float threshold = OPTIMIZE_OVERDRAW_THRESHOLD*runMisses/(end - start);
+
+        time += MESH_OPTIMIZE_CACHE_SIZE + 1;
+        int first = start;
+        int misses = 0;
+        for (int t = start; t < end; t++)
         {
-        case GL_FRAMEBUFFER_UNSUPPORTED:
-            break;
-        case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
-            TraceLog(LOG_WARNING, "Framebuffer incomplete attachment");
-            break;
-#if defined(GRAPHICS_API_OPENGL_ES2)
-        case GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS:
-            TraceLog(LOG_WARNING, "Framebuffer incomplete dimensions");
-            break;
-#endif
-        case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
-            TraceLog(LOG_WARNING, "Framebuffer incomplete missing attachment");
-            break;
+            for (int c = 0; c < 3; c++) misses += GetVertexCacheMiss(indices[t*3 + c], timestamps, &time);
+            if ((t + 1 == end) || (misses <= threshold*(t + 1 - first)))
+            {
+                clusters[clusterCount].first = first;
+                clusters[clusterCount].count = t + 1 - first;
+                clusterCount++;
+                first = t + 1;
+                misses = 0;
+                time += MESH_OPTIMIZE_CACHE_SIZE + 1;
+            }
         }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    return gbuffer;
+    // Area weighted centroids, the summed cross products of a cluster give its normal
+    Vector3* centroids = (Vector3*)R3D_MALLOC(triangleCount*sizeof(Vector3));
+    Vector3* normals = (Vector3*)R3D_MALLOC(triangleCount*sizeof(Vector3));
+    Vector3 meshCentroid = { 0 };
+    float meshArea = 0.0f;
+    for (int t = 0; t < triangleCount; t++)
+    {
+        Vector3 a = { vertices[indices[t*3]*3], vertices[indices[t*3]*3 + 1], vertices[indices[t*3]*3 + 2] };
+        Vector3 b = { vertices[indices[t*3 + 1]*3], vertices[indices[t*3 + 1]*3 + 1], vertices[indices[t*3 + 1]*3 + 2] };
+        Vector3 c = { vertices[indices[t*3 + 2]*3], vertices[indices[t*3 + 2]*3 + 1], vertices[indices[t*3 + 2]*3 + 2] };
+        normals[t] = Vector3CrossProduct(Vector3Subtract(b, a), Vector3Subtract(c, a));
+        centroids[t] = Vector3Scale(Vector3Add(Vector3Add(a, b), c), 1.0f/3.0f);
+
+        float area = Vector3Length(normals[t]);
+        meshCentroid = Vector3Add(meshCentroid, Vector3Scale(centroids[t], area));
+        meshArea += area;
+    }
+    if (meshArea > 0.0f) meshCentroid = Vector3Scale(meshCentroid, 1.0f/meshArea);
+
+    for (int i = 0; i < clusterCount; i++)
+    {
+        Vector3 centroid = { 0 };
+        Vector3 normal = { 0 };
+        float area = 0.0f;
+        for (int t = clusters[i].first; t < clusters[i].first + clusters[i].count; t++)
+        {
+            float triangleArea = Vector3Length(normals[t]);
+            centroid = Vector3Add(centroid, Vector3Scale(centroids[t], triangleArea));
+            normal = Vector3Add(normal, normals[t]);
+            area += triangleArea;
+        }
+
+        float length = Vector3Length(normal);
+        clusters[i].occlusion = 0.0f;
+        if ((area > 0.0f) && (length > 0.0f)) clusters[i].occlusion = Vector3DotProduct(Vector3Subtract(Vector3Scale(centroid, 1.0f/area), meshCentroid), normal)/length;
+    }
+
+    qsort(clusters, clusterCount, sizeof(OptimizeCluster), CompareOptimizeClusters);
+
+    unsigned short* result = (unsigned short*)R3D_MALLOC(triangleCount*3*sizeof(unsigned short));
+    int offset = 0;
+    for (int i = 0; i < clusterCount; i++)
+    {
+        memcpy(result + offset, indices + clusters[i].first*3, clusters[i].count*3*sizeof(unsigned short));
+        offset += clusters[i].count*3;
+    }
+    memcpy(indices, result, triangleCount*3*sizeof(unsigned short));
+
+    R3D_FREE(result);
+    R3D_FREE(normals);
+    R3D_FREE(centroids);
+    R3D_FREE(clusters);
+    R3D_FREE(runs);
+    R3D_FREE(timestamps);
 }
 
-R3DDEF void UnloadGBuffer(GBuffer gbuffer)
+// Vertices renumbered by first use, the unused ones kept at the end
+static void OptimizeVertexFetch(Mesh* mesh)
 {
-    rlUnloadFramebuffer(gbuffer.id);
-    rlUnloadTexture(gbuffer.color.id);
-    rlUnloadTexture(gbuffer.normal.id);
-    rlUnloadTexture(gbuffer.position.id);
+    int* remap = (int*)R3D_MALLOC(mesh->vertexCount*sizeof(int));
+    memset(remap, -1, mesh->vertexCount*sizeof(int));
+
+    int next = 0;
+    for (int i = 0; i < mesh->triangleCount*3; i++)
+    {
+        int v = mesh->indices[i];
+        if (remap[v] < 0) remap[v] = next++;
+        mesh->indices[i] = (unsigned short)remap[v];
+    }
+    for (int v = 0; v < mesh->vertexCount; v++)
+    {
+        if (remap[v] < 0) remap[v] = next++;
+    }
+
+    RemapLodVertices(mesh, remap, mesh->vertexCount);
+    R3D_FREE(remap);
 }
 
-R3DDEF void BeginDeferredMode(GBuffer gbuffer)
+R3DDEF bool OptimizeMesh(Mesh* mesh, unsigned int flags)
 {
-    rlDrawRenderBatchActive();
-    rlEnableFramebuffer(gbuffer.id);
-    rlClearScreenBuffers();
+    if ((mesh->vertices == NULL) || (mesh->triangleCount <= 0))
+    {
+        TraceLog(LOG_WARNING, "OPTIMIZE: Mesh without triangles, left as is");
+        return false;
+    }
 
-    rlViewport(0, 0, gbuffer.width, gbuffer.height);
+    // Levels and meshlets keep index ranges the reordering would break
+    if ((FindMeshLods(*mesh) != NULL) || (GetMeshMeshlets(*mesh) != NULL))
+    {
+        TraceLog(LOG_WARNING, "OPTIMIZE: Mesh with detail levels or meshlets, it must be optimized before generating them");
+        return false;
+    }
 
-    rlMatrixMode(RL_PROJECTION);
-    rlLoadIdentity();
+    Mesh original = *mesh;           // Vertex array and vertices the stored bounds are found by
+    bool welded = false;
+    if (!WeldLodMesh(mesh, &welded))
+    {
+        TraceLog(LOG_WARNING, "OPTIMIZE: Mesh with more than 65535 distinct vertices, left as is");
+        return false;
+    }
 
-    rlOrtho(0, gbuffer.width, gbuffer.height, 0, 0, 1);
+    if (flags & MESH_OPTIMIZE_VERTEX_CACHE) OptimizeVertexCache(mesh->indices, mesh->triangleCount, mesh->vertexCount);
+    if (flags & MESH_OPTIMIZE_OVERDRAW) OptimizeOverdraw(mesh->indices, mesh->triangleCount, mesh->vertices, mesh->vertexCount);
+    if (flags & MESH_OPTIMIZE_VERTEX_FETCH) OptimizeVertexFetch(mesh);
 
-    rlMatrixMode(RL_MODELVIEW);
-    rlLoadIdentity();
+    if (welded || (flags & MESH_OPTIMIZE_VERTEX_FETCH)) ReloadMesh(mesh);
+    else if ((flags != 0) && (mesh->vaoId != 0) && (mesh->vboId != NULL) && (mesh->vboId[6] != 0))
+    {
+        glBindVertexArray(mesh->vaoId);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->vboId[6]);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, mesh->triangleCount*3*sizeof(unsigned short), mesh->indices);
+        glBindVertexArray(0);
+    }
 
-    glDisable(GL_BLEND);
+    MoveMeshBounds(original, *mesh);
+
+    return true;
 }
 
-R3DDEF void EndDeferredMode()
+// Pixels shaded over pixels covered, the triangles drawn in order into orthographic depth buffers looking down both ways
+// of each axis, the mesh bounds fitted to the view
+static float GetMeshOverdraw(const Mesh* mesh)
 {
-    glEnable(GL_BLEND);
-    rlDrawRenderBatchActive();
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int v = 0; v < mesh->vertexCount; v++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            min[k] = fminf(min[k], mesh->vertices[v*3 + k]);
+            max[k] = fmaxf(max[k], mesh->vertices[v*3 + k]);
+        }
+    }
 
-    rlDisableFramebuffer();
+    const int size = OPTIMIZE_OVERDRAW_SIZE;
+    float* depth = (float*)R3D_MALLOC(size*size*sizeof(float));
+    double shaded = 0.0;
+    double covered = 0.0;
 
-    rlViewport(0, 0, GetScreenWidth(), GetScreenHeight());
+    for (int axis = 0; axis < 3; axis++)
+    {
+        // (u, v, axis) stays right handed, so the projected area has the sign of the normal along the axis
+        int u = (axis + 1)%3;
+        int w = (axis + 2)%3;
+        float extent = fmaxf(max[u] - min[u], max[w] - min[w]);
+        if (extent <= 0.0f) continue;
+        float scale = (float)(size - 1)/extent;
 
-    rlMatrixMode(RL_PROJECTION);
-    rlLoadIdentity();
+        for (int side = -1; side <= 1; side += 2)
+        {
+            for (int p = 0; p < size*size; p++) depth[p] = FLT_MAX;
 
-    rlOrtho(0, GetScreenWidth(), GetScreenHeight(), 0, 0, 1);
+            for (int t = 0; t < mesh->triangleCount; t++)
+            {
+                float x[3], y[3], z[3];
+                for (int c = 0; c < 3; c++)
+                {
+                    const float* position = mesh->vertices + GetMeshVertexIndex(mesh, t, c)*3;
+                    x[c] = (position[u] - min[u])*scale;
+                    y[c] = (position[w] - min[w])*scale;
+                    z[c] = -side*position[axis];
+                }
 
-    rlMatrixMode(RL_MODELVIEW);
-    rlLoadIdentity();
+                float area = (x[1] - x[0])*(y[2] - y[0]) - (y[1] - y[0])*(x[2] - x[0]);
+                if (side*area <= 0.0f) continue;     // Back facing or edge on
+                float sign = (area > 0.0f)? 1.0f : -1.0f;
+
+                int x0 = (int)fmaxf(floorf(fminf(x[0], fminf(x[1], x[2]))), 0.0f);
+                int x1 = (int)fminf(ceilf(fmaxf(x[0], fmaxf(x[1], x[2]))), (float)(size - 1));
+                int y0 = (int)fmaxf(floorf(fminf(y[0], fminf(y[1], y[2]))), 0.0f);
+                int y1 = (int)fminf(ceilf(fmaxf(y[0], fmaxf(y[1], y[2]))), (float)(size - 1));
+
+                for (int py = y0; py <= y1; py++)
+                {
+                    for (int px = x0; px <= x1; px++)
+                    {
+                        float cx = px + 0.5f;
+                        float cy = py + 0.5f;
+                        float e0 = sign*((x[2] - x[1])*(cy - y[1]) - (y[2] - y[1])*(cx - x[1]));
+                        float e1 = sign*((x[0] - x[2])*(cy - y[2]) - (y[0] - y[2])*(cx - x[2]));
+                        float e2 = sign*((x[1] - x[0])*(cy - y[0]) - (y[1] - y[0])*(cx - x[0]));
+                        if ((e0 < 0.0f) || (e1 < 0.0f) || (e2 < 0.0f)) continue;
+
+                        float d = (e0*z[0] + e1*z[1] + e2*z[2])/(sign*area);
+                        if (d >= depth[py*size + px]) continue;
+
+                        depth[py*size + px] = d;
+                        shaded += 1.0;
+                    }
+                }
+            }
+
+            for (int p = 0; p < size*size; p++) covered += (depth[p] < FLT_MAX)? 1.0 : 0.0;
+        }
+    }
+
+    R3D_FREE(depth);
+    return (covered > 0.0)? (float)(shaded/covered) : 0.0f;
 }
 
-R3DDEF void SetDeferredModeShaderTexture(Texture texture, int i)
+R3DDEF R3DMeshStats GetMeshStats(Mesh mesh)
 {
-    glActiveTexture(GL_TEXTURE0 + i);
-    glBindTexture(GL_TEXTURE_2D, texture.id);
+    R3DMeshStats stats = { 0 };
+    if ((mesh.vertices == NULL) || (mesh.triangleCount <= 0)) return stats;
+
+    unsigned int* timestamps = (unsigned int*)R3D_CALLOC(mesh.vertexCount, sizeof(unsigned int));
+    unsigned int time = MESH_OPTIMIZE_CACHE_SIZE + 1;
+    int misses = 0;
+    for (int i = 0; i < mesh.triangleCount*3; i++) misses += GetVertexCacheMiss(GetMeshVertexIndex(&mesh, i/3, i%3), timestamps, &time);
+    R3D_FREE(timestamps);
+
+    stats.acmr = (float)misses/mesh.triangleCount;
+    stats.atvr = (float)misses/mesh.vertexCount;
+    stats.overdraw = GetMeshOverdraw(&mesh);
+    return stats;
 }
 #pragma endregion
 
@@ -414,6 +9862,12 @@ static Vector3 ConvertAIVector3D(aiVector3D vert)
 }
 
 R3DDEF Model LoadModelAdvanced(const char* filename)
+{
+    R3DImportSettings settings = { 0 };
+    return LoadModelAdvancedEx(filename, settings);
+}
+
+R3DDEF Model LoadModelAdvancedEx(const char* filename, R3DImportSettings settings)
 {
     Model model = { 0 };
     const struct aiScene* aiModel = aiImportFile(filename, aiProcess_Triangulate);
@@ -587,17 +10041,28 @@ R3DDEF Model LoadModelAdvanced(const char* filename)
 
     for (int i = 0; i < model.meshCount; i++)
     {
-        UploadMesh(&model.meshes[i], false);
+        // GenMeshLods() and LoadMeshlets() weld the vertices and upload the mesh, with every level in its index buffer.
+        // The optimization goes first, the levels keep the triangle order of the mesh
+        Mesh* mesh = &model.meshes[i];
+        if (settings.optimizeFlags != 0)
+        {
+            R3DMeshStats before = GetMeshStats(*mesh);
+            if (OptimizeMesh(mesh, settings.optimizeFlags))
+            {
+                R3DMeshStats after = GetMeshStats(*mesh);
+                TraceLog(LOG_INFO, "OPTIMIZE: [%s] Mesh %i optimized, ACMR %.3f -> %.3f, overdraw %.3f -> %.3f", filename, i, before.acmr, after.acmr, before.overdraw, after.overdraw);
+            }
+        }
+        if (settings.lodCount > 1) GenMeshLods(mesh, settings.lodCount, settings.lodReduction, settings.lodMaxError);
+        if ((settings.meshletMinTriangles > 0) && (mesh->triangleCount >= settings.meshletMinTriangles)) StoreMeshMeshlets(*mesh, LoadMeshlets(mesh));
+        if (mesh->vaoId == 0) UploadMesh(mesh, false);
+        StoreMeshBounds(*mesh, ComputeMeshBounds(*mesh));
     }
 
     aiReleaseImport(aiModel);
     return model;
 }
 
-R3DDEF void UnloadModelAdvanced(Model model)
-{
-    UnloadModel(model);
-}
 #endif // R3D_ASSIMP_SUPPORT
 #pragma endregion
 